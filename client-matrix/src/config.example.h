@@ -35,4 +35,10 @@
 // Which pair this matrix belongs to (1 or 2)
 #define PAIR_ID 1
 
+// ─── Rendering ───────────────────────────────────────────────────────────────
+// 1 = simulate the water on the matrix from drop/tint events (phones send
+//     small JSON events instead of 2 KB frames at 30 fps)
+// 0 = display the RGB565 frames streamed by the phone
+#define LOCAL_WATER_RENDER 1
+
 #endif // CONFIG_H
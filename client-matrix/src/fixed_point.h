@@ -0,0 +1,80 @@
+/**
+ * @file fixed_point.h
+ * @brief Signed Q-format fixed-point scalar (int32 storage)
+ *
+ * Drop-in for float in the templated wave kernel: + - * and comparisons,
+ * explicit conversion from/to float. Products go through int64 and are
+ * rounded to nearest; mulTowardZero() is the variant for decay factors,
+ * where round-to-nearest would leave |x| stuck at 1 LSB forever.
+ * squaredDifference() feeds the kernel's energy sums.
+ */
+
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <math.h>
+#include <stdint.h>
+
+template <int FRAC>
+struct Fixed {
+    static_assert(FRAC > 0 && FRAC < 31, "fraction bits out of range");
+    static const int32_t ONE = (int32_t)1 << FRAC;
+
+    int32_t raw;
+
+    Fixed() : raw(0) {}
+    explicit Fixed(float f) : raw((int32_t)lrintf(f * ONE)) {}
+
+    static Fixed fromRaw(int32_t r) {
+        Fixed x;
+        x.raw = r;
+        return x;
+    }
+
+    explicit operator float() const { return (float)raw / ONE; }
+
+    Fixed operator+(Fixed o) const { return fromRaw(raw + o.raw); }
+    Fixed operator-(Fixed o) const { return fromRaw(raw - o.raw); }
+    Fixed operator*(Fixed o) const {
+        return fromRaw((int32_t)(((int64_t)raw * o.raw + (ONE >> 1)) >> FRAC));
+    }
+    Fixed operator*(int k) const { return fromRaw(raw * k); }
+    Fixed& operator+=(Fixed o) { raw += o.raw; return *this; }
+
+    bool operator<(Fixed o) const { return raw < o.raw; }
+    bool operator>(Fixed o) const { return raw > o.raw; }
+};
+
+typedef Fixed<16> Q16;
+typedef Fixed<15> Q15;
+
+// ─── Decay Multiply ──────────────────────────────────────────────────────────
+
+inline float mulTowardZero(float a, float b) {
+    return a * b;
+}
+
+template <int FRAC>
+inline Fixed<FRAC> mulTowardZero(Fixed<FRAC> a, Fixed<FRAC> b) {
+    int64_t p = (int64_t)a.raw * b.raw;
+    return Fixed<FRAC>::fromRaw((int32_t)(p >= 0 ? p >> FRAC : -((-p) >> FRAC)));
+}
+
+// ─── Energy ──────────────────────────────────────────────────────────────────
+
+/** (a − b)² in double, as JS computes it from Float32Array values */
+inline double squaredDifference(float a, float b) {
+    const double d = (double)a - (double)b;
+    return d * d;
+}
+
+/** (a − b)² in LSB², |a − b| capped at 1.0: integer sums, no soft double */
+template <int FRAC>
+inline uint64_t squaredDifference(Fixed<FRAC> a, Fixed<FRAC> b) {
+    int64_t d = (int64_t)a.raw - b.raw;
+    d = d < 0 ? -d : d;
+    d = d > Fixed<FRAC>::ONE ? Fixed<FRAC>::ONE : d;
+    return (uint64_t)(d * d);
+}
+
+#endif // FIXED_POINT_H
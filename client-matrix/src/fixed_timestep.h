@@ -0,0 +1,93 @@
+/**
+ * @file fixed_timestep.h
+ * @brief Fixed-timestep accumulator: simulation ticks at a set rate,
+ *        whatever rate the render loop runs at
+ *
+ * The render loop calls due() each time it wakes and runs that many
+ * simulation ticks: elapsed time is banked and paid out in whole ticks,
+ * so the water runs at the same speed, and costs the same CPU, whether the
+ * loop wakes every 8 ms or every 33 ms. After a stall at most maxCatchUp
+ * ticks are paid out at once; the rest are dropped (and counted) instead
+ * of turning into a catch-up burst that stalls the next frame too.
+ *
+ * Same algorithm as client-web/js/timestep.js. One thread calls due();
+ * stats() may be read from another.
+ */
+
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <atomic>
+#include <stdint.h>
+
+struct FixedTimestepStats {
+    uint32_t ticks;     // ticks paid out since reset()
+    uint32_t dropped;   // ticks not run: more than maxCatchUp were due at once
+};
+
+class FixedTimestep {
+public:
+    FixedTimestep() { reset(); }
+
+    /**
+     * @param tickUs     Tick period (rate = 1e6 / tickUs Hz)
+     * @param maxCatchUp Most ticks one due() call pays out (≥ 1)
+     */
+    void configure(uint32_t tickUs, uint32_t maxCatchUp) {
+        this->tickUs = tickUs ? tickUs : 1;
+        this->maxCatchUp = maxCatchUp ? maxCatchUp : 1;
+        reset();
+    }
+
+    /** @brief Restart the clock: the next due() pays out one tick */
+    void reset() {
+        started = false;
+        banked = 0;
+        ticks.store(0, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+    }
+
+    /** @return ticks to run now, at most maxCatchUp */
+    uint32_t due(uint32_t nowUs) {
+        if (!started) {
+            // Pay one tick now and keep half a tick in hand: a loop that wakes
+            // once per tick then gets exactly one each time, not 0/2 on jitter
+            started = true;
+            banked = tickUs + tickUs / 2;
+        } else {
+            banked += nowUs - lastUs;   // modular: survives micros() wrapping
+        }
+        lastUs = nowUs;
+
+        uint64_t steps = banked / tickUs;
+        banked -= steps * tickUs;
+        if (steps > maxCatchUp) {
+            dropped.fetch_add((uint32_t)(steps - maxCatchUp), std::memory_order_relaxed);
+            steps = maxCatchUp;
+        }
+        ticks.fetch_add((uint32_t)steps, std::memory_order_relaxed);
+        return (uint32_t)steps;
+    }
+
+    uint32_t periodUs() const { return tickUs; }
+
+    FixedTimestepStats stats() const {
+        FixedTimestepStats s;
+        s.ticks = ticks.load(std::memory_order_relaxed);
+        s.dropped = dropped.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    uint32_t tickUs = 16000;
+    uint32_t maxCatchUp = 4;
+
+    bool started = false;
+    uint32_t lastUs = 0;
+    uint64_t banked = 0;   // µs not yet paid out; 64-bit so a long stall can't overflow it
+
+    std::atomic<uint32_t> ticks{0};
+    std::atomic<uint32_t> dropped{0};
+};
+
+#endif // FIXED_TIMESTEP_H
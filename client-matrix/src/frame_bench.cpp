@@ -0,0 +1,233 @@
+#include "frame_bench.h"
+#include "frame_blend.h"
+#include "frame_format.h"
+#include "frame_pipeline.h"
+#include "hal/platform.h"
+
+#include <algorithm>
+
+#if !defined(ARDUINO)
+#include <chrono>
+#endif
+
+// ─── Clock ───────────────────────────────────────────────────────────────────
+
+#if defined(ARDUINO)
+// micros() is too coarse for a 2 KB decode; use the CPU cycle counter
+static inline uint32_t benchNowNs() {
+    static const uint32_t mhz = ESP.getCpuFreqMHz();
+    return (uint32_t)((uint64_t)ESP.getCycleCount() * 1000 / mhz);
+}
+#else
+static inline uint32_t benchNowNs() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+// ─── State ───────────────────────────────────────────────────────────────────
+
+static const char* const STAGE_NAMES[BENCH_STAGE_COUNT] = {
+    "decodeRGB565Shift",
+    "decodeRGB565Lut",
+    "decodePalette565",
+    "blendRGB24",
+    "ingest memcpy",
+    "swapBuffers",
+    "displayFrame",
+    "loop (copy)",
+    "loop (direct)",
+    "loop (decoded)",
+    "present (copy)",
+    "present (decoded)",
+};
+
+static uint32_t samples[BENCH_MAX_SAMPLES];
+static uint8_t payload[BUFFER_SIZE] __attribute__((aligned(4)));
+static uint8_t palettePayload[PALETTE_HEADER_SIZE + 256 * 2 + NUM_LEDS];
+static rgb24 scratch[NUM_LEDS];
+static rgb24 blendFrom[NUM_LEDS];
+
+// Keeps the optimizer from dropping the convert-only stage
+static volatile uint8_t sink;
+
+// ─── Helpers ─────────────────────────────────────────────────────────────────
+
+static void fillPayload(uint32_t seed) {
+    for (uint16_t i = 0; i < BUFFER_SIZE; i++) {
+        payload[i] = (uint8_t)(i * 31 + seed * 7);
+    }
+}
+
+static void summarize(BenchStage stage, uint16_t count, BenchResult* result) {
+    std::sort(samples, samples + count);
+    result->name = STAGE_NAMES[stage];
+    result->p50Ns = samples[count / 2];
+    result->p99Ns = samples[(count * 99) / 100];
+}
+
+// ─── Benchmark ───────────────────────────────────────────────────────────────
+
+void runFrameBenchmark(MatrixDisplay* display, uint16_t iterations, BenchResult* results) {
+    uint16_t count = std::min<uint16_t>(std::max<uint16_t>(iterations, 1), BENCH_MAX_SAMPLES);
+    framePipelineBegin(display);
+
+    for (uint16_t n = 0; n < count; n++) {
+        fillPayload(n);
+        uint32_t t0 = benchNowNs();
+        decodeRGB565Shift(payload, scratch, NUM_LEDS);
+        samples[n] = benchNowNs() - t0;
+        sink = scratch[n % NUM_LEDS].red;
+    }
+    summarize(BENCH_DECODE, count, &results[BENCH_DECODE]);
+
+    for (uint16_t n = 0; n < count; n++) {
+        fillPayload(n);
+        uint32_t t0 = benchNowNs();
+        decodeRGB565Lut(payload, scratch, NUM_LEDS);
+        samples[n] = benchNowNs() - t0;
+        sink = scratch[n % NUM_LEDS].red;
+    }
+    summarize(BENCH_DECODE_LUT, count, &results[BENCH_DECODE_LUT]);
+
+    palettePayload[0] = FRAME_FORMAT_PAL565;
+    palettePayload[1] = 255;
+    for (uint16_t n = 0; n < count; n++) {
+        fillPayload(n);
+        memcpy(palettePayload + PALETTE_HEADER_SIZE, payload, 256 * 2);
+        memcpy(palettePayload + PALETTE_HEADER_SIZE + 256 * 2, payload + 256 * 2, NUM_LEDS);
+        uint32_t t0 = benchNowNs();
+        decodePalette565(palettePayload, scratch);
+        samples[n] = benchNowNs() - t0;
+        sink = scratch[n % NUM_LEDS].red;
+    }
+    summarize(BENCH_DECODE_PALETTE, count, &results[BENCH_DECODE_PALETTE]);
+
+    decodeRGB565(payload, blendFrom, NUM_LEDS);
+    for (uint16_t n = 0; n < count; n++) {
+        fillPayload(n);
+        decodeRGB565(payload, scratch, NUM_LEDS);
+        uint32_t t0 = benchNowNs();
+        blendRGB24(blendFrom, scratch, scratch, NUM_LEDS, (uint16_t)(n % BLEND_WEIGHT_MAX));
+        samples[n] = benchNowNs() - t0;
+        sink = scratch[n % NUM_LEDS].red;
+    }
+    summarize(BENCH_BLEND, count, &results[BENCH_BLEND]);
+
+    setFrameIngestMode(FRAME_INGEST_COPY);
+    for (uint16_t n = 0; n < count; n++) {
+        fillPayload(n);
+        uint32_t t0 = benchNowNs();
+        receiveFrame(payload, BUFFER_SIZE);
+        samples[n] = benchNowNs() - t0;
+    }
+    presentPendingFrame();
+    summarize(BENCH_INGEST, count, &results[BENCH_INGEST]);
+
+    for (uint16_t n = 0; n < count; n++) {
+        uint32_t t0 = benchNowNs();
+        display->swapBuffers(false);
+        samples[n] = benchNowNs() - t0;
+    }
+    summarize(BENCH_SWAP, count, &results[BENCH_SWAP]);
+
+    for (uint16_t n = 0; n < count; n++) {
+        fillPayload(n);
+        uint32_t t0 = benchNowNs();
+        displayFrame(payload, BUFFER_SIZE);
+        samples[n] = benchNowNs() - t0;
+    }
+    summarize(BENCH_DISPLAY_FRAME, count, &results[BENCH_DISPLAY_FRAME]);
+
+    // Per-frame loop cost (receive + present) in each ingest mode
+    const FrameIngestMode modes[] = { FRAME_INGEST_COPY, FRAME_INGEST_DIRECT, FRAME_INGEST_DECODED };
+    const BenchStage stages[] = { BENCH_LOOP_COPY, BENCH_LOOP_DIRECT, BENCH_LOOP_DECODED };
+    for (uint8_t m = 0; m < 3; m++) {
+        setFrameIngestMode(modes[m]);
+        for (uint16_t n = 0; n < count; n++) {
+            fillPayload(n);
+            uint32_t t0 = benchNowNs();
+            receiveFrame(payload, BUFFER_SIZE);
+            presentPendingFrame();
+            samples[n] = benchNowNs() - t0;
+        }
+        summarize(stages[m], count, &results[stages[m]]);
+    }
+
+    // What's left on the presenting task when receive runs elsewhere
+    const FrameIngestMode splitModes[] = { FRAME_INGEST_COPY, FRAME_INGEST_DECODED };
+    const BenchStage presentStages[] = { BENCH_PRESENT_COPY, BENCH_PRESENT_DECODED };
+    for (uint8_t m = 0; m < 2; m++) {
+        setFrameIngestMode(splitModes[m]);
+        for (uint16_t n = 0; n < count; n++) {
+            fillPayload(n);
+            receiveFrame(payload, BUFFER_SIZE);
+            uint32_t t0 = benchNowNs();
+            presentPendingFrame();
+            samples[n] = benchNowNs() - t0;
+        }
+        summarize(presentStages[m], count, &results[presentStages[m]]);
+    }
+    setFrameIngestMode(FRAME_INGEST_DEFAULT);
+}
+
+// Interpolation: a blend + swap every refresh, a decode every release
+static double interpolationRefreshNs(const BenchResult* results) {
+    return (double)results[BENCH_BLEND].p50Ns + results[BENCH_SWAP].p50Ns + results[BENCH_DECODE].p50Ns;
+}
+
+void printFrameBenchmark(const BenchResult* results) {
+    Serial.printf("%-18s %10s %10s %8s %10s\n", "stage", "p50 ns", "p99 ns", "ns/px", "frames/s");
+    for (uint8_t s = 0; s < BENCH_STAGE_COUNT; s++) {
+        const BenchResult& r = results[s];
+        Serial.printf("%-18s %10u %10u %8.2f %10.0f\n",
+            r.name, (unsigned)r.p50Ns, (unsigned)r.p99Ns,
+            (double)r.p50Ns / NUM_LEDS,
+            r.p50Ns ? 1e9 / r.p50Ns : 0.0);
+    }
+    if (results[BENCH_DECODE_LUT].p50Ns) {
+        Serial.printf("decodeRGB565Lut: %.2fx the speed of decodeRGB565Shift (aligned input)\n",
+            (double)results[BENCH_DECODE].p50Ns / results[BENCH_DECODE_LUT].p50Ns);
+    }
+
+    const double budgetNs = 1e9 / FRAME_REFRESH_HZ;
+    const double refreshNs = interpolationRefreshNs(results);
+    Serial.printf("interpolation at %u Hz: %.0f ns worst refresh = %.1f%% of %.0f ns budget\n",
+        (unsigned)FRAME_REFRESH_HZ, refreshNs, 100.0 * refreshNs / budgetNs, budgetNs);
+}
+
+uint8_t checkFrameBenchmark(const BenchResult* results, const uint32_t* baselineNs, uint8_t maxRegressionPct) {
+    uint8_t regressed = 0;
+    for (uint8_t s = 0; s < BENCH_STAGE_COUNT; s++) {
+        if (baselineNs[s] == 0) {
+            continue;
+        }
+        uint64_t limit = (uint64_t)baselineNs[s] * (100 + maxRegressionPct) / 100;
+        limit = std::max<uint64_t>(limit, (uint64_t)baselineNs[s] + BENCH_MIN_SLACK_NS);
+        if (results[s].p50Ns > limit) {
+            Serial.printf("REGRESSION %s: p50 %u ns > %u ns (baseline %u ns +%u%%)\n",
+                results[s].name, (unsigned)results[s].p50Ns, (unsigned)limit,
+                (unsigned)baselineNs[s], maxRegressionPct);
+            regressed++;
+        }
+    }
+    return regressed;
+}
+
+uint8_t checkFrameBudget(const BenchResult* results) {
+    const uint32_t budgetNs = 1000000000UL / FRAME_REFRESH_HZ;
+    uint8_t over = 0;
+    for (uint8_t s = 0; s < BENCH_STAGE_COUNT; s++) {
+        if (results[s].p99Ns > budgetNs) {
+            Serial.printf("OVER BUDGET %s: p99 %u ns > %u ns refresh\n",
+                results[s].name, (unsigned)results[s].p99Ns, (unsigned)budgetNs);
+            over++;
+        }
+    }
+    if (interpolationRefreshNs(results) > budgetNs) {
+        Serial.printf("OVER BUDGET interpolation: %.0f ns > %u ns refresh\n",
+            interpolationRefreshNs(results), (unsigned)budgetNs);
+        over++;
+    }
+    return over;
+}
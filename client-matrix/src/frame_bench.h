@@ -0,0 +1,70 @@
+/**
+ * @file frame_bench.h
+ * @brief Microbenchmarks for the RGB565 decode and present path
+ *
+ * Times each stage of the frame pipeline on whatever MatrixDisplay it is
+ * given, so the same numbers come out of the host build and of the board
+ * (over serial, in env:esp32dev_bench).
+ */
+
+#ifndef FRAME_BENCH_H
+#define FRAME_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/display.h"
+
+#define BENCH_MAX_SAMPLES 1024
+#define BENCH_MIN_SLACK_NS 100  // absolute headroom so sub-µs stages don't flap
+
+struct BenchResult {
+    const char* name;
+    uint32_t p50Ns;  // per frame
+    uint32_t p99Ns;  // per frame
+};
+
+enum BenchStage {
+    BENCH_DECODE,         // decodeRGB565Shift() (the pipeline's decoder), no present
+    BENCH_DECODE_LUT,     // decodeRGB565Lut() on the same aligned payload, no present
+    BENCH_DECODE_PALETTE, // decodePalette565(), 256 entries, no present
+    BENCH_BLEND,          // blendRGB24() over one frame (interpolation, per refresh)
+    BENCH_INGEST,         // receiveFrame(): size check + memcpy into frameBuf
+    BENCH_SWAP,           // swapBuffers(false) alone
+    BENCH_DISPLAY_FRAME,  // displayFrame(): decode + swap
+    BENCH_LOOP_COPY,      // receiveFrame() + presentPendingFrame(), FRAME_INGEST_COPY
+    BENCH_LOOP_DIRECT,    // receiveFrame() + presentPendingFrame(), FRAME_INGEST_DIRECT
+    BENCH_LOOP_DECODED,   // receiveFrame() + presentPendingFrame(), FRAME_INGEST_DECODED
+    BENCH_PRESENT_COPY,   // presentPendingFrame() alone (the render task's share), FRAME_INGEST_COPY
+    BENCH_PRESENT_DECODED, // presentPendingFrame() alone, FRAME_INGEST_DECODED
+    BENCH_STAGE_COUNT
+};
+
+/**
+ * @brief Run every stage `iterations` times (capped at BENCH_MAX_SAMPLES)
+ * @param results Filled with BENCH_STAGE_COUNT entries, indexed by BenchStage
+ */
+void runFrameBenchmark(MatrixDisplay* display, uint16_t iterations, BenchResult* results);
+
+/**
+ * @brief Print results as a table (ns/frame, ns/pixel, frames/s), then
+ *        the interpolating render loop's share of a FRAME_REFRESH_HZ refresh
+ */
+void printFrameBenchmark(const BenchResult* results);
+
+/**
+ * @brief Compare p50 against a baseline
+ * @param baselineNs p50 per stage, indexed by BenchStage (0 = no baseline)
+ * @param maxRegressionPct Allowed slowdown before a stage counts as regressed
+ * @return Number of regressed stages (0 = pass)
+ */
+uint8_t checkFrameBenchmark(const BenchResult* results, const uint32_t* baselineNs, uint8_t maxRegressionPct);
+
+/**
+ * @brief Check every stage's p99, and the interpolating refresh, against
+ *        one FRAME_REFRESH_HZ refresh — no baseline needed
+ * @return Number of checks over budget (0 = pass)
+ */
+uint8_t checkFrameBudget(const BenchResult* results);
+
+#endif // FRAME_BENCH_H
@@ -0,0 +1,35 @@
+#include "frame_blend.h"
+
+#include <string.h>
+
+static_assert(sizeof(rgb24) == 3, "blendRGB24 treats frames as packed bytes");
+
+// ─── Blend ───────────────────────────────────────────────────────────────────
+
+static inline uint32_t blendWord(uint32_t a, uint32_t b, uint32_t wa, uint32_t wb) {
+    // Bytes 0 and 2, then bytes 1 and 3, each in a 16-bit lane
+    const uint32_t even = (((a & 0x00FF00FF) * wa + (b & 0x00FF00FF) * wb) >> 8) & 0x00FF00FF;
+    const uint32_t odd  = (((a >> 8) & 0x00FF00FF) * wa + ((b >> 8) & 0x00FF00FF) * wb) & 0xFF00FF00;
+    return even | odd;
+}
+
+void blendRGB24(const rgb24* a, const rgb24* b, rgb24* out, uint16_t pixels, uint16_t weight) {
+    const uint8_t* pa = (const uint8_t*)a;
+    const uint8_t* pb = (const uint8_t*)b;
+    uint8_t* po = (uint8_t*)out;
+    const uint32_t wb = weight > BLEND_WEIGHT_MAX ? BLEND_WEIGHT_MAX : weight;
+    const uint32_t wa = BLEND_WEIGHT_MAX - wb;
+    const size_t bytes = (size_t)pixels * sizeof(rgb24);
+
+    size_t i = 0;
+    for (; i + 4 <= bytes; i += 4) {
+        uint32_t x, y;
+        memcpy(&x, pa + i, sizeof(x));
+        memcpy(&y, pb + i, sizeof(y));
+        const uint32_t z = blendWord(x, y, wa, wb);
+        memcpy(po + i, &z, sizeof(z));
+    }
+    for (; i < bytes; i++) {
+        po[i] = (uint8_t)((pa[i] * wa + pb[i] * wb) >> 8);
+    }
+}
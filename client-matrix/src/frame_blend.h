@@ -0,0 +1,27 @@
+/**
+ * @file frame_blend.h
+ * @brief RGB24 cross-fade between two frames (temporal interpolation)
+ *
+ * out = (a × (256 − w) + b × w) >> 8 per channel, so w = 0 gives a and
+ * w = 256 gives b exactly. Works four channel bytes per 32-bit word, two
+ * 16-bit lanes per multiply (255 × 256 still fits a lane).
+ */
+
+#ifndef FRAME_BLEND_H
+#define FRAME_BLEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/display.h"
+
+#define BLEND_WEIGHT_MAX 256
+
+/**
+ * @brief Blend `pixels` pixels of a towards b by weight/256
+ *
+ * out may alias a or b.
+ */
+void blendRGB24(const rgb24* a, const rgb24* b, rgb24* out, uint16_t pixels, uint16_t weight);
+
+#endif // FRAME_BLEND_H
@@ -0,0 +1,136 @@
+#include "frame_format.h"
+#include "frame_pipeline.h"
+
+#include <string.h>
+
+// ─── Helpers ─────────────────────────────────────────────────────────────────
+
+static inline uint16_t tilesPerRow(uint8_t tileSize) {
+    return TOTAL_WIDTH / tileSize;
+}
+
+static inline size_t tileBytes(uint8_t tileSize) {
+    return (size_t)tileSize * tileSize * 2;
+}
+
+// ─── Tiles ───────────────────────────────────────────────────────────────────
+
+bool tileFrameValid(const uint8_t* payload, size_t length) {
+    if (length < TILE_HEADER_SIZE || payload[0] != FRAME_FORMAT_TILES565) {
+        return false;
+    }
+
+    const uint8_t tileSize = payload[1];
+    const uint8_t count = payload[2];
+    if (tileSize < TILE_SIZE_MIN || tileSize > TILE_SIZE_MAX || (tileSize & (tileSize - 1))) {
+        return false;
+    }
+
+    const uint16_t total = tilesPerRow(tileSize) * (TOTAL_HEIGHT / tileSize);
+    const size_t stride = 1 + tileBytes(tileSize);
+    if (count > total || length != TILE_HEADER_SIZE + count * stride) {
+        return false;
+    }
+
+    for (uint16_t t = 0; t < count; t++) {
+        if (payload[TILE_HEADER_SIZE + t * stride] >= total) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void applyTiles565(const uint8_t* payload, uint8_t* frame565) {
+    const uint8_t tileSize = payload[1];
+    const uint8_t count = payload[2];
+    const size_t rowBytes = (size_t)tileSize * 2;
+    const uint8_t* p = payload + TILE_HEADER_SIZE;
+
+    for (uint16_t t = 0; t < count; t++) {
+        const uint8_t index = *p++;
+        const uint16_t x0 = (index % tilesPerRow(tileSize)) * tileSize;
+        const uint16_t y0 = (index / tilesPerRow(tileSize)) * tileSize;
+        for (uint8_t row = 0; row < tileSize; row++, p += rowBytes) {
+            memcpy(frame565 + ((y0 + row) * TOTAL_WIDTH + x0) * 2, p, rowBytes);
+        }
+    }
+}
+
+void decodeTiles565(const uint8_t* payload, rgb24* frame) {
+    const uint8_t tileSize = payload[1];
+    const uint8_t count = payload[2];
+    const size_t rowBytes = (size_t)tileSize * 2;
+    const uint8_t* p = payload + TILE_HEADER_SIZE;
+
+    for (uint16_t t = 0; t < count; t++) {
+        const uint8_t index = *p++;
+        const uint16_t x0 = (index % tilesPerRow(tileSize)) * tileSize;
+        const uint16_t y0 = (index / tilesPerRow(tileSize)) * tileSize;
+        for (uint8_t row = 0; row < tileSize; row++, p += rowBytes) {
+            decodeRGB565(p, frame + (y0 + row) * TOTAL_WIDTH + x0, tileSize);
+        }
+    }
+}
+
+// ─── Palette ─────────────────────────────────────────────────────────────────
+
+static inline uint16_t paletteEntries(const uint8_t* payload) {
+    return (uint16_t)payload[1] + 1;
+}
+
+bool paletteFrameValid(const uint8_t* payload, size_t length) {
+    return length >= PALETTE_HEADER_SIZE && payload[0] == FRAME_FORMAT_PAL565 &&
+           length == (size_t)PALETTE_HEADER_SIZE + paletteEntries(payload) * 2 + NUM_LEDS;
+}
+
+void expandPalette565(const uint8_t* payload, uint8_t* frame565) {
+    const uint16_t entries = paletteEntries(payload);
+    const uint8_t* palette = payload + PALETTE_HEADER_SIZE;
+    const uint8_t* indices = palette + entries * 2;
+
+    for (uint16_t i = 0; i < NUM_LEDS; i++) {
+        const uint8_t index = indices[i];
+        if (index < entries) {
+            frame565[i * 2]     = palette[index * 2];
+            frame565[i * 2 + 1] = palette[index * 2 + 1];
+        } else {
+            frame565[i * 2] = frame565[i * 2 + 1] = 0;
+        }
+    }
+}
+
+void decodePalette565(const uint8_t* payload, rgb24* frame) {
+    // Only ever decoded by one task at a time; keep it off the task stack
+    static rgb24 palette[256];
+
+    const uint16_t entries = paletteEntries(payload);
+    decodeRGB565(payload + PALETTE_HEADER_SIZE, palette, entries);
+    for (uint16_t i = entries; i < 256; i++) {
+        palette[i] = rgb24(0, 0, 0);
+    }
+
+    const uint8_t* indices = payload + PALETTE_HEADER_SIZE + entries * 2;
+    for (uint16_t i = 0; i < NUM_LEDS; i++) {
+        frame[i] = palette[indices[i]];
+    }
+}
+
+// ─── Header ──────────────────────────────────────────────────────────────────
+
+bool parseFrameHeader(const uint8_t*& payload, size_t& length, FrameHeader* header) {
+    if (length <= FRAME_HEADER_SIZE || length == BUFFER_SIZE || payload[0] != FRAME_HEADER_V1) {
+        return false;
+    }
+
+    header->sequence = ((uint16_t)payload[1] << 8) | payload[2];
+    header->captureMs = ((uint32_t)payload[3] << 24) | ((uint32_t)payload[4] << 16) |
+                        ((uint32_t)payload[5] << 8) | payload[6];
+    payload += FRAME_HEADER_SIZE;
+    length -= FRAME_HEADER_SIZE;
+
+    if (payload[0] == FRAME_FORMAT_RAW565 && length == BUFFER_SIZE + 1) {
+        payload++;
+        length--;
+    }
+    return true;
+}
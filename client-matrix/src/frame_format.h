@@ -0,0 +1,101 @@
+/**
+ * @file frame_format.h
+ * @brief Binary frame formats on the phone → matrix WebSocket
+ *
+ * A payload of exactly BUFFER_SIZE bytes is a bare RGB565 frame (the
+ * original protocol). Any other length starts with a format byte:
+ *
+ *   FRAME_FORMAT_TILES565  [fmt][tileSize][count] + count × ([index][tile])
+ *                          Only the tiles that changed since the previous
+ *                          frame; each tile is tileSize² RGB565 pixels,
+ *                          row-major, big-endian. Tiles are indexed
+ *                          row-major over the (32 / tileSize)² grid.
+ *   FRAME_FORMAT_KEY565    [fmt] + BUFFER_SIZE bytes RGB565
+ *                          Full frame that (re)starts a delta stream.
+ *   FRAME_FORMAT_PAL565    [fmt][entries - 1] + entries × RGB565 + NUM_LEDS
+ *                          indices. Full frame, at most 256 colours; also
+ *                          (re)starts a delta stream. Indices past the
+ *                          palette show black.
+ *
+ * Encoders never emit a typed payload of exactly BUFFER_SIZE bytes; they
+ * send a keyframe instead.
+ *
+ * Any of the above may be wrapped in a versioned header:
+ *
+ *   FRAME_HEADER_V1  [0x81][sequence u16][capture ms u32] + typed payload
+ *                    Big-endian. The typed payload always starts with its
+ *                    format byte; FRAME_FORMAT_RAW565 is followed by the
+ *                    BUFFER_SIZE bytes. The sequence counts payloads sent,
+ *                    capture is the phone's clock when the image was made.
+ *                    No format makes a header payload BUFFER_SIZE long.
+ */
+
+#ifndef FRAME_FORMAT_H
+#define FRAME_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/display.h"
+
+#define FRAME_FORMAT_RAW565   0x00  // bare BUFFER_SIZE payload, no format byte
+#define FRAME_FORMAT_TILES565 0x01
+#define FRAME_FORMAT_KEY565   0x02
+#define FRAME_FORMAT_PAL565   0x03
+
+#define TILE_HEADER_SIZE 3
+#define TILE_SIZE_MIN    2   // one index byte must address every tile
+#define TILE_SIZE_MAX    32
+
+#define PALETTE_HEADER_SIZE 2
+
+#define FRAME_HEADER_V1   0x81
+#define FRAME_HEADER_SIZE 7
+
+struct FrameHeader {
+    uint16_t sequence;
+    uint32_t captureMs;
+};
+
+/**
+ * @brief Check header, tile size, every index and the total length
+ */
+bool tileFrameValid(const uint8_t* payload, size_t length);
+
+/**
+ * @brief Patch a BUFFER_SIZE RGB565 frame with the tiles of a valid delta
+ */
+void applyTiles565(const uint8_t* payload, uint8_t* frame565);
+
+/**
+ * @brief Decode only the tiles of a valid delta into an RGB24 frame
+ */
+void decodeTiles565(const uint8_t* payload, rgb24* frame);
+
+/**
+ * @brief Check header and total length of a palette frame
+ */
+bool paletteFrameValid(const uint8_t* payload, size_t length);
+
+/**
+ * @brief Expand a valid palette frame to BUFFER_SIZE bytes of RGB565
+ */
+void expandPalette565(const uint8_t* payload, uint8_t* frame565);
+
+/**
+ * @brief Decode a valid palette frame: palette once, then one lookup per pixel
+ */
+void decodePalette565(const uint8_t* payload, rgb24* frame);
+
+/**
+ * @brief Split off a v1 header
+ *
+ * On success payload/length are moved to the bare or typed payload inside,
+ * in the form the rest of this file expects (a wrapped FRAME_FORMAT_RAW565
+ * loses its format byte).
+ *
+ * @return false if the payload has no v1 header
+ */
+bool parseFrameHeader(const uint8_t*& payload, size_t& length, FrameHeader* header);
+
+#endif // FRAME_FORMAT_H
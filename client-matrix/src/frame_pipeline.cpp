@@ -0,0 +1,372 @@
+#include "frame_pipeline.h"
+#include "frame_blend.h"
+#include "frame_format.h"
+#include "hal/platform.h"
+#include "triple_buffer.h"
+
+// ─── State ───────────────────────────────────────────────────────────────────
+
+static MatrixDisplay* display = nullptr;
+
+struct RawFrame {
+    uint8_t data[BUFFER_SIZE] __attribute__((aligned(4)));
+};
+
+// FRAME_INGEST_COPY: RGB565 as received; FRAME_INGEST_DECODED: rgb24 pixels
+struct StagedFrame {
+    uint8_t data[NUM_LEDS * sizeof(rgb24)] __attribute__((aligned(4)));
+
+    rgb24* pixels() { return reinterpret_cast<rgb24*>(data); }
+    const rgb24* pixels() const { return reinterpret_cast<const rgb24*>(data); }
+};
+
+// FRAME_INGEST_COPY/DECODED: receive side writes, present side reads
+static TripleBuffer<StagedFrame> stagedFrames;
+
+// FRAME_INGEST_JITTER: receive side pushes, present side releases on a clock
+static JitterBuffer<BUFFER_SIZE, FRAME_JITTER_CAPACITY> jitterFrames;
+
+// FRAME_INGEST_COPY/JITTER/DECODED: receive-side image the tile deltas are patched into
+static RawFrame deltaCanvas;
+
+// FRAME_INGEST_DIRECT: single task, a plain flag is enough
+static bool directFramePending = false;
+static uint32_t directFramesDropped = 0;
+
+// Set by a keyframe, cleared by a bare RGB565 frame (receive side only)
+static bool deltaStream = false;
+static uint32_t rejectedFrames = 0;
+
+// Headed payloads (receive side only)
+static bool streamStarted = false;
+static uint16_t lastSequence = 0;
+static int32_t delayMin[2];       // smallest arrival - capture: this window, last window
+static uint16_t delaySamples = 0;
+static FrameStreamStats streamStats = {};
+
+enum FrameAdmission : uint8_t {
+    FRAME_ADMIT_SHOW,
+    FRAME_ADMIT_APPLY,   // stale: update the image, don't present it
+    FRAME_ADMIT_DROP,
+};
+
+// Interpolation (present side, JITTER only): shown = blend(from, to, weight)
+static bool interpolate = false;
+static bool interpPrimed = false;
+static rgb24 interpFrames[2][NUM_LEDS];
+static uint8_t interpTo = 0;
+static uint16_t interpWeight = 0;
+static uint32_t interpStartUs = 0;
+static uint32_t interpPeriodUs = 0;
+
+static FrameIngestMode ingestMode = FRAME_INGEST_DEFAULT;
+static uint32_t frameCount = 0;
+
+// ─── Helpers ─────────────────────────────────────────────────────────────────
+
+/**
+ * Strip a v1 header, if any, and apply the sequence and age checks.
+ */
+static FrameAdmission admitFrame(const uint8_t*& payload, size_t& length, uint32_t arrivalMs) {
+    FrameHeader header;
+    if (!parseFrameHeader(payload, length, &header)) {
+        return FRAME_ADMIT_SHOW;
+    }
+    streamStats.sequenced++;
+
+    const int16_t step = (int16_t)(header.sequence - lastSequence);
+    if (streamStarted && step <= 0 && step > -FRAME_REORDER_WINDOW) {
+        streamStats.reordered++;
+        return FRAME_ADMIT_DROP;
+    }
+    if (!streamStarted || step <= 0) {
+        // First payload, or far behind the last one: the phone started over
+        resetFrameStream();
+        streamStarted = true;
+    } else if (step > 1) {
+        streamStats.lost += step - 1;
+        deltaStream = false;    // what was lost may have been a delta
+    }
+    lastSequence = header.sequence;
+
+    // Includes the unknown clock offset; only differences matter
+    const int32_t delay = (int32_t)(arrivalMs - header.captureMs);
+    if (delaySamples == FRAME_AGE_WINDOW) {
+        delayMin[1] = delayMin[0];
+        delaySamples = 0;
+    }
+    if (delaySamples++ == 0 || delay < delayMin[0]) {
+        delayMin[0] = delay;
+    }
+    const int32_t fastest = delayMin[0] < delayMin[1] ? delayMin[0] : delayMin[1];
+    const uint32_t age = (uint32_t)(delay - fastest);
+
+    streamStats.lastAgeMs = age;
+    if (age > streamStats.maxAgeMs) {
+        streamStats.maxAgeMs = age;
+    }
+    if (age > FRAME_MAX_AGE_MS) {
+        streamStats.stale++;
+        return FRAME_ADMIT_APPLY;
+    }
+    return FRAME_ADMIT_SHOW;
+}
+
+/**
+ * Identify a payload's format and track the delta stream.
+ * @return FRAME_FORMAT_* or -1 if the payload must be dropped
+ */
+static int classifyFrame(const uint8_t* payload, size_t length) {
+    if (length == BUFFER_SIZE) {
+        deltaStream = false;
+        return FRAME_FORMAT_RAW565;
+    }
+    if (length == BUFFER_SIZE + 1 && payload[0] == FRAME_FORMAT_KEY565) {
+        deltaStream = true;
+        return FRAME_FORMAT_KEY565;
+    }
+    if (paletteFrameValid(payload, length)) {
+        deltaStream = true;
+        return FRAME_FORMAT_PAL565;
+    }
+    if (tileFrameValid(payload, length)) {
+        if (deltaStream) {
+            return FRAME_FORMAT_TILES565;
+        }
+        Serial.println("Tile delta without keyframe, dropped");
+    } else {
+        Serial.printf("Unknown frame: %u bytes, format 0x%02x\n",
+                      (unsigned)length, length ? payload[0] : 0);
+    }
+    rejectedFrames++;
+    return -1;
+}
+
+static void decodeFrame(int format, const uint8_t* payload, rgb24* buffer) {
+    switch (format) {
+        case FRAME_FORMAT_RAW565:
+            decodeRGB565(payload, buffer, NUM_LEDS);
+            break;
+        case FRAME_FORMAT_KEY565:
+            decodeRGB565(payload + 1, buffer, NUM_LEDS);
+            break;
+        case FRAME_FORMAT_TILES565:
+            decodeTiles565(payload, buffer);
+            break;
+        case FRAME_FORMAT_PAL565:
+            decodePalette565(payload, buffer);
+            break;
+    }
+}
+
+/**
+ * Hand a complete RGB565 image to the present side (COPY / JITTER / DECODED).
+ */
+static void stageFrame(const uint8_t* frame565, uint32_t arrivalMs) {
+    if (ingestMode == FRAME_INGEST_JITTER) {
+        jitterFrames.push(frame565, arrivalMs * 1000u);
+        return;
+    }
+    if (ingestMode == FRAME_INGEST_DECODED) {
+        decodeRGB565(frame565, stagedFrames.writeBuffer().pixels(), NUM_LEDS);
+    } else {
+        memcpy(stagedFrames.writeBuffer().data, frame565, BUFFER_SIZE);
+    }
+    stagedFrames.publish();
+}
+
+/**
+ * Swap the decoded back buffer to the panel. Full frames rewrite every
+ * pixel, so the front→back copy is only paid while deltas are patched in.
+ */
+static void presentBackBuffer(bool keepImage) {
+    display->swapBuffers(keepImage);
+    frameCount++;
+}
+
+/**
+ * Present a released frame (or nullptr) with interpolation on.
+ */
+static bool presentInterpolated(const uint8_t* frame, uint32_t nowUs) {
+    if (frame) {
+        rgb24* from = interpFrames[interpTo ^ 1];
+        if (!interpPrimed) {
+            decodeRGB565(frame, from, NUM_LEDS);
+            interpPrimed = true;
+        } else if (interpWeight < BLEND_WEIGHT_MAX) {
+            // Released early: fade on from what is on the panel now
+            blendRGB24(from, interpFrames[interpTo], from, NUM_LEDS, interpWeight);
+        } else {
+            interpTo ^= 1;
+        }
+        decodeRGB565(frame, interpFrames[interpTo], NUM_LEDS);
+        interpStartUs = nowUs;
+        interpPeriodUs = jitterFrames.stats().intervalUs;
+        interpWeight = 0;
+    } else if (!interpPrimed || interpWeight == BLEND_WEIGHT_MAX) {
+        return false;   // already showing the newest frame
+    } else {
+        const uint32_t elapsedUs = nowUs - interpStartUs;
+        interpWeight = elapsedUs >= interpPeriodUs
+            ? BLEND_WEIGHT_MAX
+            : (uint16_t)((uint64_t)elapsedUs * BLEND_WEIGHT_MAX / interpPeriodUs);
+    }
+    blendRGB24(interpFrames[interpTo ^ 1], interpFrames[interpTo], display->backBuffer(),
+               NUM_LEDS, interpWeight);
+    presentBackBuffer(false);
+    return true;
+}
+
+// ─── Pipeline ────────────────────────────────────────────────────────────────
+
+void framePipelineBegin(MatrixDisplay* target) {
+    display = target;
+}
+
+void setFrameIngestMode(FrameIngestMode mode) {
+    ingestMode = mode;
+    directFramePending = false;
+    deltaStream = false;    // wait for the next keyframe
+    stagedFrames.acquire();
+    jitterFrames.configure(FRAME_JITTER_MIN_DEPTH, FRAME_JITTER_MAX_DEPTH,
+                           FRAME_JITTER_NOMINAL_MS * 1000u, 1000000u / FRAME_REFRESH_HZ);
+    interpPrimed = false;
+}
+
+void setFrameInterpolation(bool enabled) {
+    interpolate = enabled;
+    interpPrimed = false;
+}
+
+void displayFrame(const uint8_t* data, size_t length) {
+    const FrameAdmission admission = admitFrame(data, length, millis());
+    const int format = admission == FRAME_ADMIT_DROP ? -1 : classifyFrame(data, length);
+    if (format < 0 || (admission == FRAME_ADMIT_APPLY && format == FRAME_FORMAT_RAW565)) {
+        return;
+    }
+
+    // Convert RGB565 to RGB24
+    decodeFrame(format, data, display->backBuffer());
+    if (admission == FRAME_ADMIT_SHOW) {
+        presentBackBuffer(deltaStream);
+    }
+}
+
+bool receiveFrame(const uint8_t* payload, size_t length) {
+    return receiveFrameAt(payload, length, millis());
+}
+
+bool receiveFrameAt(const uint8_t* payload, size_t length, uint32_t arrivalMs) {
+    // DECOUPLED: Stage the frame, set flag, but don't present yet.
+    const FrameAdmission admission = admitFrame(payload, length, arrivalMs);
+    const int format = admission == FRAME_ADMIT_DROP ? -1 : classifyFrame(payload, length);
+    if (format < 0) {
+        return false;
+    }
+    const bool show = admission == FRAME_ADMIT_SHOW;
+    if (!show && format == FRAME_FORMAT_RAW565) {
+        return false;   // stale, and nothing builds on it
+    }
+
+    if (ingestMode == FRAME_INGEST_DIRECT) {
+        if (show && directFramePending) {
+            directFramesDropped++;
+        }
+        decodeFrame(format, payload, display->backBuffer());
+        directFramePending |= show;
+        return show;
+    }
+
+    // COPY/JITTER/DECODED: the present side always gets a complete image,
+    // so a frame dropped on the way never takes a delta with it.
+    switch (format) {
+        case FRAME_FORMAT_RAW565:
+            stageFrame(payload, arrivalMs);
+            return true;
+        case FRAME_FORMAT_KEY565:
+            memcpy(deltaCanvas.data, payload + 1, BUFFER_SIZE);
+            break;
+        case FRAME_FORMAT_TILES565:
+            applyTiles565(payload, deltaCanvas.data);
+            break;
+        case FRAME_FORMAT_PAL565:
+            expandPalette565(payload, deltaCanvas.data);
+            break;
+    }
+    if (!show) {
+        return false;
+    }
+    stageFrame(deltaCanvas.data, arrivalMs);
+    return true;
+}
+
+void resetFrameStream() {
+    streamStarted = false;
+    deltaStream = false;
+    delayMin[1] = INT32_MAX;
+    delaySamples = 0;
+}
+
+bool presentPendingFrame() {
+    return presentPendingFrameAt(micros());
+}
+
+bool presentPendingFrameAt(uint32_t nowUs) {
+    if (ingestMode == FRAME_INGEST_JITTER) {
+        const uint8_t* frame = jitterFrames.due(nowUs);
+        if (interpolate) {
+            const bool presented = presentInterpolated(frame, nowUs);
+            if (frame) {
+                jitterFrames.consumed();
+            }
+            return presented;
+        }
+        if (!frame) {
+            return false;
+        }
+        decodeRGB565(frame, display->backBuffer(), NUM_LEDS);
+        jitterFrames.consumed();
+        presentBackBuffer(false);
+        return true;
+    }
+
+    if (ingestMode == FRAME_INGEST_DIRECT) {
+        if (!directFramePending) {
+            return false;
+        }
+        directFramePending = false;
+        presentBackBuffer(deltaStream);
+        return true;
+    }
+
+    if (!stagedFrames.acquire()) {
+        return false;
+    }
+    if (ingestMode == FRAME_INGEST_DECODED) {
+        memcpy(display->backBuffer(), stagedFrames.readBuffer().pixels(), NUM_LEDS * sizeof(rgb24));
+    } else {
+        decodeRGB565(stagedFrames.readBuffer().data, display->backBuffer(), NUM_LEDS);
+    }
+    presentBackBuffer(false);
+    return true;
+}
+
+uint32_t getFrameCount() {
+    return frameCount;
+}
+
+uint32_t getDroppedFrameCount() {
+    return stagedFrames.overwrittenCount() + directFramesDropped;
+}
+
+uint32_t getRejectedFrameCount() {
+    return rejectedFrames;
+}
+
+FrameStreamStats getFrameStreamStats() {
+    return streamStats;
+}
+
+JitterStats getJitterStats() {
+    return jitterFrames.stats();
+}
@@ -0,0 +1,209 @@
+/**
+ * @file frame_pipeline.h
+ * @brief RGB565 frame receive → decode → present pipeline
+ *
+ * Accepts every format in frame_format.h. Tile deltas are only applied
+ * after a keyframe or palette frame; a bare RGB565 frame ends the delta
+ * stream.
+ *
+ * Payloads with a v1 header are also checked for order and age:
+ *   - late or duplicate sequence numbers are dropped;
+ *   - a gap is counted as lost and ends the delta stream (the next
+ *     keyframe restarts it);
+ *   - a frame more than FRAME_MAX_AGE_MS older than the fastest recent
+ *     one is not shown. Keyframes, palette frames and deltas are still
+ *     applied, since the frames after them build on them.
+ * Age is measured against the smallest (arrival - capture) seen over the
+ * last FRAME_AGE_WINDOW..2×FRAME_AGE_WINDOW frames, so phone and matrix
+ * clocks need no synchronisation.
+ *
+ * Platform-independent: talks to the panel only through MatrixDisplay, so
+ * it is shared by the ESP32 firmware and the host-native build.
+ */
+
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/display.h"
+#include "jitter_buffer.h"
+#include "rgb565_decoder.h"
+
+// ─── Geometry ────────────────────────────────────────────────────────────────
+
+#define TOTAL_WIDTH   32
+#define TOTAL_HEIGHT  32
+
+const uint8_t  INCOMING_COLOR_DEPTH = 16;  // RGB565
+const uint16_t NUM_LEDS = TOTAL_WIDTH * TOTAL_HEIGHT;
+const uint16_t BUFFER_SIZE = NUM_LEDS * (INCOMING_COLOR_DEPTH / 8);
+
+// ─── Ingest Mode ─────────────────────────────────────────────────────────────
+
+/**
+ * How receiveFrame() handles a payload:
+ *
+ *   FRAME_INGEST_COPY    memcpy into a lock-free triple buffer; decode +
+ *                        swap later in presentPendingFrame(). Safe with
+ *                        receive and present on different tasks/cores.
+ *   FRAME_INGEST_DIRECT  decode straight from the payload into the display
+ *                        back buffer; presentPendingFrame() only swaps.
+ *                        Receive and present must run on the same task.
+ *   FRAME_INGEST_JITTER  like COPY, but through a jitter buffer
+ *                        (jitter_buffer.h): call presentPendingFrame() once
+ *                        per panel refresh and frames come out at a steady
+ *                        cadence instead of as they arrive. Can also
+ *                        cross-fade between frames, see
+ *                        setFrameInterpolation().
+ *   FRAME_INGEST_DECODED DIRECT across tasks: decode straight from the
+ *                        payload into the triple buffer's write slot;
+ *                        presentPendingFrame() copies the decoded slot to
+ *                        the back buffer and swaps. The RGB565 copy and the
+ *                        decode leave the presenting task, which is left
+ *                        with a memcpy: the back buffer belongs to the
+ *                        panel, so nothing can be decoded into it early.
+ *
+ * None of the modes tear. COPY, DIRECT and DECODED skip stale frames: a
+ * newer frame arriving before the present simply replaces the older one.
+ * Skipped tile deltas are still applied (to the staging canvas in COPY and
+ * DECODED mode, to the back buffer in DIRECT mode), so nothing is lost
+ * with them.
+ *
+ * DIRECT is the default: valid wherever receive and present share a task.
+ * Builds that split them pick DECODED (or JITTER) with setFrameIngestMode().
+ */
+enum FrameIngestMode : uint8_t {
+    FRAME_INGEST_COPY,
+    FRAME_INGEST_DIRECT,
+    FRAME_INGEST_JITTER,
+    FRAME_INGEST_DECODED,
+};
+
+#ifndef FRAME_INGEST_DEFAULT
+#define FRAME_INGEST_DEFAULT FRAME_INGEST_DIRECT
+#endif
+
+#ifndef FRAME_JITTER_CAPACITY
+#define FRAME_JITTER_CAPACITY 4     // frames queued (2..7); one 2 KB slot each, plus one
+#endif
+#ifndef FRAME_JITTER_MIN_DEPTH
+#define FRAME_JITTER_MIN_DEPTH 1
+#endif
+#ifndef FRAME_JITTER_MAX_DEPTH
+#define FRAME_JITTER_MAX_DEPTH 3
+#endif
+#define FRAME_JITTER_NOMINAL_MS 33  // the phone's send interval
+#ifndef FRAME_REFRESH_HZ
+#define FRAME_REFRESH_HZ 120        // how often presentPendingFrame() runs in JITTER
+#endif
+
+// ─── Stream Checks ───────────────────────────────────────────────────────────
+
+#ifndef FRAME_MAX_AGE_MS
+#define FRAME_MAX_AGE_MS 120
+#endif
+
+#define FRAME_AGE_WINDOW     64   // frames per minimum-delay window
+#define FRAME_REORDER_WINDOW 64   // older sequence numbers mean a new stream
+
+struct FrameStreamStats {
+    uint32_t sequenced;   // payloads with a v1 header
+    uint32_t lost;        // sequence numbers never received
+    uint32_t reordered;   // late or duplicate, dropped
+    uint32_t stale;       // older than FRAME_MAX_AGE_MS, not shown
+    uint32_t lastAgeMs;   // age of the latest headed payload
+    uint32_t maxAgeMs;
+};
+
+// ─── Pipeline ────────────────────────────────────────────────────────────────
+
+/**
+ * @brief Bind the pipeline to a display (call once before any frame)
+ */
+void framePipelineBegin(MatrixDisplay* display);
+
+/**
+ * @brief Switch ingest mode (drops any frame not yet presented)
+ *
+ * Call before frames start flowing, or from the presenting task.
+ */
+void setFrameIngestMode(FrameIngestMode mode);
+
+/**
+ * @brief Cross-fade between received frames (FRAME_INGEST_JITTER only)
+ *
+ * Each presentPendingFrame() shows the last two released frames blended
+ * by how far it is into the release interval, so a 30 fps stream moves
+ * at the refresh rate. Costs one release interval of latency and a
+ * blend per refresh. Call from the presenting task.
+ */
+void setFrameInterpolation(bool enabled);
+
+/**
+ * @brief Decode a frame of any format into the back buffer and present it
+ */
+void displayFrame(const uint8_t* data, size_t length);
+
+/**
+ * @brief Receive-side handler for a binary WebSocket payload
+ *
+ * Stores the payload (copied or already decoded, see FrameIngestMode);
+ * it is shown on the next presentPendingFrame().
+ *
+ * @return true if a frame is now pending
+ */
+bool receiveFrame(const uint8_t* payload, size_t length);
+
+/**
+ * @brief receiveFrame() with an explicit arrival time (replaying traces)
+ */
+bool receiveFrameAt(const uint8_t* payload, size_t length, uint32_t arrivalMs);
+
+/**
+ * @brief Forget sequence and delay history (a new phone stream begins)
+ *
+ * Call from the receiving task.
+ */
+void resetFrameStream();
+
+/**
+ * @brief Draw the latest received frame, if any (older ones are skipped);
+ *        in FRAME_INGEST_JITTER the one due at this refresh, if any
+ * @return true if a frame was presented
+ */
+bool presentPendingFrame();
+
+/**
+ * @brief presentPendingFrame() at an explicit time in µs (replaying traces)
+ */
+bool presentPendingFrameAt(uint32_t nowUs);
+
+/**
+ * @brief Number of frames presented since boot
+ */
+uint32_t getFrameCount();
+
+/**
+ * @brief Frames received but replaced by a newer one before presentation
+ */
+uint32_t getDroppedFrameCount();
+
+/**
+ * @brief Payloads rejected: unknown format, malformed, or a tile delta
+ *        with no keyframe to apply it to
+ */
+uint32_t getRejectedFrameCount();
+
+/**
+ * @brief Sequence/age counters for headed payloads since boot
+ */
+FrameStreamStats getFrameStreamStats();
+
+/**
+ * @brief Jitter buffer depth and counters (FRAME_INGEST_JITTER)
+ */
+JitterStats getJitterStats();
+
+#endif // FRAME_PIPELINE_H
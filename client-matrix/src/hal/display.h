@@ -0,0 +1,63 @@
+/**
+ * @file display.h
+ * @brief Display abstraction over the SmartMatrix background layer
+ *
+ * The frame pipeline only needs two things from the panel: a back buffer
+ * to draw RGB24 pixels into, and a way to present it. MatrixDisplay
+ * captures exactly that, so the same decode path drives the real
+ * SmartMatrix layer on the ESP32 and an in-memory surface on the host.
+ */
+
+#ifndef HAL_DISPLAY_H
+#define HAL_DISPLAY_H
+
+#if defined(ARDUINO)
+#include <SmartMatrix.h>
+#else
+#include <stdint.h>
+
+// Layout-compatible stand-in for SmartMatrix's rgb24
+struct rgb24 {
+    rgb24() : red(0), green(0), blue(0) {}
+    rgb24(uint8_t r, uint8_t g, uint8_t b) : red(r), green(g), blue(b) {}
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+#endif
+
+class MatrixDisplay {
+public:
+    virtual ~MatrixDisplay() {}
+
+    /** @brief Buffer the next frame is drawn into (never the one on screen) */
+    virtual rgb24* backBuffer() = 0;
+
+    /**
+     * @brief Present the back buffer (same contract as SMLayerBackground)
+     * @param copy Copy the new front buffer into the back buffer afterwards;
+     *             pass false when the next frame overwrites every pixel
+     */
+    virtual void swapBuffers(bool copy = true) = 0;
+};
+
+#if defined(ARDUINO)
+/**
+ * @brief Adapter for a SmartMatrix background layer
+ *
+ * Usage: static SmartMatrixDisplay<decltype(bg)> display(bg);
+ */
+template <typename Layer>
+class SmartMatrixDisplay : public MatrixDisplay {
+public:
+    explicit SmartMatrixDisplay(Layer& layer) : layer(layer) {}
+
+    rgb24* backBuffer() override { return layer.backBuffer(); }
+    void swapBuffers(bool copy = true) override { layer.swapBuffers(copy); }
+
+private:
+    Layer& layer;
+};
+#endif
+
+#endif // HAL_DISPLAY_H
@@ -0,0 +1,19 @@
+/**
+ * @file platform.h
+ * @brief Platform shim shared by the firmware and the host-native build
+ *
+ * On the ESP32 this is just <Arduino.h>. On the host it provides the few
+ * Arduino symbols the portable modules rely on (millis, micros, delay,
+ * Serial.printf) so they compile unchanged under `pio run -e native`.
+ */
+
+#ifndef HAL_PLATFORM_H
+#define HAL_PLATFORM_H
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include "native/arduino_shim.h"
+#endif
+
+#endif // HAL_PLATFORM_H
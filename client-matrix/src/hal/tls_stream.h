@@ -0,0 +1,681 @@
+/**
+ * @file tls_stream.h
+ * @brief TCP / TLS connection that survives reconnects, with TLS session
+ *        resumption
+ *
+ * One TlsStream is connected, closed and connected again for the life of
+ * the WebSocket client (ws_client.h). Its TLS context (configuration, RNG,
+ * record buffers) is set up on the first connect and kept; each handshake
+ * offers the session of the previous one, so a reconnect to the same
+ * server resumes it instead of redoing the key exchange and certificate.
+ * Sessions also go to a TlsSessionStore, which outlives the stream (NVS on
+ * the ESP32), so the first connection after a reboot resumes as well.
+ *
+ * The server's certificate isn't verified, as with the WebSocketsClient
+ * setup this replaces (no CA is configured).
+ *
+ * ESP32: mbedTLS over lwIP sockets (TLS 1.2, as in ESP-IDF 3.3).
+ * Host:  OpenSSL, capped at TLS 1.2 to behave like the board.
+ */
+
+#ifndef HAL_TLS_STREAM_H
+#define HAL_TLS_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal/platform.h"
+
+#if defined(ARDUINO)
+#include <Preferences.h>
+#include <lwip/sockets.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/platform.h>
+#include <mbedtls/ssl.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <string>
+#endif
+
+#define TLS_SESSION_MAX      1024    // serialized session, ticket included
+#define TLS_WRITE_TIMEOUT_MS 1000
+
+struct TlsSessionBlob {
+    uint16_t length;
+    uint8_t data[TLS_SESSION_MAX];
+};
+
+/**
+ * @brief Somewhere to keep the last session between streams (reboots)
+ */
+class TlsSessionStore {
+public:
+    virtual ~TlsSessionStore() {}
+
+    /** @return false if there is no session for host */
+    virtual bool load(const char* host, TlsSessionBlob& blob) = 0;
+    virtual void save(const char* host, const TlsSessionBlob& blob) = 0;
+    virtual void clear() = 0;
+};
+
+struct TlsHandshakeStats {
+    uint32_t tcpUs;     // DNS + TCP connect
+    uint32_t tlsUs;     // TLS handshake
+    bool offered;       // a session was offered
+    bool resumed;       // and the server took it
+};
+
+#if defined(ARDUINO)
+// ─── ESP32 (mbedTLS) ─────────────────────────────────────────────────────────
+
+/**
+ * @brief Sessions in NVS, namespace "tls" (one session: the one server)
+ */
+class NvsSessionStore : public TlsSessionStore {
+public:
+    bool load(const char* host, TlsSessionBlob& blob) override {
+        Preferences prefs;
+        if (!prefs.begin("tls", true)) {
+            return false;
+        }
+        const size_t length = prefs.getBytesLength("session");
+        const bool ok = prefs.getString("host", "") == host && length > 0 && length <= TLS_SESSION_MAX &&
+            prefs.getBytes("session", blob.data, length) == length;
+        blob.length = ok ? (uint16_t)length : 0;
+        prefs.end();
+        return ok;
+    }
+
+    void save(const char* host, const TlsSessionBlob& blob) override {
+        Preferences prefs;
+        prefs.begin("tls", false);
+        prefs.putString("host", host);
+        prefs.putBytes("session", blob.data, blob.length);
+        prefs.end();
+    }
+
+    void clear() override {
+        Preferences prefs;
+        prefs.begin("tls", false);
+        prefs.clear();
+        prefs.end();
+    }
+};
+
+inline TlsSessionStore* defaultTlsSessionStore() {
+    static NvsSessionStore nvs;
+    return &nvs;
+}
+
+class TlsStream {
+public:
+    TlsStream() {
+        mbedtls_net_init(&net);
+        mbedtls_ssl_init(&ssl);
+        mbedtls_ssl_config_init(&conf);
+        mbedtls_ctr_drbg_init(&drbg);
+        mbedtls_entropy_init(&entropy);
+        mbedtls_ssl_session_init(&session);
+    }
+
+    ~TlsStream() {
+        close();
+        mbedtls_ssl_session_free(&session);
+        mbedtls_ssl_free(&ssl);
+        mbedtls_ssl_config_free(&conf);
+        mbedtls_ctr_drbg_free(&drbg);
+        mbedtls_entropy_free(&entropy);
+    }
+
+    /** @brief Where sessions are kept between streams; nullptr: this stream only */
+    void setSessionStore(TlsSessionStore* sessionStore) {
+        store = sessionStore;
+        storeChecked = false;
+    }
+
+    /** @brief Connect (blocking, up to timeoutMs per read) and handshake if secure */
+    bool connect(const char* host, uint16_t port, bool secure, uint32_t timeoutMs) {
+        close();
+        stats = {};
+        char portText[6];
+        snprintf(portText, sizeof(portText), "%u", (unsigned)port);
+
+        const uint32_t tcpStart = micros();
+        int ret = mbedtls_net_connect(&net, host, portText, MBEDTLS_NET_PROTO_TCP);
+        stats.tcpUs = micros() - tcpStart;
+        if (ret != 0) {
+            Serial.printf("[TLS] TCP connect to %s:%u failed (-0x%04x)\n", host, (unsigned)port, (unsigned)-ret);
+            mbedtls_net_free(&net);
+            return false;
+        }
+        const int one = 1;
+        setsockopt(net.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        tls = secure;
+        open = true;
+        if (!secure) {
+            mbedtls_net_set_nonblock(&net);
+            return true;
+        }
+
+        if (!setup()) {
+            close();
+            return false;
+        }
+        mbedtls_ssl_session_reset(&ssl);   // same context, buffers and RNG as last time
+        mbedtls_ssl_set_hostname(&ssl, host);
+        mbedtls_ssl_conf_read_timeout(&conf, timeoutMs);
+        mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, nullptr, mbedtls_net_recv_timeout);
+
+        loadStoredSession(host);
+        if (haveSession && mbedtls_ssl_set_session(&ssl, &session) == 0) {
+            stats.offered = true;
+        }
+
+        const uint32_t tlsStart = micros();
+        while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+            if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+                Serial.printf("[TLS] Handshake failed (-0x%04x)%s\n", (unsigned)-ret,
+                    stats.offered ? ", forgetting the session" : "");
+                forgetSession();
+                close();
+                return false;
+            }
+        }
+        stats.tlsUs = micros() - tlsStart;
+        // A resumed session keeps its master secret; a new one never has the old one
+        stats.resumed = stats.offered && memcmp(ssl.session->master, session.master, sizeof(session.master)) == 0;
+        keepSession(host);
+
+        mbedtls_net_set_nonblock(&net);
+        mbedtls_ssl_set_bio(&ssl, &net, mbedtls_net_send, mbedtls_net_recv, nullptr);
+        return true;
+    }
+
+    /** @return bytes read, 0 if nothing has arrived, < 0 once closed */
+    int read(uint8_t* out, size_t capacity) {
+        if (!open) {
+            return -1;
+        }
+        const int n = tls ? mbedtls_ssl_read(&ssl, out, capacity) : mbedtls_net_recv(&net, out, capacity);
+        if (n > 0) {
+            return n;
+        }
+        if (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            return 0;
+        }
+        return -1;   // 0: EOF, close_notify or an error
+    }
+
+    /**
+     * @brief Block until read() has something to say (a decrypted record
+     *        already buffered, the socket readable, or closed), or timeoutMs
+     * @return false on timeout
+     */
+    bool waitReadable(uint32_t timeoutMs) {
+        if (!open || (tls && mbedtls_ssl_get_bytes_avail(&ssl) > 0)) {
+            return true;
+        }
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(net.fd, &readable);
+        timeval timeout = { (time_t)(timeoutMs / 1000), (suseconds_t)(timeoutMs % 1000) * 1000 };
+        return select(net.fd + 1, &readable, nullptr, nullptr, &timeout) != 0;   // an error: read() finds out
+    }
+
+    bool write(const uint8_t* data, size_t length) {
+        const uint32_t start = millis();
+        while (open && length > 0) {
+            const int n = tls ? mbedtls_ssl_write(&ssl, data, length) : mbedtls_net_send(&net, data, length);
+            if (n > 0) {
+                data += n;
+                length -= (size_t)n;
+            } else if ((n == MBEDTLS_ERR_SSL_WANT_WRITE || n == MBEDTLS_ERR_SSL_WANT_READ) &&
+                       millis() - start < TLS_WRITE_TIMEOUT_MS) {
+                delay(1);
+            } else {
+                return false;
+            }
+        }
+        return length == 0;
+    }
+
+    void close() {
+        if (!open) {
+            return;
+        }
+        if (tls) {
+            mbedtls_ssl_close_notify(&ssl);
+        }
+        mbedtls_net_free(&net);
+        open = false;
+    }
+
+    bool connected() const { return open; }
+    const TlsHandshakeStats& lastHandshake() const { return stats; }
+
+private:
+    /** @brief Once per stream: RNG, configuration, record buffers */
+    bool setup() {
+        if (ready) {
+            return true;
+        }
+        static const char PERSONALIZATION[] = "missingdrop";
+        int ret = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+            (const unsigned char*)PERSONALIZATION, sizeof(PERSONALIZATION) - 1);
+        if (ret == 0) {
+            ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                MBEDTLS_SSL_PRESET_DEFAULT);
+        }
+        if (ret == 0) {
+            mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+            mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+            ret = mbedtls_ssl_setup(&ssl, &conf);
+        }
+        if (ret != 0) {
+            Serial.printf("[TLS] Setup failed (-0x%04x)\n", (unsigned)-ret);
+            return false;
+        }
+        ready = true;
+        return true;
+    }
+
+    /** @brief After a reboot: the session the last boot saved */
+    void loadStoredSession(const char* host) {
+        if (haveSession || storeChecked || !store) {
+            return;
+        }
+        storeChecked = true;
+        if (store->load(host, saved) && deserialize(saved)) {
+            haveSession = true;
+        }
+    }
+
+    /** @brief Keep the new (or re-ticketed) session, and store it if it changed */
+    void keepSession(const char* host) {
+        mbedtls_ssl_session_free(&session);
+        mbedtls_ssl_session_init(&session);
+        haveSession = mbedtls_ssl_get_session(&ssl, &session) == 0;
+        if (!haveSession || !store) {
+            return;
+        }
+        TlsSessionBlob blob;
+        if (serialize(blob) && (blob.length != saved.length || memcmp(blob.data, saved.data, blob.length) != 0)) {
+            store->save(host, blob);
+            saved = blob;
+        }
+    }
+
+    void forgetSession() {
+        if (!stats.offered) {
+            return;
+        }
+        mbedtls_ssl_session_free(&session);
+        mbedtls_ssl_session_init(&session);
+        haveSession = false;
+        saved.length = 0;
+        if (store) {
+            store->clear();
+        }
+    }
+
+    // mbedTLS 2.16 has no session (de)serialization: the fields a client
+    // needs to resume, version byte first
+
+    bool serialize(TlsSessionBlob& blob) const {
+        size_t n = 0;
+        auto put = [&blob, &n](const void* data, size_t length) {
+            if (n + length <= TLS_SESSION_MAX) {
+                memcpy(blob.data + n, data, length);
+            }
+            n += length;
+        };
+        const uint8_t version = 1;
+        put(&version, 1);
+#if defined(MBEDTLS_HAVE_TIME)
+        put(&session.start, sizeof(session.start));
+#endif
+        put(&session.ciphersuite, sizeof(session.ciphersuite));
+        put(&session.compression, sizeof(session.compression));
+        put(&session.id_len, sizeof(session.id_len));
+        put(session.id, sizeof(session.id));
+        put(session.master, sizeof(session.master));
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+        put(&session.ticket_len, sizeof(session.ticket_len));
+        put(&session.ticket_lifetime, sizeof(session.ticket_lifetime));
+        if (session.ticket_len) {
+            put(session.ticket, session.ticket_len);
+        }
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+        put(&session.mfl_code, sizeof(session.mfl_code));
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+        put(&session.trunc_hmac, sizeof(session.trunc_hmac));
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+        put(&session.encrypt_then_mac, sizeof(session.encrypt_then_mac));
+#endif
+        blob.length = n <= TLS_SESSION_MAX ? (uint16_t)n : 0;
+        return blob.length > 0;
+    }
+
+    bool deserialize(const TlsSessionBlob& blob) {
+        size_t n = 0;
+        auto get = [&blob, &n](void* data, size_t length) {
+            if (n + length <= blob.length) {
+                memcpy(data, blob.data + n, length);
+            }
+            n += length;
+        };
+        uint8_t version = 0;
+        get(&version, 1);
+        if (version != 1) {
+            return false;
+        }
+        mbedtls_ssl_session_free(&session);
+        mbedtls_ssl_session_init(&session);
+#if defined(MBEDTLS_HAVE_TIME)
+        get(&session.start, sizeof(session.start));
+#endif
+        get(&session.ciphersuite, sizeof(session.ciphersuite));
+        get(&session.compression, sizeof(session.compression));
+        get(&session.id_len, sizeof(session.id_len));
+        get(session.id, sizeof(session.id));
+        get(session.master, sizeof(session.master));
+#if defined(MBEDTLS_SSL_SESSION_TICKETS) && defined(MBEDTLS_SSL_CLI_C)
+        size_t ticketLength = 0;
+        get(&ticketLength, sizeof(ticketLength));
+        get(&session.ticket_lifetime, sizeof(session.ticket_lifetime));
+        if (ticketLength > 0 && n + ticketLength <= blob.length) {
+            session.ticket = (unsigned char*)mbedtls_calloc(1, ticketLength);
+            if (session.ticket) {
+                get(session.ticket, ticketLength);
+                session.ticket_len = ticketLength;
+            }
+        }
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+        get(&session.mfl_code, sizeof(session.mfl_code));
+#endif
+#if defined(MBEDTLS_SSL_TRUNCATED_HMAC)
+        get(&session.trunc_hmac, sizeof(session.trunc_hmac));
+#endif
+#if defined(MBEDTLS_SSL_ENCRYPT_THEN_MAC)
+        get(&session.encrypt_then_mac, sizeof(session.encrypt_then_mac));
+#endif
+        return n == blob.length && session.id_len <= sizeof(session.id);
+    }
+
+    mbedtls_net_context net;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+    mbedtls_ssl_session session;   // offered on the next handshake
+    TlsSessionBlob saved = {};     // as last loaded from / saved to the store
+
+    TlsSessionStore* store = nullptr;
+    TlsHandshakeStats stats = {};
+    bool ready = false;
+    bool open = false;
+    bool tls = false;
+    bool haveSession = false;
+    bool storeChecked = false;
+};
+
+#else
+// ─── Host (OpenSSL) ──────────────────────────────────────────────────────────
+
+/**
+ * @brief Sessions in memory; hand it to a new stream to stand in for a reboot
+ */
+class MemorySessionStore : public TlsSessionStore {
+public:
+    bool load(const char* host, TlsSessionBlob& blob) override {
+        if (stored.length == 0 || storedHost != host) {
+            return false;
+        }
+        blob = stored;
+        return true;
+    }
+
+    void save(const char* host, const TlsSessionBlob& blob) override {
+        storedHost = host;
+        stored = blob;
+        saves++;
+    }
+
+    void clear() override { stored.length = 0; }
+
+    uint32_t saves = 0;
+
+private:
+    std::string storedHost;
+    TlsSessionBlob stored = {};
+};
+
+inline TlsSessionStore* defaultTlsSessionStore() {
+    return nullptr;
+}
+
+class TlsStream {
+public:
+    ~TlsStream() {
+        close();
+        if (session) {
+            SSL_SESSION_free(session);
+        }
+        if (ctx) {
+            SSL_CTX_free(ctx);
+        }
+    }
+
+    void setSessionStore(TlsSessionStore* sessionStore) {
+        store = sessionStore;
+        storeChecked = false;
+    }
+
+    bool connect(const char* host, uint16_t port, bool secure, uint32_t timeoutMs) {
+        close();
+        stats = {};
+
+        const uint32_t tcpStart = micros();
+        fd = tcpConnect(host, port, timeoutMs);
+        stats.tcpUs = micros() - tcpStart;
+        if (fd < 0) {
+            Serial.printf("[TLS] TCP connect to %s:%u failed\n", host, (unsigned)port);
+            return false;
+        }
+        if (!secure) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            return true;
+        }
+
+        if (!ctx) {
+            ctx = SSL_CTX_new(TLS_client_method());
+            SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+            SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+        }
+        ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, fd);
+        SSL_set_tlsext_host_name(ssl, host);
+
+        loadStoredSession(host);
+        if (session && SSL_set_session(ssl, session) == 1) {
+            stats.offered = true;
+        }
+
+        const uint32_t tlsStart = micros();
+        if (SSL_connect(ssl) != 1) {
+            Serial.printf("[TLS] Handshake failed%s\n", stats.offered ? ", forgetting the session" : "");
+            forgetSession();
+            close();
+            return false;
+        }
+        stats.tlsUs = micros() - tlsStart;
+        stats.resumed = SSL_session_reused(ssl) == 1;
+        keepSession(host);
+
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        return true;
+    }
+
+    int read(uint8_t* out, size_t capacity) {
+        if (fd < 0) {
+            return -1;
+        }
+        if (!ssl) {
+            const ssize_t n = ::recv(fd, out, capacity, 0);
+            return n > 0 ? (int)n : (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? 0 : -1;
+        }
+        const int n = SSL_read(ssl, out, (int)capacity);
+        if (n > 0) {
+            return n;
+        }
+        const int error = SSL_get_error(ssl, n);
+        return error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE ? 0 : -1;
+    }
+
+    bool waitReadable(uint32_t timeoutMs) {
+        if (fd < 0 || (ssl && SSL_pending(ssl) > 0)) {
+            return true;
+        }
+        pollfd p = { fd, POLLIN, 0 };
+        return ::poll(&p, 1, (int)timeoutMs) != 0;
+    }
+
+    bool write(const uint8_t* data, size_t length) {
+        while (fd >= 0 && length > 0) {
+            const int n = ssl ? SSL_write(ssl, data, (int)length) : (int)::send(fd, data, length, MSG_NOSIGNAL);
+            if (n > 0) {
+                data += n;
+                length -= (size_t)n;
+                continue;
+            }
+            const bool retry = ssl ? SSL_get_error(ssl, n) == SSL_ERROR_WANT_WRITE : (errno == EAGAIN || errno == EWOULDBLOCK);
+            pollfd p = { fd, POLLOUT, 0 };
+            if (!retry || ::poll(&p, 1, TLS_WRITE_TIMEOUT_MS) <= 0) {
+                return false;
+            }
+        }
+        return length == 0;
+    }
+
+    void close() {
+        if (ssl) {
+            SSL_shutdown(ssl);
+            SSL_free(ssl);
+            ssl = nullptr;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+    bool connected() const { return fd >= 0; }
+    const TlsHandshakeStats& lastHandshake() const { return stats; }
+
+private:
+    static int tcpConnect(const char* host, uint16_t port, uint32_t timeoutMs) {
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* found = nullptr;
+        char portText[6];
+        snprintf(portText, sizeof(portText), "%u", (unsigned)port);
+        if (getaddrinfo(host, portText, &hints, &found) != 0) {
+            return -1;
+        }
+        const int s = ::socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+        timeval timeout = { (time_t)(timeoutMs / 1000), (suseconds_t)(timeoutMs % 1000) * 1000 };
+        const int one = 1;
+        const bool ok = s >= 0 && setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+            setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0 &&
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == 0 &&
+            ::connect(s, found->ai_addr, found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!ok && s >= 0) {
+            ::close(s);
+        }
+        return ok ? s : -1;
+    }
+
+    void loadStoredSession(const char* host) {
+        if (session || storeChecked || !store) {
+            return;
+        }
+        storeChecked = true;
+        TlsSessionBlob blob;
+        if (store->load(host, blob)) {
+            const unsigned char* p = blob.data;
+            session = d2i_SSL_SESSION(nullptr, &p, blob.length);
+            saved = blob;
+        }
+    }
+
+    void keepSession(const char* host) {
+        // A copy: OpenSSL marks the live session unresumable when the
+        // connection later dies without close_notify (mbedtls copies too)
+        SSL_SESSION* current = SSL_get_session(ssl);
+        if (session) {
+            SSL_SESSION_free(session);
+        }
+        session = current ? SSL_SESSION_dup(current) : nullptr;
+        if (!session || !store) {
+            return;
+        }
+        TlsSessionBlob blob;
+        const int length = i2d_SSL_SESSION(session, nullptr);
+        unsigned char* p = blob.data;
+        if (length <= 0 || length > TLS_SESSION_MAX || i2d_SSL_SESSION(session, &p) != length) {
+            return;
+        }
+        blob.length = (uint16_t)length;
+        if (blob.length != saved.length || memcmp(blob.data, saved.data, blob.length) != 0) {
+            store->save(host, blob);
+            saved = blob;
+        }
+    }
+
+    void forgetSession() {
+        if (!stats.offered) {
+            return;
+        }
+        SSL_SESSION_free(session);
+        session = nullptr;
+        saved.length = 0;
+        if (store) {
+            store->clear();
+        }
+    }
+
+    int fd = -1;
+    SSL_CTX* ctx = nullptr;
+    SSL* ssl = nullptr;
+    SSL_SESSION* session = nullptr;
+    TlsSessionBlob saved = {};
+
+    TlsSessionStore* store = nullptr;
+    TlsHandshakeStats stats = {};
+    bool storeChecked = false;
+};
+#endif
+
+#endif // HAL_TLS_STREAM_H
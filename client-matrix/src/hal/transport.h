@@ -0,0 +1,405 @@
+/**
+ * @file transport.h
+ * @brief Frame transport abstraction over WebSocketsClient
+ *
+ * Mirrors the subset of the links2004 WebSocketsClient API the firmware
+ * uses (begin/beginSSL, loop, sendTXT, onEvent) so the receive path can be
+ * driven by the real socket on the ESP32 or by a loopback on the host.
+ * The socket-backed transports take the client as a template parameter:
+ * WebSocketsClient, or PersistentWebSocketClient (ws_client.h), which
+ * resumes its TLS session on reconnect and also builds on the host.
+ *
+ * Two ways to pump the socket:
+ *   - polled (WebSocketsTransport): loop() reads the socket and dispatches
+ *     from the caller's task, so a message waits for the next loop();
+ *   - event-driven (QueuedTransport): a socket task of its own reads and
+ *     queues each complete message as it arrives (transport_inbox.h), and
+ *     wakes whoever waits in waitForMessage(); loop() then dispatches the
+ *     queued messages to the same onEvent() handler.
+ */
+
+#ifndef HAL_TRANSPORT_H
+#define HAL_TRANSPORT_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hal/platform.h"
+#include "spsc_queue.h"
+#include "transport_inbox.h"
+
+#if defined(ARDUINO)
+#include <WebSocketsClient.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Same names and order as WStype_t in WebSockets.h
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+#endif
+
+typedef void (*TransportEventHandler)(WStype_t type, uint8_t* payload, size_t length);
+
+class FrameTransport {
+public:
+    virtual ~FrameTransport() {}
+
+    /** @brief Open the connection (reconnects are handled internally) */
+    virtual void begin(const char* host, uint16_t port, const char* path, bool secure) = 0;
+    virtual void disconnect() = 0;
+
+    /** @brief Pump the socket; events are dispatched from here */
+    virtual void loop() = 0;
+
+    virtual bool sendTXT(const char* text) = 0;
+
+    void onEvent(TransportEventHandler handler) { eventHandler = handler; }
+
+protected:
+    void dispatch(WStype_t type, uint8_t* payload, size_t length) {
+        if (eventHandler) {
+            eventHandler(type, payload, length);
+        }
+    }
+
+private:
+    TransportEventHandler eventHandler = nullptr;
+};
+
+/**
+ * @brief FrameTransport whose socket is read on a task of its own
+ *
+ * Implementations call receive() from the socket task and wake the
+ * consumer; the consumer blocks in waitForMessage() and dispatches with
+ * loop(). onEvent() handlers run on the consumer, as before.
+ */
+class QueuedTransport : public FrameTransport {
+public:
+    /** @brief Dispatch everything received so far */
+    void loop() override {
+        inbox.drain([this](uint8_t type, uint8_t* payload, size_t length) {
+            dispatch((WStype_t)type, payload, length);
+        }, micros, WStype_BIN);
+    }
+
+    /**
+     * @brief Block until a message is queued or timeoutMs passes
+     * @return true if there is something for loop() to dispatch
+     */
+    virtual bool waitForMessage(uint32_t timeoutMs) = 0;
+
+    /** @brief Frames dispatched, drops, arrival → dispatched latency */
+    TransportInboxStats inboxStats() const { return inbox.stats(); }
+
+protected:
+    /** @brief Socket task: queue a complete message, stamped now */
+    bool receive(WStype_t type, const uint8_t* payload, size_t length) {
+        return inbox.push((uint8_t)type, payload, length, micros());
+    }
+
+    /** @brief Socket task: drop a message without queueing it */
+    void discard() { inbox.discard(); }
+
+    TransportInbox inbox;
+};
+
+/**
+ * @brief FrameTransport backed by a links2004 WebSocketsClient (or a client
+ *        with the same API)
+ */
+template <typename Client>
+class WebSocketsTransport : public FrameTransport {
+public:
+    WebSocketsTransport() {
+        client.onEvent([this](WStype_t type, uint8_t* payload, size_t length) {
+            dispatch(type, payload, length);
+        });
+    }
+
+    void begin(const char* host, uint16_t port, const char* path, bool secure) override {
+        if (secure) {
+            client.beginSSL(host, port, path);
+        } else {
+            client.begin(host, port, path);
+        }
+    }
+
+    void disconnect() override { client.disconnect(); }
+    void loop() override { client.loop(); }
+    bool sendTXT(const char* text) override { return client.sendTXT(text); }
+
+    void setReconnectInterval(unsigned long ms) { client.setReconnectInterval(ms); }
+
+private:
+    Client client;
+};
+
+#define SOCKET_TASK_CORE     0       // next to the WiFi stack
+#define SOCKET_TASK_PRIORITY 3       // above the network and render tasks
+#define SOCKET_TASK_STACK    8192    // TLS reads happen here now
+#define SOCKET_WAIT_MS       5       // longest a request or queued text waits for the socket task
+#define SOCKET_OUTBOX_SLOTS  4       // texts waiting for the socket task (power of two)
+#define SOCKET_TEXT_MAX      192     // the join message, with room to spare
+
+/**
+ * @brief QueuedTransport over a WebSocket client pumped by its own task
+ *
+ * Between pumps the socket task blocks in the client's waitForData(),
+ * which PersistentWebSocketClient implements with select() on its socket
+ * (poll() on the host): the task sleeps until bytes arrive, a reconnect is
+ * due, or SOCKET_WAIT_MS passes, and a message is queued as soon as it is
+ * read, whatever the consumer is busy with. The links2004 client has no
+ * blocking read and doesn't expose its TLS socket, so with it the task
+ * yields one tick (1 ms) between pumps instead.
+ *
+ * The client isn't thread-safe, and its loop() can block for seconds in a
+ * (re)connect and handshake, so the consumer never calls into it: begin(),
+ * disconnect() and setReconnectInterval() post a request, and sendTXT()
+ * queues its text, for the socket task to carry out before its next pump
+ * (within SOCKET_WAIT_MS). The mutex only keeps the destructor from
+ * deleting the task inside the client.
+ *
+ * A connection change the inbox has no room for waits in pendingState,
+ * and is dispatched after everything queued before it. Until then nothing
+ * may overtake it: later connection changes replace it (the latest state
+ * is the one that counts) and other messages are dropped.
+ *
+ * On the host the task is a std::thread and the consumer waits on a
+ * condition variable, so the harness runs this class as the firmware does.
+ */
+template <typename Client>
+class SocketTaskTransport : public QueuedTransport {
+public:
+    SocketTaskTransport() {
+#if defined(ARDUINO)
+        lock = xSemaphoreCreateMutex();
+#endif
+        client.onEvent([this](WStype_t type, uint8_t* payload, size_t length) {
+            // On the socket task, inside client.loop()
+#if !defined(ARDUINO)
+            std::unique_lock<std::mutex> guard(wakeLock);
+#endif
+            const bool stateChange = type == WStype_CONNECTED || type == WStype_DISCONNECTED;
+            if (pendingState.load() != WStype_ERROR) {
+                if (stateChange) {
+                    pendingState = type;   // behind a pending change: keep the latest
+                } else {
+                    discard();
+                }
+            } else if (!receive(type, payload, length) && stateChange) {
+                pendingState = type;   // never lose a connection change to a full inbox
+            }
+#if !defined(ARDUINO)
+            guard.unlock();
+#endif
+            wakeConsumer();
+        });
+    }
+
+    ~SocketTaskTransport() override {
+#if defined(ARDUINO)
+        xSemaphoreTake(lock, portMAX_DELAY);   // the socket task is not inside the client
+        if (socketTask) {
+            vTaskDelete(socketTask);
+        }
+        xSemaphoreGive(lock);
+        vSemaphoreDelete(lock);
+#else
+        running.store(false);
+        if (socketThread.joinable()) {
+            socketThread.join();   // within one pump
+        }
+#endif
+    }
+
+    /** @brief Connect (again) on the socket task; host and path must outlive the transport */
+    void begin(const char* host, uint16_t port, const char* path, bool secure) override {
+        target.host = host;
+        target.port = port;
+        target.path = path;
+        target.secure = secure;
+        request.store(REQUEST_BEGIN, std::memory_order_release);
+#if defined(ARDUINO)
+        if (!socketTask) {
+            xTaskCreatePinnedToCore(socketTaskMain, "socket", SOCKET_TASK_STACK, this,
+                SOCKET_TASK_PRIORITY, &socketTask, SOCKET_TASK_CORE);
+        }
+#else
+        if (!socketThread.joinable()) {
+            running.store(true);
+            socketThread = std::thread([this]() {
+                while (running.load()) {
+                    pump();
+                }
+            });
+        }
+#endif
+    }
+
+    /** @brief Close on the socket task; replaces a begin() it hasn't carried out yet */
+    void disconnect() override {
+        request.store(REQUEST_DISCONNECT, std::memory_order_release);
+    }
+
+    /** @return true once queued for the socket task; false if too long or the outbox is full */
+    bool sendTXT(const char* text) override {
+        const size_t length = strlen(text);
+        OutboundText* slot = length < SOCKET_TEXT_MAX ? outbox.writeSlot() : nullptr;
+        if (!slot) {
+            return false;
+        }
+        memcpy(slot->text, text, length + 1);
+        outbox.commit();
+        return true;
+    }
+
+    void setReconnectInterval(unsigned long ms) {
+        reconnectIntervalMs.store((uint32_t)ms, std::memory_order_release);
+    }
+
+    void loop() override {
+        // Everything queued before a pending connection change goes first;
+        // whatever arrives after it waits in the inbox for the next loop()
+        QueuedTransport::loop();
+        const WStype_t state = pendingState.exchange(WStype_ERROR);
+        if (state != WStype_ERROR) {
+            dispatch(state, nullptr, 0);
+        }
+    }
+
+    bool waitForMessage(uint32_t timeoutMs) override {
+#if defined(ARDUINO)
+        consumer = xTaskGetCurrentTaskHandle();
+        if (!hasMessage()) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+        }
+        return hasMessage();
+#else
+        std::unique_lock<std::mutex> guard(wakeLock);
+        return wake.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this]() { return hasMessage(); });
+#endif
+    }
+
+private:
+    enum : uint8_t { REQUEST_NONE, REQUEST_BEGIN, REQUEST_DISCONNECT };
+
+    struct Target {
+        const char* host;
+        uint16_t port;
+        const char* path;
+        bool secure;
+    };
+
+    struct OutboundText {
+        char text[SOCKET_TEXT_MAX];
+    };
+
+#if defined(ARDUINO)
+    static void socketTaskMain(void* arg) {
+        SocketTaskTransport* self = static_cast<SocketTaskTransport*>(arg);
+        for (;;) {
+            xSemaphoreTake(self->lock, portMAX_DELAY);
+            self->pump();
+            xSemaphoreGive(self->lock);
+        }
+    }
+#endif
+
+    /** Socket task: requests and queued texts, the client, then wait for the socket */
+    void pump() {
+        serviceRequests();
+        client.loop();
+        waitForSocket(client, 0);
+    }
+
+    /** PersistentWebSocketClient: sleep on the socket */
+    template <typename C>
+    static auto waitForSocket(C& c, int) -> decltype(c.waitForData(0), void()) {
+        c.waitForData(SOCKET_WAIT_MS);
+    }
+
+    /** WebSocketsClient: nothing to sleep on, pump again after a tick */
+    template <typename C>
+    static void waitForSocket(C&, long) {
+        delay(1);
+    }
+
+    /** Socket task: carry out what the consumer asked for since the last pump */
+    void serviceRequests() {
+        const uint32_t interval = reconnectIntervalMs.exchange(0, std::memory_order_acquire);
+        if (interval) {
+            client.setReconnectInterval(interval);
+        }
+        switch (request.exchange(REQUEST_NONE, std::memory_order_acquire)) {
+            case REQUEST_BEGIN:
+                client.disconnect();
+                if (target.secure) {
+                    client.beginSSL(target.host, target.port, target.path);
+                } else {
+                    client.begin(target.host, target.port, target.path);
+                }
+                break;
+            case REQUEST_DISCONNECT:
+                client.disconnect();
+                break;
+            default:
+                break;
+        }
+        OutboundText* text;
+        while ((text = outbox.front()) != nullptr) {
+            client.sendTXT(text->text);   // not connected: dropped, as a direct sendTXT() would be
+            outbox.release();
+        }
+    }
+
+    bool hasMessage() const {
+        return !inbox.empty() || pendingState.load() != WStype_ERROR;
+    }
+
+    void wakeConsumer() {
+#if defined(ARDUINO)
+        TaskHandle_t task = consumer;
+        if (task) {
+            xTaskNotifyGive(task);
+        }
+#else
+        wake.notify_one();
+#endif
+    }
+
+    Client client;
+#if defined(ARDUINO)
+    SemaphoreHandle_t lock = nullptr;
+    TaskHandle_t socketTask = nullptr;
+    volatile TaskHandle_t consumer = nullptr;
+#else
+    std::atomic<bool> running{false};
+    std::thread socketThread;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+#endif
+    std::atomic<WStype_t> pendingState{WStype_ERROR};   // WStype_ERROR: none
+
+    // Consumer → socket task
+    Target target = {};
+    std::atomic<uint8_t> request{REQUEST_NONE};
+    std::atomic<uint32_t> reconnectIntervalMs{0};       // 0: unchanged
+    SpscQueue<OutboundText, SOCKET_OUTBOX_SLOTS> outbox;
+};
+
+#endif // HAL_TRANSPORT_H
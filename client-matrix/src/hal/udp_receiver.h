@@ -0,0 +1,291 @@
+/**
+ * @file udp_receiver.h
+ * @brief Frame datagrams from the server's UDP relay, read on a task of
+ *        their own
+ *
+ * The WebSocket stays the control channel (join, status, hold, ...); once
+ * the server has handed out a relay port and token in `joined`, frames
+ * arrive here instead, as sequence-numbered datagrams (udp_frames.h).
+ * A lost datagram costs its own frame only: nothing is retransmitted, so
+ * no later frame waits behind it the way it would behind a lost TCP
+ * segment.
+ *
+ * Same shape as SocketTaskTransport: the receive task reassembles frames
+ * and queues each complete one in a TransportInbox, wakes the consumer,
+ * and the consumer dispatches them with loop() to the usual event handler
+ * as WStype_BIN. The receive task also (re)registers with the server
+ * every UDP_REGISTER_INTERVAL_MS, which keeps NAT bindings open and tells
+ * the server the matrix is still listening.
+ *
+ * BSD sockets on both sides: lwIP on the ESP32, the host's on Linux.
+ */
+
+#ifndef HAL_UDP_RECEIVER_H
+#define HAL_UDP_RECEIVER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/platform.h"
+#include "hal/transport.h"
+#include "transport_inbox.h"
+#include "udp_frames.h"
+
+#if defined(ARDUINO)
+#include <lwip/sockets.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#define UDP_RECEIVE_TIMEOUT_MS 250   // receive task checks registration / stop this often
+
+#if defined(ARDUINO)
+#define UDP_TASK_CORE     0          // next to the WiFi stack
+#define UDP_TASK_PRIORITY 3          // as the WebSocket's socket task
+#define UDP_TASK_STACK    4096       // frames are reassembled in the receiver, not on the stack
+#endif
+
+class UdpFrameReceiver {
+public:
+    ~UdpFrameReceiver() { stop(); }
+
+    /**
+     * @brief Open the socket on localPort (0: any) and start the receive task
+     * @return false if the socket couldn't be opened
+     */
+    bool begin(uint16_t localPort = 0) {
+        if (fd >= 0) {
+            return true;
+        }
+        fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            return false;
+        }
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(localPort);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        timeval timeout = { 0, UDP_RECEIVE_TIMEOUT_MS * 1000 };
+        if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
+        running.store(true);
+#if defined(ARDUINO)
+        xTaskCreatePinnedToCore(receiveTaskMain, "udp", UDP_TASK_STACK, this,
+            UDP_TASK_PRIORITY, &receiveTask, UDP_TASK_CORE);
+#else
+        receiveThread = std::thread([this]() { receiveLoop(); });
+#endif
+        return true;
+    }
+
+    /**
+     * @brief Register with the relay (now and every UDP_REGISTER_INTERVAL_MS)
+     * @param address IPv4 address, network byte order
+     * @param port    The server's UDP_PORT (`udpPort` in `joined`)
+     * @param token   `udpToken` in `joined`; a new one restarts the stream
+     */
+    void setServer(uint32_t address, uint16_t port, uint32_t token) {
+        serverAddress.store(address);
+        serverPort.store(port);
+        serverToken.store(token);
+        generation.fetch_add(1, std::memory_order_release);
+        sendRegister();
+    }
+
+    /** @brief Stop registering (the WebSocket closed); frames are ignored */
+    void clearServer() {
+        serverPort.store(0);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+
+    void stop() {
+        if (fd < 0) {
+            return;
+        }
+        running.store(false);
+#if defined(ARDUINO)
+        while (!taskDone.load()) {
+            vTaskDelay(pdMS_TO_TICKS(10));   // at most one receive timeout
+        }
+#else
+        if (receiveThread.joinable()) {
+            receiveThread.join();
+        }
+#endif
+        ::close(fd);
+        fd = -1;
+    }
+
+    void onEvent(TransportEventHandler handler) { eventHandler = handler; }
+
+    /** @brief Dispatch every frame completed so far, as WStype_BIN */
+    void loop() {
+#if defined(ARDUINO)
+        consumer = xTaskGetCurrentTaskHandle();
+#endif
+        inbox.drain([this](uint8_t type, uint8_t* payload, size_t length) {
+            if (eventHandler) {
+                eventHandler((WStype_t)type, payload, length);
+            }
+        }, micros, WStype_BIN);
+    }
+
+    /**
+     * @brief Block until a frame is queued or timeoutMs passes
+     *
+     * On the ESP32 the receive task wakes the consumer with a task
+     * notification, so a task waiting in SocketTaskTransport's
+     * waitForMessage() wakes for a frame here as well.
+     */
+    bool waitForMessage(uint32_t timeoutMs) {
+#if defined(ARDUINO)
+        consumer = xTaskGetCurrentTaskHandle();
+        if (inbox.empty()) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+        }
+        return !inbox.empty();
+#else
+        std::unique_lock<std::mutex> guard(wakeLock);
+        return wake.wait_for(guard, std::chrono::milliseconds(timeoutMs), [this]() { return !inbox.empty(); });
+#endif
+    }
+
+    /** @brief Frames dispatched, drops, arrival → dispatched latency */
+    TransportInboxStats inboxStats() const { return inbox.stats(); }
+
+    /** @brief Reassembly counters (frames, incomplete, late, malformed) */
+    UdpFrameStats frameStats() const {
+        UdpFrameStats s;
+        s.frames = published[0].load(std::memory_order_relaxed);
+        s.incomplete = published[1].load(std::memory_order_relaxed);
+        s.late = published[2].load(std::memory_order_relaxed);
+        s.malformed = published[3].load(std::memory_order_relaxed);
+        return s;
+    }
+
+    /** @brief Port the socket is bound to (the ephemeral one for begin(0)) */
+    uint16_t localPort() const {
+        sockaddr_in addr = {};
+        socklen_t len = sizeof(addr);
+        if (fd < 0 || ::getsockname(fd, (sockaddr*)&addr, &len) != 0) {
+            return 0;
+        }
+        return ntohs(addr.sin_port);
+    }
+
+private:
+#if defined(ARDUINO)
+    static void receiveTaskMain(void* arg) {
+        UdpFrameReceiver* self = static_cast<UdpFrameReceiver*>(arg);
+        self->receiveLoop();
+        self->taskDone.store(true);
+        vTaskDelete(nullptr);
+    }
+#endif
+
+    void receiveLoop() {
+        uint8_t datagram[UDP_HEADER_SIZE + UDP_CHUNK_BYTES + 1];   // + 1: oversized shows as malformed
+        uint32_t seenGeneration = generation.load(std::memory_order_acquire);
+        uint32_t lastRegister = millis();
+
+        while (running.load()) {
+            if (millis() - lastRegister >= UDP_REGISTER_INTERVAL_MS) {
+                sendRegister();
+                lastRegister = millis();
+            }
+
+            sockaddr_in from = {};
+            socklen_t fromLength = sizeof(from);
+            const int n = ::recvfrom(fd, datagram, sizeof(datagram), 0, (sockaddr*)&from, &fromLength);
+
+            // setServer() registered meanwhile: the relay numbers the new stream from 0
+            const uint32_t current = generation.load(std::memory_order_acquire);
+            if (current != seenGeneration) {
+                seenGeneration = current;
+                assembler.reset();
+                lastRegister = millis();
+            }
+            if (n <= 0 || serverPort.load() == 0 || from.sin_addr.s_addr != serverAddress.load()) {
+                continue;   // timeout, or not from the relay
+            }
+            if (assembler.push(datagram, (size_t)n)) {
+                queue(assembler.frame(), assembler.frameLength());
+            }
+            const UdpFrameStats s = assembler.stats();
+            published[0].store(s.frames, std::memory_order_relaxed);
+            published[1].store(s.incomplete, std::memory_order_relaxed);
+            published[2].store(s.late, std::memory_order_relaxed);
+            published[3].store(s.malformed, std::memory_order_relaxed);
+        }
+    }
+
+    void sendRegister() {
+        const uint16_t port = serverPort.load();
+        if (fd < 0 || port == 0) {
+            return;
+        }
+        uint8_t datagram[UDP_REGISTER_SIZE];
+        const size_t length = udpWriteRegister(datagram, serverToken.load());
+        sockaddr_in to = {};
+        to.sin_family = AF_INET;
+        to.sin_port = htons(port);
+        to.sin_addr.s_addr = serverAddress.load();
+        ::sendto(fd, datagram, length, 0, (sockaddr*)&to, sizeof(to));
+    }
+
+    void queue(const uint8_t* frame, size_t length) {
+#if defined(ARDUINO)
+        inbox.push(WStype_BIN, frame, length, micros());
+        TaskHandle_t task = consumer;
+        if (task) {
+            xTaskNotifyGive(task);
+        }
+#else
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            inbox.push(WStype_BIN, frame, length, micros());
+        }
+        wake.notify_one();
+#endif
+    }
+
+    int fd = -1;
+    std::atomic<bool> running{false};
+    std::atomic<uint32_t> serverAddress{0};
+    std::atomic<uint16_t> serverPort{0};
+    std::atomic<uint32_t> serverToken{0};
+    std::atomic<uint32_t> generation{0};
+
+    // Receive task only
+    UdpFrameAssembler assembler;
+    std::atomic<uint32_t> published[4] = {};   // UdpFrameStats, in field order
+
+    TransportInbox inbox;
+    TransportEventHandler eventHandler = nullptr;
+
+#if defined(ARDUINO)
+    TaskHandle_t receiveTask = nullptr;
+    volatile TaskHandle_t consumer = nullptr;
+    std::atomic<bool> taskDone{false};
+#else
+    std::thread receiveThread;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+#endif
+};
+
+#endif // HAL_UDP_RECEIVER_H
@@ -0,0 +1,276 @@
+/**
+ * @file jitter_buffer.h
+ * @brief Jitter buffer + presentation clock for streamed frames
+ *
+ * The producer (network side) pushes complete frames as they arrive; the
+ * consumer (render side) calls due() once per panel refresh and gets at
+ * most one frame, released at the mean arrival interval on the refresh
+ * nearest its due time. WiFi bursts are absorbed by the queue instead of
+ * showing up as two frames in one refresh followed by a gap.
+ *
+ * Depth adapts to the measured inter-arrival jitter (RFC 3550-style
+ * running estimate): target = 1 + ⌈2 × jitter / interval⌉, clamped to
+ * [minDepth, maxDepth]. Playback starts once the target is buffered; an
+ * empty queue at release time is an underrun (the panel keeps the last
+ * frame and playback re-primes). Frames are dropped, oldest first, when
+ * the queue is full or holds more than target + 1 (latency above target);
+ * both count as overruns.
+ *
+ * There are CAPACITY + 1 slots: up to CAPACITY queued, one being written
+ * and one on the panel. Which slot is where lives in one atomic word
+ * (queue order, count, free set), so push() on a full queue can take the
+ * oldest queued slot for the incoming frame. A render stall never costs
+ * the newest frames.
+ *
+ * One thread may call push(), one (possibly different) thread due() and
+ * consumed(). reset() needs both sides idle.
+ */
+
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+struct JitterStats {
+    uint8_t depth;         // frames buffered now
+    uint8_t targetDepth;   // adaptive target
+    uint32_t underruns;    // release ticks with nothing to release
+    uint32_t overruns;     // frames dropped: queue full or latency above target
+    uint32_t intervalUs;   // mean inter-arrival time
+    uint32_t jitterUs;     // inter-arrival jitter estimate
+};
+
+template <size_t FRAME_BYTES, uint32_t CAPACITY>
+class JitterBuffer {
+    static_assert(CAPACITY >= 2 && CAPACITY <= 7, "slot indices are 3 bits, all fields in one word");
+
+public:
+    JitterBuffer() { reset(); }
+
+    /**
+     * @param minDepth  Smallest target depth (≥ 1)
+     * @param maxDepth  Largest target depth (< CAPACITY)
+     * @param nominalIntervalUs Interval assumed before any frame arrives
+     * @param refreshUs Panel refresh period, i.e. how often due() is called
+     */
+    void configure(uint8_t minDepth, uint8_t maxDepth, uint32_t nominalIntervalUs, uint32_t refreshUs) {
+        this->minDepth = minDepth < 1 ? 1 : minDepth;
+        this->maxDepth = maxDepth >= CAPACITY ? CAPACITY - 1 : maxDepth;
+        nominalUs = nominalIntervalUs;
+        halfRefreshUs = refreshUs / 2;
+        reset();
+    }
+
+    void reset() {
+        slotState.store(FREE_ALL, std::memory_order_release);
+        heldSlot = NO_SLOT;
+        havePrevious = false;
+        intervalUs.store(nominalUs << INTERVAL_SHIFT, std::memory_order_relaxed);
+        jitterUs.store(0, std::memory_order_relaxed);
+        targetDepth.store(minDepth, std::memory_order_relaxed);
+        primed = false;
+    }
+
+    // ─── Producer ────────────────────────────────────────────────────────
+
+    /** @return false if the queue was full (its oldest frame dropped to make room) */
+    bool push(const uint8_t* frame, uint32_t arrivalUs) {
+        trackArrival(arrivalUs);
+
+        // Take a free slot, or the oldest queued one when the queue is full
+        uint32_t state = slotState.load(std::memory_order_acquire);
+        uint32_t index, next;
+        bool evicted;
+        do {
+            evicted = queuedIn(state) == CAPACITY;
+            if (evicted) {
+                index = state & INDEX_MASK;
+                next = withoutOldest(state);
+            } else {
+                index = __builtin_ctz(state >> FREE_SHIFT);
+                next = state & ~(1u << (FREE_SHIFT + index));
+            }
+        } while (!slotState.compare_exchange_weak(state, next, std::memory_order_acq_rel));
+        if (evicted) {
+            producerDrops.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Slot& slot = slots[index];
+        memcpy(slot.data, frame, FRAME_BYTES);
+        slot.arrivalUs = arrivalUs;
+
+        // Append (the consumer only ever shortens the queue meanwhile)
+        state = slotState.load(std::memory_order_relaxed);
+        do {
+            const uint32_t queued = queuedIn(state);
+            next = (state & ~COUNT_MASK) | (index << (INDEX_BITS * queued)) | ((queued + 1) << COUNT_SHIFT);
+        } while (!slotState.compare_exchange_weak(state, next, std::memory_order_release));
+        return !evicted;
+    }
+
+    // ─── Consumer ────────────────────────────────────────────────────────
+
+    /**
+     * @brief Call once per refresh tick
+     * @return frame to present now (valid until consumed()), or nullptr
+     *         to keep showing the current one
+     */
+    const uint8_t* due(uint32_t nowUs, uint32_t* arrivalUs = nullptr) {
+        const uint8_t target = targetDepth.load(std::memory_order_relaxed);
+        uint32_t depth = queuedIn(slotState.load(std::memory_order_acquire));
+
+        if (!primed) {
+            if (depth < target) {
+                return nullptr;
+            }
+            primed = true;
+            nextReleaseUs = nowUs;
+        }
+        // Release on the refresh nearest the due time, not the one after it
+        if ((int32_t)(nowUs + halfRefreshUs - nextReleaseUs) < 0) {
+            return nullptr;
+        }
+        if (depth == 0) {
+            underruns.fetch_add(1, std::memory_order_relaxed);
+            primed = false;
+            return nullptr;
+        }
+
+        // Latency above target: skip ahead, oldest first
+        uint32_t index = popOldest(&depth);
+        for (; depth >= (uint32_t)target + 1; index = popOldest(&depth)) {
+            freeSlot(index);
+            consumerDrops.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const uint32_t period = intervalUs.load(std::memory_order_relaxed) >> INTERVAL_SHIFT;
+        nextReleaseUs += period;
+        if ((int32_t)(nowUs - nextReleaseUs) >= (int32_t)period) {
+            nextReleaseUs = nowUs + period;   // fell behind (stalled render): resync
+        }
+
+        heldSlot = index;
+        if (arrivalUs) {
+            *arrivalUs = slots[index].arrivalUs;
+        }
+        return slots[index].data;
+    }
+
+    /** @brief Hand the frame returned by due() back to the producer */
+    void consumed() {
+        if (heldSlot != NO_SLOT) {
+            freeSlot(heldSlot);
+            heldSlot = NO_SLOT;
+        }
+    }
+
+    JitterStats stats() const {
+        JitterStats s;
+        s.depth = (uint8_t)queuedIn(slotState.load(std::memory_order_acquire));
+        s.targetDepth = targetDepth.load(std::memory_order_relaxed);
+        s.underruns = underruns.load(std::memory_order_relaxed);
+        s.overruns = producerDrops.load(std::memory_order_relaxed) +
+                     consumerDrops.load(std::memory_order_relaxed);
+        s.intervalUs = intervalUs.load(std::memory_order_relaxed) >> INTERVAL_SHIFT;
+        s.jitterUs = jitterUs.load(std::memory_order_relaxed) >> INTERVAL_SHIFT;
+        return s;
+    }
+
+private:
+    static const uint8_t INTERVAL_SHIFT = 4;   // running averages in 1/16 µs, gain 1/16
+
+    struct Slot {
+        uint8_t data[FRAME_BYTES] __attribute__((aligned(4)));
+        uint32_t arrivalUs;
+    };
+
+    // slotState: queued slot indices, oldest in the low bits | count | free set
+    static const uint32_t INDEX_BITS = 3;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t COUNT_SHIFT = INDEX_BITS * CAPACITY;
+    static const uint32_t COUNT_MASK = INDEX_MASK << COUNT_SHIFT;
+    static const uint32_t FREE_SHIFT = COUNT_SHIFT + INDEX_BITS;
+    static const uint32_t FREE_ALL = ((1u << (CAPACITY + 1)) - 1) << FREE_SHIFT;
+    static const uint32_t NO_SLOT = 0xFF;
+
+    static uint32_t queuedIn(uint32_t state) { return (state & COUNT_MASK) >> COUNT_SHIFT; }
+
+    /** @brief state with its oldest queued index removed (queue not empty) */
+    static uint32_t withoutOldest(uint32_t state) {
+        const uint32_t order = (state & ((1u << COUNT_SHIFT) - 1)) >> INDEX_BITS;
+        return (state & ~((1u << FREE_SHIFT) - 1)) | order | ((queuedIn(state) - 1) << COUNT_SHIFT);
+    }
+
+    /** @brief Consumer: dequeue the oldest slot; *remaining gets what is left queued */
+    uint32_t popOldest(uint32_t* remaining) {
+        uint32_t state = slotState.load(std::memory_order_acquire);
+        uint32_t next;
+        do {
+            next = withoutOldest(state);
+        } while (!slotState.compare_exchange_weak(state, next, std::memory_order_acquire));
+        *remaining = queuedIn(state) - 1;
+        return state & INDEX_MASK;
+    }
+
+    /** @brief Consumer: give a dequeued slot back to the producer */
+    void freeSlot(uint32_t index) {
+        slotState.fetch_or(1u << (FREE_SHIFT + index), std::memory_order_release);
+    }
+
+    void trackArrival(uint32_t arrivalUs) {
+        if (!havePrevious) {
+            havePrevious = true;
+            previousUs = arrivalUs;
+            return;
+        }
+        const int32_t delta = (int32_t)(arrivalUs - previousUs);
+        previousUs = arrivalUs;
+
+        int32_t interval = intervalUs.load(std::memory_order_relaxed);
+        int32_t jitter = jitterUs.load(std::memory_order_relaxed);
+        // Stalls are followed by a catch-up burst, so they stay in the mean;
+        // a reconnect-length gap is not followed by one, so it is capped
+        const int32_t capped = delta < 8 * (interval >> INTERVAL_SHIFT) ? delta : 8 * (interval >> INTERVAL_SHIFT);
+        interval += capped - (interval >> INTERVAL_SHIFT);
+        const int32_t deviation = capped > (interval >> INTERVAL_SHIFT)
+            ? capped - (interval >> INTERVAL_SHIFT)
+            : (interval >> INTERVAL_SHIFT) - capped;
+        jitter += deviation - (jitter >> INTERVAL_SHIFT);
+        intervalUs.store(interval, std::memory_order_relaxed);
+        jitterUs.store(jitter, std::memory_order_relaxed);
+
+        const uint32_t meanUs = (uint32_t)interval >> INTERVAL_SHIFT;
+        const uint32_t spreadUs = 2 * ((uint32_t)jitter >> INTERVAL_SHIFT);
+        uint32_t target = meanUs ? 1 + (spreadUs + meanUs - 1) / meanUs : maxDepth;
+        target = target < minDepth ? minDepth : target > maxDepth ? maxDepth : target;
+        targetDepth.store((uint8_t)target, std::memory_order_relaxed);
+    }
+
+    Slot slots[CAPACITY + 1];
+    std::atomic<uint32_t> slotState{FREE_ALL};
+
+    uint8_t minDepth = 1;
+    uint8_t maxDepth = CAPACITY - 1;
+    uint32_t nominalUs = 33333;
+    uint32_t halfRefreshUs = 0;
+
+    // Producer side
+    bool havePrevious = false;
+    uint32_t previousUs = 0;
+    std::atomic<int32_t> intervalUs{0};
+    std::atomic<int32_t> jitterUs{0};
+    std::atomic<uint8_t> targetDepth{1};
+    std::atomic<uint32_t> producerDrops{0};
+
+    // Consumer side
+    bool primed = false;
+    uint32_t heldSlot = NO_SLOT;   // returned by due(), on the panel until consumed()
+    uint32_t nextReleaseUs = 0;
+    std::atomic<uint32_t> underruns{0};
+    std::atomic<uint32_t> consumerDrops{0};
+};
+
+#endif // JITTER_BUFFER_H
@@ -5,9 +5,18 @@
  * and receives RGB565 frames to display on a 32×32 SmartMatrix LED panel.
  *
  * Features:
- *   - WPA2-Personal or WPA2-Enterprise WiFi (compile-time flag)
- *   - WebSocket client with auto-reconnect
+ *   - WPA2-Personal or WPA2-Enterprise WiFi (compile-time flag),
+ *     reconnecting with backoff in the background (wifi_link.h), straight
+ *     to the last good AP after a power cycle (WIFI_FAST_CONNECT)
+ *   - Boot timeline to first pixel in the log ([BOOT])
+ *   - WebSocket client with auto-reconnect and TLS session resumption
+ *     (MATRIX_TLS_RESUME)
  *   - RGB565 → RGB24 conversion for SmartMatrix display
+ *   - Network task on core 0, render task on core 1 (MATRIX_DUAL_CORE)
+ *   - WebSocket read on a socket task of its own (MATRIX_SOCKET_TASK)
+ *   - Streamed frames over the server's UDP relay (MATRIX_UDP_FRAMES)
+ *   - On-device water simulation from drop/tint events (LOCAL_WATER_RENDER),
+ *     in lockstep with the phones (MATRIX_LOCKSTEP)
  *   - Config-based secrets (config.h, gitignored)
  *
  * Dependencies:
@@ -24,18 +33,29 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <atomic>
+#include <esp_timer.h>
 #include <WebSocketsClient.h>
 #include <ArduinoJson.h>
 
 #include "wifi_client.h"
+#include "frame_pipeline.h"
+#include "hal/transport.h"
+#include "hal/udp_receiver.h"
+#include "ws_client.h"
+#include "water_renderer.h"
+#include "water_simulation.h"   // WATER_FIXED_POINT
+#include "fixed_timestep.h"
+
+#ifdef MATRIX_BENCHMARK
+#include "frame_bench.h"
+#endif
 
 // ─── SmartMatrix Configuration ───────────────────────────────────────────────
 
 #include <SmartMatrix.h>
 
 #define COLOR_DEPTH   24
-#define TOTAL_WIDTH   32
-#define TOTAL_HEIGHT  32
 
 #define kRefreshDepth 24
 #define kDmaBufferRows 4
@@ -46,61 +66,393 @@
 SMARTMATRIX_ALLOCATE_BUFFERS(matrix, TOTAL_WIDTH, TOTAL_HEIGHT, kRefreshDepth, kDmaBufferRows, kPanelType, kMatrixOptions);
 SMARTMATRIX_ALLOCATE_BACKGROUND_LAYER(bg, TOTAL_WIDTH, TOTAL_HEIGHT, COLOR_DEPTH, kbgOptions);
 
-// ─── Constants ───────────────────────────────────────────────────────────────
+static SmartMatrixDisplay<decltype(bg)> display(bg);
 
-const uint8_t  INCOMING_COLOR_DEPTH = 16;  // RGB565
-const uint16_t NUM_LEDS = TOTAL_WIDTH * TOTAL_HEIGHT;
-const uint16_t BUFFER_SIZE = NUM_LEDS * (INCOMING_COLOR_DEPTH / 8);
+// ─── Constants ───────────────────────────────────────────────────────────────
 
-#define WIFI_TIMEOUT       20000   // 20s WiFi connection timeout
+#define WIFI_BOOT_WAIT_MS  10000   // boot: the first association's head start on the panel
 #define WS_RECONNECT_DELAY 3000    // 3s between reconnect attempts
 #define LED_BLINK_INTERVAL 500     // Status LED blink rate
+#define FRAME_STATS_INTERVAL 10000 // 10s between frame stream stats logs
+
+// ─── Task Layout ─────────────────────────────────────────────────────────────
+// 1: WiFi + WebSocket run in a task on core 0 (next to the WiFi stack) and
+//    rendering in a task on core 1, so a slow TLS read or a WiFi reconnect
+//    never stalls the panel. Frames are decoded on the network task and
+//    cross over through the pipeline's lock-free triple buffer
+//    (FRAME_INGEST_DECODED).
+// 0: everything in loop(), as before; frames are decoded straight into
+//    the back buffer (FRAME_INGEST_DIRECT).
+#ifndef MATRIX_DUAL_CORE
+#define MATRIX_DUAL_CORE 1
+#endif
+
+#define NETWORK_CORE       0
+#define RENDER_CORE        1
+#define NETWORK_TASK_STACK 10240   // TLS handshake needs the headroom
+#define RENDER_TASK_STACK  4096
+#define RENDER_WAKE_TIMEOUT_MS 100
+#define NETWORK_WAKE_TIMEOUT_MS 100  // housekeeping cadence while no message arrives
+
+// 1: a socket task pumps the WebSocket and queues each message as it
+//    completes (SocketTaskTransport); the network task sleeps until one
+//    is queued, so a frame no longer waits for the loop around it.
+// 0: the network task (or loop()) polls the socket itself.
+#ifndef MATRIX_SOCKET_TASK
+#define MATRIX_SOCKET_TASK 1
+#endif
+
+// 1: streamed frames go through the pipeline's jitter buffer and the render
+//    task presents once per panel refresh (FRAME_INGEST_JITTER), smoothing
+//    out WiFi bursts at the cost of a frame or two of latency.
+// 0: present each frame as soon as it arrives (FRAME_INGEST_DECODED).
+#ifndef MATRIX_JITTER_BUFFER
+#define MATRIX_JITTER_BUFFER 1
+#endif
+
+// 1: cross-fade between the last two streamed frames on every refresh
+//    (setFrameInterpolation), so a 30 fps stream moves at the refresh
+//    rate. Adds a frame interval of latency. Needs the jitter buffer.
+#ifndef MATRIX_INTERPOLATE
+#define MATRIX_INTERPOLATE 0
+#endif
+#if MATRIX_INTERPOLATE && !(MATRIX_DUAL_CORE && MATRIX_JITTER_BUFFER)
+#error "MATRIX_INTERPOLATE needs MATRIX_DUAL_CORE and MATRIX_JITTER_BUFFER"
+#endif
+
+// ─── Render Mode ─────────────────────────────────────────────────────────────
+// 1: simulate and composite the water here from drop/tint events (see
+//    water_renderer.h); the phone stops streaming frames.
+// 0: display the RGB565 frames streamed by the phone.
+#ifndef LOCAL_WATER_RENDER
+#define LOCAL_WATER_RENDER 1
+#endif
+
+// 1: join the server's tick-stamped event log (water_lockstep.h), so this
+//    matrix and both phones compute identical water. Needs the Q16 kernel.
+// 0: apply events as they arrive.
+#ifndef MATRIX_LOCKSTEP
+#define MATRIX_LOCKSTEP (LOCAL_WATER_RENDER && WATER_FIXED_POINT)
+#endif
+#if MATRIX_LOCKSTEP && !(LOCAL_WATER_RENDER && WATER_FIXED_POINT)
+#error "MATRIX_LOCKSTEP needs LOCAL_WATER_RENDER and -DWATER_FIXED_POINT=1"
+#endif
+
+// 1: ask the server for its UDP relay (udp_receiver.h): streamed frames
+//    arrive as datagrams, so a lost packet drops one frame instead of
+//    holding up every frame behind it; join and control stay on the
+//    WebSocket, which also carries the frames if the server has no relay.
+// 0: frames over the WebSocket only.
+#ifndef MATRIX_UDP_FRAMES
+#define MATRIX_UDP_FRAMES 0
+#endif
+#if MATRIX_UDP_FRAMES && LOCAL_WATER_RENDER
+#error "MATRIX_UDP_FRAMES streams frames: build with -DLOCAL_WATER_RENDER=0"
+#endif
+
+// 1: PersistentWebSocketClient (ws_client.h): one TLS context for the
+//    whole run, and the last session offered again on every reconnect and
+//    after a reboot (kept in NVS), so a reconnect costs one round trip and
+//    no key exchange. Each attempt logs its TCP / TLS / upgrade times.
+// 0: links2004's WebSocketsClient, a full handshake on every connect.
+#ifndef MATRIX_TLS_RESUME
+#define MATRIX_TLS_RESUME 1
+#endif
 
 // ─── Global State ────────────────────────────────────────────────────────────
 
-static uint8_t frameBuf[BUFFER_SIZE] __attribute__((aligned(4)));
-static uint32_t frameCount = 0;
 static bool wsConnected = false;
 
-WebSocketsClient* webSocket = nullptr;
+#if MATRIX_TLS_RESUME
+typedef PersistentWebSocketClient MatrixClient;
+#else
+typedef WebSocketsClient MatrixClient;
+#endif
+#if MATRIX_SOCKET_TASK
+typedef SocketTaskTransport<MatrixClient> MatrixTransport;
+#else
+typedef WebSocketsTransport<MatrixClient> MatrixTransport;
+#endif
+
+MatrixTransport* webSocket = nullptr;
+#if MATRIX_UDP_FRAMES
+static UdpFrameReceiver* udpFrames = nullptr;
+#endif
 static uint8_t disconnectedCounter = 0;
 
+static TaskHandle_t renderTaskHandle = nullptr;
+
+// ─── Boot Timeline ───────────────────────────────────────────────────────────
+// Installations are power-cycled daily: how long until the panel is live,
+// in ms since the app started
+
+static uint32_t bootWifiMs = 0;
+static std::atomic<bool> bootSocketUp{false};       // read on the render side
+
+static void logBootSocket() {
+    static bool logged = false;
+    if (!logged) {
+        logged = true;
+        bootSocketUp.store(true);
+        Serial.printf("[BOOT] WebSocket open at %u ms (WiFi up at %u ms, %s)\n",
+            (unsigned)millis(), (unsigned)bootWifiMs, describeWiFiConnection());
+    }
+}
+
+// The first frame on the panel that came from the server: a streamed
+// frame, or a water frame drawn once the WebSocket is open (in lockstep,
+// the sync point it joined at). Logged from the network side.
+static std::atomic<uint32_t> bootFirstPixelMs{0};   // set on the render side
+
+static void markFirstPixel() {
+    uint32_t none = 0;
+    bootFirstPixelMs.compare_exchange_strong(none, millis());
+}
+
+static void logBootFirstPixel() {
+    static bool logged = false;
+    const uint32_t at = bootFirstPixelMs.load();
+    if (!logged && at) {
+        logged = true;
+        Serial.printf("[BOOT] First pixel at %u ms\n", (unsigned)at);
+    }
+}
+
 // ─── WiFi Connection ─────────────────────────────────────────────────────────
 
+void setupWebSocket();
+
+/**
+ * @brief Pump the WiFi link (never blocks) and follow it with the WebSocket
+ */
+static void handleWiFi() {
+    switch (serviceWiFi()) {
+        case WIFI_ACTION_UP:
+            if (!bootWifiMs) {
+                bootWifiMs = millis();
+            }
+            setupWebSocket();   // connect now, not at the next retry
+            break;
+        case WIFI_ACTION_DOWN:
+            if (webSocket) {
+                webSocket->disconnect();   // no connects into a dead link meanwhile
+            }
+            break;
+        default:
+            break;
+    }
+}
 
+// ─── Frame Stream ────────────────────────────────────────────────────────────
 
-// ─── RGB565 → RGB24 Conversion ──────────────────────────────────────────────
+#if !LOCAL_WATER_RENDER
+// The phone's water is flat: no frames until it moves again (network side)
+static bool streamHeld = false;
 
-inline void convert16to24bit(const uint8_t high, const uint8_t low, rgb24* col) {
-    uint16_t rgb16 = ((uint16_t)high << 8) | low;
-    col->red   = ((rgb16 >> 11) & 0x1F) << 3;
-    col->green = ((rgb16 >>  5) & 0x3F) << 2;
-    col->blue  = (rgb16 & 0x1F) << 3;
+static bool isMessageType(const uint8_t* payload, size_t length, const char* type) {
+    JsonDocument doc;
+    return !deserializeJson(doc, payload, length) && strcmp(doc["type"] | "", type) == 0;
 }
 
-// ─── Display Frame ──────────────────────────────────────────────────────────
+/**
+ * @brief Log losses and latency of the phone's frame stream now and then
+ */
+static void logFrameStats() {
+    static uint32_t lastLog = 0;
+    if (millis() - lastLog < FRAME_STATS_INTERVAL) {
+        return;
+    }
+    lastLog = millis();
+
+    const FrameStreamStats stats = getFrameStreamStats();
+    if (stats.sequenced == 0 || streamHeld) {
+        return;
+    }
+    Serial.printf("[FRAMES] shown %u, lost %u, reordered %u, stale %u, skipped %u, age %u ms (max %u)\n",
+        (unsigned)getFrameCount(), (unsigned)stats.lost, (unsigned)stats.reordered,
+        (unsigned)stats.stale, (unsigned)getDroppedFrameCount(),
+        (unsigned)stats.lastAgeMs, (unsigned)stats.maxAgeMs);
+#if MATRIX_DUAL_CORE && MATRIX_JITTER_BUFFER
+    const JitterStats jitter = getJitterStats();
+    Serial.printf("[FRAMES] jitter buffer depth %u/%u, underruns %u, overruns %u, interval %u us, jitter %u us\n",
+        jitter.depth, jitter.targetDepth, (unsigned)jitter.underruns, (unsigned)jitter.overruns,
+        (unsigned)jitter.intervalUs, (unsigned)jitter.jitterUs);
+#endif
+#if MATRIX_SOCKET_TASK
+    const TransportInboxStats inbox = webSocket->inboxStats();
+    Serial.printf("[FRAMES] socket → pipeline %u us (mean %u, max %u), inbox drops %u\n",
+        (unsigned)inbox.lastLatencyUs, (unsigned)inbox.meanLatencyUs, (unsigned)inbox.maxLatencyUs,
+        (unsigned)(inbox.overflows + inbox.oversized));
+#endif
+#if MATRIX_UDP_FRAMES
+    const UdpFrameStats udp = udpFrames->frameStats();
+    if (udp.frames) {
+        Serial.printf("[FRAMES] UDP: %u frames, %u incomplete, %u late chunks, %u malformed\n",
+            (unsigned)udp.frames, (unsigned)udp.incomplete, (unsigned)udp.late, (unsigned)udp.malformed);
+    }
+#endif
+}
+#endif
 
-void displayFrame(const uint8_t* data, size_t length) {
-    if (length != BUFFER_SIZE) {
-        Serial.printf("Frame size mismatch: got %u, expected %u\n", length, BUFFER_SIZE);
+#if MATRIX_UDP_FRAMES
+/**
+ * @brief Register with the server's UDP relay if `joined` offers one
+ */
+static void handleJoined(const uint8_t* payload, size_t length) {
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, length) || strcmp(doc["type"] | "", "joined") != 0) {
         return;
     }
+    const uint16_t port = doc["udpPort"] | 0;
+    if (port == 0) {
+        Serial.println("[UDP] Server has no UDP relay, frames stay on the WebSocket");
+        return;
+    }
+    IPAddress server;
+    if (!WiFi.hostByName(WSS_SERVER_HOST, server)) {
+        Serial.printf("[UDP] Could not resolve %s, frames stay on the WebSocket\n", WSS_SERVER_HOST);
+        return;
+    }
+    udpFrames->setServer((uint32_t)server, port, doc["udpToken"] | 0u);
+    Serial.printf("[UDP] Registering with %s:%u\n", server.toString().c_str(), (unsigned)port);
+}
+#endif
 
-    rgb24* buffer = bg.backBuffer();
+// ─── Water Events ────────────────────────────────────────────────────────────
+
+#if LOCAL_WATER_RENDER
+// Water ticks at WATER_STEP_MS whenever the render loop gets to run
+static FixedTimestep waterClock;
+
+/**
+ * @brief Turn a drop/tint/params/reset JSON message into a WaterEvent
+ * @return true if the message was a water event
+ */
+static bool handleWaterMessage(const uint8_t* payload, size_t length) {
+    JsonDocument doc;
+    if (deserializeJson(doc, payload, length)) {
+        return false;
+    }
 
-    // Convert RGB565 to RGB24
-    uint16_t idx = 0;
-    for (uint16_t i = 0; i < NUM_LEDS; i++, idx += 2) {
-        convert16to24bit(data[idx], data[idx + 1], &buffer[i]);
+    const char* type = doc["type"] | "";
+    if (strcmp(type, "tick") == 0) {
+        setWaterHorizon(doc["tick"] | 0u);
+        return true;
     }
 
-    bg.swapBuffers();
-    frameCount++;
+    WaterEvent e = {};
+    const char* layer = doc["layer"] | "";
+    e.layer = strcmp(layer, "remote") == 0 ? WATER_LAYER_REMOTE
+            : strcmp(layer, "local") == 0 ? WATER_LAYER_LOCAL
+            : WATER_LAYER_BOTH;
+    e.stamped = doc["tick"].is<uint32_t>();
+    e.tick = doc["tick"] | 0u;
+    e.hasTint = doc["r"].is<int>() && doc["g"].is<int>() && doc["b"].is<int>();
+    e.r = doc["r"] | 0;
+    e.g = doc["g"] | 0;
+    e.b = doc["b"] | 0;
+
+    if (strcmp(type, "drop") == 0) {
+        e.type = WATER_EVENT_DROP;
+        e.x = doc["x"] | 0;
+        e.y = doc["y"] | 0;
+        e.strength = doc["strength"] | 1.0f;
+        e.radius = doc["radius"] | 2;
+        e.burst = doc["burst"] | 0;
+    } else if (strcmp(type, "tint") == 0) {
+        e.type = WATER_EVENT_TINT;
+    } else if (strcmp(type, "params") == 0) {
+        e.type = WATER_EVENT_PARAMS;
+        e.waveDamp = doc["waveDamp"] | 0.985f;
+        e.renderGain = doc["renderGain"] | 2.3f;
+    } else if (strcmp(type, "reset") == 0) {
+        e.type = WATER_EVENT_RESET;
+        if (e.stamped && e.layer == WATER_LAYER_BOTH) {
+            // (Re)joining the log: nothing is vouched for past this point yet
+            setWaterHorizon(e.tick - 1);
+        }
+    } else {
+        return false;
+    }
+
+    if (!postWaterEvent(e)) {
+        Serial.println("[WATER] Event queue full, event dropped");
+    }
+    return true;
 }
 
-// ─── WebSocket Event Handler ─────────────────────────────────────────────────
+/**
+ * @brief Log the water's tick rate, and how far behind the server's
+ *        horizon it runs
+ */
+static void logWaterStats() {
+    static uint32_t lastLog = 0;
+    static FixedTimestepStats lastClock = {};
+    const uint32_t now = millis();
+    if (now - lastLog < FRAME_STATS_INTERVAL) {
+        return;
+    }
+    const FixedTimestepStats clock = waterClock.stats();
+    const uint32_t centiHz = (uint32_t)((uint64_t)(clock.ticks - lastClock.ticks) * 100000 / (now - lastLog));
+    Serial.printf("[WATER] %u.%02u ticks/s, %u dropped%s\n",
+        (unsigned)(centiHz / 100), (unsigned)(centiHz % 100), (unsigned)(clock.dropped - lastClock.dropped),
+        isWaterIdle() ? ", idle (flat)" : "");
+    lastLog = now;
+    lastClock = clock;
+
+#if MATRIX_LOCKSTEP
+    const WaterLockstepStats stats = getWaterLockstepStats();
+    if (!stats.synced) {
+        Serial.println("[WATER] Waiting for the lockstep sync point");
+        return;
+    }
+    Serial.printf("[WATER] lockstep tick %u, horizon %u, stalls %u, late events %u, resyncs %u (%u asks)\n",
+        (unsigned)stats.tick, (unsigned)stats.horizon, (unsigned)stats.stalls, (unsigned)stats.lateEvents,
+        (unsigned)stats.resyncs, (unsigned)stats.resyncAsks);
+#endif
+}
+
+#if MATRIX_LOCKSTEP
+/**
+ * @brief Report the lockstep water to the server: ask for a sync point once
+ *        it has left the log (an event lost to a full queue, or one that
+ *        came too late), and say when it has gone flat (beats may pause)
+ */
+static void reportWaterLockstep() {
+    if (!wsConnected) {
+        return;
+    }
+    if (takeWaterResyncRequest()) {
+        webSocket->sendTXT("{\"type\":\"resync\"}");
+        Serial.println("[WATER] Out of lockstep (lost or late event): asked the server for a sync point");
+    }
+    uint32_t tick;
+    if (takeWaterHold(&tick)) {
+        char msg[48];
+        snprintf(msg, sizeof(msg), "{\"type\":\"hold\",\"tick\":%u}", (unsigned)tick);
+        webSocket->sendTXT(msg);
+    }
+}
+#endif
 
-static bool newFrameReceived = false;
+/**
+ * @brief Advance the water by the ticks that came due and show it
+ */
+static void presentWaterFrame() {
+    const uint32_t steps = waterClock.due(micros());
+    if (steps == 0) {
+        return;   // woke early: nothing moved
+    }
+    if (!waterRendererTick(millis(), steps)) {
+        return;   // flat water, no event: the last frame still stands
+    }
+    renderWater(display.backBuffer());
+    display.swapBuffers(false);
+    if (bootSocketUp.load()) {
+        markFirstPixel();
+    }
+}
+#endif
 
 // ─── WebSocket Event Handler ─────────────────────────────────────────────────
 
@@ -111,42 +463,67 @@ void onWebSocketEvent(WStype_t type, uint8_t* payload, size_t length) {
             wsConnected = true;
             disconnectedCounter = 0;
             digitalWrite(PICO_LED_PIN, HIGH);
+            logBootSocket();
 
             // Send join message
             {
-                char joinMsg[64];
+                char joinMsg[192];
                 snprintf(joinMsg, sizeof(joinMsg),
-                    "{\"type\":\"join\",\"role\":\"matrix\",\"pair\":%d}", PAIR_ID);
+                    "{\"type\":\"join\",\"role\":\"matrix\",\"pair\":%d,\"render\":\"%s\","
+                    "\"formats\":[\"rgb565\",\"tiles565\",\"pal565\"],\"frameHeader\":1,\"lockstep\":%d,\"udp\":%d}",
+                    PAIR_ID, LOCAL_WATER_RENDER ? "local" : "stream", MATRIX_LOCKSTEP, MATRIX_UDP_FRAMES);
                 webSocket->sendTXT(joinMsg);
                 Serial.printf("[WS] Joined as matrix, pair %d\n", PAIR_ID);
             }
             break;
 
         case WStype_TEXT:
+#if LOCAL_WATER_RENDER
+            if (handleWaterMessage(payload, length)) {
+                break;
+            }
+#else
+#if MATRIX_UDP_FRAMES
+            handleJoined(payload, length);
+#endif
+            // A phone (re)joining starts its frame sequence over
+            if (isMessageType(payload, length, "status")) {
+                resetFrameStream();
+            }
+            if (isMessageType(payload, length, "hold")) {
+                if (!streamHeld) {
+                    Serial.println("[FRAMES] Phone's water is flat: holding the last frame");
+                }
+                streamHeld = true;
+                break;
+            }
+#endif
             Serial.printf("[WS] Message: %s\n", payload);
             break;
 
         case WStype_BIN:
-            // Binary frame: RGB565 pixel data
-            // DECOUPLED: Copy to buffer, set flag, but don't draw yet.
-            if (length == BUFFER_SIZE) {
-                memcpy(frameBuf, payload, length);
-                newFrameReceived = true;
-            } else {
-                Serial.printf("Frame size mismatch: got %u, expected %u\n", length, BUFFER_SIZE);
+#if LOCAL_WATER_RENDER
+            // The water is rendered here; streamed frames are not used
+#else
+            // Binary frame (see frame_format.h), drawn by the render side
+            streamHeld = false;
+            if (receiveFrame(payload, length) && renderTaskHandle) {
+                xTaskNotifyGive(renderTaskHandle);
             }
+#endif
             break;
 
         case WStype_DISCONNECTED:
             Serial.println("[WS] Disconnected.");
             wsConnected = false;
             disconnectedCounter++;
+#if MATRIX_UDP_FRAMES
+            udpFrames->clearServer();   // the relay forgets us with the WebSocket
+#endif
             digitalWrite(PICO_LED_PIN, LOW);
             if (disconnectedCounter >= 3) {
-                Serial.printf("[WS] Disconnected %d times, checking WiFi...\n", disconnectedCounter);
-                if (WiFi.status() != WL_CONNECTED) {
-                    connectToWiFi();
-                }
+                Serial.printf("[WS] Disconnected %d times, WiFi %s\n", disconnectedCounter,
+                    isWiFiOnline() ? "up" : "reconnecting");
             }
             break;
 
@@ -162,29 +539,104 @@ void onWebSocketEvent(WStype_t type, uint8_t* payload, size_t length) {
 // ─── WebSocket Connection ────────────────────────────────────────────────────
 
 void setupWebSocket() {
+    // Kept across WiFi reconnects: begin() again on the same client, so
+    // its TLS context and session survive
     if (webSocket) {
         webSocket->disconnect();
-        delay(100);
-        delete webSocket;
+    } else {
+        webSocket = new MatrixTransport();
+        webSocket->onEvent(onWebSocketEvent);
     }
 
-    webSocket = new WebSocketsClient();
-
+    webSocket->begin(WSS_SERVER_HOST, WSS_SERVER_PORT, WSS_SERVER_PATH, WS_SECURE);
     if (WS_SECURE) {
-        webSocket->beginSSL(WSS_SERVER_HOST, WSS_SERVER_PORT, WSS_SERVER_PATH);
         Serial.println("[WS] Using secure WebSocket connection (WSS)");
     } else {
-        webSocket->begin(WSS_SERVER_HOST, WSS_SERVER_PORT, WSS_SERVER_PATH);
         Serial.println("[WS] Using non-secure WebSocket connection (WS)");
     }
 
-    webSocket->onEvent(onWebSocketEvent);
     webSocket->setReconnectInterval(5000);
 
+#if MATRIX_UDP_FRAMES
+    if (!udpFrames) {
+        udpFrames = new UdpFrameReceiver();
+        udpFrames->onEvent(onWebSocketEvent);   // frames arrive as WStype_BIN
+        if (!udpFrames->begin()) {
+            Serial.println("[UDP] Could not open a socket, frames stay on the WebSocket");
+        }
+    }
+#endif
+
     Serial.printf("[WS] Connecting to %s://%s:%d%s ...\n",
         WS_SECURE ? "wss" : "ws", WSS_SERVER_HOST, WSS_SERVER_PORT, WSS_SERVER_PATH);
 }
 
+// ─── Tasks ───────────────────────────────────────────────────────────────────
+
+#if MATRIX_DUAL_CORE
+static void networkTask(void*) {
+    setupWebSocket();
+    for (;;) {
+#if MATRIX_SOCKET_TASK
+        // Asleep until the socket task queues a message
+        webSocket->waitForMessage(NETWORK_WAKE_TIMEOUT_MS);
+#endif
+        webSocket->loop();
+#if MATRIX_UDP_FRAMES
+        udpFrames->loop();   // its receive task wakes this task too
+#endif
+        handleWiFi();
+#if LOCAL_WATER_RENDER
+        logWaterStats();
+#if MATRIX_LOCKSTEP
+        reportWaterLockstep();
+#endif
+#else
+        logFrameStats();
+#endif
+        logBootFirstPixel();
+#if !MATRIX_SOCKET_TASK
+        vTaskDelay(1); // let the idle task feed the watchdog
+#endif
+    }
+}
+
+static void renderTask(void*) {
+#if LOCAL_WATER_RENDER
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(WATER_STEP_MS));
+        presentWaterFrame();
+    }
+#elif MATRIX_JITTER_BUFFER
+    // Once per refresh, on a µs timer: in ticks the 8333 µs period would
+    // round to 8 ms and run 4% fast of the jitter buffer's clock. The
+    // jitter buffer decides whether a frame is due.
+    esp_timer_create_args_t refresh = {};
+    refresh.callback = [](void* task) { xTaskNotifyGive((TaskHandle_t)task); };
+    refresh.arg = xTaskGetCurrentTaskHandle();
+    refresh.name = "refresh";
+    esp_timer_handle_t refreshTimer;
+    esp_timer_create(&refresh, &refreshTimer);
+    esp_timer_start_periodic(refreshTimer, 1000000 / FRAME_REFRESH_HZ);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // a late wake presents once
+        if (presentPendingFrame()) {
+            markFirstPixel();
+        }
+    }
+#else
+    for (;;) {
+        // Woken once per received frame; the timeout is only a safety net
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RENDER_WAKE_TIMEOUT_MS));
+        if (presentPendingFrame()) {
+            markFirstPixel();
+        }
+    }
+#endif
+}
+#endif
+
 // ─── Setup ───────────────────────────────────────────────────────────────────
 
 void setup() {
@@ -199,15 +651,31 @@ void setup() {
     Serial.println("WiFi mode: WPA2-Personal");
 #endif
 
-    // Initialize LED matrix
-    // Connect WiFi (Before Matrix, to ensure heap availability for WPA2 handshake)
-    connectToWiFi();
+    // Connect WiFi (Before Matrix, to ensure heap availability for WPA2 handshake);
+    // if it takes longer, the panel starts anyway and the link keeps trying
+    startWiFi();
+    if (waitForWiFi(WIFI_BOOT_WAIT_MS)) {
+        bootWifiMs = millis();
+    }
 
     // Initialize LED matrix
     bg.enableColorCorrection(true);
     matrix.addLayer(&bg);
     matrix.setBrightness(255);
     matrix.begin();
+    framePipelineBegin(&display);
+
+#ifdef MATRIX_BENCHMARK
+    // Decode/present microbenchmarks on the real panel, then carry on as usual
+    {
+        BenchResult results[BENCH_STAGE_COUNT];
+        runFrameBenchmark(&display, BENCH_MAX_SAMPLES, results);
+        Serial.println("[BENCH] Frame pipeline:");
+        printFrameBenchmark(results);
+        Serial.println(checkFrameBudget(results) ? "[BENCH] FAIL: over the refresh budget"
+                                                 : "[BENCH] PASS: every stage fits a refresh");
+    }
+#endif
 
     // Show a brief startup color
     rgb24* buffer = bg.backBuffer();
@@ -216,24 +684,63 @@ void setup() {
     }
     bg.swapBuffers();
 
+#if LOCAL_WATER_RENDER
+    setWaterLockstep(MATRIX_LOCKSTEP);
+    waterClock.configure(WATER_STEP_MS * 1000, WATER_MAX_CATCH_UP);
+#endif
+
+#if MATRIX_DUAL_CORE
+    // Receive and present now run on different cores
+#if MATRIX_JITTER_BUFFER
+    setFrameIngestMode(FRAME_INGEST_JITTER);
+    if (matrix.getRefreshRate() != FRAME_REFRESH_HZ) {
+        Serial.printf("[FRAMES] Panel refreshes at %u Hz, frames are presented at %u Hz (not in phase)\n",
+            (unsigned)matrix.getRefreshRate(), (unsigned)FRAME_REFRESH_HZ);
+    }
+    setFrameInterpolation(MATRIX_INTERPOLATE);
+#else
+    setFrameIngestMode(FRAME_INGEST_DECODED);
+#endif
+    xTaskCreatePinnedToCore(renderTask, "render", RENDER_TASK_STACK, nullptr, 2, &renderTaskHandle, RENDER_CORE);
+    xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr, 1, nullptr, NETWORK_CORE);
+#else
     // Connect WebSocket
     setupWebSocket();
+#endif
 }
 
 // ─── Loop ────────────────────────────────────────────────────────────────────
 
 void loop() {
+#if MATRIX_DUAL_CORE
+    // All work happens in networkTask / renderTask
+    vTaskDelete(nullptr);
+#else
     // Process WebSocket events (reconnect is handled internally)
     if (webSocket) {
         webSocket->loop();
     }
+#if MATRIX_UDP_FRAMES
+    udpFrames->loop();
+#endif
 
+#if LOCAL_WATER_RENDER
+    // Steps the water at a fixed cadence, however fast loop() spins
+    presentWaterFrame();
+    logWaterStats();
+#if MATRIX_LOCKSTEP
+    reportWaterLockstep();
+#endif
+#else
     // Render latest frame if available (SKIP drawing old frames if multiple arrived)
-    if (newFrameReceived) {
-        newFrameReceived = false;
-        displayFrame(frameBuf, BUFFER_SIZE);
+    if (presentPendingFrame()) {
+        markFirstPixel();
     }
+    logFrameStats();
+#endif
+    logBootFirstPixel();
 
-    // Reconnect WiFi if lost
-    checkWiFiConnection();
+    // Reconnect WiFi if lost (without blocking the panel)
+    handleWiFi();
+#endif
 }
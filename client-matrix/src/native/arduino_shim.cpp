@@ -0,0 +1,22 @@
+#include "arduino_shim.h"
+
+#include <chrono>
+#include <thread>
+
+SerialShim Serial;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint32_t micros() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
@@ -0,0 +1,40 @@
+/**
+ * @file arduino_shim.h
+ * @brief Host stand-ins for the Arduino core symbols used by portable code
+ */
+
+#ifndef NATIVE_ARDUINO_SHIM_H
+#define NATIVE_ARDUINO_SHIM_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+/**
+ * @brief stdout-backed replacement for HardwareSerial
+ */
+class SerialShim {
+public:
+    void begin(unsigned long) {}
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n < 0 ? 0 : (size_t)n;
+    }
+
+    size_t print(const char* text) { return printf("%s", text); }
+    size_t println(const char* text = "") { return printf("%s\n", text); }
+};
+
+extern SerialShim Serial;
+
+#endif // NATIVE_ARDUINO_SHIM_H
@@ -0,0 +1,59 @@
+/**
+ * @file loopback_transport.h
+ * @brief In-process FrameTransport for the host build
+ *
+ * Payloads pushed with inject() are delivered as WStype_BIN events on the
+ * next loop(), the same way WebSocketsClient delivers them from its loop().
+ */
+
+#ifndef NATIVE_LOOPBACK_TRANSPORT_H
+#define NATIVE_LOOPBACK_TRANSPORT_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "hal/transport.h"
+
+class LoopbackTransport : public FrameTransport {
+public:
+    void begin(const char*, uint16_t, const char*, bool) override {
+        connected = true;
+        dispatch(WStype_CONNECTED, nullptr, 0);
+    }
+
+    void disconnect() override {
+        if (connected) {
+            connected = false;
+            dispatch(WStype_DISCONNECTED, nullptr, 0);
+        }
+    }
+
+    void loop() override {
+        while (connected && !pending.empty()) {
+            std::vector<uint8_t> payload;
+            payload.swap(pending.front());
+            pending.pop_front();
+            dispatch(WStype_BIN, payload.data(), payload.size());
+        }
+    }
+
+    bool sendTXT(const char* text) override {
+        sent.emplace_back(text);
+        return connected;
+    }
+
+    /** @brief Queue a binary payload as if it arrived from the server */
+    void inject(const uint8_t* payload, size_t length) {
+        pending.emplace_back(payload, payload + length);
+    }
+
+    const std::vector<std::string>& sentMessages() const { return sent; }
+
+private:
+    bool connected = false;
+    std::deque<std::vector<uint8_t>> pending;
+    std::vector<std::string> sent;
+};
+
+#endif // NATIVE_LOOPBACK_TRANSPORT_H
@@ -0,0 +1,2173 @@
+/**
+ * MissingDrop — Host-native frame pipeline harness
+ *
+ * Runs the firmware's receive → decode → swap path on Linux, with the
+ * SmartMatrix layer and the WebSocket client replaced by in-memory
+ * stand-ins. Frames are synthetic RGB565 gradients.
+ *
+ * Usage:
+ *   pio run -e native            (env:native_q16: the water in Q16, as on the ESP32)
+ *   .pio/build/native/program [frames]
+ *   .pio/build/native/program bench [--iterations N]
+ *                                   [--baseline FILE] [--save-baseline FILE]
+ *                                   [--max-regression PCT]
+ *   .pio/build/native/program stress [frames]
+ *   .pio/build/native/program water [ticks]
+ *   .pio/build/native/program wave [ticks]
+ *   node tools/water_reference.mjs | .pio/build/native/program water-ref [tolerance]
+ *   node tools/frame_codec_reference.mjs | .pio/build/native/program codec
+ *   .pio/build/native/program sequence
+ *   .pio/build/native/program jitter [refresh Hz]
+ *   .pio/build/native/program interpolate [refresh Hz]
+ *   node tools/lockstep_reference.mjs | .pio/build/native_q16/program lockstep
+ *   .pio/build/native/program timestep
+ *   .pio/build/native/program socket [frames]
+ *   .pio/build/native/program udp [loss %]
+ *   .pio/build/native/program tls [rtt ms]
+ *   .pio/build/native/program wifi
+ *
+ * In bench mode the exit code is non-zero when any stage's p99, or the
+ * interpolating refresh, overruns one FRAME_REFRESH_HZ refresh, or when
+ * any stage's p50 is more than PCT (default 15) percent slower than the
+ * baseline file.
+ *
+ * Stress mode runs receive and present on two std::threads (standing in
+ * for the firmware's network and render tasks), in FRAME_INGEST_COPY,
+ * FRAME_INGEST_DECODED and FRAME_INGEST_JITTER, and fails on any torn,
+ * out-of-order or lost-latest frame.
+ *
+ * Water mode times the on-device water renderer (both layers + composite)
+ * and fails if a tick takes more than a tenth of WATER_STEP_MS on the
+ * host or the panel stops changing; water-ref replays a trace recorded
+ * from client-web/js/water.js and fails if the C++ port drifts from it. Wave mode runs the float and Q16
+ * instantiations of WaveKernel side by side, reports steps/s and the
+ * maximum deviation of the fixed-point fields from the float reference,
+ * and fails past WAVE_MAX_HEIGHT_DEV or WAVE_MAX_SHADE_DEV.
+ *
+ * Codec mode replays a keyframe/tile-delta/palette stream from
+ * client-web/js/frame_codec.js through the COPY, DIRECT and DECODED
+ * ingest modes, presenting after every payload and after every other one,
+ * and fails unless the panel matches the phone's image bit for bit each
+ * time. Sequence mode feeds
+ * headed payloads with gaps, duplicates, late and stale frames, and checks
+ * what is shown, what is counted, and that stale deltas still land.
+ *
+ * Jitter mode replays synthetic arrival traces (steady, paired bursts,
+ * WiFi hiccups, random jitter) against present-on-arrival and against
+ * the jitter buffer, once per panel refresh, and compares the cadence of
+ * what reaches the panel. It then pushes the random trace through the
+ * pipeline in FRAME_INGEST_JITTER and checks that frames stay in order.
+ *
+ * Interpolate mode checks blendRGB24() against a per-byte reference for
+ * every weight, then plays the steady and random traces through
+ * FRAME_INGEST_JITTER with setFrameInterpolation(true), alternating black
+ * and white frames, and fails unless the panel updates at least twice per
+ * received frame, never jumps by more than a refresh's share of the
+ * fade, and ends on the last frame exactly. The ESP32 cost is the blendRGB24
+ * line of `bench` on the board (env:esp32dev_bench); this mode prints a
+ * cycle-count estimate against the refresh budget.
+ *
+ * Lockstep mode replays tick-stamped event logs through the Q16 lockstep
+ * core (water_lockstep.h), and through both layers of the web client's
+ * water core (wasm/water_core.cpp, linked natively by
+ * native/water_core_host.cpp), and fails unless their field and shading
+ * checksums, and whether they have gone idle, match
+ * client-web/js/lockstep.js bit for bit at every checkpoint. The Q16 build (env:native_q16, the water the
+ * ESP32 runs) also checks that the renderer leaves the log on a lost
+ * event, asks for a resync once and again after WATER_LOCKSTEP_RESYNC_TICKS
+ * without an answer, rejoins at the next sync point, where its flat water
+ * skips to the horizon, and leaves again on an event lost right after it.
+ * The float build says it skipped that.
+ *
+ * Timestep mode drives FixedTimestep at the water's tick from render loops
+ * of 30 to 144 Hz, with timer jitter and one long stall, and fails unless
+ * each runs the water at the same ticks/s, never pays out more than
+ * WATER_MAX_CATCH_UP at once, drops only the stall's backlog, and a loop
+ * waking once per tick steps exactly once per wake.
+ *
+ * Socket mode streams frames from a loopback WebSocket server stand-in
+ * (native/socket_transport.h) to the firmware's PersistentWebSocketClient
+ * twice: polled, the socket read between the loop's other work
+ * (WebSocketsTransport), and event-driven, the firmware's socket task
+ * (SocketTaskTransport, a thread on the host) blocking in poll() and
+ * queueing each frame for a consumer that waits on it. It reports send → available latency
+ * both ways and fails unless every frame arrives in order and the
+ * event-driven p99 beats the polled one.
+ *
+ * UDP mode streams frames over a lossy link stand-in (one-way delay and
+ * jitter, each packet lost with the given probability) twice: as relay
+ * datagrams into UdpFrameReceiver (hal/udp_receiver.h), and over TCP,
+ * where a lost segment is retransmitted after an RTO and every frame
+ * behind it waits, into SocketTaskTransport. It runs lossless first,
+ * then at the given loss (default 5%), reports frames shown and send →
+ * dispatched latency, and fails unless both paths deliver everything
+ * when nothing is lost, neither ever shows a frame out of order or misses
+ * the last one, and under loss UDP's p99 beats TCP's.
+ *
+ * TLS mode connects PersistentWebSocketClient (ws_client.h) to a loopback
+ * WSS server stand-in behind a delay proxy (native/tls_server.h, default
+ * 40 ms RTT): first a new client per connection with no stored session,
+ * as WebSocketsClient does, then one client the server drops and that
+ * reconnects TLS_RECONNECTS times, then a "rebooted" client on the same
+ * session store. It prints each attempt's TCP / TLS / upgrade times and
+ * fails unless only the first connection of the kept client does a full
+ * handshake, the rebooted one resumes, and resumed handshakes are faster.
+ *
+ * WiFi mode drives the WiFi link state machine (wifi_link.h) with a
+ * simulated radio through boot, an AP that comes up late, a five-minute
+ * outage, attempts that never hear back, and a kick from a present AP,
+ * then boots with the last AP cached: still there, moved, and mute. It
+ * fails unless every backoff is the doubling one within its jitter, a
+ * dropped link is retried at once, hung attempts time out, the outage
+ * costs an attempt every 25–30 s rather than a restart, the link is up
+ * again within one capped backoff of the AP returning, a cached AP that
+ * fails falls back to a scan at once, and a boot with a good cache comes
+ * up faster than one that scans.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "frame_bench.h"
+#include "frame_blend.h"
+#include "frame_format.h"
+#include "frame_pipeline.h"
+#include "fixed_timestep.h"
+#include "hal/platform.h"
+#include "native/loopback_transport.h"
+#include "native/native_display.h"
+#include "native/socket_transport.h"
+#include "native/tls_server.h"
+#include "hal/udp_receiver.h"
+#include "udp_frames.h"
+#include "water_renderer.h"
+#include "water_lockstep.h"
+#include "water_simulation.h"
+#include "wave_kernel.h"
+#include "wifi_link.h"
+
+static NativeDisplay display;
+static LoopbackTransport transport;
+
+// ─── Synthetic Frames ────────────────────────────────────────────────────────
+
+static void makeFrame(uint8_t* out, uint32_t seed) {
+    for (uint16_t i = 0; i < NUM_LEDS; i++) {
+        uint16_t x = i % TOTAL_WIDTH;
+        uint16_t y = i / TOTAL_WIDTH;
+        uint16_t r5 = (x + seed) & 0x1F;
+        uint16_t g6 = (x + y + seed) & 0x3F;
+        uint16_t b5 = (y + seed * 3) & 0x1F;
+        uint16_t rgb16 = (r5 << 11) | (g6 << 5) | b5;
+        out[i * 2]     = rgb16 >> 8;
+        out[i * 2 + 1] = rgb16 & 0xFF;
+    }
+}
+
+// Every pixel carries the frame's sequence number, so a torn frame shows up
+// as a non-uniform front buffer
+static void makeSequenceFrame(uint8_t* out, uint16_t seq) {
+    for (uint16_t i = 0; i < NUM_LEDS; i++) {
+        out[i * 2]     = seq >> 8;
+        out[i * 2 + 1] = seq & 0xFF;
+    }
+}
+
+static uint16_t pixelSequence(const rgb24& px) {
+    // Both decoder engines keep the source bits in the top of each channel
+    return ((px.red >> 3) << 11) | ((px.green >> 2) << 5) | (px.blue >> 3);
+}
+
+// ─── WebSocket Event Handler ─────────────────────────────────────────────────
+
+static void onTransportEvent(WStype_t type, uint8_t* payload, size_t length) {
+    switch (type) {
+        case WStype_BIN:
+            receiveFrame(payload, length);
+            break;
+        default:
+            break;
+    }
+}
+
+// ─── Modes ───────────────────────────────────────────────────────────────────
+
+static const char* ingestModeName(FrameIngestMode mode) {
+    switch (mode) {
+        case FRAME_INGEST_COPY:    return "copy";
+        case FRAME_INGEST_DIRECT:  return "direct";
+        case FRAME_INGEST_JITTER:  return "jitter";
+        case FRAME_INGEST_DECODED: return "decoded";
+    }
+    return "?";
+}
+
+static int runPipeline(uint32_t frames) {
+    framePipelineBegin(&display);
+    transport.onEvent(onTransportEvent);
+    transport.begin("loopback", 0, "/ws", false);
+
+    static uint8_t payload[BUFFER_SIZE];
+    uint32_t start = micros();
+
+    for (uint32_t f = 0; f < frames; f++) {
+        makeFrame(payload, f);
+        transport.inject(payload, sizeof(payload));
+
+        // Same order as the firmware loop()
+        transport.loop();
+        presentPendingFrame();
+    }
+
+    uint32_t elapsed = micros() - start;
+    Serial.printf("Frames presented: %u / %u (swaps: %u)\n",
+        getFrameCount(), frames, display.getSwapCount());
+    Serial.printf("Pipeline time (%s ingest): %u us total, %.2f us/frame\n",
+        ingestModeName(FRAME_INGEST_DEFAULT),
+        elapsed, frames ? (double)elapsed / frames : 0.0);
+
+    return getFrameCount() == frames ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool loadBaseline(const char* path, const BenchResult* results, uint32_t* baselineNs) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        Serial.printf("Cannot read baseline %s\n", path);
+        return false;
+    }
+    char line[96];
+    while (fgets(line, sizeof(line), f)) {
+        char name[64];
+        unsigned p50;
+        // Stage names contain spaces, so the value is the last field
+        char* sep = strrchr(line, '=');
+        if (!sep || sscanf(sep + 1, "%u", &p50) != 1) {
+            continue;
+        }
+        size_t len = (size_t)(sep - line);
+        if (len >= sizeof(name)) {
+            continue;
+        }
+        memcpy(name, line, len);
+        name[len] = '\0';
+        for (uint8_t s = 0; s < BENCH_STAGE_COUNT; s++) {
+            if (strcmp(name, results[s].name) == 0) {
+                baselineNs[s] = p50;
+            }
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static bool saveBaseline(const char* path, const BenchResult* results) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        Serial.printf("Cannot write baseline %s\n", path);
+        return false;
+    }
+    for (uint8_t s = 0; s < BENCH_STAGE_COUNT; s++) {
+        fprintf(f, "%s=%u\n", results[s].name, (unsigned)results[s].p50Ns);
+    }
+    fclose(f);
+    return true;
+}
+
+static int runBench(int argc, char** argv) {
+    uint16_t iterations = BENCH_MAX_SAMPLES;
+    const char* baselinePath = nullptr;
+    const char* savePath = nullptr;
+    uint8_t maxRegressionPct = 15;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = (uint16_t)strtoul(argv[i + 1], nullptr, 10);
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            baselinePath = argv[i + 1];
+        } else if (strcmp(argv[i], "--save-baseline") == 0) {
+            savePath = argv[i + 1];
+        } else if (strcmp(argv[i], "--max-regression") == 0) {
+            maxRegressionPct = (uint8_t)strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    BenchResult results[BENCH_STAGE_COUNT];
+    runFrameBenchmark(&display, iterations, results);
+    printFrameBenchmark(results);
+
+    if (savePath && !saveBaseline(savePath, results)) {
+        return EXIT_FAILURE;
+    }
+    if (checkFrameBudget(results) > 0) {
+        Serial.println("FAIL: frame pipeline over the refresh budget");
+        return EXIT_FAILURE;
+    }
+
+    if (baselinePath) {
+        uint32_t baselineNs[BENCH_STAGE_COUNT] = {};
+        if (!loadBaseline(baselinePath, results, baselineNs)) {
+            return EXIT_FAILURE;
+        }
+        if (checkFrameBenchmark(results, baselineNs, maxRegressionPct) > 0) {
+            return EXIT_FAILURE;
+        }
+        Serial.printf("No stage regressed more than %u%%\n", maxRegressionPct);
+    }
+    Serial.println("PASS");
+    return EXIT_SUCCESS;
+}
+
+static int runStress(uint32_t frames) {
+    if (frames == 0 || frames > 0xFFFF) {
+        frames = 0xFFFF;
+    }
+
+    framePipelineBegin(&display);
+    bool ok = true;
+    const FrameIngestMode modes[] = { FRAME_INGEST_COPY, FRAME_INGEST_DECODED, FRAME_INGEST_JITTER };
+    for (FrameIngestMode mode : modes) {
+        setFrameIngestMode(mode);
+        const uint32_t droppedBefore = getDroppedFrameCount();
+        const uint32_t overrunsBefore = getJitterStats().overruns;
+
+        std::atomic<bool> producing{true};
+        uint32_t presented = 0, torn = 0, reordered = 0;
+        uint16_t lastSeq = 0;
+
+        auto checkFront = [&]() {
+            const rgb24* front = display.frontBuffer();
+            uint16_t seq = pixelSequence(front[0]);
+            for (uint16_t i = 1; i < NUM_LEDS; i++) {
+                if (pixelSequence(front[i]) != seq) {
+                    torn++;
+                    break;
+                }
+            }
+            if (seq <= lastSeq) {
+                reordered++;
+            }
+            lastSeq = seq;
+            presented++;
+        };
+
+        // Stand-in for networkTask
+        std::thread network([&]() {
+            static uint8_t payload[BUFFER_SIZE];
+            for (uint32_t seq = 1; seq <= frames; seq++) {
+                makeSequenceFrame(payload, (uint16_t)seq);
+                receiveFrame(payload, BUFFER_SIZE);
+                if ((seq & 0x3F) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            producing.store(false, std::memory_order_release);
+        });
+
+        // Stand-in for renderTask
+        std::thread render([&]() {
+            while (producing.load(std::memory_order_acquire)) {
+                if (presentPendingFrame()) {
+                    checkFront();
+                }
+            }
+            // Whatever was published last must still come through; the
+            // jitter buffer releases it on its own clock, while it holds
+            // enough to play
+            const uint32_t drainUntil = millis() + 500;
+            do {
+                if (presentPendingFrame()) {
+                    checkFront();
+                }
+            } while (mode == FRAME_INGEST_JITTER && getJitterStats().depth &&
+                     (int32_t)(millis() - drainUntil) < 0);
+        });
+
+        network.join();
+        render.join();
+
+        // COPY and DECODED replace an unpresented frame; JITTER drops the oldest queued one
+        const uint32_t dropped = mode != FRAME_INGEST_JITTER
+            ? getDroppedFrameCount() - droppedBefore
+            : getJitterStats().overruns - overrunsBefore;
+        const uint32_t left = mode == FRAME_INGEST_JITTER ? getJitterStats().depth : 0;
+        const char* name = ingestModeName(mode);
+        Serial.printf("Stress (%s): %u frames sent, %u presented, %u dropped, %u left queued\n",
+            name, frames, presented, dropped, left);
+        Serial.printf("Torn: %u, out of order: %u, last presented: %u (expected %u)\n",
+            torn, reordered, lastSeq, frames - left);
+
+        ok = ok && torn == 0 && reordered == 0 && lastSeq == frames - left
+            && presented + dropped + left == frames;
+    }
+    setFrameIngestMode(FRAME_INGEST_DEFAULT);
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// The ESP32 is an order of magnitude slower than the host, so the host
+// gets a tenth of the tick
+#define WATER_HOST_BUDGET_US (WATER_STEP_MS * 1000 / 10)
+
+static int runWater(uint32_t ticks) {
+    static rgb24 frame[NUM_LEDS];
+    static rgb24 previous[NUM_LEDS];
+    const uint8_t xs[] = { 4, 16, 27, 9 };
+    uint32_t moving = 0;
+    uint32_t start = micros();
+
+    for (uint32_t t = 0; t < ticks; t++) {
+        // A drop every ~half second on alternating layers keeps the water busy
+        if (t % 30 == 0) {
+            WaterEvent e = {};
+            e.type = WATER_EVENT_DROP;
+            e.layer = (t / 30) % 2 ? WATER_LAYER_REMOTE : WATER_LAYER_LOCAL;
+            e.x = xs[(t / 30) % 4];
+            e.y = xs[(t / 30 + 1) % 4];
+            e.strength = 1.0f;
+            e.radius = 3;
+            postWaterEvent(e);
+        }
+        waterRendererTick(t * WATER_STEP_MS);
+        renderWater(frame);
+        if (memcmp(frame, previous, sizeof(frame)) != 0) {
+            moving++;
+            memcpy(previous, frame, sizeof(frame));
+        }
+    }
+
+    uint32_t elapsed = micros() - start;
+    double perTick = ticks ? (double)elapsed / ticks : 0.0;
+    Serial.printf("Water: %u ticks in %u us, %.2f us/tick (step ×2 + shade ×2 + composite), budget %u us\n",
+        ticks, elapsed, perTick, WATER_STEP_MS * 1000);
+    Serial.printf("  %u of %u ticks changed the panel\n", moving, ticks);
+
+    bool ok = perTick <= WATER_HOST_BUDGET_US && moving >= ticks / 2;
+    if (perTick > WATER_HOST_BUDGET_US) {
+        Serial.printf("FAIL: %.2f us/tick over the host budget of %u us\n", perTick, WATER_HOST_BUDGET_US);
+    }
+    if (moving < ticks / 2) {
+        Serial.println("FAIL: the water stopped moving");
+    }
+    if (ok) {
+        Serial.println("PASS");
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Same impulse in both kernels: a radius-3 Gaussian on the velocity field
+template <typename Scalar>
+static void waveImpulse(WaveKernel<Scalar>& kernel, int cx, int cy, float strength) {
+    for (int dy = -3; dy <= 3; dy++) {
+        for (int dx = -3; dx <= 3; dx++) {
+            int x = cx + dx, y = cy + dy;
+            if (x < 1 || x > WAVE_SIZE - 2 || y < 1 || y > WAVE_SIZE - 2) continue;
+            float w = strength * expf(-(dx * dx + dy * dy) * (2.2f / 9.0f));
+            kernel.addVelocity(y * WAVE_SIZE + x, Scalar(w));
+        }
+    }
+}
+
+template <typename Scalar>
+static double timeWaveSteps(WaveKernel<Scalar>& kernel, uint32_t ticks) {
+    static Scalar shade[WAVE_CELLS];
+    kernel.reset();
+    waveImpulse(kernel, 16, 16, 2.0f);
+    uint32_t start = micros();
+    for (uint32_t t = 0; t < ticks; t++) {
+        kernel.step();
+        kernel.getShadingMap(shade);
+    }
+    uint32_t elapsed = micros() - start;
+    return elapsed ? ticks * 1e6 / elapsed : 0.0;
+}
+
+// Q16 against the float kernel: ~0.011 and ~1.8/255 today
+#define WAVE_MAX_HEIGHT_DEV 0.05f
+#define WAVE_MAX_SHADE_DEV  (4.0f / 255.0f)
+
+static int runWave(uint32_t ticks) {
+    static WaveKernel<float> ref;
+    static WaveKernel<Q16> fixed;
+    static float refShade[WAVE_CELLS];
+    static Q16 fixedShade[WAVE_CELLS];
+
+    float maxHeightDev = 0.0f, maxShadeDev = 0.0f;
+    uint32_t seed = 12345;
+
+    for (uint32_t t = 0; t < ticks; t++) {
+        // A drop every 250 ticks at a pseudo-random spot (LCG, same for both)
+        if (t % 250 == 0) {
+            seed = seed * 1664525u + 1013904223u;
+            int x = 2 + (seed >> 8) % 28;
+            int y = 2 + (seed >> 16) % 28;
+            float strength = 0.5f + ((seed >> 24) & 0xFF) / 128.0f;
+            waveImpulse(ref, x, y, strength);
+            waveImpulse(fixed, x, y, strength);
+        }
+
+        ref.step();
+        fixed.step();
+        ref.getShadingMap(refShade);
+        fixed.getShadingMap(fixedShade);
+
+        for (int i = 0; i < WAVE_CELLS; i++) {
+            float dh = fabsf(ref.heightField()[i] - (float)fixed.heightField()[i]);
+            float ds = fabsf(refShade[i] - (float)fixedShade[i]);
+            maxHeightDev = dh > maxHeightDev ? dh : maxHeightDev;
+            maxShadeDev = ds > maxShadeDev ? ds : maxShadeDev;
+        }
+    }
+
+    double floatRate = timeWaveSteps(ref, ticks);
+    double fixedRate = timeWaveSteps(fixed, ticks);
+
+    Serial.printf("Wave kernel over %u ticks (step + shading map):\n", ticks);
+    Serial.printf("  float: %10.0f steps/s\n", floatRate);
+    Serial.printf("  Q16:   %10.0f steps/s\n", fixedRate);
+    Serial.printf("  max |h| deviation %.6f, max shade deviation %.6f (%.2f of 255)\n",
+        maxHeightDev, maxShadeDev, maxShadeDev * 255.0f);
+
+    if (!(maxHeightDev <= WAVE_MAX_HEIGHT_DEV) || !(maxShadeDev <= WAVE_MAX_SHADE_DEV)) {
+        Serial.printf("FAIL: Q16 drifted from float (limits |h| %.3f, shade %.1f of 255)\n",
+            WAVE_MAX_HEIGHT_DEV, WAVE_MAX_SHADE_DEV * 255.0f);
+        return EXIT_FAILURE;
+    }
+    Serial.println("PASS");
+    return EXIT_SUCCESS;
+}
+
+static int runWaterReference(int tolerance) {
+    static rgb24 frame[NUM_LEDS];
+    static char line[16384];
+    const uint32_t seedMs = 1000;  // performance.now() pinned to 1000 ms in the script
+    uint32_t frames = 0, mismatched = 0;
+    int maxDiff = 0;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        if (strncmp(line, "drop ", 5) == 0) {
+            char layer[8];
+            unsigned x, y, radius, r, g, b;
+            float strength;
+            if (sscanf(line + 5, "%7s %u %u %f %u %u %u %u", layer, &x, &y, &strength, &radius, &r, &g, &b) != 8) {
+                continue;
+            }
+            WaterEvent e = {};
+            e.type = WATER_EVENT_DROP;
+            e.layer = strcmp(layer, "remote") == 0 ? WATER_LAYER_REMOTE : WATER_LAYER_LOCAL;
+            e.x = x;
+            e.y = y;
+            e.strength = strength;
+            e.radius = radius;
+            e.hasTint = true;
+            e.r = r;
+            e.g = g;
+            e.b = b;
+            postWaterEvent(e);
+        } else if (strncmp(line, "step", 4) == 0) {
+            waterRendererTick(seedMs);
+        } else if (strncmp(line, "frame ", 6) == 0) {
+            renderWater(frame);
+            char* p = line + 6;
+            for (uint16_t i = 0; i < NUM_LEDS * 3; i++) {
+                int expected = (int)strtol(p, &p, 10);
+                const rgb24& px = frame[i / 3];
+                int actual = i % 3 == 0 ? px.red : i % 3 == 1 ? px.green : px.blue;
+                int diff = abs(actual - expected);
+                if (diff > tolerance) {
+                    mismatched++;
+                }
+                maxDiff = diff > maxDiff ? diff : maxDiff;
+            }
+            frames++;
+        }
+    }
+
+    Serial.printf("Water reference (%s): %u frames, max channel diff %d, %u channels off by more than %d\n",
+        WATER_FIXED_POINT ? "Q16" : "float", frames, maxDiff, mismatched, tolerance);
+    bool ok = frames > 0 && mismatched == 0;
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static std::vector<uint8_t> parseHex(const char* p) {
+    std::vector<uint8_t> bytes;
+    while (isxdigit((unsigned char)p[0]) && isxdigit((unsigned char)p[1])) {
+        char pair[3] = { p[0], p[1], 0 };
+        bytes.push_back((uint8_t)strtoul(pair, nullptr, 16));
+        p += 2;
+    }
+    return bytes;
+}
+
+// Constant arrival time: later captures then always look fastest, so
+// nothing in a replayed trace is ever stale
+#define REPLAY_ARRIVAL_MS 1000000
+
+static int runCodec() {
+    static rgb24 expected[NUM_LEDS];
+    static char line[8192];
+    std::vector<std::vector<uint8_t>> packets, images;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        if (strncmp(line, "packet ", 7) == 0) {
+            packets.push_back(parseHex(line + 7));
+        } else if (strncmp(line, "expect ", 7) == 0) {
+            images.push_back(parseHex(line + 7));
+        }
+    }
+    if (packets.empty() || packets.size() != images.size()) {
+        Serial.println("Codec: no packets on stdin");
+        Serial.println("FAIL");
+        return EXIT_FAILURE;
+    }
+
+    framePipelineBegin(&display);
+    bool ok = true;
+    const FrameIngestMode modes[] = { FRAME_INGEST_COPY, FRAME_INGEST_DIRECT, FRAME_INGEST_DECODED };
+    for (FrameIngestMode mode : modes) {
+        for (uint32_t presentEvery = 1; presentEvery <= 2; presentEvery++) {
+            setFrameIngestMode(mode);
+            resetFrameStream();
+            const uint32_t rejectedBefore = getRejectedFrameCount();
+            uint32_t checked = 0, mismatched = 0;
+
+            for (size_t i = 0; i < packets.size(); i++) {
+                receiveFrameAt(packets[i].data(), packets[i].size(), REPLAY_ARRIVAL_MS);
+                if ((i + 1) % presentEvery != 0 && i + 1 != packets.size()) {
+                    continue;
+                }
+                presentPendingFrame();
+                decodeRGB565(images[i].data(), expected, NUM_LEDS);
+                if (memcmp(display.frontBuffer(), expected, sizeof(expected)) != 0) {
+                    mismatched++;
+                }
+                checked++;
+            }
+
+            const uint32_t rejected = getRejectedFrameCount() - rejectedBefore;
+            Serial.printf("Codec %-7s present 1/%u: %u payloads, %u images checked, %u mismatched, %u rejected\n",
+                ingestModeName(mode), presentEvery,
+                (unsigned)packets.size(), checked, mismatched, rejected);
+            ok = ok && mismatched == 0 && rejected == 0;
+        }
+    }
+
+    const FrameStreamStats stats = getFrameStreamStats();
+    Serial.printf("Headed payloads: %u, lost %u, reordered %u, stale %u\n",
+        (unsigned)stats.sequenced, (unsigned)stats.lost, (unsigned)stats.reordered, (unsigned)stats.stale);
+    ok = ok && stats.sequenced > 0 && stats.lost == 0 && stats.reordered == 0 && stats.stale == 0;
+
+    // A delta with no keyframe in front of it must be refused
+    setFrameIngestMode(FRAME_INGEST_DIRECT);
+    for (size_t i = 0; i < packets.size(); i++) {
+        if (packets[i][0] == FRAME_FORMAT_TILES565 && packets[i].size() != BUFFER_SIZE) {
+            const bool accepted = receiveFrame(packets[i].data(), packets[i].size());
+            Serial.printf("Orphan delta: %s\n", accepted ? "accepted" : "rejected");
+            ok = ok && !accepted;
+            break;
+        }
+    }
+
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static std::vector<uint8_t> headed(uint16_t sequence, uint32_t captureMs, const std::vector<uint8_t>& typed) {
+    std::vector<uint8_t> out(FRAME_HEADER_SIZE + typed.size());
+    out[0] = FRAME_HEADER_V1;
+    out[1] = sequence >> 8;
+    out[2] = sequence & 0xFF;
+    out[3] = captureMs >> 24;
+    out[4] = (captureMs >> 16) & 0xFF;
+    out[5] = (captureMs >> 8) & 0xFF;
+    out[6] = captureMs & 0xFF;
+    memcpy(out.data() + FRAME_HEADER_SIZE, typed.data(), typed.size());
+    return out;
+}
+
+static std::vector<uint8_t> typedFrame(uint8_t format, uint32_t seed) {
+    std::vector<uint8_t> out(1 + BUFFER_SIZE, format);
+    makeFrame(out.data() + 1, seed);
+    return out;
+}
+
+// One solid 8×8 tile
+static std::vector<uint8_t> tileDelta(uint8_t index, uint16_t rgb16) {
+    std::vector<uint8_t> out = { FRAME_FORMAT_TILES565, 8, 1, index };
+    for (uint8_t i = 0; i < 64; i++) {
+        out.push_back(rgb16 >> 8);
+        out.push_back(rgb16 & 0xFF);
+    }
+    return out;
+}
+
+static int runSequence() {
+    const uint32_t FRESH = 40, STALE = 40 + FRAME_MAX_AGE_MS + 100;
+    static uint8_t image[BUFFER_SIZE];   // everything the pipeline should have absorbed
+    static rgb24 expected[NUM_LEDS], previous[NUM_LEDS];
+    framePipelineBegin(&display);
+    bool ok = true;
+
+    const FrameIngestMode modes[] = { FRAME_INGEST_COPY, FRAME_INGEST_DIRECT, FRAME_INGEST_DECODED };
+    for (FrameIngestMode mode : modes) {
+        setFrameIngestMode(mode);
+        resetFrameStream();
+        const FrameStreamStats before = getFrameStreamStats();
+        uint32_t captureMs = 10000, failures = 0;
+
+        auto absorb = [&](const std::vector<uint8_t>& typed) {
+            if (typed[0] == FRAME_FORMAT_TILES565) {
+                applyTiles565(typed.data(), image);
+            } else {
+                memcpy(image, typed.data() + 1, BUFFER_SIZE);
+            }
+        };
+        // Send and present; a shown frame must be `image`, otherwise the
+        // panel must not change
+        auto step = [&](uint16_t sequence, const std::vector<uint8_t>& typed, uint32_t delay, bool shown) {
+            captureMs += 33;
+            const std::vector<uint8_t> payload = headed(sequence, captureMs, typed);
+            memcpy(previous, display.frontBuffer(), sizeof(previous));
+            receiveFrameAt(payload.data(), payload.size(), captureMs + delay);
+            const bool presented = presentPendingFrame();
+            decodeRGB565(image, expected, NUM_LEDS);
+            const rgb24* want = shown ? expected : previous;
+            if (presented != shown || memcmp(display.frontBuffer(), want, sizeof(expected)) != 0) {
+                failures++;
+            }
+        };
+
+        const auto key = typedFrame(FRAME_FORMAT_KEY565, 1);
+        const auto bare = typedFrame(FRAME_FORMAT_RAW565, 2);
+        const auto staleBare = typedFrame(FRAME_FORMAT_RAW565, 3);
+        const auto d1 = tileDelta(3, 0xF800), d2 = tileDelta(5, 0x07E0), d3 = tileDelta(7, 0x001F);
+
+        absorb(key);
+        step(0, key, FRESH, true);
+        absorb(d1);
+        step(1, d1, FRESH, true);
+        absorb(d2);
+        step(2, d2, STALE, false);      // not shown, but still applied...
+        absorb(d3);
+        step(3, d3, FRESH, true);       // ...so it appears with the next delta
+        step(3, d3, FRESH, false);      // duplicate
+        step(2, d2, FRESH, false);      // late
+        step(5, d1, FRESH, false);      // 4 lost: the delta stream is broken
+        absorb(key);
+        step(6, key, FRESH, true);
+        step(7, staleBare, STALE, false);
+        absorb(bare);
+        step(8, bare, FRESH, true);
+        step(0, bare, FRESH, false);    // looks late...
+        resetFrameStream();             // ...until the phone's rejoin is seen
+        step(0, bare, FRESH, true);
+        step(40000, bare, FRESH, true); // far off: a new stream
+
+        const FrameStreamStats after = getFrameStreamStats();
+        const uint32_t lost = after.lost - before.lost;
+        const uint32_t reordered = after.reordered - before.reordered;
+        const uint32_t stale = after.stale - before.stale;
+        Serial.printf("Sequence %-7s: lost %u, reordered %u, stale %u, %u wrong steps\n",
+            ingestModeName(mode),
+            (unsigned)lost, (unsigned)reordered, (unsigned)stale, (unsigned)failures);
+        ok = ok && failures == 0 && lost == 1 && reordered == 3 && stale == 2;
+    }
+
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── Jitter Traces ───────────────────────────────────────────────────────────
+
+#define TRACE_FRAMES      600     // 20 s at 30 fps
+#define TRACE_INTERVAL_US 33333
+
+enum TraceKind { TRACE_STEADY, TRACE_BURSTS, TRACE_HICCUPS, TRACE_RANDOM, TRACE_COUNT };
+static const char* const TRACE_NAMES[TRACE_COUNT] = { "steady", "bursts", "hiccups", "random" };
+
+// Arrival times (µs) of frames sent every TRACE_INTERVAL_US
+static std::vector<uint32_t> makeTrace(TraceKind kind) {
+    std::vector<uint32_t> arrivals;
+    uint32_t rng = 12345;
+    for (uint32_t i = 0; i < TRACE_FRAMES; i++) {
+        uint32_t sent = 100000 + i * TRACE_INTERVAL_US;
+        uint32_t at = sent;
+        switch (kind) {
+            case TRACE_STEADY:
+                break;
+            case TRACE_BURSTS:      // WiFi power save: frames arrive in pairs
+                at = sent + (i % 2 == 0 ? TRACE_INTERVAL_US - 1000 : 0);
+                break;
+            case TRACE_HICCUPS: {   // 200 ms stall every 3 s, then a catch-up burst
+                uint32_t phase = sent % 3000000;
+                if (phase < 200000) {
+                    at = sent - phase + 200000 + (phase / TRACE_INTERVAL_US) * 500;
+                }
+                break;
+            }
+            case TRACE_RANDOM:      // 0..30 ms of extra delay per frame
+                rng = rng * 1664525 + 1013904223;
+                at = sent + (rng >> 8) % 30000;
+                break;
+            default:
+                break;
+        }
+        // Frames come over one TCP stream: never ahead of the one before
+        if (!arrivals.empty() && at < arrivals.back()) {
+            at = arrivals.back();
+        }
+        arrivals.push_back(at);
+    }
+    return arrivals;
+}
+
+struct CadenceResult {
+    uint32_t presented;
+    uint32_t lost;         // never shown (overwritten / dropped)
+    uint32_t stalls;       // present gaps over 1.5 × the send interval
+    double intervalSdMs;   // spread of the time between presents
+    double latencyMs;      // mean arrival → present
+};
+
+static CadenceResult summarizeCadence(const std::vector<uint32_t>& presents, const std::vector<uint32_t>& latencies) {
+    CadenceResult r = {};
+    r.presented = presents.size();
+    double sum = 0, sumSq = 0;
+    for (size_t i = 1; i < presents.size(); i++) {
+        double gap = (presents[i] - presents[i - 1]) / 1000.0;
+        sum += gap;
+        sumSq += gap * gap;
+        if (gap > 1.5 * TRACE_INTERVAL_US / 1000.0) {
+            r.stalls++;
+        }
+    }
+    size_t n = presents.size() > 1 ? presents.size() - 1 : 1;
+    double mean = sum / n;
+    r.intervalSdMs = sqrt(std::max(0.0, sumSq / n - mean * mean));
+    double latency = 0;
+    for (uint32_t l : latencies) {
+        latency += l / 1000.0;
+    }
+    r.latencyMs = latencies.empty() ? 0 : latency / latencies.size();
+    return r;
+}
+
+static int runJitter(uint32_t refreshHz) {
+    if (refreshHz < 30 || refreshHz > 1000) {
+        refreshHz = 120;
+    }
+    const uint32_t tickUs = 1000000 / refreshHz;
+    bool ok = true;
+
+    Serial.printf("Jitter traces, %u frames at %u us, presented at %u Hz refresh\n",
+        TRACE_FRAMES, TRACE_INTERVAL_US, (unsigned)refreshHz);
+    Serial.printf("%-8s %-7s %9s %6s %7s %9s %11s %6s %6s\n",
+        "trace", "mode", "presented", "lost", "stalls", "sd ms", "latency ms", "under", "depth");
+
+    for (int k = 0; k < TRACE_COUNT; k++) {
+        const std::vector<uint32_t> arrivals = makeTrace((TraceKind)k);
+        const uint32_t endUs = arrivals.back() + 500000;
+
+        // Present on arrival: newest frame at the next refresh
+        std::vector<uint32_t> presents, latencies;
+        size_t next = 0;
+        uint32_t lost = 0;
+        for (uint32_t t = 0; t < endUs; t += tickUs) {
+            size_t arrived = 0;
+            for (; next < arrivals.size() && arrivals[next] <= t; next++) {
+                arrived++;
+            }
+            if (arrived) {
+                lost += arrived - 1;
+                presents.push_back(t);
+                latencies.push_back(t - arrivals[next - 1]);
+            }
+        }
+        CadenceResult direct = summarizeCadence(presents, latencies);
+        direct.lost = lost;
+
+        // Jitter buffer, same capacity and depth range as the pipeline
+        static JitterBuffer<sizeof(uint32_t), FRAME_JITTER_CAPACITY> jitter;
+        jitter.configure(FRAME_JITTER_MIN_DEPTH, FRAME_JITTER_MAX_DEPTH, TRACE_INTERVAL_US, tickUs);
+        presents.clear();
+        latencies.clear();
+        next = 0;
+        uint32_t maxDepth = 0;
+        for (uint32_t t = 0; t < endUs; t += tickUs) {
+            for (; next < arrivals.size() && arrivals[next] <= t; next++) {
+                jitter.push((const uint8_t*)&next, arrivals[next]);
+            }
+            uint32_t arrivedUs;
+            if (jitter.due(t, &arrivedUs)) {
+                jitter.consumed();
+                presents.push_back(t);
+                latencies.push_back(t - arrivedUs);
+            }
+            maxDepth = std::max<uint32_t>(maxDepth, jitter.stats().targetDepth);
+        }
+        CadenceResult buffered = summarizeCadence(presents, latencies);
+        const JitterStats js = jitter.stats();
+        buffered.lost = js.overruns;
+
+        Serial.printf("%-8s %-7s %9u %6u %7u %9.2f %11.1f %6s %6s\n", TRACE_NAMES[k], "arrival",
+            direct.presented, direct.lost, direct.stalls, direct.intervalSdMs, direct.latencyMs, "-", "-");
+        Serial.printf("%-8s %-7s %9u %6u %7u %9.2f %11.1f %6u %6u\n", TRACE_NAMES[k], "jitter",
+            buffered.presented, buffered.lost, buffered.stalls, buffered.intervalSdMs, buffered.latencyMs,
+            (unsigned)js.underruns, (unsigned)maxDepth);
+
+        if (k == TRACE_STEADY) {
+            // The one underrun is the end of the trace; the spread is the
+            // interval not being a whole number of refreshes
+            ok = ok && buffered.lost == 0 && js.underruns <= 1 && buffered.intervalSdMs < 0.5;
+        } else if (k != TRACE_HICCUPS) {
+            // Hiccups can't be hidden with 3 frames of depth; the rest must get smoother
+            ok = ok && buffered.intervalSdMs < direct.intervalSdMs;
+        }
+    }
+
+    // Render stall: twice the capacity arrives with nothing presented, then
+    // the render side resumes. The frames kept must be the newest ones.
+    {
+        static JitterBuffer<sizeof(uint32_t), FRAME_JITTER_CAPACITY> jitter;
+        jitter.configure(FRAME_JITTER_MIN_DEPTH, FRAME_JITTER_MAX_DEPTH, TRACE_INTERVAL_US, tickUs);
+        const uint32_t pushed = 2 * FRAME_JITTER_CAPACITY + 1;
+        uint32_t t = 0;
+        for (uint32_t frame = 0; frame < pushed; frame++, t += TRACE_INTERVAL_US) {
+            jitter.push((const uint8_t*)&frame, t);
+        }
+        std::vector<uint32_t> shown;
+        for (uint32_t end = t + 500000; t < end; t += tickUs) {
+            const uint8_t* frame = jitter.due(t);
+            if (frame) {
+                uint32_t id;
+                memcpy(&id, frame, sizeof(id));
+                shown.push_back(id);
+                jitter.consumed();
+            }
+        }
+        const JitterStats js = jitter.stats();
+        bool inOrder = !shown.empty();
+        for (size_t i = 1; i < shown.size(); i++) {
+            inOrder = inOrder && shown[i] > shown[i - 1];
+        }
+        Serial.printf("Render stall: %u pushed, %u presented (%u..%u), %u overruns\n", (unsigned)pushed,
+            (unsigned)shown.size(), shown.empty() ? 0 : (unsigned)shown.front(),
+            shown.empty() ? 0 : (unsigned)shown.back(), (unsigned)js.overruns);
+        ok = ok && inOrder && shown.back() == pushed - 1 && shown.size() + js.overruns == pushed;
+    }
+
+    // Same trace through the pipeline: in order, nothing torn
+    framePipelineBegin(&display);
+    setFrameIngestMode(FRAME_INGEST_JITTER);
+    const std::vector<uint32_t> arrivals = makeTrace(TRACE_RANDOM);
+    static uint8_t payload[BUFFER_SIZE];
+    uint32_t presented = 0, disorder = 0;
+    uint16_t lastSeq = 0;
+    size_t next = 0;
+    for (uint32_t t = 0; t < arrivals.back() + 500000; t += tickUs) {
+        for (; next < arrivals.size() && arrivals[next] <= t; next++) {
+            makeSequenceFrame(payload, (uint16_t)(next + 1));
+            receiveFrameAt(payload, BUFFER_SIZE, arrivals[next] / 1000);
+        }
+        if (presentPendingFrameAt(t)) {
+            const uint16_t seq = pixelSequence(display.frontBuffer()[0]);
+            disorder += seq <= lastSeq;
+            lastSeq = seq;
+            presented++;
+        }
+    }
+    const JitterStats js = getJitterStats();
+    Serial.printf("Pipeline (jitter ingest): %u presented, %u out of order, last %u of %u, target depth %u, jitter %u us\n",
+        presented, disorder, lastSeq, TRACE_FRAMES, js.targetDepth, (unsigned)js.jitterUs);
+    ok = ok && disorder == 0 && lastSeq == TRACE_FRAMES && presented + js.overruns == TRACE_FRAMES;
+    setFrameIngestMode(FRAME_INGEST_DEFAULT);
+
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── Timestep ────────────────────────────────────────────────────────────────
+
+static int runTimestep() {
+    static const uint32_t LOOP_HZ[] = { 30, 60, 62, 120, 144 };   // 62: once per tick (62.5 Hz)
+    static const uint32_t RUN_US = 20000000;
+    static const uint32_t STALL_AT_US = 10000000;
+    static const uint32_t STALL_US = 300000;
+    const uint32_t tickUs = WATER_STEP_MS * 1000;
+    bool ok = true;
+
+    Serial.printf("Fixed timestep: %u us ticks, catch-up %u, %u s runs with one %u ms stall\n",
+        (unsigned)tickUs, (unsigned)WATER_MAX_CATCH_UP, (unsigned)(RUN_US / 1000000), (unsigned)(STALL_US / 1000));
+    Serial.printf("%-8s %7s %7s %9s %8s %9s %10s\n", "loop Hz", "wakes", "ticks", "ticks/s", "dropped", "max/wake", "idle wakes");
+
+    for (uint32_t hz : LOOP_HZ) {
+        const uint32_t periodUs = hz == 62 ? tickUs : 1000000 / hz;
+        FixedTimestep clock;
+        clock.configure(tickUs, WATER_MAX_CATCH_UP);
+
+        uint32_t rng = 12345 + hz;
+        uint32_t wakes = 0, maxSteps = 0, idle = 0, bursts = 0, droppedBeforeStall = 0;
+        bool stalled = false;
+        uint32_t t = 1000;   // arbitrary start
+        const uint32_t start = t;
+        for (; t - start < RUN_US; t += periodUs) {
+            if (!stalled && t - start >= STALL_AT_US) {
+                stalled = true;
+                droppedBeforeStall = clock.stats().dropped;
+                t += STALL_US;
+            }
+            rng = rng * 1664525 + 1013904223;
+            const uint32_t jitterUs = (rng >> 16) % 401;   // ±200 µs of timer jitter
+            const uint32_t steps = clock.due(t + jitterUs - 200);
+            wakes++;
+            idle += steps == 0;
+            bursts += steps > 1;
+            maxSteps = std::max(maxSteps, steps);
+        }
+        const FixedTimestepStats stats = clock.stats();
+        const double elapsedS = (double)(t - start) / 1e6;
+        const double expected = (double)(t - start) / tickUs;
+        const double rate = stats.ticks / elapsedS;
+        Serial.printf("%-8s %7u %7u %9.2f %8u %9u %10u\n", hz == 62 ? "62.5" : std::to_string(hz).c_str(),
+            wakes, (unsigned)stats.ticks, rate, (unsigned)stats.dropped, maxSteps, idle);
+
+        // Every tick is either run or dropped (±2: phase and the last wake)
+        ok = ok && fabs(stats.ticks + stats.dropped - expected) <= 2.0;
+        ok = ok && maxSteps <= WATER_MAX_CATCH_UP && droppedBeforeStall == 0;
+        // The stall drops its backlog beyond the catch-up, and nothing else
+        const uint32_t backlog = (STALL_US + periodUs) / tickUs + 1;
+        ok = ok && stats.dropped + WATER_MAX_CATCH_UP >= backlog - 1 && stats.dropped <= backlog;
+        if (hz == 62) {
+            // Once per tick: one step per wake, never 0 then 2 on jitter (bar the stall's wake)
+            ok = ok && idle == 0 && bursts <= 1;
+        }
+    }
+
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── Lockstep ────────────────────────────────────────────────────────────────
+
+static uint32_t shadingChecksum(const int32_t* shade) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < WAVE_CELLS; i++) {
+        hash = (hash ^ (uint32_t)shade[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t shadingChecksum(const WaveKernel<Q16>& kernel) {
+    static Q16 shade[WAVE_CELLS];
+    static int32_t raw[WAVE_CELLS];
+    kernel.getShadingMap(shade);
+    for (int i = 0; i < WAVE_CELLS; i++) {
+        raw[i] = shade[i].raw;
+    }
+    return shadingChecksum(raw);
+}
+
+// The web client's water core (wasm/water_core.cpp, native/water_core_host.cpp)
+extern "C" {
+void water_reset(int i);
+void water_reset_parameters(int i);
+void water_set_wave_damp(int i, float val);
+void water_set_render_gain(int i, float val);
+void water_drop(int i, uint32_t tick, int x, int y, int radius, int burst, int strength);
+void water_step(int i);
+int water_idle(int i);
+uint32_t water_checksum(int i);
+const int32_t* water_shade(int i);
+}
+
+#if WATER_FIXED_POINT
+/**
+ * The renderer side of the log: a sync point joins it, an event lost to a
+ * full queue leaves it (asking for a resync, and again while unanswered),
+ * and the next sync point joins it again. The flat water then skips
+ * straight to the horizon and reports itself flat from there; an event
+ * lost right after the sync point leaves the log again.
+ */
+static bool checkResync() {
+    setWaterLockstep(true);
+    WaterEvent sync = {};
+    sync.type = WATER_EVENT_RESET;
+    sync.layer = WATER_LAYER_BOTH;
+    sync.stamped = true;
+    sync.tick = 10;
+    postWaterEvent(sync);
+    setWaterHorizon(20);
+    waterRendererTick(0, 1);
+    const bool joined = getWaterLockstepStats().synced;
+
+    WaterEvent drop = {};
+    drop.type = WATER_EVENT_DROP;
+    drop.layer = WATER_LAYER_LOCAL;
+    drop.stamped = true;
+    drop.tick = 30;
+    drop.strength = 1.0f;
+    uint32_t posted = 0;
+    while (postWaterEvent(drop)) {
+        posted++;
+    }
+    waterRendererTick(0, 1);
+    const WaterLockstepStats left = getWaterLockstepStats();
+    const bool asked = takeWaterResyncRequest() && !takeWaterResyncRequest();
+
+    // Whatever was queued behind the hole is skipped until the sync point;
+    // with no answer, the request goes out again (the tick that left counts)
+    waterRendererTick(0, WATER_LOCKSTEP_RESYNC_TICKS - 2);
+    const bool waited = !takeWaterResyncRequest();
+    waterRendererTick(0, 1);
+    const bool retried = takeWaterResyncRequest();
+
+    sync.tick = 50;
+    postWaterEvent(sync);
+    setWaterHorizon(60);
+    waterRendererTick(0, 1);
+    const WaterLockstepStats rejoined = getWaterLockstepStats();
+    uint32_t holdTick = 0;
+    const bool held = takeWaterHold(&holdTick) && holdTick == 61;
+
+    // Left again right after the sync point: a departure of its own
+    postWaterEvent(drop);
+    while (postWaterEvent(drop)) {
+    }
+    waterRendererTick(0, 1);
+    const WaterLockstepStats again = getWaterLockstepStats();
+    const bool askedAgain = takeWaterResyncRequest();
+    setWaterLockstep(false);
+
+    Serial.printf("Resync: joined %d, %u queued then one lost: synced %d, %u resyncs, asked %d, "
+        "again after %u ticks out %d; rejoined at tick %u: %d, flat from tick %u; "
+        "lost one at once: synced %d, %u resyncs, asked %d\n", joined, (unsigned)posted, left.synced,
+        (unsigned)left.resyncs, asked, (unsigned)WATER_LOCKSTEP_RESYNC_TICKS, waited && retried,
+        (unsigned)rejoined.tick, rejoined.synced, (unsigned)holdTick, again.synced, (unsigned)again.resyncs,
+        askedAgain);
+    return joined && !left.synced && left.resyncs == 1 && asked && waited && retried &&
+        rejoined.synced && rejoined.tick == 61 && held && rejoined.stalls == 0 &&
+        !again.synced && again.resyncs == 2 && askedAgain;
+}
+#endif
+
+static int runLockstep() {
+    static WaveKernel<Q16> kernel;
+    static char line[256];
+    uint32_t tick = 0, checks = 0, mismatched = 0, events = 0, traces = 0, idleChecks = 0;
+    uint32_t coreMismatched = 0;
+    char name[32] = "";
+
+    // Each record's tick is where the C++ side must be before applying it.
+    // The water core plays every trace on both its layers.
+    auto stepTo = [&](uint32_t target) {
+        for (; tick < target; tick++) {
+            kernel.step();
+            water_step(0);
+            water_step(1);
+        }
+    };
+
+    while (fgets(line, sizeof(line), stdin)) {
+        unsigned t, x, y, radius, burst, idle;
+        float a, b;
+        char field[16], shading[16];
+        if (sscanf(line, "trace %31s", name) == 1) {
+            kernel.setDefaultParameters();
+            kernel.reset();
+            for (int i = 0; i < 2; i++) {
+                water_reset_parameters(i);
+                water_reset(i);
+            }
+            tick = 0;
+            traces++;
+        } else if (sscanf(line, "drop %u %u %u %f %u %u", &t, &x, &y, &a, &radius, &burst) == 6) {
+            stepTo(t);
+            LockstepDrop drop;
+            drop.tick = t;
+            drop.x = x;
+            drop.y = y;
+            drop.radius = radius;
+            drop.burst = burst;
+            drop.strength = (uint16_t)lrintf(a * LOCKSTEP_STRENGTH_ONE);
+            lockstepDrop(kernel, drop);
+            for (int i = 0; i < 2; i++) {
+                water_drop(i, t, x, y, radius, burst, drop.strength);
+            }
+            events++;
+        } else if (sscanf(line, "params %u %f %f", &t, &a, &b) == 3) {
+            stepTo(t);
+            kernel.setWaveDamp(a);
+            kernel.setRenderGain(b);
+            for (int i = 0; i < 2; i++) {
+                water_set_wave_damp(i, a);
+                water_set_render_gain(i, b);
+            }
+            events++;
+        } else if (sscanf(line, "reset %u", &t) == 1) {
+            stepTo(t);
+            kernel.reset();
+            water_reset(0);
+            water_reset(1);
+            events++;
+        } else if (sscanf(line, "check %u %15s %15s %u", &t, field, shading, &idle) == 4) {
+            stepTo(t);
+            const uint32_t expectedField = (uint32_t)strtoul(field, nullptr, 16);
+            const uint32_t expectedShading = (uint32_t)strtoul(shading, nullptr, 16);
+            const uint32_t actualField = lockstepChecksum(kernel);
+            const uint32_t actualShading = shadingChecksum(kernel);
+            if (actualField != expectedField || actualShading != expectedShading || kernel.isIdle() != (idle != 0)) {
+                if (mismatched++ < 5) {
+                    Serial.printf("%s tick %u: fields %08x (JS %08x), shading %08x (JS %08x), idle %d (JS %u)\n",
+                        name, t, (unsigned)actualField, (unsigned)expectedField,
+                        (unsigned)actualShading, (unsigned)expectedShading, kernel.isIdle(), idle);
+                }
+            }
+            for (int i = 0; i < 2; i++) {
+                const uint32_t coreField = water_checksum(i);
+                const uint32_t coreShading = shadingChecksum(water_shade(i));
+                const bool coreIdle = water_idle(i) != 0;
+                if (coreField != expectedField || coreShading != expectedShading || coreIdle != (idle != 0)) {
+                    if (coreMismatched++ < 5) {
+                        Serial.printf("%s tick %u, water core layer %d: fields %08x (JS %08x), shading %08x (JS %08x), idle %d (JS %u)\n",
+                            name, t, i, (unsigned)coreField, (unsigned)expectedField,
+                            (unsigned)coreShading, (unsigned)expectedShading, coreIdle, idle);
+                    }
+                }
+            }
+            idleChecks += kernel.isIdle();
+            checks++;
+        }
+    }
+
+    Serial.printf("Lockstep: %u traces, %u events, %u checkpoints (%u idle), %u mismatched\n",
+        traces, events, checks, idleChecks, mismatched);
+    Serial.printf("Water core (wasm/water_core.cpp, both layers): %u mismatched\n", coreMismatched);
+    bool ok = checks > 0 && idleChecks > 0 && mismatched == 0 && coreMismatched == 0;
+#if WATER_FIXED_POINT
+    ok = checkResync() && ok;
+#else
+    Serial.println("Resync: skipped, the renderer runs lockstep in Q16 only (env:native_q16)");
+#endif
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── Interpolation ───────────────────────────────────────────────────────────
+
+// blendRGB24 inner loop on the LX6, per 4-byte word: 2 loads, 1 store,
+// 4 MULL, 6 AND/shift, 3 ADD/OR, loop overhead; MULL is pipelined
+#define ESP32_CPU_MHZ             240
+#define ESP32_BLEND_CYCLES_PER_WORD 20
+
+static bool checkBlend() {
+    static rgb24 a[NUM_LEDS], b[NUM_LEDS], out[NUM_LEDS], expected[NUM_LEDS];
+    uint32_t rng = 777;
+    for (uint16_t i = 0; i < NUM_LEDS; i++) {
+        rng = rng * 1664525 + 1013904223;
+        a[i].red = rng >> 24;
+        a[i].green = rng >> 16;
+        a[i].blue = rng >> 8;
+        rng = rng * 1664525 + 1013904223;
+        b[i].red = rng >> 24;
+        b[i].green = rng >> 16;
+        b[i].blue = rng >> 8;
+    }
+    a[0] = rgb24(255, 255, 255);
+    b[1] = rgb24(255, 255, 255);
+
+    uint32_t mismatches = 0;
+    const uint16_t counts[] = { NUM_LEDS, NUM_LEDS - 1, 5 };   // whole words and byte tails
+    for (uint16_t pixels : counts) {
+        for (uint16_t w = 0; w <= BLEND_WEIGHT_MAX; w++) {
+            const uint8_t* pa = (const uint8_t*)a;
+            const uint8_t* pb = (const uint8_t*)b;
+            uint8_t* pe = (uint8_t*)expected;
+            for (size_t i = 0; i < (size_t)pixels * 3; i++) {
+                pe[i] = (uint8_t)((pa[i] * (BLEND_WEIGHT_MAX - w) + pb[i] * w) >> 8);
+            }
+            blendRGB24(a, b, out, pixels, w);
+            mismatches += memcmp(out, expected, (size_t)pixels * 3) != 0;
+        }
+    }
+    memcpy(out, a, sizeof(out));
+    blendRGB24(out, b, out, NUM_LEDS, 100);    // in place
+    blendRGB24(a, b, expected, NUM_LEDS, 100);
+    mismatches += memcmp(out, expected, sizeof(out)) != 0;
+
+    Serial.printf("blendRGB24 vs reference: %u mismatching weights\n", mismatches);
+    return mismatches == 0;
+}
+
+static int runInterpolate(uint32_t refreshHz) {
+    if (refreshHz < 30 || refreshHz > 1000) {
+        refreshHz = 120;
+    }
+    const uint32_t tickUs = 1000000 / refreshHz;
+    bool ok = checkBlend();
+
+    // Largest change per refresh if the fade is spread over the interval
+    // (plus a millisecond: arrivals are stamped in whole ms)
+    const uint32_t fadeStep = 255 * (tickUs + 1000) / TRACE_INTERVAL_US + 2;
+
+    framePipelineBegin(&display);
+    static uint8_t payload[BUFFER_SIZE];
+    // White as the selected engine decodes it (248 with SHIFT, 255 with LUT)
+    const uint8_t whiteBytes[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+    rgb24 white[2];
+    decodeRGB565(whiteBytes, white, 2);
+    Serial.printf("%-8s %-7s %9s %10s %9s %6s\n", "trace", "mode", "presented", "updates/s", "max step", "last");
+    const TraceKind traces[] = { TRACE_STEADY, TRACE_RANDOM };
+    for (TraceKind kind : traces) {
+        const std::vector<uint32_t> arrivals = makeTrace(kind);
+        for (int interpolate = 0; interpolate < 2; interpolate++) {
+            setFrameIngestMode(FRAME_INGEST_JITTER);
+            setFrameInterpolation(interpolate);
+            uint32_t presented = 0, maxStep = 0, firstUs = 0, lastUs = 0;
+            int level = -1;
+            size_t next = 0;
+            for (uint32_t t = 0; t < arrivals.back() + 500000; t += tickUs) {
+                for (; next < arrivals.size() && arrivals[next] <= t; next++) {
+                    memset(payload, next % 2 ? 0xFF : 0x00, BUFFER_SIZE);
+                    receiveFrameAt(payload, BUFFER_SIZE, arrivals[next] / 1000);
+                }
+                if (presentPendingFrameAt(t)) {
+                    const int red = display.frontBuffer()[0].red;
+                    if (level >= 0) {
+                        maxStep = std::max<uint32_t>(maxStep, abs(red - level));
+                    } else {
+                        firstUs = t;
+                    }
+                    level = red;
+                    lastUs = t;
+                    presented++;
+                }
+            }
+            const double rate = lastUs > firstUs ? presented * 1e6 / (lastUs - firstUs) : 0;
+            // Sent last: frame TRACE_FRAMES - 1, which is white
+            const bool endsOnLast = level == white[0].red;
+            Serial.printf("%-8s %-7s %9u %10.1f %9u %6s\n", TRACE_NAMES[kind],
+                interpolate ? "blend" : "plain", presented, rate, (unsigned)maxStep,
+                endsOnLast ? "ok" : "WRONG");
+            ok = ok && endsOnLast;
+            if (interpolate) {
+                ok = ok && rate >= 2 * 1e6 / TRACE_INTERVAL_US && maxStep <= fadeStep;
+            }
+        }
+    }
+    setFrameInterpolation(false);
+    setFrameIngestMode(FRAME_INGEST_DEFAULT);
+
+    // Estimated, not measured: the host can't run at the LX6's clock
+    const double blendUs = (double)(NUM_LEDS * 3 / 4) * ESP32_BLEND_CYCLES_PER_WORD / ESP32_CPU_MHZ;
+    Serial.printf("ESP32 estimate: blendRGB24 ~%.0f us per refresh = %.1f%% of %u us at %u Hz "
+                  "(measure with env:esp32dev_bench)\n",
+        blendUs, 100.0 * blendUs / tickUs, (unsigned)tickUs, (unsigned)refreshHz);
+
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── Socket ──────────────────────────────────────────────────────────────────
+
+#define SOCKET_FRAME_INTERVAL_US 16000
+#define SOCKET_WORK_US           5000    // a loop()'s render work, polled mode
+#define SOCKET_HICCUP_US         30000   // every SOCKET_HICCUP_EVERY loops: a slow WiFi or TLS call
+#define SOCKET_HICCUP_EVERY      25
+
+static std::vector<uint32_t> socketSentUs;
+static std::vector<uint32_t> socketLatencies;
+static uint16_t socketLastSeq;
+static uint32_t socketDisorder;
+static bool socketConnected;
+
+static void onSocketEvent(WStype_t type, uint8_t* payload, size_t length) {
+    if (type == WStype_CONNECTED) {
+        socketConnected = true;
+    }
+    if (type != WStype_BIN || length != BUFFER_SIZE) {
+        return;
+    }
+    receiveFrame(payload, length);
+    const uint16_t seq = (payload[0] << 8) | payload[1];
+    socketLatencies.push_back(micros() - socketSentUs[seq]);
+    socketDisorder += seq <= socketLastSeq;
+    socketLastSeq = seq;
+}
+
+static uint32_t percentileUs(std::vector<uint32_t> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(values.size() * p))];
+}
+
+static void busyFor(uint32_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+/** @brief Start the transport against a fresh server and pump it until the upgrade is through */
+template <typename Transport>
+static bool connectLoopback(Transport& client, LoopbackWebSocketServer& server) {
+    const uint16_t port = server.listen();
+    if (!port) {
+        return false;
+    }
+    socketConnected = false;
+    client.onEvent(onSocketEvent);
+    client.begin("127.0.0.1", port, "/", false);
+    bool accepted = false;
+    std::thread accepting([&]() { accepted = server.accept(2000); });
+    for (const uint32_t start = millis(); !socketConnected && millis() - start < 2000;) {
+        client.loop();   // polled: connects here; event: dispatches CONNECTED
+        delay(1);
+    }
+    accepting.join();
+    return accepted && socketConnected;
+}
+
+static TransportInboxStats socketInboxStats(const QueuedTransport& client) { return client.inboxStats(); }
+static TransportInboxStats socketInboxStats(const FrameTransport&) { return {}; }
+
+/** @brief Event-driven: networkTask wakes when a frame is queued; the work is on the render task */
+static void consumeSocket(QueuedTransport& client, const std::atomic<bool>& sending, uint32_t frames) {
+    std::thread render([&]() {
+        for (uint32_t i = 0; sending.load(); i++) {
+            busyFor(i % SOCKET_HICCUP_EVERY ? SOCKET_WORK_US : SOCKET_HICCUP_US);
+            presentPendingFrame();
+        }
+    });
+    while (sending.load() || socketLastSeq < frames) {
+        if (client.waitForMessage(50)) {
+            client.loop();
+        } else if (!sending.load()) {
+            break;
+        }
+    }
+    render.join();
+}
+
+/** @brief Polled: a single loop(), the socket then whatever else loop() does */
+static void consumeSocket(FrameTransport& client, const std::atomic<bool>& sending, uint32_t frames) {
+    for (uint32_t i = 0; sending.load() || socketLastSeq < frames; i++) {
+        client.loop();
+        busyFor(i % SOCKET_HICCUP_EVERY ? SOCKET_WORK_US : SOCKET_HICCUP_US);
+        presentPendingFrame();
+        if (!sending.load() && i > frames * 4) {
+            break;
+        }
+    }
+}
+
+/** @brief Stream frames to one transport; false unless every frame arrived in order */
+template <typename Transport>
+static bool runSocketPass(uint32_t frames, uint32_t& p99) {
+    const bool event = std::is_base_of<QueuedTransport, Transport>::value;
+    LoopbackWebSocketServer server;
+    Transport client;
+    if (!connectLoopback(client, server)) {
+        Serial.println("Loopback socket failed");
+        return false;
+    }
+
+    socketSentUs.assign(frames + 1, 0);
+    socketLatencies.clear();
+    socketLastSeq = 0;
+    socketDisorder = 0;
+    std::atomic<bool> sending{true};
+
+    // Stand-in for the phone + server
+    std::thread phone([&]() {
+        static uint8_t payload[BUFFER_SIZE];
+        for (uint32_t seq = 1; seq <= frames; seq++) {
+            makeSequenceFrame(payload, (uint16_t)seq);
+            socketSentUs[seq] = micros();
+            server.sendBinary(payload, BUFFER_SIZE);
+            busyFor(SOCKET_FRAME_INTERVAL_US);
+        }
+        sending.store(false);
+    });
+
+    consumeSocket(client, sending, frames);
+    phone.join();
+    client.disconnect();
+
+    const TransportInboxStats inbox = socketInboxStats(client);
+    p99 = percentileUs(socketLatencies, 0.99);
+    char queueUs[12] = "-";
+    if (event) {
+        snprintf(queueUs, sizeof(queueUs), "%u", (unsigned)inbox.meanLatencyUs);
+    }
+    Serial.printf("%-7s %9u %8u %8u %8u %8s %10u\n", event ? "event" : "polled",
+        (unsigned)socketLatencies.size(), percentileUs(socketLatencies, 0.5), p99,
+        percentileUs(socketLatencies, 1.0), queueUs, (unsigned)(inbox.overflows + inbox.oversized));
+    return socketLatencies.size() == frames && socketDisorder == 0 && socketLastSeq == frames
+        && (!event || inbox.frames == frames);
+}
+
+static int runSocket(uint32_t frames) {
+    if (frames == 0 || frames > 0xFFFE) {
+        frames = 250;
+    }
+    framePipelineBegin(&display);
+    setFrameIngestMode(FRAME_INGEST_COPY);
+    uint32_t p99[2] = {};
+
+    Serial.printf("%u frames every %u us over TCP loopback; polled loop does %u us of work, %u us every %u loops\n",
+        frames, SOCKET_FRAME_INTERVAL_US, SOCKET_WORK_US, SOCKET_HICCUP_US, SOCKET_HICCUP_EVERY);
+    Serial.printf("%-7s %9s %8s %8s %8s %8s %10s\n", "mode", "received", "p50 us", "p99 us", "max us", "queue us", "dropped");
+
+    bool ok = runSocketPass<WebSocketsTransport<PersistentWebSocketClient>>(frames, p99[0]);
+    ok = runSocketPass<SocketTaskTransport<PersistentWebSocketClient>>(frames, p99[1]) && ok;
+    Serial.println("queue us: mean arrival → dispatched, from the socket task's inbox stats");
+    setFrameIngestMode(FRAME_INGEST_DEFAULT);
+
+    ok = ok && p99[1] < p99[0];
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── UDP ─────────────────────────────────────────────────────────────────────
+
+#define LINK_DELAY_US      20000   // one way
+#define LINK_JITTER_US     8000    // extra, uniform; under the frame interval, so frames don't swap
+#define LINK_MSS           1400    // TCP segment payload
+#define LINK_RTO_US        200000  // Linux's minimum; lwIP's is longer
+#define LINK_FRAMES        300
+
+struct LinkEvent {
+    uint32_t dueUs;   // from the start of the run
+    uint16_t seq;
+    uint8_t chunk;    // UDP: datagram index; TCP: unused (whole frame)
+};
+
+/**
+ * @brief When each frame (TCP) or datagram (UDP) comes out of the link
+ *
+ * Frame `seq` leaves at seq × SOCKET_FRAME_INTERVAL_US. Lost datagrams
+ * are simply missing. A lost TCP segment arrives an RTO later (doubling
+ * each time it is lost again), and TCP hands the frame over only once it
+ * and every frame before it are complete.
+ */
+static std::vector<LinkEvent> scheduleLink(uint32_t frames, uint32_t lossPct, bool tcp) {
+    std::vector<LinkEvent> events;
+    uint32_t rng = 12345;
+    auto roll = [&rng](uint32_t range) {
+        rng = rng * 1664525u + 1013904223u;
+        return (rng >> 8) % range;
+    };
+    uint32_t delivered = 0;
+    for (uint32_t seq = 1; seq <= frames; seq++) {
+        const uint32_t sent = seq * SOCKET_FRAME_INTERVAL_US;
+        if (tcp) {
+            uint32_t complete = 0;
+            for (uint32_t offset = 0; offset < BUFFER_SIZE; offset += LINK_MSS) {
+                uint32_t at = sent + LINK_DELAY_US + roll(LINK_JITTER_US);
+                for (uint32_t rto = LINK_RTO_US; roll(100) < lossPct; rto *= 2) {
+                    at += rto;
+                }
+                complete = std::max(complete, at);
+            }
+            delivered = std::max(delivered, complete);
+            events.push_back({ delivered, (uint16_t)seq, 0 });
+        } else {
+            for (uint8_t chunk = 0; chunk < udpChunkCount(BUFFER_SIZE); chunk++) {
+                const uint32_t at = sent + LINK_DELAY_US + roll(LINK_JITTER_US);
+                if (roll(100) >= lossPct) {
+                    events.push_back({ at, (uint16_t)seq, chunk });
+                }
+            }
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+        [](const LinkEvent& a, const LinkEvent& b) { return a.dueUs < b.dueUs; });
+    return events;
+}
+
+/** @brief Start the clock: frame seq counts as sent at its departure time */
+static uint32_t startLink(uint32_t frames) {
+    const uint32_t startUs = micros();
+    for (uint32_t seq = 1; seq <= frames; seq++) {
+        socketSentUs[seq] = startUs + seq * SOCKET_FRAME_INTERVAL_US;
+    }
+    return startUs;
+}
+
+/** @brief Sleep until each event is due and hand it to send(event) */
+template <typename Send>
+static void playLink(const std::vector<LinkEvent>& events, uint32_t startUs, Send send) {
+    for (const LinkEvent& e : events) {
+        const int32_t wait = (int32_t)(startUs + e.dueUs - micros());
+        if (wait > 0) {
+            busyFor((uint32_t)wait);
+        }
+        send(e);
+    }
+}
+
+/** @brief Consumer side: dispatch until the link is done and the last frame is in */
+template <typename Client>
+static void drainLink(Client& client, const std::atomic<bool>& linkDone) {
+    for (;;) {
+        const bool done = linkDone.load();
+        if (client.waitForMessage(50)) {
+            client.loop();
+            presentPendingFrame();
+        } else if (done) {
+            break;
+        }
+    }
+}
+
+static bool runUdpPath(uint32_t frames, uint32_t lossPct, const std::vector<LinkEvent>& events) {
+    const int relay = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in relayAddr = {};
+    relayAddr.sin_family = AF_INET;
+    relayAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t relayLength = sizeof(relayAddr);
+    timeval timeout = { 1, 0 };
+    if (relay < 0 || ::bind(relay, (sockaddr*)&relayAddr, sizeof(relayAddr)) != 0 ||
+        ::getsockname(relay, (sockaddr*)&relayAddr, &relayLength) != 0 ||
+        setsockopt(relay, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0) {
+        Serial.println("Relay socket failed");
+        return false;
+    }
+
+    UdpFrameReceiver receiver;
+    receiver.onEvent(onSocketEvent);
+    const uint32_t token = 0x5EED0000u + lossPct;
+    if (!receiver.begin(0)) {
+        Serial.println("Receiver socket failed");
+        ::close(relay);
+        return false;
+    }
+    receiver.setServer(htonl(INADDR_LOOPBACK), ntohs(relayAddr.sin_port), token);
+
+    // The relay learns where the matrix is from its registration
+    uint8_t datagram[UDP_HEADER_SIZE + UDP_CHUNK_BYTES];
+    sockaddr_in matrixAddr = {};
+    socklen_t matrixLength = sizeof(matrixAddr);
+    const ssize_t n = ::recvfrom(relay, datagram, sizeof(datagram), 0, (sockaddr*)&matrixAddr, &matrixLength);
+    const uint32_t registered = n == UDP_REGISTER_SIZE ? ((uint32_t)datagram[2] << 24 | (uint32_t)datagram[3] << 16 |
+        (uint32_t)datagram[4] << 8 | datagram[5]) : 0;
+    if (registered != token) {
+        Serial.println("No registration from the receiver");
+        ::close(relay);
+        return false;
+    }
+
+    const uint32_t startUs = startLink(frames);
+    std::atomic<bool> linkDone{false};
+    std::thread link([&]() {
+        static uint8_t payload[BUFFER_SIZE];
+        playLink(events, startUs, [&](const LinkEvent& e) {
+            makeSequenceFrame(payload, e.seq);
+            const size_t length = udpWriteChunk(datagram, payload, BUFFER_SIZE, e.seq, e.chunk);
+            ::sendto(relay, datagram, length, 0, (sockaddr*)&matrixAddr, matrixLength);
+        });
+        linkDone.store(true);
+    });
+    drainLink(receiver, linkDone);
+    link.join();
+    receiver.stop();
+    ::close(relay);
+
+    const UdpFrameStats udp = receiver.frameStats();
+    Serial.printf("        udp: %u incomplete, %u late chunks, %u malformed\n",
+        (unsigned)udp.incomplete, (unsigned)udp.late, (unsigned)udp.malformed);
+    return udp.malformed == 0 && udp.frames == socketLatencies.size() && socketDisorder == 0;
+}
+
+static bool runTcpPath(uint32_t frames, const std::vector<LinkEvent>& events) {
+    LoopbackWebSocketServer server;
+    SocketTaskTransport<PersistentWebSocketClient> client;
+    if (!connectLoopback(client, server)) {
+        Serial.println("Loopback socket failed");
+        return false;
+    }
+
+    const uint32_t startUs = startLink(frames);
+    std::atomic<bool> linkDone{false};
+    std::thread link([&]() {
+        static uint8_t payload[BUFFER_SIZE];
+        playLink(events, startUs, [&](const LinkEvent& e) {
+            makeSequenceFrame(payload, e.seq);
+            server.sendBinary(payload, BUFFER_SIZE);
+        });
+        linkDone.store(true);
+    });
+    drainLink(client, linkDone);
+    link.join();
+    client.disconnect();
+    return socketDisorder == 0;
+}
+
+static int runUdp(uint32_t lossPct) {
+    if (lossPct == 0 || lossPct > 50) {
+        lossPct = 5;
+    }
+    const uint32_t frames = LINK_FRAMES;
+    framePipelineBegin(&display);
+    setFrameIngestMode(FRAME_INGEST_COPY);
+    bool ok = true;
+
+    Serial.printf("%u frames every %u us; link delay %u us + up to %u us jitter, TCP RTO %u us\n",
+        frames, SOCKET_FRAME_INTERVAL_US, LINK_DELAY_US, LINK_JITTER_US, LINK_RTO_US);
+    Serial.printf("%-4s %5s %7s %7s %8s %8s %8s\n", "path", "loss", "shown", "lost", "p50 us", "p99 us", "max us");
+
+    uint32_t p99[2] = {};
+    const uint32_t losses[2] = { 0, lossPct };
+    for (int pass = 0; pass < 2; pass++) {
+        for (int tcp = 0; tcp < 2; tcp++) {
+            const std::vector<LinkEvent> events = scheduleLink(frames, losses[pass], tcp);
+            socketSentUs.assign(frames + 1, 0);
+            socketLatencies.clear();
+            socketLastSeq = 0;
+            socketDisorder = 0;
+
+            const bool pathOk = tcp ? runTcpPath(frames, events) : runUdpPath(frames, losses[pass], events);
+            const uint32_t shown = (uint32_t)socketLatencies.size();
+            if (pass == 1) {
+                p99[tcp] = percentileUs(socketLatencies, 0.99);
+            }
+            Serial.printf("%-4s %4u%% %7u %7u %8u %8u %8u\n", tcp ? "tcp" : "udp", (unsigned)losses[pass],
+                (unsigned)shown, (unsigned)(frames - shown), percentileUs(socketLatencies, 0.5),
+                percentileUs(socketLatencies, 0.99), percentileUs(socketLatencies, 1.0));
+            ok = ok && pathOk && shown > 0;
+            if (pass == 0) {
+                ok = ok && shown == frames;
+            }
+            ok = ok && socketLastSeq == frames;   // the newest frame always gets through
+        }
+    }
+    Serial.println("tcp lost: arrived in a burst behind a retransmit, overwritten in the inbox");
+    setFrameIngestMode(FRAME_INGEST_DEFAULT);
+
+    ok = ok && p99[0] < p99[1];
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── TLS ─────────────────────────────────────────────────────────────────────
+
+#define TLS_RECONNECTS   4      // server drops per client, after the first connect
+#define TLS_WAIT_MS      5000
+
+struct TlsRun {
+    std::vector<WsConnectAttempt> attempts;
+    bool ok = true;
+};
+
+/**
+ * @brief Connect, then have the server drop the client `drops` times
+ *
+ * The client reconnects each time on its own (reconnect interval 0); each
+ * attempt counts once the server's hello has arrived.
+ */
+static void runTlsClient(PersistentWebSocketClient& client, LoopbackTlsServer& server,
+                         uint16_t port, uint32_t drops, TlsRun& run) {
+    bool open = false;
+    uint32_t hellos = 0;
+    client.setReconnectInterval(0);
+    client.onEvent([&](WStype_t type, uint8_t* payload, size_t length) {
+        if (type == WStype_CONNECTED) {
+            open = true;
+        } else if (type == WStype_DISCONNECTED) {
+            open = false;
+        } else if (type == WStype_TEXT && length == 16 && strcmp((const char*)payload, "{\"type\":\"hello\"}") == 0) {
+            hellos++;
+        }
+    });
+    client.beginSSL("localhost", port, "/");
+
+    for (uint32_t i = 0; i <= drops && run.ok; i++) {
+        const uint32_t start = millis();
+        while (hellos <= i && millis() - start < TLS_WAIT_MS) {
+            client.loop();
+            delay(1);
+        }
+        if (hellos <= i) {
+            run.ok = false;
+            break;
+        }
+        run.attempts.push_back(client.lastAttempt());
+        if (i < drops) {
+            server.dropClient();
+            while (open && millis() - start < TLS_WAIT_MS) {
+                client.loop();
+                delay(1);
+            }
+            run.ok = !open;
+        }
+    }
+    client.disconnect();
+}
+
+static int runTls(uint32_t rttMs) {
+    if (rttMs == 0 || rttMs > 1000) {
+        rttMs = 40;
+    }
+    LoopbackTlsServer server;
+    DelayProxy proxy;
+    const uint16_t serverPort = server.start();
+    const uint16_t port = serverPort ? proxy.start(serverPort, rttMs * 1000 / 2) : 0;
+    if (!port) {
+        Serial.println("Could not start the TLS server stand-in");
+        Serial.println("FAIL");
+        return EXIT_FAILURE;
+    }
+    Serial.printf("TLS 1.2 server behind %u ms RTT (data only; the loopback TCP connect is instant)\n", (unsigned)rttMs);
+
+    // Before: a new client per connection, no stored session (WebSocketsClient's behaviour)
+    Serial.println("-- new client per connection, no stored session");
+    TlsRun fresh;
+    for (uint32_t i = 0; i <= TLS_RECONNECTS && fresh.ok; i++) {
+        PersistentWebSocketClient client;
+        runTlsClient(client, server, port, 0, fresh);
+    }
+
+    // After: one client across reconnects, sessions kept in a stand-in for NVS
+    MemorySessionStore nvs;
+    TlsRun kept;
+    Serial.println("-- one client across reconnects, session store");
+    {
+        PersistentWebSocketClient client;
+        client.setSessionStore(&nvs);
+        runTlsClient(client, server, port, TLS_RECONNECTS, kept);
+    }
+    Serial.println("-- reboot: new client, same session store");
+    TlsRun rebooted;
+    {
+        PersistentWebSocketClient client;
+        client.setSessionStore(&nvs);
+        runTlsClient(client, server, port, 0, rebooted);
+    }
+
+    bool ok = fresh.ok && kept.ok && rebooted.ok &&
+        fresh.attempts.size() == TLS_RECONNECTS + 1 &&
+        kept.attempts.size() == TLS_RECONNECTS + 1 && rebooted.attempts.size() == 1;
+
+    uint64_t fullUs = 0, resumedUs = 0, fullConnectUs = 0, resumedConnectUs = 0;
+    uint32_t fulls = 0, resumes = 0;
+    auto tally = [&](const WsConnectAttempt& a) {
+        const uint32_t connectUs = a.tcpUs + a.tlsUs + a.upgradeUs;
+        if (a.resumed) {
+            resumedUs += a.tlsUs;
+            resumedConnectUs += connectUs;
+            resumes++;
+        } else {
+            fullUs += a.tlsUs;
+            fullConnectUs += connectUs;
+            fulls++;
+        }
+    };
+    for (const WsConnectAttempt& a : fresh.attempts) {
+        ok = ok && !a.resumed;
+        tally(a);
+    }
+    for (size_t i = 0; i < kept.attempts.size(); i++) {
+        ok = ok && kept.attempts[i].resumed == (i > 0);
+        tally(kept.attempts[i]);
+    }
+    for (const WsConnectAttempt& a : rebooted.attempts) {
+        ok = ok && a.resumed;
+        tally(a);
+    }
+    ok = ok && server.resumptions() == resumes && resumes == TLS_RECONNECTS + 1 && fulls > 0;
+
+    if (fulls && resumes) {
+        Serial.printf("%-8s %6s %10s %12s\n", "session", "count", "TLS ms", "connect ms");
+        Serial.printf("%-8s %6u %10.1f %12.1f\n", "full", (unsigned)fulls,
+            fullUs / 1000.0 / fulls, fullConnectUs / 1000.0 / fulls);
+        Serial.printf("%-8s %6u %10.1f %12.1f\n", "resumed", (unsigned)resumes,
+            resumedUs / 1000.0 / resumes, resumedConnectUs / 1000.0 / resumes);
+        ok = ok && resumedUs * fulls < fullUs * resumes;
+    }
+    Serial.printf("server: %u handshakes, %u resumed; session saved %u times\n",
+        (unsigned)server.handshakes(), (unsigned)server.resumptions(), (unsigned)nvs.saves);
+    proxy.stop();
+    server.stop();
+
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── WiFi ────────────────────────────────────────────────────────────────────
+
+#define WIFI_SIM_STEP_MS      10      // the network task's loop
+#define WIFI_SIM_ASSOC_MS     900     // scan, association + DHCP, AP in range
+#define WIFI_SIM_NO_AP_MS     2500    // full scan, then NO_AP_FOUND
+#define WIFI_SIM_CACHED_MS    300     // straight to the known BSSID / channel
+#define WIFI_SIM_CACHE_MISS_MS 600    // one channel probed, then NO_AP_FOUND
+#define WIFI_REASON_LEAVE     8       // as after WiFi.disconnect()
+#define WIFI_REASON_BEACON    200     // BEACON_TIMEOUT
+#define WIFI_REASON_NO_AP     201     // NO_AP_FOUND
+
+enum WifiSimCache : uint8_t {
+    WIFI_SIM_NO_CACHE,    // first boot
+    WIFI_SIM_CACHE_OK,    // last boot's AP is still there
+    WIFI_SIM_CACHE_MOVED, // the AP moved channel / was replaced: fails fast
+    WIFI_SIM_CACHE_MUTE,  // the cached attempt never hears back
+};
+
+struct WifiScenario {
+    const char* name;
+    WifiSimCache cache;        // what the driver has in NVS at boot
+    uint32_t apDownFromMs;     // AP out of reach in [from, until)
+    uint32_t apDownUntilMs;
+    uint32_t silentAttempts;   // the first N attempts never hear back
+    uint32_t kickAtMs;         // the AP drops the station once (0: never)
+    uint32_t durationMs;
+};
+
+struct WifiScenarioResult {
+    bool ok;
+    uint32_t upAfterApMs;      // last disruption (boot, AP back, kick) → link up
+    uint32_t firstUpMs;        // boot → link up
+    uint32_t maxGapMs;         // longest wait between attempts
+    uint32_t longestCallUs;    // longest update() / event()
+};
+
+/**
+ * @brief Run WifiLink against a simulated radio and check its decisions
+ *
+ * The driver side does what wifi_client.cpp does: CONNECT_CACHED goes to
+ * the cached AP, CACHE_MISS forgets it, and every UP caches the AP again.
+ */
+static WifiScenarioResult runWifiScenario(const WifiScenario& sc, WifiLink& link) {
+    WifiScenarioResult result = { true, 0, 0, 0, 0 };
+    auto apUp = [&sc](uint32_t t) { return t < sc.apDownFromMs || t >= sc.apDownUntilMs; };
+
+    bool pending = false;   // one event in flight from the radio
+    uint32_t pendingAt = 0;
+    WifiLinkEvent pendingEvent = WIFI_EVENT_GOT_IP;
+    uint8_t pendingReason = 0;
+    auto schedule = [&](uint32_t at, WifiLinkEvent event, uint8_t reason) {
+        pending = true;
+        pendingAt = at;
+        pendingEvent = event;
+        pendingReason = reason;
+    };
+
+    WifiSimCache cache = sc.cache;
+    bool up = false, kicked = false, retryDue = false;
+    uint32_t lastAttemptMs = 0, downAtMs = 0;
+
+    // Check each action as it comes, then do what the ESP32 driver would
+    auto handle = [&](WifiLinkAction action, uint32_t t) {
+        switch (action) {
+            case WIFI_ACTION_CONNECT:
+            case WIFI_ACTION_CONNECT_CACHED: {
+                const bool cached = action == WIFI_ACTION_CONNECT_CACHED;
+                result.ok = result.ok && cached == (cache != WIFI_SIM_NO_CACHE);
+                if (link.stats().attempts > 1) {
+                    result.maxGapMs = std::max(result.maxGapMs, t - lastAttemptMs);
+                }
+                lastAttemptMs = t;
+                if (retryDue) {
+                    result.ok = result.ok && t - downAtMs <= WIFI_SIM_STEP_MS;   // a drop retries at once
+                    retryDue = false;
+                }
+                if (link.stats().attempts <= sc.silentAttempts || (cached && cache == WIFI_SIM_CACHE_MUTE)) {
+                    pending = false;
+                } else if (cached && (cache == WIFI_SIM_CACHE_MOVED || !apUp(t))) {
+                    schedule(t + WIFI_SIM_CACHE_MISS_MS, WIFI_EVENT_DISCONNECTED, WIFI_REASON_NO_AP);
+                } else if (apUp(t)) {
+                    schedule(t + (cached ? WIFI_SIM_CACHED_MS : WIFI_SIM_ASSOC_MS), WIFI_EVENT_GOT_IP, 0);
+                } else {
+                    schedule(t + WIFI_SIM_NO_AP_MS, WIFI_EVENT_DISCONNECTED, WIFI_REASON_NO_AP);
+                }
+                break;
+            }
+            case WIFI_ACTION_ABORT:
+                schedule(t + 1, WIFI_EVENT_DISCONNECTED, WIFI_REASON_LEAVE);
+                if (link.attemptCached()) {
+                    cache = WIFI_SIM_NO_CACHE;   // as CACHE_MISS; the scan follows after the settle delay
+                    result.ok = result.ok && link.retryInMs(t) == WIFI_ABORT_SETTLE_MS;
+                    break;
+                }
+                [[fallthrough]];   // an aborted attempt has failed too
+            case WIFI_ACTION_FAILED: {
+                const uint32_t k = link.consecutiveFailures();
+                const uint32_t nominal = std::min<uint32_t>(WIFI_BACKOFF_MAX_MS,
+                    (uint32_t)WIFI_BACKOFF_BASE_MS << std::min<uint32_t>(k - 1, 15));
+                const uint32_t wait = link.retryInMs(t);
+                result.ok = result.ok && wait >= nominal - nominal / 4 && wait <= nominal;
+                break;
+            }
+            case WIFI_ACTION_CACHE_MISS:
+                cache = WIFI_SIM_NO_CACHE;
+                result.ok = result.ok && link.retryInMs(t) == 0 && !link.hasCachedAp();   // scan at once
+                break;
+            case WIFI_ACTION_UP:
+                result.ok = result.ok && !up;
+                up = true;
+                result.upAfterApMs = t - std::max(downAtMs, t >= sc.apDownUntilMs ? sc.apDownUntilMs : 0);
+                if (!result.firstUpMs) {
+                    result.firstUpMs = t;
+                }
+                cache = WIFI_SIM_CACHE_OK;   // this AP, saved
+                link.setCachedAp(true);
+                break;
+            case WIFI_ACTION_DOWN:
+                result.ok = result.ok && up;
+                up = false;
+                downAtMs = t;
+                retryDue = true;
+                break;
+            default:
+                break;
+        }
+    };
+
+    link.setCachedAp(cache != WIFI_SIM_NO_CACHE);
+    link.begin(0);
+    for (uint32_t t = 0; t < sc.durationMs; t += WIFI_SIM_STEP_MS) {
+        // The radio: an AP that vanishes or kicks us drops an up link
+        if (up && !pending && (!apUp(t) || (sc.kickAtMs && !kicked && t >= sc.kickAtMs))) {
+            kicked = kicked || apUp(t);
+            schedule(t, WIFI_EVENT_DISCONNECTED, WIFI_REASON_BEACON);
+        }
+        if (pending && (int32_t)(t - pendingAt) >= 0) {
+            pending = false;
+            if (pendingEvent == WIFI_EVENT_GOT_IP && !apUp(t)) {
+                pendingEvent = WIFI_EVENT_DISCONNECTED;   // went away mid-association
+                pendingReason = WIFI_REASON_NO_AP;
+            }
+            const uint32_t start = micros();
+            const WifiLinkAction action = link.event(pendingEvent, pendingReason, t);
+            result.longestCallUs = std::max(result.longestCallUs, micros() - start);
+            handle(action, t);
+        }
+        const uint32_t start = micros();
+        const WifiLinkAction action = link.update(t);
+        result.longestCallUs = std::max(result.longestCallUs, micros() - start);
+        handle(action, t);
+    }
+    result.ok = result.ok && up && link.online();
+    return result;
+}
+
+static int runWifi() {
+    const WifiScenario scenarios[] = {
+        // name         cache in NVS          AP down from, until  silent kick    duration
+        { "boot",       WIFI_SIM_NO_CACHE,    0,       0,          0,     0,      10000 },
+        { "late AP",    WIFI_SIM_NO_CACHE,    0,       20000,      0,     0,      60000 },
+        { "outage",     WIFI_SIM_NO_CACHE,    30000,   330000,     0,     0,      400000 },
+        { "hung",       WIFI_SIM_NO_CACHE,    0,       0,          2,     0,      60000 },
+        { "kicked",     WIFI_SIM_NO_CACHE,    0,       0,          0,     20000,  30000 },
+        { "fast boot",  WIFI_SIM_CACHE_OK,    0,       0,          0,     0,      10000 },
+        { "AP moved",   WIFI_SIM_CACHE_MOVED, 0,       0,          0,     0,      10000 },
+        { "cache mute", WIFI_SIM_CACHE_MUTE,  0,       0,          0,     0,      20000 },
+    };
+    bool ok = true;
+    uint32_t scanBootMs = 0, fastBootMs = 0;
+    Serial.printf("backoff %u → %u ms (−¼ jitter), attempt timeout %u ms (cached AP %u ms)\n",
+        WIFI_BACKOFF_BASE_MS, WIFI_BACKOFF_MAX_MS, WIFI_ATTEMPT_TIMEOUT_MS, WIFI_CACHED_TIMEOUT_MS);
+    Serial.printf("simulated: scan + association %u ms, cached AP %u ms, no AP %u ms (cached: %u ms)\n",
+        WIFI_SIM_ASSOC_MS, WIFI_SIM_CACHED_MS, WIFI_SIM_NO_AP_MS, WIFI_SIM_CACHE_MISS_MS);
+    Serial.printf("%-10s %8s %6s %8s %6s %5s %9s %12s %10s %8s\n", "scenario", "attempts", "failed",
+        "timeouts", "misses", "drops", "first up", "up after ms", "max gap ms", "call us");
+    for (const WifiScenario& sc : scenarios) {
+        WifiLink link(0x5eed);
+        const WifiScenarioResult r = runWifiScenario(sc, link);
+        const WifiLinkStats& s = link.stats();
+        bool pass = r.ok;
+        if (strcmp(sc.name, "boot") == 0) {
+            pass = pass && s.attempts == 1 && r.upAfterApMs == WIFI_SIM_ASSOC_MS;
+            scanBootMs = r.firstUpMs;
+        } else if (strcmp(sc.name, "late AP") == 0) {
+            pass = pass && s.failures > 3 && s.drops == 0 &&
+                r.upAfterApMs <= WIFI_BACKOFF_MAX_MS + WIFI_SIM_NO_AP_MS + WIFI_SIM_ASSOC_MS;
+        } else if (strcmp(sc.name, "outage") == 0) {
+            // Capped backoff: about one attempt per 25–30 s, never a restart
+            pass = pass && s.drops == 1 && s.attempts < 25 &&
+                r.maxGapMs <= WIFI_BACKOFF_MAX_MS + WIFI_SIM_NO_AP_MS &&
+                r.upAfterApMs <= WIFI_BACKOFF_MAX_MS + WIFI_SIM_NO_AP_MS + WIFI_SIM_ASSOC_MS;
+        } else if (strcmp(sc.name, "hung") == 0) {
+            pass = pass && s.timeouts == 2 && s.failures == 2;
+        } else if (strcmp(sc.name, "kicked") == 0) {
+            // Back to the AP it was just on, without a scan
+            pass = pass && s.drops == 1 && s.failures == 0 && s.attempts == 2 &&
+                r.upAfterApMs == WIFI_SIM_CACHED_MS;
+        } else if (strcmp(sc.name, "fast boot") == 0) {
+            pass = pass && s.attempts == 1 && r.firstUpMs == WIFI_SIM_CACHED_MS;
+            fastBootMs = r.firstUpMs;
+        } else if (strcmp(sc.name, "AP moved") == 0) {
+            // One quick miss, then straight into a scan: no backoff
+            pass = pass && s.attempts == 2 && s.cacheMisses == 1 && s.failures == 0 &&
+                r.firstUpMs <= WIFI_SIM_CACHE_MISS_MS + WIFI_SIM_ASSOC_MS + WIFI_SIM_STEP_MS;
+        } else if (strcmp(sc.name, "cache mute") == 0) {
+            pass = pass && s.attempts == 2 && s.cacheMisses == 1 && s.timeouts == 1 && s.failures == 0 &&
+                r.firstUpMs <= WIFI_CACHED_TIMEOUT_MS + WIFI_ABORT_SETTLE_MS + WIFI_SIM_ASSOC_MS + WIFI_SIM_STEP_MS;
+        }
+        Serial.printf("%-10s %8u %6u %8u %6u %5u %9u %12u %10u %8u %s\n", sc.name,
+            (unsigned)s.attempts, (unsigned)s.failures, (unsigned)s.timeouts, (unsigned)s.cacheMisses,
+            (unsigned)s.drops, (unsigned)r.firstUpMs, (unsigned)r.upAfterApMs, (unsigned)r.maxGapMs,
+            (unsigned)r.longestCallUs, pass ? "" : "✗");
+        ok = ok && pass;
+    }
+    Serial.printf("boot to WiFi: %u ms scanning, %u ms with the cached AP\n", (unsigned)scanBootMs, (unsigned)fastBootMs);
+    ok = ok && fastBootMs < scanBootMs;
+    Serial.println(ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// ─── Main ────────────────────────────────────────────────────────────────────
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return runBench(argc, argv);
+    }
+    if (argc > 1 && strcmp(argv[1], "water") == 0) {
+        return runWater(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 10000);
+    }
+    if (argc > 1 && strcmp(argv[1], "wave") == 0) {
+        return runWave(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 10000);
+    }
+    if (argc > 1 && strcmp(argv[1], "water-ref") == 0) {
+        // Float matches to rounding; Q16 needs a few LSB of slack
+        return runWaterReference(argc > 2 ? atoi(argv[2]) : (WATER_FIXED_POINT ? 4 : 1));
+    }
+    if (argc > 1 && strcmp(argv[1], "codec") == 0) {
+        return runCodec();
+    }
+    if (argc > 1 && strcmp(argv[1], "sequence") == 0) {
+        return runSequence();
+    }
+    if (argc > 1 && strcmp(argv[1], "jitter") == 0) {
+        return runJitter(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 120);
+    }
+    if (argc > 1 && strcmp(argv[1], "lockstep") == 0) {
+        return runLockstep();
+    }
+    if (argc > 1 && strcmp(argv[1], "timestep") == 0) {
+        return runTimestep();
+    }
+    if (argc > 1 && strcmp(argv[1], "interpolate") == 0) {
+        return runInterpolate(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 120);
+    }
+    if (argc > 1 && strcmp(argv[1], "socket") == 0) {
+        return runSocket(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 250);
+    }
+    if (argc > 1 && strcmp(argv[1], "udp") == 0) {
+        return runUdp(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 5);
+    }
+    if (argc > 1 && strcmp(argv[1], "tls") == 0) {
+        return runTls(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 40);
+    }
+    if (argc > 1 && strcmp(argv[1], "wifi") == 0) {
+        return runWifi();
+    }
+    if (argc > 1 && strcmp(argv[1], "stress") == 0) {
+        return runStress(argc > 2 ? (uint32_t)strtoul(argv[2], nullptr, 10) : 0xFFFF);
+    }
+    return runPipeline(argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1000);
+}
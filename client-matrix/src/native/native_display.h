@@ -0,0 +1,40 @@
+/**
+ * @file native_display.h
+ * @brief In-memory double-buffered MatrixDisplay for the host build
+ *
+ * Behaves like SMLayerBackground: drawing goes to the back buffer and
+ * swapBuffers() makes it the front buffer, then (unless copy is false)
+ * copies it back so the next frame starts from what is on screen.
+ */
+
+#ifndef NATIVE_DISPLAY_H
+#define NATIVE_DISPLAY_H
+
+#include <string.h>
+
+#include "frame_pipeline.h"
+
+class NativeDisplay : public MatrixDisplay {
+public:
+    rgb24* backBuffer() override { return buffers[back]; }
+
+    void swapBuffers(bool copy = true) override {
+        back ^= 1;
+        if (copy) {
+            memcpy(buffers[back], buffers[back ^ 1], sizeof(buffers[0]));
+        }
+        swapCount++;
+    }
+
+    /** @brief What the panel would currently show */
+    const rgb24* frontBuffer() const { return buffers[back ^ 1]; }
+
+    uint32_t getSwapCount() const { return swapCount; }
+
+private:
+    rgb24 buffers[2][NUM_LEDS];
+    uint8_t back = 0;
+    uint32_t swapCount = 0;
+};
+
+#endif // NATIVE_DISPLAY_H
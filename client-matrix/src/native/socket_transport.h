@@ -0,0 +1,131 @@
+/**
+ * @file socket_transport.h
+ * @brief Host stand-in for the WebSocket server, over a TCP loopback socket
+ *
+ * LoopbackWebSocketServer accepts one client on 127.0.0.1, answers its
+ * HTTP upgrade, and sends it WebSocket frames (RFC 6455 base framing,
+ * unmasked, never fragmented). The client side is the firmware's own:
+ * PersistentWebSocketClient, pumped by WebSocketsTransport (polled) or
+ * SocketTaskTransport (its own thread), both from hal/transport.h.
+ */
+
+#ifndef NATIVE_SOCKET_TRANSPORT_H
+#define NATIVE_SOCKET_TRANSPORT_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "hal/transport.h"
+#include "ws_client.h"
+
+/** @brief One frame header + payload, optionally masked (client → server) */
+inline bool wsWriteFrame(int fd, uint8_t opcode, const uint8_t* payload, size_t length, bool masked) {
+    static const uint8_t MASK[4] = { 0x37, 0xFA, 0x21, 0x3D };
+    uint8_t frame[WS_FRAME_OVERHEAD + TRANSPORT_MESSAGE_MAX];
+    if (length > TRANSPORT_MESSAGE_MAX) {
+        return false;
+    }
+    const size_t n = wsEncodeFrame(frame, opcode, payload, length, masked ? MASK : nullptr);
+    for (size_t sent = 0; sent < n;) {
+        const ssize_t w = ::send(fd, frame + sent, n - sent, MSG_NOSIGNAL);
+        if (w <= 0) {
+            return false;
+        }
+        sent += (size_t)w;
+    }
+    return true;
+}
+
+/** @brief wsParseFrames() on a growable buffer */
+template <typename OnFrame>
+inline bool wsParseFrames(std::vector<uint8_t>& buffer, OnFrame onFrame) {
+    size_t length = buffer.size();
+    const bool ok = wsParseFrames(buffer.data(), length, onFrame);
+    buffer.resize(length);
+    return ok;
+}
+
+// ─── Server stand-in ─────────────────────────────────────────────────────────
+
+class LoopbackWebSocketServer {
+public:
+    ~LoopbackWebSocketServer() { close(); }
+
+    /** @return the port listened on (ephemeral), 0 on failure */
+    uint16_t listen() {
+        listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (listener < 0 || ::bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 ||
+            ::listen(listener, 1) != 0 || ::getsockname(listener, (sockaddr*)&addr, &len) != 0) {
+            return 0;
+        }
+        return ntohs(addr.sin_port);
+    }
+
+    /** @brief Wait up to timeoutMs for the client and answer its upgrade */
+    bool accept(int timeoutMs) {
+        pollfd p = { listener, POLLIN, 0 };
+        if (::poll(&p, 1, timeoutMs) <= 0) {
+            return false;
+        }
+        client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            return false;
+        }
+        const int one = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return upgrade(timeoutMs);
+    }
+
+    bool sendBinary(const uint8_t* payload, size_t length) {
+        return wsWriteFrame(client, WS_OPCODE_BINARY, payload, length, false);
+    }
+
+    bool sendText(const char* text) {
+        return wsWriteFrame(client, WS_OPCODE_TEXT, (const uint8_t*)text, strlen(text), false);
+    }
+
+    void close() {
+        if (client >= 0) {
+            ::close(client);
+            client = -1;
+        }
+        if (listener >= 0) {
+            ::close(listener);
+            listener = -1;
+        }
+    }
+
+private:
+    /** The client checks the status line only, so no Sec-WebSocket-Accept */
+    bool upgrade(int timeoutMs) {
+        std::string request;
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            pollfd p = { client, POLLIN, 0 };
+            char chunk[512];
+            const ssize_t n = ::poll(&p, 1, timeoutMs) > 0 ? ::recv(client, chunk, sizeof(chunk), 0) : -1;
+            if (n <= 0) {
+                return false;
+            }
+            request.append(chunk, (size_t)n);
+        }
+        static const char RESPONSE[] =
+            "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n\r\n";
+        return ::send(client, RESPONSE, sizeof(RESPONSE) - 1, MSG_NOSIGNAL) == (ssize_t)sizeof(RESPONSE) - 1;
+    }
+
+    int listener = -1;
+    int client = -1;
+};
+
+#endif // NATIVE_SOCKET_TRANSPORT_H
@@ -0,0 +1,319 @@
+/**
+ * @file tls_server.h
+ * @brief Host stand-ins for the WSS server and the network path to it
+ *
+ * LoopbackTlsServer is a one-client-at-a-time WebSocket server over TLS
+ * (OpenSSL, TLS 1.2, self-signed RSA-2048 certificate made at start, the
+ * default session cache and tickets on). It answers the HTTP upgrade,
+ * sends one text message, and keeps the connection until dropClient()
+ * cuts it, as a server restart or a network drop would.
+ *
+ * DelayProxy sits in front of it on loopback and holds every chunk of
+ * data for a fixed one-way delay in each direction, so each round trip of
+ * a handshake costs what it would over the internet.
+ */
+
+#ifndef NATIVE_TLS_SERVER_H
+#define NATIVE_TLS_SERVER_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hal/platform.h"
+#include "ws_client.h"
+
+/** @brief Listening TCP socket on 127.0.0.1; *port gets the ephemeral port */
+inline int listenLoopback(uint16_t* port) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    const int one = 1;
+    if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        ::bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, 4) != 0 ||
+        ::getsockname(fd, (sockaddr*)&addr, &len) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+/** @brief accept(), giving up after timeoutMs so a stop flag gets looked at */
+inline int acceptWithin(int listener, int timeoutMs) {
+    pollfd p = { listener, POLLIN, 0 };
+    if (::poll(&p, 1, timeoutMs) <= 0) {
+        return -1;
+    }
+    const int fd = ::accept(listener, nullptr, nullptr);
+    const int one = 1;
+    if (fd >= 0) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+// ─── TLS WebSocket server ────────────────────────────────────────────────────
+
+class LoopbackTlsServer {
+public:
+    ~LoopbackTlsServer() { stop(); }
+
+    /** @return the port listened on, 0 on failure */
+    uint16_t start() {
+        ctx = SSL_CTX_new(TLS_server_method());
+        SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
+        static const unsigned char SESSION_CONTEXT[] = "missingdrop";
+        SSL_CTX_set_session_id_context(ctx, SESSION_CONTEXT, sizeof(SESSION_CONTEXT) - 1);
+
+        EVP_PKEY* key = EVP_RSA_gen(2048);
+        X509* cert = X509_new();
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        const bool ok = key && X509_sign(cert, key, EVP_sha256()) > 0 &&
+            SSL_CTX_use_certificate(ctx, cert) == 1 && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+        X509_free(cert);
+        EVP_PKEY_free(key);
+
+        uint16_t port = 0;
+        listener = ok ? listenLoopback(&port) : -1;
+        if (listener < 0) {
+            return 0;
+        }
+        running.store(true);
+        worker = std::thread([this]() { serve(); });
+        return port;
+    }
+
+    void stop() {
+        running.store(false);
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (listener >= 0) {
+            ::close(listener);
+            listener = -1;
+        }
+        if (ctx) {
+            SSL_CTX_free(ctx);
+            ctx = nullptr;
+        }
+    }
+
+    /** @brief Cut the current client off without a close frame */
+    void dropClient() { dropRequested.store(true); }
+
+    /** @brief Handshakes completed, and how many of them resumed a session */
+    uint32_t handshakes() const { return handshakeCount.load(); }
+    uint32_t resumptions() const { return resumedCount.load(); }
+
+private:
+    void serve() {
+        while (running.load()) {
+            const int fd = acceptWithin(listener, 50);
+            if (fd < 0) {
+                continue;
+            }
+            SSL* ssl = SSL_new(ctx);
+            SSL_set_fd(ssl, fd);
+            dropRequested.store(false);
+            if (SSL_accept(ssl) == 1) {
+                handshakeCount++;
+                resumedCount += SSL_session_reused(ssl) == 1;
+                if (upgrade(ssl)) {
+                    static const char HELLO[] = "{\"type\":\"hello\"}";
+                    uint8_t frame[WS_FRAME_OVERHEAD + sizeof(HELLO)];
+                    const size_t n = wsEncodeFrame(frame, WS_OPCODE_TEXT, (const uint8_t*)HELLO, sizeof(HELLO) - 1, nullptr);
+                    SSL_write(ssl, frame, (int)n);
+                    holdUntilDropped(fd);
+                }
+            }
+            SSL_free(ssl);   // no close_notify: the connection just goes away
+            ::close(fd);
+        }
+    }
+
+    /** @brief Read the HTTP upgrade and answer 101 */
+    bool upgrade(SSL* ssl) {
+        std::string request;
+        char chunk[512];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            const int n = SSL_read(ssl, chunk, sizeof(chunk));
+            if (n <= 0) {
+                return false;
+            }
+            request.append(chunk, (size_t)n);
+        }
+        const size_t keyAt = request.find("Sec-WebSocket-Key: ");
+        if (keyAt == std::string::npos) {
+            return false;
+        }
+        const size_t keyStart = keyAt + 19;
+        std::string accept = request.substr(keyStart, request.find("\r\n", keyStart) - keyStart);
+        accept += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        unsigned char digest[SHA_DIGEST_LENGTH];
+        SHA1((const unsigned char*)accept.data(), accept.size(), digest);
+        unsigned char encoded[32];
+        EVP_EncodeBlock(encoded, digest, SHA_DIGEST_LENGTH);
+
+        char response[192];
+        const int length = snprintf(response, sizeof(response),
+            "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Accept: %s\r\n\r\n", (const char*)encoded);
+        return SSL_write(ssl, response, length) == length;
+    }
+
+    void holdUntilDropped(int fd) {
+        while (running.load() && !dropRequested.load()) {
+            pollfd p = { fd, POLLIN, 0 };
+            if (::poll(&p, 1, 10) > 0) {
+                char sink[256];
+                if (::recv(fd, sink, sizeof(sink), 0) <= 0) {
+                    return;   // the client went away
+                }
+            }
+        }
+    }
+
+    SSL_CTX* ctx = nullptr;
+    int listener = -1;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> dropRequested{false};
+    std::atomic<uint32_t> handshakeCount{0};
+    std::atomic<uint32_t> resumedCount{0};
+};
+
+// ─── Network delay ───────────────────────────────────────────────────────────
+
+class DelayProxy {
+public:
+    ~DelayProxy() { stop(); }
+
+    /** @return the port to connect to instead of targetPort, 0 on failure */
+    uint16_t start(uint16_t targetPort, uint32_t oneWayUs) {
+        target = targetPort;
+        delayUs = oneWayUs;
+        uint16_t port = 0;
+        listener = listenLoopback(&port);
+        if (listener < 0) {
+            return 0;
+        }
+        running.store(true);
+        worker = std::thread([this]() {
+            while (running.load()) {
+                const int client = acceptWithin(listener, 50);
+                if (client >= 0) {
+                    relay(client);
+                }
+            }
+        });
+        return port;
+    }
+
+    void stop() {
+        running.store(false);
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (listener >= 0) {
+            ::close(listener);
+            listener = -1;
+        }
+    }
+
+private:
+    struct Chunk {
+        uint32_t dueUs;
+        std::vector<uint8_t> bytes;
+    };
+
+    /** @brief Shuttle one connection both ways until either side closes */
+    void relay(int client) {
+        const int server = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(target);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        const int one = 1;
+        if (server < 0 || ::connect(server, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            ::close(client);
+            if (server >= 0) {
+                ::close(server);
+            }
+            return;
+        }
+        setsockopt(server, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        const int fds[2] = { client, server };
+        std::deque<Chunk> pending[2];   // [0]: client → server, [1]: server → client
+        bool open = true;
+        while (open && running.load()) {
+            // Sleep until data arrives or the next chunk is due
+            int timeoutMs = 5;
+            for (int d = 0; d < 2; d++) {
+                if (!pending[d].empty()) {
+                    const int32_t wait = (int32_t)(pending[d].front().dueUs - micros());
+                    timeoutMs = std::min(timeoutMs, wait <= 0 ? 0 : (int)(wait / 1000));
+                }
+            }
+            pollfd p[2] = { { client, POLLIN, 0 }, { server, POLLIN, 0 } };
+            ::poll(p, 2, timeoutMs);
+            for (int d = 0; d < 2 && open; d++) {
+                if (p[d].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    uint8_t buffer[4096];
+                    const ssize_t n = ::recv(fds[d], buffer, sizeof(buffer), 0);
+                    if (n <= 0) {
+                        open = false;
+                        break;
+                    }
+                    pending[d].push_back({ micros() + delayUs, std::vector<uint8_t>(buffer, buffer + n) });
+                }
+            }
+            for (int d = 0; d < 2 && open; d++) {
+                while (!pending[d].empty() && (int32_t)(micros() - pending[d].front().dueUs) >= 0) {
+                    const std::vector<uint8_t>& bytes = pending[d].front().bytes;
+                    if (::send(fds[1 - d], bytes.data(), bytes.size(), MSG_NOSIGNAL) != (ssize_t)bytes.size()) {
+                        open = false;
+                        break;
+                    }
+                    pending[d].pop_front();
+                }
+            }
+        }
+        ::close(client);
+        ::close(server);
+    }
+
+    uint16_t target = 0;
+    uint32_t delayUs = 0;
+    int listener = -1;
+    std::thread worker;
+    std::atomic<bool> running{false};
+};
+
+#endif // NATIVE_TLS_SERVER_H
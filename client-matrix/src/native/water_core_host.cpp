@@ -0,0 +1,12 @@
+/**
+ * @file water_core_host.cpp
+ * @brief The web client's water core (wasm/water_core.cpp), built into the
+ *        host harness
+ *
+ * PlatformIO only compiles src/, so the core is pulled in here. Natively
+ * its exports are plain extern "C" functions, which `program lockstep`
+ * drives through the same traces as the firmware's lockstep water and
+ * checks against client-web/js/lockstep.js.
+ */
+
+#include "../../wasm/water_core.cpp"
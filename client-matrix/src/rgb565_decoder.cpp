@@ -0,0 +1,68 @@
+#include "rgb565_decoder.h"
+
+#include <string.h>
+
+#if defined(ARDUINO)
+#include <esp_attr.h>
+#define DECODER_LUT_ATTR DRAM_ATTR  // keep tables out of flash cache misses
+#else
+#define DECODER_LUT_ATTR
+#endif
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "decodeRGB565Lut assumes a little-endian target (ESP32, x86, ARM)"
+#endif
+
+// ─── Expansion Tables ────────────────────────────────────────────────────────
+
+// v5 → (v << 3) | (v >> 2)
+static const uint8_t LUT5[32] DECODER_LUT_ATTR = {
+      0,   8,  16,  24,  33,  41,  49,  57,  66,  74,  82,  90,  99, 107, 115, 123,
+    132, 140, 148, 156, 165, 173, 181, 189, 198, 206, 214, 222, 231, 239, 247, 255,
+};
+
+// v6 → (v << 2) | (v >> 4)
+static const uint8_t LUT6[64] DECODER_LUT_ATTR = {
+      0,   4,   8,  12,  16,  20,  24,  28,  32,  36,  40,  44,  48,  52,  56,  60,
+     65,  69,  73,  77,  81,  85,  89,  93,  97, 101, 105, 109, 113, 117, 121, 125,
+    130, 134, 138, 142, 146, 150, 154, 158, 162, 166, 170, 174, 178, 182, 186, 190,
+    195, 199, 203, 207, 211, 215, 219, 223, 227, 231, 235, 239, 243, 247, 251, 255,
+};
+
+// ─── Engines ─────────────────────────────────────────────────────────────────
+
+void decodeRGB565Shift(const uint8_t* src, rgb24* dst, uint16_t pixels) {
+    uint16_t idx = 0;
+    for (uint16_t i = 0; i < pixels; i++, idx += 2) {
+        convert16to24bit(src[idx], src[idx + 1], &dst[i]);
+    }
+}
+
+// Pixel bytes are big-endian (high, low); in a little-endian halfword h
+// that is high = h & 0xFF, low = h >> 8:
+//   R = high >> 3
+//   G = (high & 7) << 3 | low >> 5
+//   B = low & 0x1F
+static inline void expandHalf(uint32_t h, rgb24* out) {
+    out->red   = LUT5[(h >> 3) & 0x1F];
+    out->green = LUT6[((h & 0x07) << 3) | ((h >> 13) & 0x07)];
+    out->blue  = LUT5[(h >> 8) & 0x1F];
+}
+
+void decodeRGB565Lut(const uint8_t* src, rgb24* dst, uint16_t pixels) {
+    uint16_t i = 0;
+
+    if (((uintptr_t)src & 3) == 0) {
+        const uint8_t* words = (const uint8_t*)__builtin_assume_aligned(src, 4);
+        for (; i + 1 < pixels; i += 2) {
+            uint32_t w;
+            memcpy(&w, words + i * 2, sizeof(w));  // single aligned load
+            expandHalf(w, &dst[i]);
+            expandHalf(w >> 16, &dst[i + 1]);
+        }
+    }
+
+    for (; i < pixels; i++) {
+        expandHalf((uint32_t)src[i * 2] | ((uint32_t)src[i * 2 + 1] << 8), &dst[i]);
+    }
+}
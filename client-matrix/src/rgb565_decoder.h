@@ -0,0 +1,55 @@
+/**
+ * @file rgb565_decoder.h
+ * @brief RGB565 → RGB24 frame decoder engines
+ *
+ * The pipeline decodes with the shift engine: one pixel at a time via
+ * convert16to24bit(), low bits zero-filled (0x1F → 248).
+ *
+ * decodeRGB565Lut() is kept as a candidate the bench times against it in
+ * every build: two pixels per aligned 32-bit load, channels expanded
+ * through 32/64-entry tables with bit replication (0x1F → 255). It is not
+ * wired into the pipeline. On the host it is slower (the compiler
+ * vectorizes the shift loop), and its fast path needs the pixels 4-byte
+ * aligned, which DIRECT and DECODED ingest never give it: they decode
+ * from the payload, where the pixels sit behind a 1- or 7-byte header.
+ */
+
+#ifndef RGB565_DECODER_H
+#define RGB565_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/display.h"
+
+/**
+ * @brief Convert one big-endian RGB565 pixel to RGB24
+ */
+inline void convert16to24bit(const uint8_t high, const uint8_t low, rgb24* col) {
+    uint16_t rgb16 = ((uint16_t)high << 8) | low;
+    col->red   = ((rgb16 >> 11) & 0x1F) << 3;
+    col->green = ((rgb16 >>  5) & 0x3F) << 2;
+    col->blue  = (rgb16 & 0x1F) << 3;
+}
+
+/**
+ * @brief Shift-and-mask engine (the original per-byte loop)
+ */
+void decodeRGB565Shift(const uint8_t* src, rgb24* dst, uint16_t pixels);
+
+/**
+ * @brief Table-driven, word-at-a-time engine
+ *
+ * Fast path needs `src` 4-byte aligned; unaligned input is still decoded
+ * correctly, one pixel at a time.
+ */
+void decodeRGB565Lut(const uint8_t* src, rgb24* dst, uint16_t pixels);
+
+/**
+ * @brief Decode with the pipeline's engine (shift)
+ */
+inline void decodeRGB565(const uint8_t* src, rgb24* dst, uint16_t pixels) {
+    decodeRGB565Shift(src, dst, pixels);
+}
+
+#endif // RGB565_DECODER_H
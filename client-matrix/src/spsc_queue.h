@@ -0,0 +1,84 @@
+/**
+ * @file spsc_queue.h
+ * @brief Lock-free single-producer / single-consumer ring buffer
+ *
+ * Fixed capacity, no allocation. push() fails instead of blocking when the
+ * ring is full. One thread pushes, one thread pops.
+ *
+ * For large items, writeSlot()/commit() and front()/release() work on the
+ * ring in place instead of copying through push()/pop().
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+template <typename T, uint32_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    /** @brief Producer: enqueue a copy of `item` @return false if full */
+    bool push(const T& item) {
+        uint32_t head = writePos.load(std::memory_order_relaxed);
+        if (head - readPos.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        items[head & (N - 1)] = item;
+        writePos.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Consumer: dequeue into `item` @return false if empty */
+    bool pop(T& item) {
+        uint32_t tail = readPos.load(std::memory_order_relaxed);
+        if (tail == writePos.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[tail & (N - 1)];
+        readPos.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Producer: free slot to fill, then commit() @return nullptr if full */
+    T* writeSlot() {
+        uint32_t head = writePos.load(std::memory_order_relaxed);
+        if (head - readPos.load(std::memory_order_acquire) == N) {
+            return nullptr;
+        }
+        return &items[head & (N - 1)];
+    }
+
+    /** @brief Producer: publish the slot returned by writeSlot() */
+    void commit() {
+        writePos.store(writePos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** @brief Consumer: oldest item, left in place until release() @return nullptr if empty */
+    T* front() {
+        uint32_t tail = readPos.load(std::memory_order_relaxed);
+        if (tail == writePos.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &items[tail & (N - 1)];
+    }
+
+    /** @brief Consumer: drop the item returned by front() */
+    void release() {
+        readPos.store(readPos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    uint32_t size() const {
+        return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+    }
+
+private:
+    T items[N];
+    std::atomic<uint32_t> writePos{0};
+    std::atomic<uint32_t> readPos{0};
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,139 @@
+/**
+ * @file transport_inbox.h
+ * @brief Hand-off of complete WebSocket messages from the socket task to
+ *        the task that handles them
+ *
+ * The socket side copies each event (connect, text, binary frame, ...)
+ * into a slot the moment it is complete, stamped with its arrival time;
+ * the consumer drains the slots in order and dispatches them to the usual
+ * event handler. Lock-free (SpscQueue), no allocation: one task pushes,
+ * one task drains.
+ *
+ * Binary frames are timed from arrival to the end of their dispatch (for
+ * the firmware: receiveFrame() has made them available to the render
+ * side), so the stats show how long a frame sat waiting for the consumer.
+ */
+
+#ifndef TRANSPORT_INBOX_H
+#define TRANSPORT_INBOX_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "spsc_queue.h"
+
+#ifndef TRANSPORT_INBOX_SLOTS
+#define TRANSPORT_INBOX_SLOTS 4       // power of two
+#endif
+#define TRANSPORT_MESSAGE_MAX 2304    // a keyframe with its v1 header, or a JSON event
+
+struct TransportMessage {
+    uint8_t type;          // WStype_t
+    uint16_t length;
+    uint32_t arrivedUs;
+    uint8_t data[TRANSPORT_MESSAGE_MAX + 1];   // NUL-terminated, as WebSocketsClient delivers text
+};
+
+struct TransportInboxStats {
+    uint32_t frames;          // binary frames dispatched
+    uint32_t overflows;       // messages dropped, inbox full
+    uint32_t oversized;       // messages dropped, larger than TRANSPORT_MESSAGE_MAX
+    uint32_t lastLatencyUs;   // arrival → dispatched, latest frame
+    uint32_t meanLatencyUs;
+    uint32_t maxLatencyUs;
+};
+
+class TransportInbox {
+public:
+    // ─── Socket side ─────────────────────────────────────────────────────
+
+    /** @return false if the message was dropped (inbox full or too large) */
+    bool push(uint8_t type, const uint8_t* payload, size_t length, uint32_t arrivedUs) {
+        if (length > TRANSPORT_MESSAGE_MAX) {
+            oversized.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        TransportMessage* slot = queue.writeSlot();
+        if (!slot) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slot->type = type;
+        slot->length = (uint16_t)length;
+        slot->arrivedUs = arrivedUs;
+        if (length) {
+            memcpy(slot->data, payload, length);
+        }
+        slot->data[length] = 0;
+        queue.commit();
+        return true;
+    }
+
+    /** @brief A message the socket side chose not to queue (counted as an overflow) */
+    void discard() {
+        overflows.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // ─── Consumer ────────────────────────────────────────────────────────
+
+    bool empty() const { return queue.size() == 0; }
+
+    /**
+     * @brief Dispatch every queued message, oldest first
+     * @param dispatch Called as dispatch(type, data, length)
+     * @param now      Clock for the latency stats (micros())
+     * @param binaryType Message type whose latency is tracked (WStype_BIN)
+     * @return messages dispatched
+     */
+    template <typename Dispatch, typename Clock>
+    uint32_t drain(Dispatch dispatch, Clock now, uint8_t binaryType) {
+        uint32_t count = 0;
+        TransportMessage* message;
+        while ((message = queue.front()) != nullptr) {
+            dispatch(message->type, message->data, (size_t)message->length);
+            if (message->type == binaryType) {
+                recordLatency(now() - message->arrivedUs);
+            }
+            queue.release();
+            count++;
+        }
+        return count;
+    }
+
+    /** @brief Counters so far; read on the consumer side */
+    TransportInboxStats stats() const {
+        TransportInboxStats s;
+        s.frames = frames;
+        s.overflows = overflows.load(std::memory_order_relaxed);
+        s.oversized = oversized.load(std::memory_order_relaxed);
+        s.lastLatencyUs = lastLatencyUs;
+        s.meanLatencyUs = frames ? (uint32_t)(totalLatencyUs / frames) : 0;
+        s.maxLatencyUs = maxLatencyUs;
+        return s;
+    }
+
+private:
+    void recordLatency(uint32_t us) {
+        frames++;
+        lastLatencyUs = us;
+        totalLatencyUs += us;
+        if (us > maxLatencyUs) {
+            maxLatencyUs = us;
+        }
+    }
+
+    SpscQueue<TransportMessage, TRANSPORT_INBOX_SLOTS> queue;
+
+    std::atomic<uint32_t> overflows{0};
+    std::atomic<uint32_t> oversized{0};
+
+    // Consumer only
+    uint32_t frames = 0;
+    uint32_t lastLatencyUs = 0;
+    uint32_t maxLatencyUs = 0;
+    uint64_t totalLatencyUs = 0;
+};
+
+#endif // TRANSPORT_INBOX_H
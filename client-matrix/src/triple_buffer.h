@@ -0,0 +1,67 @@
+/**
+ * @file triple_buffer.h
+ * @brief Lock-free single-producer / single-consumer triple buffer
+ *
+ * The producer always has a private slot to write into and the consumer
+ * always has a private slot to read from; the third slot is swapped
+ * between them through one atomic word. Neither side ever blocks or sees
+ * a half-written slot, and the consumer always gets the newest published
+ * value — intermediate ones are overwritten (and counted) when the
+ * producer outruns it.
+ *
+ * Exactly one thread may call writeBuffer()/publish() and exactly one
+ * (possibly different) thread may call acquire()/readBuffer().
+ */
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <stdint.h>
+
+template <typename T>
+class TripleBuffer {
+public:
+    /** @brief Producer: slot to fill before publish() */
+    T& writeBuffer() { return buffers[writeIndex]; }
+
+    /** @brief Producer: hand the write slot to the consumer */
+    void publish() {
+        uint32_t prev = middle.exchange(writeIndex | DIRTY, std::memory_order_acq_rel);
+        writeIndex = prev & INDEX_MASK;
+        if (prev & DIRTY) {
+            overwritten.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Consumer: take the newest published slot, if there is one
+     * @return true if readBuffer() now holds a value not seen before
+     */
+    bool acquire() {
+        if (!(middle.load(std::memory_order_acquire) & DIRTY)) {
+            return false;
+        }
+        uint32_t prev = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = prev & INDEX_MASK;
+        return true;
+    }
+
+    /** @brief Consumer: slot returned by the last successful acquire() */
+    const T& readBuffer() const { return buffers[readIndex]; }
+
+    /** @brief Published values the consumer never acquired */
+    uint32_t overwrittenCount() const { return overwritten.load(std::memory_order_relaxed); }
+
+private:
+    static const uint32_t INDEX_MASK = 0x3;
+    static const uint32_t DIRTY = 0x4;
+
+    T buffers[3];
+    std::atomic<uint32_t> middle{1};
+    std::atomic<uint32_t> overwritten{0};
+    uint32_t writeIndex = 0;  // producer-owned
+    uint32_t readIndex = 2;   // consumer-owned
+};
+
+#endif // TRIPLE_BUFFER_H
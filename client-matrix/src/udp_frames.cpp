@@ -0,0 +1,119 @@
+#include "udp_frames.h"
+
+#include <string.h>
+
+// ─── Datagrams ───────────────────────────────────────────────────────────────
+
+size_t udpWriteRegister(uint8_t* out, uint32_t token) {
+    out[0] = UDP_MAGIC;
+    out[1] = UDP_TYPE_REGISTER;
+    out[2] = (uint8_t)(token >> 24);
+    out[3] = (uint8_t)(token >> 16);
+    out[4] = (uint8_t)(token >> 8);
+    out[5] = (uint8_t)token;
+    return UDP_REGISTER_SIZE;
+}
+
+uint8_t udpChunkCount(size_t length) {
+    const size_t count = length == 0 ? 1 : (length + UDP_CHUNK_BYTES - 1) / UDP_CHUNK_BYTES;
+    return count > UDP_MAX_CHUNKS ? 0 : (uint8_t)count;
+}
+
+size_t udpWriteChunk(uint8_t* out, const uint8_t* payload, size_t length, uint16_t seq, uint8_t index) {
+    const uint8_t count = udpChunkCount(length);
+    if (index >= count) {
+        return 0;
+    }
+    const size_t offset = (size_t)index * UDP_CHUNK_BYTES;
+    const size_t chunk = length - offset < UDP_CHUNK_BYTES ? length - offset : UDP_CHUNK_BYTES;
+
+    out[0] = UDP_MAGIC;
+    out[1] = UDP_TYPE_FRAME;
+    out[2] = (uint8_t)(seq >> 8);
+    out[3] = (uint8_t)seq;
+    out[4] = index;
+    out[5] = count;
+    memcpy(out + UDP_HEADER_SIZE, payload + offset, chunk);
+    return UDP_HEADER_SIZE + chunk;
+}
+
+// ─── Assembler ───────────────────────────────────────────────────────────────
+
+void UdpFrameAssembler::reset() {
+    assembledLength = 0;
+    received = 0;
+    chunkCount = 0;
+    currentSeq = 0;
+    assembling = false;
+    haveCompleted = false;
+    lastCompleted = 0;
+    counters = {};
+}
+
+bool UdpFrameAssembler::push(const uint8_t* datagram, size_t length) {
+    if (length <= UDP_HEADER_SIZE || datagram[0] != UDP_MAGIC || datagram[1] != UDP_TYPE_FRAME) {
+        counters.malformed++;
+        return false;
+    }
+    const uint16_t seq = (uint16_t)((datagram[2] << 8) | datagram[3]);
+    const uint8_t index = datagram[4];
+    const uint8_t count = datagram[5];
+    const size_t chunk = length - UDP_HEADER_SIZE;
+    if (count == 0 || count > UDP_MAX_CHUNKS || index >= count || chunk > UDP_CHUNK_BYTES ||
+        (index < count - 1 && chunk != UDP_CHUNK_BYTES)) {
+        counters.malformed++;
+        return false;
+    }
+
+    // Older than the newest frame shown: late (or the server restarted)
+    if (haveCompleted) {
+        const int16_t ahead = (int16_t)(seq - lastCompleted);
+        if (ahead <= -UDP_REORDER_WINDOW) {
+            haveCompleted = false;
+            assembling = false;
+        } else if (ahead <= 0) {
+            counters.late++;
+            return false;
+        }
+    }
+
+    // A newer frame replaces one still missing chunks; an older one is late
+    if (assembling && seq != currentSeq) {
+        const int16_t ahead = (int16_t)(seq - currentSeq);
+        if (ahead < 0 && ahead > -UDP_REORDER_WINDOW) {
+            counters.late++;
+            return false;
+        }
+        counters.incomplete++;
+        assembling = false;
+    }
+
+    if (!assembling) {
+        assembling = true;
+        currentSeq = seq;
+        chunkCount = count;
+        received = 0;
+    } else if (count != chunkCount) {
+        counters.malformed++;
+        return false;
+    }
+
+    const uint8_t bit = (uint8_t)(1u << index);
+    if (received & bit) {
+        counters.late++;   // duplicate
+        return false;
+    }
+    memcpy(buffer + (size_t)index * UDP_CHUNK_BYTES, datagram + UDP_HEADER_SIZE, chunk);
+    chunkLength[index] = chunk;
+    received |= bit;
+
+    if (received != (uint8_t)((1u << chunkCount) - 1)) {
+        return false;
+    }
+    assembledLength = (size_t)(chunkCount - 1) * UDP_CHUNK_BYTES + chunkLength[chunkCount - 1];
+    assembling = false;
+    haveCompleted = true;
+    lastCompleted = seq;
+    counters.frames++;
+    return true;
+}
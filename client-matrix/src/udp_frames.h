@@ -0,0 +1,103 @@
+/**
+ * @file udp_frames.h
+ * @brief Frame datagrams for the UDP transport, and their reassembly
+ *
+ * The server relays each binary payload a phone sends (any format in
+ * frame_format.h, with its v1 header) to a matrix that registered over
+ * UDP, split into datagrams of at most UDP_CHUNK_BYTES so none is
+ * IP-fragmented:
+ *
+ *   Frame chunk (server → matrix), 6-byte header + chunk:
+ *     [0]    UDP_MAGIC
+ *     [1]    UDP_TYPE_FRAME
+ *     [2-3]  relay sequence number, uint16 big-endian, one per payload
+ *     [4]    chunk index
+ *     [5]    chunk count (1–UDP_MAX_CHUNKS)
+ *
+ *   Registration (matrix → server), every UDP_REGISTER_INTERVAL_MS:
+ *     [0]    UDP_MAGIC
+ *     [1]    UDP_TYPE_REGISTER
+ *     [2-5]  token from the server's `joined` message, uint32 big-endian
+ *
+ * A lost datagram loses its frame and nothing else: the assembler keeps
+ * only the newest frame under construction, drops chunks of frames older
+ * than the newest one completed (late) and never waits for a retransmit.
+ * Each datagram must therefore be self-contained: a matrix on UDP doesn't
+ * advertise tile deltas.
+ *
+ * Platform-independent (no sockets here); see hal/udp_receiver.h.
+ */
+
+#ifndef UDP_FRAMES_H
+#define UDP_FRAMES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define UDP_MAGIC          0xD7
+#define UDP_TYPE_REGISTER  0x00
+#define UDP_TYPE_FRAME     0x01
+#define UDP_HEADER_SIZE    6
+#define UDP_REGISTER_SIZE  6
+#define UDP_CHUNK_BYTES    1400   // payload per datagram, below a WiFi MTU with headers
+#define UDP_MAX_CHUNKS     4
+#define UDP_FRAME_MAX      (UDP_CHUNK_BYTES * UDP_MAX_CHUNKS)
+#define UDP_REGISTER_INTERVAL_MS 2000   // also keeps NAT bindings open
+#define UDP_REORDER_WINDOW 64     // sequence numbers further back mean a new stream
+
+struct UdpFrameStats {
+    uint32_t frames;       // complete frames handed on
+    uint32_t incomplete;   // abandoned for a newer frame with chunks missing
+    uint32_t late;         // chunks of a frame older than the newest completed one
+    uint32_t malformed;    // not a frame chunk, or inconsistent with its frame
+};
+
+/**
+ * @brief Build a registration datagram
+ * @return its size (UDP_REGISTER_SIZE)
+ */
+size_t udpWriteRegister(uint8_t* out, uint32_t token);
+
+/**
+ * @brief Build the chunk `index` of `payload` for relay sequence `seq`
+ * @param out At least UDP_HEADER_SIZE + UDP_CHUNK_BYTES bytes
+ * @return datagram size, 0 if index is out of range
+ */
+size_t udpWriteChunk(uint8_t* out, const uint8_t* payload, size_t length, uint16_t seq, uint8_t index);
+
+/** @brief Datagrams needed for a payload (0 if it is too large) */
+uint8_t udpChunkCount(size_t length);
+
+class UdpFrameAssembler {
+public:
+    UdpFrameAssembler() { reset(); }
+
+    /** @brief Forget the stream (new registration: the server restarts at 0) */
+    void reset();
+
+    /**
+     * @brief Take one datagram
+     * @return true if it completed a frame: see frame() / frameLength()
+     */
+    bool push(const uint8_t* datagram, size_t length);
+
+    const uint8_t* frame() const { return buffer; }
+    size_t frameLength() const { return assembledLength; }
+    uint16_t frameSequence() const { return currentSeq; }
+
+    UdpFrameStats stats() const { return counters; }
+
+private:
+    uint8_t buffer[UDP_FRAME_MAX];
+    size_t assembledLength;
+    size_t chunkLength[UDP_MAX_CHUNKS];
+    uint8_t received;      // bitmask of chunks in buffer
+    uint8_t chunkCount;
+    uint16_t currentSeq;   // frame in buffer (complete or not)
+    bool assembling;
+    bool haveCompleted;
+    uint16_t lastCompleted;
+    UdpFrameStats counters;
+};
+
+#endif // UDP_FRAMES_H
@@ -0,0 +1,90 @@
+/**
+ * @file water_composite.h
+ * @brief Local/remote layer composite and RGB565 pack, integer only
+ *
+ * Per pixel, from two Q16 shading maps: shade superposition, a tint mix
+ * towards the remote colour where the remote layer moves, and the
+ * brightness boost — composeShading() in client-web/js/water.js, within
+ * one LSB. The matrix renderer and the web client's WebAssembly core
+ * (wasm/water_core.cpp) both composite through here, so a phone and a
+ * matrix in lockstep draw the same pixels.
+ *
+ * Header-only, no platform dependency; the loops are plain enough for
+ * the compiler to vectorise (SIMD128 in the WebAssembly build).
+ */
+
+#ifndef WATER_COMPOSITE_H
+#define WATER_COMPOSITE_H
+
+#include <stdint.h>
+
+#include "wave_kernel.h"
+
+#define WATER_BRIGHTNESS_BOOST_Q8 512   // BRIGHTNESS_BOOST (2.0) × 256
+
+struct WaterTint {
+    uint8_t r, g, b;
+};
+
+static const int32_t WATER_SHADE_ONE = 1 << 16;
+static const int32_t WATER_SHADE_HALF = 1 << 15;
+
+/**
+ * lerp(local, remote, mix) × k for one channel: mix in Q16, k in Q14
+ * (brightness up to 2.0). Intermediates stay below 2^32.
+ */
+inline uint8_t composeWaterChannel(int32_t local, int32_t remote, int32_t mix, uint32_t k) {
+    const uint32_t c8 = ((local << 16) + (remote - local) * mix + 128) >> 8;   // Q8
+    const uint32_t v = (c8 * k + (1u << 21)) >> 22;
+    return v > 255 ? 255 : (uint8_t)v;
+}
+
+/**
+ * @brief Composite two Q16 shading maps (0–65536, row-major)
+ * @param out Called as out(x, y, r, g, b) for every pixel, unrotated
+ */
+template <typename Out>
+inline void composeWater(const int32_t* shadeLocal, const int32_t* shadeRemote,
+                         WaterTint local, WaterTint remote, Out out) {
+    for (int y = 0; y < WAVE_SIZE; y++) {
+        for (int x = 0; x < WAVE_SIZE; x++) {
+            const int i = y * WAVE_SIZE + x;
+            const int32_t s1 = shadeLocal[i];
+            const int32_t s2 = shadeRemote[i];
+
+            // Superposition of wave slopes: 0.5 + (s1 - 0.5) + (s2 - 0.5)
+            int32_t totalShade = s1 + s2 - WATER_SHADE_HALF;
+            if (totalShade < 0) totalShade = 0;
+            if (totalShade > WATER_SHADE_ONE) totalShade = WATER_SHADE_ONE;
+
+            // Remote activity pushes the colour towards remoteTint
+            int32_t mixFactor = (s2 > WATER_SHADE_HALF ? s2 - WATER_SHADE_HALF : WATER_SHADE_HALF - s2) * 4;
+            if (mixFactor > WATER_SHADE_ONE) mixFactor = WATER_SHADE_ONE;
+
+            const uint32_t k = (totalShade * WATER_BRIGHTNESS_BOOST_Q8 + (1 << 9)) >> 10;   // Q14
+
+            out(x, y,
+                composeWaterChannel(local.r, remote.r, mixFactor, k),
+                composeWaterChannel(local.g, remote.g, mixFactor, k),
+                composeWaterChannel(local.b, remote.b, mixFactor, k));
+        }
+    }
+}
+
+/**
+ * @brief Pixel index after the 90° CCW turn the panel needs: (x, y) → (y, 31 − x)
+ *
+ * Same as the phone's rotation before sending a frame.
+ */
+inline int waterPanelIndex(int x, int y) {
+    return (WAVE_SIZE - 1 - x) * WAVE_SIZE + y;
+}
+
+/** @brief Big-endian RGB565, as frames go over the wire */
+inline void packWater565(uint8_t* frame565, int index, uint8_t r, uint8_t g, uint8_t b) {
+    const uint16_t rgb16 = (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+    frame565[index * 2] = (uint8_t)(rgb16 >> 8);
+    frame565[index * 2 + 1] = (uint8_t)(rgb16 & 0xFF);
+}
+
+#endif // WATER_COMPOSITE_H
@@ -0,0 +1,87 @@
+#include "water_lockstep.h"
+
+// ─── Tables ──────────────────────────────────────────────────────────────────
+
+// round(65536 × exp(-(dx² + dy²) × 2.2 / radius²)), [radius - 1][|dx|][|dy|]
+static const int32_t DROP_WEIGHTS[5][6][6] = {
+    { { 65536,  7262,     0,     0,     0,     0 },
+      {  7262,   805,     0,     0,     0,     0 } },
+    { { 65536, 37811,  7262,     0,     0,     0 },
+      { 37811, 21815,  4190,     0,     0,     0 },
+      {  7262,  4190,   805,     0,     0,     0 } },
+    { { 65536, 51324, 24651,  7262,     0,     0 },
+      { 51324, 40194, 19305,  5687,     0,     0 },
+      { 24651, 19305,  9272,  2731,     0,     0 },
+      {  7262,  5687,  2731,   805,     0,     0 } },
+    { { 65536, 57117, 37811, 19013,  7262,     0 },
+      { 57117, 49779, 32954, 16570,  6329,     0 },
+      { 37811, 32954, 21815, 10969,  4190,     0 },
+      { 19013, 16570, 10969,  5516,  2107,     0 },
+      {  7262,  6329,  4190,  2107,   805,     0 } },
+    { { 65536, 60015, 46090, 29684, 16032,  7262 },
+      { 60015, 54960, 42208, 27183, 14682,  6650 },
+      { 46090, 42208, 32414, 20876, 11275,  5107 },
+      { 29684, 27183, 20876, 13445,  7262,  3289 },
+      { 16032, 14682, 11275,  7262,  3922,  1776 },
+      {  7262,  6650,  5107,  3289,  1776,   805 } },
+};
+
+static const int32_t JITTER_Q16 = 29491;   // 0.45 px per unit of radius
+
+// ─── Helpers ─────────────────────────────────────────────────────────────────
+
+static inline int clampi(int x, int lo, int hi) {
+    return x < lo ? lo : x > hi ? hi : x;
+}
+
+uint32_t lockstepHash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/** Jitter offset in whole px: round((2u - 1) × 0.45 × radius), u in [0, 1) */
+static int jitterOffset(uint32_t seed, int radius) {
+    const int64_t u = lockstepHash(seed) >> 16;                // Q16
+    const int64_t t = (2 * u - 65536) * radius * JITTER_Q16;    // Q32
+    return (int)((t + ((int64_t)1 << 31)) >> 32);
+}
+
+// ─── Lockstep ────────────────────────────────────────────────────────────────
+
+void lockstepDrop(WaveKernel<Q16>& kernel, const LockstepDrop& drop) {
+    const int rad = clampi(drop.radius, 1, 5);
+    const int bursts = clampi(drop.burst, 1, 8);
+    const int32_t strength = drop.strength > LOCKSTEP_STRENGTH_MAX ? LOCKSTEP_STRENGTH_MAX : drop.strength;
+    const int32_t (*weight)[6] = DROP_WEIGHTS[rad - 1];
+
+    for (int b = 0; b < bursts; b++) {
+        const uint32_t seed = drop.tick * 0x9E3779B1u + (uint32_t)(b * 17 + drop.x * 5 + drop.y * 3) * 2;
+        const int px = clampi(drop.x + jitterOffset(seed, rad), 1, WAVE_SIZE - 2);
+        const int py = clampi(drop.y + jitterOffset(seed + 1, rad), 1, WAVE_SIZE - 2);
+
+        for (int dx = -rad; dx <= rad; dx++) {
+            for (int dy = -rad; dy <= rad; dy++) {
+                const int x = px + dx;
+                const int y = py + dy;
+                if (x < 1 || x > WAVE_SIZE - 2 || y < 1 || y > WAVE_SIZE - 2) continue;
+                const int32_t w = weight[dx < 0 ? -dx : dx][dy < 0 ? -dy : dy];
+                kernel.addVelocity(y * WAVE_SIZE + x, Q16::fromRaw((strength * w + 128) >> 8));
+            }
+        }
+    }
+}
+
+uint32_t lockstepChecksum(const WaveKernel<Q16>& kernel) {
+    uint32_t hash = 2166136261u;
+    const Q16* fields[] = { kernel.heightField(), kernel.velocityField() };
+    for (const Q16* field : fields) {
+        for (int i = 0; i < WAVE_CELLS; i++) {
+            hash = (hash ^ (uint32_t)field[i].raw) * 16777619u;
+        }
+    }
+    return hash;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file water_lockstep.h
+ * @brief Deterministic water core shared by phones and matrices
+ *
+ * Everything that changes the wave fields in lockstep mode, in integer
+ * math only, so client-web/js/lockstep.js computes the same bits:
+ *
+ *   - the fields are WaveKernel<Q16> (JS: Int32Array, products exact in
+ *     doubles, same rounding);
+ *   - a drop is stamped with the simulation tick it applies at; its jitter
+ *     is an integer hash of that tick instead of the wall clock, and its
+ *     Gaussian falloff is a Q16 table instead of exp();
+ *   - strengths travel as multiples of 1/256, waveDamp/renderGain as
+ *     multiples of 1/65536, so parsing them can't round differently.
+ *
+ * Given the same event log, every device holds identical fields at every
+ * tick, however fast it runs. Compositing and tints are render-side only.
+ */
+
+#ifndef WATER_LOCKSTEP_H
+#define WATER_LOCKSTEP_H
+
+#include <stdint.h>
+
+#include "wave_kernel.h"
+
+#define LOCKSTEP_TICK_MS 16      // one simulation step; server and phones use the same
+#define LOCKSTEP_STRENGTH_ONE 256
+#define LOCKSTEP_STRENGTH_MAX (16 * LOCKSTEP_STRENGTH_ONE)   // keeps strength × weight in int32
+
+struct LockstepDrop {
+    uint32_t tick;
+    uint8_t x;
+    uint8_t y;
+    uint8_t radius;      // clamped to 1–5
+    uint8_t burst;       // clamped to 1–8
+    uint16_t strength;   // × 1/256, clamped to LOCKSTEP_STRENGTH_MAX
+};
+
+/**
+ * @brief Inject a drop into a Q16 kernel (call before stepping drop.tick)
+ */
+void lockstepDrop(WaveKernel<Q16>& kernel, const LockstepDrop& drop);
+
+/**
+ * @brief Word-wise FNV-1a over the height then velocity field
+ */
+uint32_t lockstepChecksum(const WaveKernel<Q16>& kernel);
+
+/**
+ * @brief 32-bit integer hash (drop jitter)
+ */
+uint32_t lockstepHash(uint32_t x);
+
+#endif // WATER_LOCKSTEP_H
@@ -0,0 +1,322 @@
+#include "water_renderer.h"
+#include "frame_pipeline.h"
+#include "hal/platform.h"
+#include "spsc_queue.h"
+#include "water_simulation.h"
+
+#include <atomic>
+#include <math.h>
+
+static_assert(WATER_SIZE == TOTAL_WIDTH && WATER_SIZE == TOTAL_HEIGHT, "water grid must match the panel");
+static_assert(WATER_STEP_MS == LOCKSTEP_TICK_MS, "lockstep ticks are water steps");
+
+// ─── State ───────────────────────────────────────────────────────────────────
+
+static WaterSimulation localWater;
+static WaterSimulation remoteWater;
+
+static WaterTint localTint = { 60, 150, 255 };
+static WaterTint remoteTint = { 255, 100, 100 }; // Default remote color until updated
+
+static SpscQueue<WaterEvent, WATER_EVENT_QUEUE> events;
+static uint32_t eventsDropped = 0;
+
+// Something changed since the last renderWater() (render side)
+static bool dirty = true;
+
+// Lockstep: render side, except the horizon (network side)
+static bool lockstep = false;
+static std::atomic<uint32_t> horizon{0};
+static WaterLockstepStats lockstepStats = {};
+static std::atomic<bool> eventLost{false};       // network → render: a stamped event was dropped
+static std::atomic<bool> resyncWanted{false};    // render → network: ask for a sync point
+static const uint32_t NO_HOLD = 0xFFFFFFFF;
+static std::atomic<uint32_t> holdTick{NO_HOLD};  // render → network: flat from this tick on
+
+static int32_t shadeLocal[WATER_CELLS];    // Q16
+static int32_t shadeRemote[WATER_CELLS];
+
+// ─── Events ──────────────────────────────────────────────────────────────────
+
+bool postWaterEvent(const WaterEvent& event) {
+    if (!events.push(event)) {
+        eventsDropped++;
+        if (lockstep) {
+            eventLost.store(true, std::memory_order_release);   // the log has a hole now
+        }
+        return false;
+    }
+    return true;
+}
+
+static void applyEvent(const WaterEvent& e, uint32_t nowMs) {
+    dirty = true;
+    WaterSimulation& layer = e.layer == WATER_LAYER_REMOTE ? remoteWater : localWater;
+    WaterTint& tint = e.layer == WATER_LAYER_REMOTE ? remoteTint : localTint;
+    const bool local = e.layer != WATER_LAYER_REMOTE;
+    const bool remote = e.layer != WATER_LAYER_LOCAL;
+
+    switch (e.type) {
+        case WATER_EVENT_DROP:
+            if (e.hasTint) {
+                tint = { e.r, e.g, e.b };
+            }
+#if WATER_FIXED_POINT
+            if (lockstep && e.stamped) {
+                LockstepDrop drop;
+                drop.tick = e.tick;
+                drop.x = e.x;
+                drop.y = e.y;
+                drop.radius = e.radius;
+                drop.burst = e.burst ? e.burst : 1;
+                const long strength = lrintf(e.strength * LOCKSTEP_STRENGTH_ONE);
+                drop.strength = strength < 0 ? 0 : strength > LOCKSTEP_STRENGTH_MAX ? LOCKSTEP_STRENGTH_MAX : strength;
+                layer.dropAt(drop);
+                break;
+            }
+#endif
+            layer.dropAt(e.x, e.y, e.strength, e.radius, layer.getDropBurst(), nowMs * 0.001);
+            break;
+
+        case WATER_EVENT_TINT:
+            tint = { e.r, e.g, e.b };
+            break;
+
+        case WATER_EVENT_PARAMS:
+            // Untagged: the phone's sliders drive both of its layers.
+            // Tagged (lockstep): they belong to the layer of the phone that sent them
+            if (local) {
+                localWater.setWaveDamp(e.waveDamp);
+                localWater.setRenderGain(e.renderGain);
+            }
+            if (remote) {
+                remoteWater.setWaveDamp(e.waveDamp);
+                remoteWater.setRenderGain(e.renderGain);
+            }
+            break;
+
+        case WATER_EVENT_RESET:
+            if (local) {
+                localWater.reset();
+            }
+            if (remote) {
+                remoteWater.reset();
+            }
+            break;
+    }
+}
+
+/** Step both layers; an idle layer's step does nothing */
+static void stepLayers() {
+    dirty = dirty || !localWater.isIdle() || !remoteWater.isIdle();
+    localWater.step();
+    remoteWater.step();
+}
+
+// ─── Lockstep ────────────────────────────────────────────────────────────────
+
+#if WATER_FIXED_POINT
+static bool holdPosted = false;   // holdTick is out for this flat spell
+static bool departed = false;     // left the log for a lost or late event, no sync point since
+static uint32_t outTicks = 0;     // ticks since the last resync request, while departed
+
+/** A stamped reset of both layers: where a client joins (or rejoins) the log */
+static bool isSyncPoint(const WaterEvent& e) {
+    return e.stamped && e.type == WATER_EVENT_RESET && e.layer == WATER_LAYER_BOTH;
+}
+
+static void syncTo(const WaterEvent& e) {
+    dirty = true;
+    // Everyone restarts from flat water and default parameters
+    localWater.reset();
+    localWater.resetParameters();
+    remoteWater.reset();
+    remoteWater.resetParameters();
+    lockstepStats.synced = true;
+    lockstepStats.tick = e.tick;
+    holdPosted = false;
+    departed = false;
+}
+
+/** Have the network side ask the server for a sync point */
+static void askResync() {
+    lockstepStats.resyncAsks++;
+    outTicks = 0;
+    resyncWanted.store(true, std::memory_order_release);
+}
+
+/**
+ * Leave the log: the fields no longer match everyone else's, so stop
+ * stepping them (the panel keeps the last frame) and skip events until the
+ * next sync point, which the network side asks the server for.
+ */
+static void desync() {
+    lockstepStats.synced = false;
+    lockstepStats.resyncs++;
+    departed = true;
+    askResync();
+}
+
+/**
+ * Step up to the horizon: the ticks due, one more while more than
+ * WATER_LOCKSTEP_MAX_LAG behind. Events are applied right before the tick
+ * they are stamped with; a dropped or late one leaves the log. Flat water
+ * steps to itself, so while both layers are idle the tick skips ahead to
+ * the next event or the horizon (as LockstepSchedule.advance does).
+ */
+static void advanceLockstep(uint32_t due) {
+    if (eventLost.exchange(false, std::memory_order_acquire)) {
+        if (lockstepStats.synced) {
+            desync();
+        } else {
+            askResync();   // it may have been the sync point
+        }
+    }
+    WaterEvent* e;
+    while (!lockstepStats.synced && (e = events.front()) != nullptr) {
+        if (isSyncPoint(*e)) {
+            syncTo(*e);
+        }
+        events.release();
+    }
+    if (!lockstepStats.synced) {
+        // Out of the log since a departure: the request, or its answer, may be lost
+        outTicks += departed ? due : 0;
+        if (outTicks >= WATER_LOCKSTEP_RESYNC_TICKS) {
+            askResync();
+        }
+        return;
+    }
+    if (due == 0) {
+        return;
+    }
+
+    const uint32_t last = horizon.load(std::memory_order_acquire);
+    lockstepStats.horizon = last;
+    const bool behind = (int32_t)(last + 1 - lockstepStats.tick) > WATER_LOCKSTEP_MAX_LAG;
+    uint32_t steps = 0;
+    for (; steps < due + behind; steps++) {
+        if (isWaterIdle()) {
+            uint32_t next = last + 1;
+            if ((e = events.front()) != nullptr && (int32_t)(e->tick - next) < 0) {
+                next = e->tick;
+            }
+            if ((int32_t)(next - lockstepStats.tick) > 0) {
+                lockstepStats.tick = next;
+            }
+        }
+        // A sync point applies at once: the water restarts there anyway
+        while ((e = events.front()) != nullptr &&
+               (isSyncPoint(*e) || (int32_t)(e->tick - lockstepStats.tick) <= 0)) {
+            if (isSyncPoint(*e)) {
+                syncTo(*e);
+            } else if (e->stamped && e->tick != lockstepStats.tick) {
+                lockstepStats.lateEvents++;
+                desync();
+                return;   // this event goes with the rest until the sync point
+            } else {
+                applyEvent(*e, 0);
+                holdPosted = false;
+            }
+            events.release();
+        }
+        if ((int32_t)(last + 1 - lockstepStats.tick) <= 0) {
+            break;   // not vouched for yet
+        }
+        if (lockstepStats.tick % WATER_LOCKSTEP_LOG_TICKS == 0) {
+            Serial.printf("[WATER] tick %u: local %08x remote %08x\n", (unsigned)lockstepStats.tick,
+                (unsigned)localWater.checksum(), (unsigned)remoteWater.checksum());
+        }
+        stepLayers();
+        lockstepStats.tick++;
+    }
+    lockstepStats.stalls += steps == 0 && !isWaterIdle();
+
+    // Flat with every event applied: the server may pause its beats
+    if (!isWaterIdle() || events.front() != nullptr) {
+        holdPosted = false;
+    } else if (!holdPosted) {
+        holdPosted = true;
+        holdTick.store(lockstepStats.tick, std::memory_order_release);
+    }
+}
+#endif
+
+bool setWaterLockstep(bool enabled) {
+#if WATER_FIXED_POINT
+    lockstep = enabled;
+    lockstepStats = {};
+    eventLost.store(false);
+    resyncWanted.store(false);
+    holdTick.store(NO_HOLD);
+    holdPosted = false;
+    departed = false;
+    outTicks = 0;
+    return true;
+#else
+    lockstep = false;
+    return !enabled;
+#endif
+}
+
+void setWaterHorizon(uint32_t tick) {
+    horizon.store(tick, std::memory_order_release);
+}
+
+bool takeWaterResyncRequest() {
+    return resyncWanted.exchange(false, std::memory_order_acquire);
+}
+
+bool takeWaterHold(uint32_t* tick) {
+    const uint32_t t = holdTick.exchange(NO_HOLD, std::memory_order_acquire);
+    if (t == NO_HOLD) {
+        return false;
+    }
+    *tick = t;
+    return true;
+}
+
+WaterLockstepStats getWaterLockstepStats() {
+    return lockstepStats;
+}
+
+bool waterRendererTick(uint32_t nowMs, uint32_t steps) {
+#if WATER_FIXED_POINT
+    if (lockstep) {
+        advanceLockstep(steps);
+        return dirty;
+    }
+#endif
+    WaterEvent e;
+    while (events.pop(e)) {
+        applyEvent(e, nowMs);
+    }
+    for (uint32_t i = 0; i < steps; i++) {
+        stepLayers();
+    }
+    return dirty;
+}
+
+bool isWaterIdle() {
+    return localWater.isIdle() && remoteWater.isIdle();
+}
+
+uint32_t getWaterEventsDropped() {
+    return eventsDropped;
+}
+
+// ─── Compositing ─────────────────────────────────────────────────────────────
+
+void renderWater(rgb24* out) {
+    dirty = false;
+    localWater.getShadingMapQ16(shadeLocal);
+    remoteWater.getShadingMapQ16(shadeRemote);
+
+    composeWater(shadeLocal, shadeRemote, localTint, remoteTint,
+        [out](int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+            rgb24& px = out[waterPanelIndex(x, y)];
+            px.red = r;
+            px.green = g;
+            px.blue = b;
+        });
+}
@@ -0,0 +1,150 @@
+/**
+ * @file water_renderer.h
+ * @brief On-device water: local + remote simulations and tint compositing
+ *
+ * Mirrors what app.js mainLoop() does on the phone — two WaterSimulation
+ * layers, mixed per pixel with localTint/remoteTint, mixFactor and
+ * BRIGHTNESS_BOOST, rotated 90° CCW for the panel — so the phone only has
+ * to send drop/tint events instead of 2 KB frames.
+ *
+ * The composite is integer-only (Q16 shading, Q8 colour; water_composite.h),
+ * so with WATER_FIXED_POINT the whole render path is bit-exact across
+ * boards and with the phone's WebAssembly core. It stays within one LSB of
+ * the phone's float composeShading().
+ *
+ * Events are posted from the network side and applied by the render side
+ * on its next tick (single producer, single consumer).
+ *
+ * Once both layers' ripples have died out they go idle (WaveKernel): no
+ * stepping, and waterRendererTick() reports that the last frame still
+ * stands, so the render loop can skip compositing until the next event.
+ *
+ * In lockstep mode (setWaterLockstep, needs WATER_FIXED_POINT) events carry
+ * the simulation tick the server stamped them with and are applied exactly
+ * at that tick (water_lockstep.h). The server's beats say up to which tick
+ * every event has been sent; the water never steps past that horizon, so
+ * every phone and matrix computes the same fields from the same log. A
+ * client joins the log at a stamped reset of both layers. An event lost to
+ * a full queue, or one stamped for a tick already simulated, means the
+ * fields have parted from everyone else's: the water stops, leaves the log
+ * and waits for the next sync point, and takeWaterResyncRequest() tells
+ * the network side to ask the server for one (again every
+ * WATER_LOCKSTEP_RESYNC_TICKS until it comes: a request can be lost too). Flat water skips ahead to
+ * the next event instead of stepping, so the server may pause its beats
+ * once every client reports it flat (takeWaterHold()).
+ */
+
+#ifndef WATER_RENDERER_H
+#define WATER_RENDERER_H
+
+#include <stdint.h>
+
+#include "hal/display.h"
+#include "water_composite.h"
+
+#define WATER_STEP_MS 16           // one simulation step per ~60 Hz tick (a phone's rAF)
+#define WATER_EVENT_QUEUE 32
+#define WATER_MAX_CATCH_UP 4        // steps per render after a stall; the rest are dropped
+#define WATER_LOCKSTEP_MAX_LAG 8    // ticks behind the horizon before catching up
+#define WATER_LOCKSTEP_LOG_TICKS 625  // checksum log period (10 s), same tick on every device
+#define WATER_LOCKSTEP_RESYNC_TICKS 125  // out of the log: ask for a sync point again every 2 s
+
+enum WaterEventType : uint8_t {
+    WATER_EVENT_DROP,    // x, y, strength, radius (+ tint)
+    WATER_EVENT_TINT,    // tint only
+    WATER_EVENT_PARAMS,  // waveDamp, renderGain
+    WATER_EVENT_RESET,
+};
+
+enum WaterLayer : uint8_t {
+    WATER_LAYER_LOCAL,   // this matrix's own phone
+    WATER_LAYER_REMOTE,  // the other pair's phone
+    WATER_LAYER_BOTH,    // untagged params/reset (drops and tints: local)
+};
+
+struct WaterEvent {
+    WaterEventType type;
+    WaterLayer layer;
+    uint8_t x;
+    uint8_t y;
+    uint8_t radius;
+    uint8_t burst;       // lockstep drops; 0 = the layer's default
+    bool hasTint;
+    bool stamped;        // tick is valid
+    uint32_t tick;
+    uint8_t r, g, b;
+    float strength;
+    float waveDamp;
+    float renderGain;
+};
+
+/**
+ * @brief Queue an event for the next tick (network side)
+ * @return false if the queue is full and the event was dropped
+ */
+bool postWaterEvent(const WaterEvent& event);
+
+/**
+ * @brief Apply queued events, then advance both layers (render side)
+ * @param nowMs    Clock for the drop jitter seed (millis()); only turned
+ *                 into seconds when an unstamped drop is applied
+ * @param steps    Ticks due, from a FixedTimestep at WATER_STEP_MS. In
+ *                 lockstep one more while far behind, never past the horizon
+ * @return false if nothing changed since the last renderWater(): both
+ *         layers idle (flat) and no event applied, the frame still stands
+ */
+bool waterRendererTick(uint32_t nowMs, uint32_t steps = 1);
+
+/**
+ * @brief Both layers are idle: flat water, nothing to simulate until a drop
+ */
+bool isWaterIdle();
+
+/**
+ * @brief Composite both layers into a panel-oriented RGB24 frame
+ */
+void renderWater(rgb24* out);
+
+/**
+ * @brief Events dropped because the queue was full
+ */
+uint32_t getWaterEventsDropped();
+
+// ─── Lockstep ────────────────────────────────────────────────────────────────
+
+struct WaterLockstepStats {
+    bool synced;          // joined the event log
+    uint32_t tick;        // next tick to simulate
+    uint32_t horizon;     // last tick the server vouched for
+    uint32_t stalls;      // renders with steps due but none vouched for
+    uint32_t lateEvents;  // stamped for a tick already simulated (breaks lockstep)
+    uint32_t resyncs;     // times the log was left for a lost or late event
+    uint32_t resyncAsks;  // sync points asked for (first asks and retries)
+};
+
+/**
+ * @brief Switch lockstep mode (before events flow)
+ * @return false if this build can't run it (WATER_FIXED_POINT off)
+ */
+bool setWaterLockstep(bool enabled);
+
+/**
+ * @brief Server beat: every event up to `tick` has been sent (network side)
+ */
+void setWaterHorizon(uint32_t tick);
+
+/**
+ * @brief The water left the log: ask the server for a sync point (network
+ *        side; true once per departure)
+ */
+bool takeWaterResyncRequest();
+
+/**
+ * @brief The water has gone flat with every event applied: tell the server
+ *        (network side; true once per flat spell, tick = next tick)
+ */
+bool takeWaterHold(uint32_t* tick);
+
+WaterLockstepStats getWaterLockstepStats();
+
+#endif // WATER_RENDERER_H
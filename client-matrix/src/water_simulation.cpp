@@ -0,0 +1,120 @@
+#include "water_simulation.h"
+
+#include <math.h>
+
+// ─── Helpers ─────────────────────────────────────────────────────────────────
+
+static inline int clampi(int x, int lo, int hi) {
+    return x < lo ? lo : x > hi ? hi : x;
+}
+
+/** Simple hash for deterministic pseudo-random jitter (double, as in JS). */
+static double hash11(double x) {
+    double s = sin(x * 127.1 + 311.7) * 43758.5453;
+    return s - floor(s);
+}
+
+#if !WATER_FIXED_POINT
+// Float shading on its way to Q16 (render side only)
+static float shadeScratch[WATER_CELLS];
+#endif
+
+/** Row-major index. */
+static inline int idx(int x, int y) {
+    return y * WATER_SIZE + x;
+}
+
+// ─── WaterSimulation ─────────────────────────────────────────────────────────
+
+WaterSimulation::WaterSimulation()
+    : dropStrength(1.0f),
+      dropRadius(2),
+      dropBurst(1) {
+}
+
+void WaterSimulation::dropAt(int cx, int cy, float strength, int radius, int burstCount, double seedTime) {
+    const int rad = clampi(radius, 1, 5);
+    const int bursts = clampi(burstCount, 1, 8);
+
+    const double falloff = 2.2 / (rad * rad);
+    const double jitter = rad * 0.45;
+
+    // Gaussian weight per |dx|,|dy| (in double, like Math.exp in JS)
+    double weight[6][6];
+    for (int dx = 0; dx <= rad; dx++) {
+        for (int dy = 0; dy <= rad; dy++) {
+            weight[dx][dy] = exp(-(dx * dx + dy * dy) * falloff);
+        }
+    }
+
+    for (int b = 0; b < bursts; b++) {
+        const double seed = seedTime + (b * 17 + cx * 5 + cy * 3);
+        // Math.round(): halves go up
+        const int jcx = (int)floor((hash11(seed * 1.37 + 2.1) - 0.5) * 2.0 * jitter + 0.5);
+        const int jcy = (int)floor((hash11(seed * 1.93 + 9.4) - 0.5) * 2.0 * jitter + 0.5);
+        const int px = clampi(cx + jcx, 1, WATER_SIZE - 2);
+        const int py = clampi(cy + jcy, 1, WATER_SIZE - 2);
+
+        for (int dx = -rad; dx <= rad; dx++) {
+            for (int dy = -rad; dy <= rad; dy++) {
+                const int x = px + dx;
+                const int y = py + dy;
+                if (x < 1 || x > WATER_SIZE - 2 || y < 1 || y > WATER_SIZE - 2) continue;
+                const double w = weight[dx < 0 ? -dx : dx][dy < 0 ? -dy : dy];
+                kernel.addVelocity(idx(x, y), WaterScalar((float)(strength * w)));
+            }
+        }
+    }
+}
+
+void WaterSimulation::dropAt(int cx, int cy, double seedTime) {
+    dropAt(cx, cy, dropStrength, dropRadius, dropBurst, seedTime);
+}
+
+void WaterSimulation::step() {
+    kernel.step();
+}
+
+void WaterSimulation::getShadingMap(float* map) const {
+#if WATER_FIXED_POINT
+    kernel.getShadingMap(shade);
+    for (int i = 0; i < WATER_CELLS; i++) {
+        map[i] = (float)shade[i];
+    }
+#else
+    kernel.getShadingMap(map);
+#endif
+}
+
+void WaterSimulation::getShadingMapQ16(int32_t* map) const {
+#if WATER_FIXED_POINT
+    kernel.getShadingMap(shade);
+    for (int i = 0; i < WATER_CELLS; i++) {
+        map[i] = shade[i].raw;
+    }
+#else
+    kernel.getShadingMap(shadeScratch);
+    for (int i = 0; i < WATER_CELLS; i++) {
+        map[i] = (int32_t)lrintf(shadeScratch[i] * Q16::ONE);
+    }
+#endif
+}
+
+void WaterSimulation::reset() {
+    kernel.reset();
+}
+
+void WaterSimulation::resetParameters() {
+    kernel.setDefaultParameters();
+    dropStrength = 1.0f;
+    dropRadius = 2;
+    dropBurst = 1;
+}
+
+void WaterSimulation::setDropRadius(int val) {
+    dropRadius = clampi(val, 1, 5);
+}
+
+void WaterSimulation::setDropBurst(int val) {
+    dropBurst = clampi(val, 1, 8);
+}
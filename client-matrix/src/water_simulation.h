@@ -0,0 +1,109 @@
+/**
+ * @file water_simulation.h
+ * @brief 2D wave-equation water simulation on a 32×32 grid
+ *
+ * C++ port of WaterSimulation in client-web/js/water.js, same parameters,
+ * same defaults, same update order. The step/shading loops live in
+ * WaveKernel; WATER_FIXED_POINT picks its scalar:
+ *
+ *   0  float — matches the JS (Float32Array fields) to float rounding
+ *   1  Q16 fixed point — integer-only step and shading
+ */
+
+#ifndef WATER_SIMULATION_H
+#define WATER_SIMULATION_H
+
+#include <stdint.h>
+
+#include "wave_kernel.h"
+#include "water_lockstep.h"
+
+#define WATER_SIZE WAVE_SIZE
+#define WATER_CELLS WAVE_CELLS
+
+#ifndef WATER_FIXED_POINT
+#define WATER_FIXED_POINT 0
+#endif
+
+#if WATER_FIXED_POINT
+typedef Q16 WaterScalar;
+#else
+typedef float WaterScalar;
+#endif
+
+class WaterSimulation {
+public:
+    WaterSimulation();
+
+    /**
+     * @brief Inject a water drop at (cx, cy)
+     * @param strength   Drop energy
+     * @param radius     Drop radius in px (clamped to 1–5)
+     * @param burstCount Number of jittered sub-drops (clamped to 1–8)
+     * @param seedTime   Jitter seed in seconds (performance.now() * 0.001 in JS)
+     */
+    void dropAt(int cx, int cy, float strength, int radius, int burstCount, double seedTime);
+
+    /** @brief Drop with the current default strength/radius/burst */
+    void dropAt(int cx, int cy, double seedTime);
+
+#if WATER_FIXED_POINT
+    /** @brief Tick-stamped drop, bit-exact with client-web/js/lockstep.js */
+    void dropAt(const LockstepDrop& drop) { lockstepDrop(kernel, drop); }
+
+    /** @brief Field checksum, comparable across devices in lockstep */
+    uint32_t checksum() const { return lockstepChecksum(kernel); }
+#endif
+
+    /** @brief Advance the simulation by one time step (nothing while idle) */
+    void step();
+
+    /** @brief Flat water: step() is a no-op until the next drop (WaveKernel) */
+    bool isIdle() const { return kernel.isIdle(); }
+
+    /** @brief Field energy after the last step (Σ v² + Σ |∇h|²) */
+    double getEnergy() const { return kernel.getEnergy(); }
+
+    /** @brief Directional shading per pixel (0.0–1.0, 0.5 = flat), row-major */
+    void getShadingMap(float* map) const;
+
+    /** @brief Same shading in Q16 (0–65536); no float in the fixed-point build */
+    void getShadingMapQ16(int32_t* map) const;
+
+    /** @brief Reset both fields to zero (flat water) */
+    void reset();
+
+    /** @brief Back to the default parameters (as constructed) */
+    void resetParameters();
+
+    // ─── Parameters ──────────────────────────────────────────────────────────
+
+    void setWaveK(float val) { kernel.setWaveK(val); }
+    void setWaveDamp(float val) { kernel.setWaveDamp(val); }
+    void setRenderGain(float val) { kernel.setRenderGain(val); }
+    void setDropStrength(float val) { dropStrength = val; }
+    void setDropRadius(int val);
+    void setDropBurst(int val);
+
+    float getWaveK() const { return kernel.getWaveK(); }
+    float getWaveDamp() const { return kernel.getWaveDamp(); }
+    float getRenderGain() const { return kernel.getRenderGain(); }
+    float getDropStrength() const { return dropStrength; }
+    int getDropRadius() const { return dropRadius; }
+    int getDropBurst() const { return dropBurst; }
+
+    const WaveKernel<WaterScalar>& waveKernel() const { return kernel; }
+
+private:
+    WaveKernel<WaterScalar> kernel;  // height/velocity fields, step, shading
+
+#if WATER_FIXED_POINT
+    mutable WaterScalar shade[WATER_CELLS];  // fixed-point shading before conversion
+#endif
+
+    float dropStrength;  // default drop energy
+    int dropRadius;      // default drop radius (px)
+    int dropBurst;       // number of jittered sub-drops per trigger
+};
+
+#endif // WATER_SIMULATION_H
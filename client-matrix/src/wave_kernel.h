@@ -0,0 +1,160 @@
+/**
+ * @file wave_kernel.h
+ * @brief Templated 32×32 wave-equation kernel (float reference or fixed-point)
+ *
+ * The inner loops of WaterSimulation, parameterised on the scalar type:
+ *
+ *   WaveKernel<float>  reference, same arithmetic as water.js
+ *   WaveKernel<Q16>    integer only — int32 fields, int64 products
+ *
+ * Parameters are set as floats (waveK, waveDamp, renderGain, as in JS) and
+ * converted once; step() and getShadingMap() never touch floats in the
+ * fixed-point instantiation.
+ *
+ * Idle: step() measures the field energy (Σ v² + Σ |∇h|², forward
+ * differences) and goes idle below WAVE_IDLE_ENERGY_Q32, or on an exact fixed
+ * point (v ≡ 0 before and after a step, where Q16 rounding can leave a
+ * faint static residue). An idle kernel's step() does nothing until a drop
+ * or a waveK/waveDamp change. The rule only reads the fields, so kernels
+ * in lockstep go idle, and wake, on the same tick.
+ */
+
+#ifndef WAVE_KERNEL_H
+#define WAVE_KERNEL_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "fixed_point.h"
+
+#define WAVE_SIZE 32
+#define WAVE_CELLS (WAVE_SIZE * WAVE_SIZE)
+#define WAVE_IDLE_ENERGY_Q32 64   // Q16 LSB² (2^-32): steepest step ~1e-4, under ½ LSB of shade
+
+// Energy sums: double for float fields, LSB² integers for fixed point
+inline bool waveEnergyIdle(double e) { return e < WAVE_IDLE_ENERGY_Q32 / 4294967296.0; }
+inline bool waveEnergyIdle(uint64_t e) { return e < WAVE_IDLE_ENERGY_Q32; }
+inline double waveEnergyValue(double e) { return e; }
+inline double waveEnergyValue(uint64_t e) { return e / 4294967296.0; }
+
+template <typename Scalar>
+class WaveKernel {
+public:
+    WaveKernel() {
+        setDefaultParameters();
+        reset();
+    }
+
+    void setDefaultParameters() {
+        setWaveK(0.20f);
+        setWaveDamp(0.985f);
+        setRenderGain(2.3f);
+    }
+
+    void setWaveK(float val) { waveK = Scalar(val); waveKf = val; idle = false; }
+    void setWaveDamp(float val) { waveDamp = Scalar(val); waveDampf = val; idle = false; }
+    void setRenderGain(float val) { renderGain = Scalar(val); renderGainf = val; }
+
+    float getWaveK() const { return waveKf; }
+    float getWaveDamp() const { return waveDampf; }
+    float getRenderGain() const { return renderGainf; }
+
+    void reset() {
+        memset((void*)h, 0, sizeof(h));
+        memset((void*)v, 0, sizeof(v));
+        energy = 0;
+        stillVelocity = true;
+        idle = true;
+    }
+
+    /** @brief Add `amount` to the velocity of cell i (drops); wakes the kernel */
+    void addVelocity(int i, Scalar amount) {
+        v[i] += amount;
+        stillVelocity = false;
+        idle = false;
+    }
+
+    /** @brief Advance one time step (nothing while idle) */
+    void step() {
+        if (idle) {
+            return;
+        }
+        const Scalar zero(0.0f);
+        Energy kinetic = 0;
+        bool still = true;
+
+        // Laplacian → velocity
+        for (int y = 1; y < WAVE_SIZE - 1; y++) {
+            for (int x = 1; x < WAVE_SIZE - 1; x++) {
+                const int i = y * WAVE_SIZE + x;
+                const Scalar lap = h[i - 1] + h[i + 1] + h[i - WAVE_SIZE] + h[i + WAVE_SIZE] - h[i] * 4;
+                v[i] = mulTowardZero(v[i] + waveK * lap, waveDamp);
+                kinetic += squaredDifference(v[i], zero);
+                still = still && !(v[i] < zero) && !(v[i] > zero);
+            }
+        }
+
+        // Velocity → height; the borders stay 0, so every interior edge counts
+        Energy potential = 0;
+        for (int y = 1; y < WAVE_SIZE - 1; y++) {
+            for (int x = 1; x < WAVE_SIZE - 1; x++) {
+                const int i = y * WAVE_SIZE + x;
+                h[i] += v[i];
+                potential += squaredDifference(h[i], h[i - 1]) + squaredDifference(h[i], h[i - WAVE_SIZE]);
+                if (x == WAVE_SIZE - 2) potential += squaredDifference(h[i], zero);
+                if (y == WAVE_SIZE - 2) potential += squaredDifference(h[i], zero);
+            }
+        }
+
+        energy = kinetic + potential;
+        idle = waveEnergyIdle(energy) || (still && stillVelocity);
+        stillVelocity = still;
+    }
+
+    /** @brief Energy after the last step (0 after reset) */
+    double getEnergy() const { return waveEnergyValue(energy); }
+
+    /** @brief Flat, or frozen on a fixed point: step() is a no-op until woken */
+    bool isIdle() const { return idle; }
+
+    /** @brief Directional shading per pixel (0–1, 0.5 = flat), row-major */
+    void getShadingMap(Scalar* map) const {
+        const Scalar zero(0.0f), half(0.5f), quarter(0.25f), one(1.0f);
+        for (int y = 0; y < WAVE_SIZE; y++) {
+            for (int x = 0; x < WAVE_SIZE; x++) {
+                const int xm = x > 0 ? x - 1 : x;
+                const int xp = x < WAVE_SIZE - 1 ? x + 1 : x;
+                const int ym = y > 0 ? y - 1 : y;
+                const int yp = y < WAVE_SIZE - 1 ? y + 1 : y;
+
+                const Scalar gx = h[y * WAVE_SIZE + xp] - h[y * WAVE_SIZE + xm];
+                const Scalar gy = h[yp * WAVE_SIZE + x] - h[ym * WAVE_SIZE + x];
+                Scalar shade = half + renderGain * (gx * half + gy * quarter);
+                if (shade < zero) shade = zero;
+                if (shade > one) shade = one;
+                map[y * WAVE_SIZE + x] = shade;
+            }
+        }
+    }
+
+    const Scalar* heightField() const { return h; }
+    const Scalar* velocityField() const { return v; }
+
+private:
+    Scalar h[WAVE_CELLS];  // height field
+    Scalar v[WAVE_CELLS];  // velocity field
+
+    Scalar waveK;       // wave propagation speed
+    Scalar waveDamp;    // damping per tick (< 1.0 → energy loss)
+    Scalar renderGain;  // brightness multiplier for the gradient shade
+
+    float waveKf, waveDampf, renderGainf;  // as set, for getters
+
+    typedef decltype(squaredDifference(Scalar(), Scalar())) Energy;
+
+    Energy energy;        // Σ v² + Σ |∇h|² after the last step
+    bool stillVelocity;   // v ≡ 0 after the last step
+    bool idle;
+};
+
+#endif // WAVE_KERNEL_H
@@ -1,5 +1,8 @@
 #include "wifi_client.h"
 #include "config.h"
+#include "spsc_queue.h"
+
+#include <Preferences.h>
 
 #if USE_ENTERPRISE_WIFI
 #include "esp_wpa2.h"
@@ -14,32 +17,102 @@
 // Given the user wants "Manage the wifi as in [numeric-flower]", I will follow that logic
 // which relies on Serial.
 
-bool connectToWiFi() {
-    Serial.println("Connecting to WiFi...");
-    
-    // Disconnect previous connection
-    WiFi.disconnect(true);
-    delay(1000);
-    
+struct WifiEventRecord {
+    WifiLinkEvent event;
+    uint8_t reason;
+};
+
+static WifiLink wifiLink;
+// WiFi event task → serviceWiFi(). A lost event heals itself: the attempt times out
+static SpscQueue<WifiEventRecord, 16> wifiEvents;
+
+// ─── Last good AP (NVS) ──────────────────────────────────────────────────────
+
+struct WifiApCache {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;        // the lease, as IPAddress stores it
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+static WifiApCache apCache;
+static bool upViaCache = false;
+static bool upWithStaticIp = false;
+
+static bool loadApCache() {
+    Preferences prefs;
+    if (!prefs.begin("wifi", true)) {
+        return false;
+    }
+    // Only for the SSID it was made for: config.h may have changed since
+    const bool ok = prefs.getString("ssid", "") == WIFI_SSID &&
+        prefs.getBytes("ap", &apCache, sizeof(apCache)) == sizeof(apCache) && apCache.channel != 0;
+    prefs.end();
+    return ok;
+}
+
+/** @brief Remember the AP we're on; written only when it changed (daily power cycles) */
+static void saveApCache() {
+    WifiApCache current;
+    memset(&current, 0, sizeof(current));
+    memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+    current.channel = (uint8_t)WiFi.channel();
+    current.ip = WiFi.localIP();
+    current.gateway = WiFi.gatewayIP();
+    current.subnet = WiFi.subnetMask();
+    current.dns = WiFi.dnsIP();
+    if (upViaCache && memcmp(&current, &apCache, sizeof(current)) == 0) {
+        return;
+    }
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.putString("ssid", WIFI_SSID);
+    prefs.putBytes("ap", &current, sizeof(current));
+    prefs.end();
+    apCache = current;
+    Serial.printf("[WiFi] Saved AP %02x:%02x:%02x:%02x:%02x:%02x, channel %u for fast connect\n",
+        current.bssid[0], current.bssid[1], current.bssid[2], current.bssid[3], current.bssid[4],
+        current.bssid[5], (unsigned)current.channel);
+}
+
+static void forgetApCache() {
+    Preferences prefs;
+    prefs.begin("wifi", false);
+    prefs.remove("ap");
+    prefs.end();
+}
+
+// ─── Link ────────────────────────────────────────────────────────────────────
+
+static void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    switch (event) {
+        case SYSTEM_EVENT_STA_GOT_IP:
+            wifiEvents.push({ WIFI_EVENT_GOT_IP, 0 });
+            break;
+        case SYSTEM_EVENT_STA_LOST_IP:
+            wifiEvents.push({ WIFI_EVENT_LOST_IP, 0 });
+            break;
+        case SYSTEM_EVENT_STA_DISCONNECTED:
+            wifiEvents.push({ WIFI_EVENT_DISCONNECTED, info.disconnected.reason });
+            break;
+        default:
+            break;
+    }
+}
+
+void startWiFi() {
+    WiFi.persistent(false);          // credentials come from config.h: no flash write per attempt
+    WiFi.setAutoReconnect(false);    // wifiLink decides when to retry
     WiFi.mode(WIFI_STA);
     WiFi.setSleep(false);
-    
+    WiFi.onEvent(onWiFiEvent);
+
     // Debug: Print MAC Address
     Serial.print("Device MAC: ");
     Serial.println(WiFi.macAddress());
 
-    // Debug: Scan Networks
-    Serial.println("Scanning networks...");
-    int n = WiFi.scanNetworks();
-    if (n == 0) {
-        Serial.println("No networks found!");
-    } else {
-        Serial.printf("%d networks found:\n", n);
-        for (int i = 0; i < n; ++i) {
-            Serial.printf("  %d: %s (%d) %s\n", i + 1, WiFi.SSID(i).c_str(), WiFi.RSSI(i), (WiFi.encryptionType(i) == WIFI_AUTH_OPEN) ? "Open" : "Secured");
-        }
-    }
-
 #if USE_ENTERPRISE_WIFI
     // WPA2-Enterprise (e.g. eduroam)
     // NOTE: This uses the older SDK macro as found in previous steps
@@ -54,45 +127,121 @@ bool connectToWiFi() {
     // Disable certificate verification for simplicity/compatibility
     esp_wifi_sta_wpa2_ent_set_ca_cert(NULL, 0);
     esp_wifi_sta_wpa2_ent_set_cert_key(NULL, 0, NULL, 0, NULL, 0);
+#endif
+
+    wifiLink = WifiLink(esp_random());
+#if WIFI_FAST_CONNECT
+    wifiLink.setCachedAp(loadApCache());
+#endif
+    wifiLink.begin(millis());
+    serviceWiFi();
+}
 
-    WiFi.begin(WIFI_SSID);
+/**
+ * @param cached Straight to the cached AP: its BSSID on its channel (no
+ *               scan), and with WIFI_STATIC_IP its last lease (no DHCP)
+ */
+static void startAttempt(bool cached) {
+    const uint8_t* bssid = cached ? apCache.bssid : nullptr;
+    const int32_t channel = cached ? apCache.channel : 0;
+    upViaCache = cached;
+#if WIFI_STATIC_IP
+    upWithStaticIp = cached && apCache.ip != 0;
+    if (upWithStaticIp) {
+        WiFi.config(IPAddress(apCache.ip), IPAddress(apCache.gateway), IPAddress(apCache.subnet), IPAddress(apCache.dns));
+    } else {
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());   // back to DHCP
+    }
+#endif
+    if (cached) {
+        Serial.printf("[WiFi] Connecting to %s on channel %u, cached AP (attempt %u)...\n",
+            WIFI_SSID, (unsigned)channel, (unsigned)wifiLink.stats().attempts);
+    } else {
+        Serial.printf("[WiFi] Connecting to %s (attempt %u)...\n", WIFI_SSID, (unsigned)wifiLink.stats().attempts);
+    }
+#if USE_ENTERPRISE_WIFI
+    WiFi.begin(WIFI_SSID, nullptr, channel, bssid);
 #else
     // WPA2-Personal
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD, channel, bssid);
 #endif
+}
 
-    unsigned long startAttemptTime = millis();
+/** @brief Do what the link asked; @return UP / DOWN, else NONE */
+static WifiLinkAction perform(WifiLinkAction action) {
+    const uint32_t now = millis();
+    switch (action) {
+        case WIFI_ACTION_CONNECT:
+        case WIFI_ACTION_CONNECT_CACHED:
+            startAttempt(action == WIFI_ACTION_CONNECT_CACHED);
+            break;
+        case WIFI_ACTION_ABORT:
+            WiFi.disconnect();   // its DISCONNECTED event arrives while waiting: ignored
+            if (wifiLink.attemptCached()) {
+                forgetApCache();
+                Serial.printf("[WiFi] Cached AP silent for %u s, scanning\n", (unsigned)(WIFI_CACHED_TIMEOUT_MS / 1000));
+            } else {
+                Serial.printf("[WiFi] No connection after %u s, retrying in %u ms\n",
+                    (unsigned)(WIFI_ATTEMPT_TIMEOUT_MS / 1000), (unsigned)wifiLink.retryInMs(now));
+            }
+            break;
+        case WIFI_ACTION_CACHE_MISS:
+            forgetApCache();
+            Serial.printf("[WiFi] Cached AP failed (reason %u), scanning\n", (unsigned)wifiLink.stats().lastReason);
+            break;
+        case WIFI_ACTION_FAILED:
+            Serial.printf("[WiFi] Attempt failed (reason %u), retrying in %u ms\n",
+                (unsigned)wifiLink.stats().lastReason, (unsigned)wifiLink.retryInMs(now));
+            break;
+        case WIFI_ACTION_UP:
+            Serial.printf("[WiFi] Connected in %u ms (%s), IP %s\n", (unsigned)wifiLink.stats().lastConnectMs,
+                describeWiFiConnection(), WiFi.localIP().toString().c_str());
+#if WIFI_FAST_CONNECT
+            saveApCache();
+            wifiLink.setCachedAp(true);
+#endif
+            // Setup NTP
+            configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+            return action;
+        case WIFI_ACTION_DOWN:
+            Serial.printf("[WiFi] Lost (reason %u), reconnecting\n", (unsigned)wifiLink.stats().lastReason);
+            return action;
+        default:
+            break;
+    }
+    return WIFI_ACTION_NONE;
+}
 
-    // Try for 20 seconds (as per main.cpp original timeout, numeric-flower had 30s)
-    while (WiFi.status() != WL_CONNECTED && millis() - startAttemptTime < 30000) {
-        Serial.print(".");
-        delay(500);
+WifiLinkAction serviceWiFi() {
+    WifiLinkAction change = WIFI_ACTION_NONE;
+    WifiEventRecord record;
+    while (wifiEvents.pop(record)) {
+        const WifiLinkAction action = perform(wifiLink.event(record.event, record.reason, millis()));
+        change = action != WIFI_ACTION_NONE ? action : change;   // the latest UP / DOWN wins
     }
-    Serial.println();
-
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("✅ Wi-Fi connected!");
-        Serial.print("IP: ");
-        Serial.println(WiFi.localIP());
-
-        // Setup NTP
-        configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-        Serial.println("⏰ NTP Sync...");
-        
-        return true;
-    } else {
-        Serial.println("❌ WiFi failed. Restarting...");
-        delay(2000);
-        ESP.restart();
-        return false;
+    const WifiLinkAction action = perform(wifiLink.update(millis()));
+    return action != WIFI_ACTION_NONE ? action : change;
+}
+
+bool waitForWiFi(uint32_t timeoutMs) {
+    const uint32_t start = millis();
+    while (!wifiLink.online() && millis() - start < timeoutMs) {
+        serviceWiFi();
+        delay(10);
+    }
+    if (!wifiLink.online()) {
+        Serial.println("[WiFi] Not connected yet, carrying on; reconnecting in the background");
     }
+    return wifiLink.online();
+}
+
+bool isWiFiOnline() {
+    return wifiLink.online();
 }
 
-void checkWiFiConnection() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("⚠️ WiFi lost. Reconnecting...");
-        connectToWiFi();
-        // Re-init WebSocket after WiFi reconnect
-        setupWebSocket();
+const char* describeWiFiConnection() {
+    if (upViaCache) {
+        return upWithStaticIp ? "cached AP, static IP" : "cached AP, DHCP";
     }
+    return "scan, DHCP";
 }
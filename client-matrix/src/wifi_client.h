@@ -1,6 +1,14 @@
 /**
  * @file wifi_client.h
  * @brief Wi-Fi connection management
+ *
+ * Non-blocking: WiFi events are queued by the WiFi event task and fed to
+ * a WifiLink (wifi_link.h) from whichever task calls serviceWiFi(), which
+ * starts associations and reconnects with backoff as the link decides.
+ *
+ * The last good AP (BSSID, channel, and the IP lease if WIFI_STATIC_IP)
+ * is kept in NVS, namespace "wifi", so a power cycle associates straight
+ * to it instead of scanning every channel first.
  */
 
 #ifndef WIFI_CLIENT_H
@@ -9,18 +17,42 @@
 #include <Arduino.h>
 #include <WiFi.h>
 
-// Forward declaration of setupWebSocket from main.cpp
-void setupWebSocket();
+#include "wifi_link.h"
+
+// 1: connect straight to the AP (BSSID + channel) that worked last time,
+//    scanning only if it doesn't answer.
+// 0: scan for the SSID on every attempt.
+#ifndef WIFI_FAST_CONNECT
+#define WIFI_FAST_CONNECT 1
+#endif
+
+// 1: with the cached AP, reuse its last DHCP lease as a static IP and skip
+//    DHCP. Only where the router reserves that address for the matrix.
+// 0: DHCP on every connect.
+#ifndef WIFI_STATIC_IP
+#define WIFI_STATIC_IP 0
+#endif
 
 /**
- * @brief Connect to WiFi (blocking)
- * @return true if connected, false if failed
+ * @brief Bring the station up and start the first association (returns at once)
  */
-bool connectToWiFi();
+void startWiFi();
 
 /**
- * @brief Check connection and reconnect if lost
+ * @brief Pump the link: queued WiFi events in, associations out
+ * @return WIFI_ACTION_UP / WIFI_ACTION_DOWN when the link changed, else NONE
  */
-void checkWiFiConnection();
+WifiLinkAction serviceWiFi();
+
+/**
+ * @brief Pump the link until it is up or timeoutMs passes (boot only)
+ * @return true if connected
+ */
+bool waitForWiFi(uint32_t timeoutMs);
+
+bool isWiFiOnline();
+
+/** @brief How the link last came up, e.g. "cached AP, static IP" or "scan, DHCP" */
+const char* describeWiFiConnection();
 
 #endif // WIFI_CLIENT_H
@@ -0,0 +1,109 @@
+#include "wifi_link.h"
+
+void WifiLink::begin(uint32_t nowMs) {
+    linkState = WIFI_LINK_WAITING;
+    retryAtMs = nowMs;
+    failedInRow = 0;
+}
+
+WifiLinkAction WifiLink::update(uint32_t nowMs) {
+    switch (linkState) {
+        case WIFI_LINK_WAITING:
+            if ((int32_t)(nowMs - retryAtMs) >= 0) {
+                linkState = WIFI_LINK_CONNECTING;
+                attemptStartMs = nowMs;
+                cachedAttempt = cachedAp;
+                counters.attempts++;
+                return cachedAttempt ? WIFI_ACTION_CONNECT_CACHED : WIFI_ACTION_CONNECT;
+            }
+            return WIFI_ACTION_NONE;
+        case WIFI_LINK_CONNECTING:
+            if (nowMs - attemptStartMs >= (cachedAttempt ? WIFI_CACHED_TIMEOUT_MS : WIFI_ATTEMPT_TIMEOUT_MS)) {
+                counters.timeouts++;
+                if (cachedAttempt) {
+                    counters.lastReason = 0;
+                    missCache(nowMs + WIFI_ABORT_SETTLE_MS);
+                } else {
+                    fail(0, nowMs);
+                }
+                return WIFI_ACTION_ABORT;
+            }
+            return WIFI_ACTION_NONE;
+        default:
+            return WIFI_ACTION_NONE;
+    }
+}
+
+WifiLinkAction WifiLink::event(WifiLinkEvent event, uint8_t reason, uint32_t nowMs) {
+    if (linkState == WIFI_LINK_IDLE) {
+        return WIFI_ACTION_NONE;
+    }
+    if (event == WIFI_EVENT_GOT_IP) {
+        if (linkState == WIFI_LINK_ONLINE) {
+            return WIFI_ACTION_NONE;   // lease renewed
+        }
+        // Also from WAITING: an aborted attempt that got through after all
+        if (linkState == WIFI_LINK_CONNECTING) {
+            counters.lastConnectMs = nowMs - attemptStartMs;
+        }
+        linkState = WIFI_LINK_ONLINE;
+        failedInRow = 0;
+        return WIFI_ACTION_UP;
+    }
+
+    counters.lastReason = reason;
+    switch (linkState) {
+        case WIFI_LINK_ONLINE:
+            // Retry at once: usually the AP is still there
+            counters.drops++;
+            linkState = WIFI_LINK_WAITING;
+            retryAtMs = nowMs;
+            return WIFI_ACTION_DOWN;
+        case WIFI_LINK_CONNECTING:
+            if (event == WIFI_EVENT_LOST_IP) {
+                return WIFI_ACTION_NONE;   // DHCP restarting within the attempt
+            }
+            if (cachedAttempt) {
+                missCache(nowMs);   // the AP moved or changed channel: scan for it now
+                return WIFI_ACTION_CACHE_MISS;
+            }
+            fail(reason, nowMs);
+            return WIFI_ACTION_FAILED;
+        default:
+            return WIFI_ACTION_NONE;   // late news of an aborted attempt
+    }
+}
+
+uint32_t WifiLink::retryInMs(uint32_t nowMs) const {
+    if (linkState != WIFI_LINK_WAITING || (int32_t)(retryAtMs - nowMs) <= 0) {
+        return 0;
+    }
+    return retryAtMs - nowMs;
+}
+
+void WifiLink::fail(uint8_t reason, uint32_t nowMs) {
+    counters.failures++;
+    counters.lastReason = reason;
+    failedInRow++;
+    linkState = WIFI_LINK_WAITING;
+    retryAtMs = nowMs + backoffMs();
+}
+
+void WifiLink::missCache(uint32_t retryAt) {
+    counters.cacheMisses++;
+    cachedAp = false;
+    linkState = WIFI_LINK_WAITING;
+    retryAtMs = retryAt;
+}
+
+uint32_t WifiLink::backoffMs() {
+    const uint32_t doublings = failedInRow > 16 ? 15 : failedInRow - 1;
+    uint32_t delayMs = (uint32_t)WIFI_BACKOFF_BASE_MS << doublings;
+    if (delayMs > WIFI_BACKOFF_MAX_MS) {
+        delayMs = WIFI_BACKOFF_MAX_MS;
+    }
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return delayMs - randomState % (delayMs / 4 + 1);
+}
@@ -0,0 +1,122 @@
+/**
+ * @file wifi_link.h
+ * @brief WiFi connection state machine: driven by events, never waits
+ *
+ * The driver (wifi_client.cpp on the ESP32, a simulated radio in the host
+ * harness) feeds WiFi events in with event(), calls update() from its
+ * loop, and does what either returns: start an association, abort one
+ * that hangs, or tell the rest of the firmware the link went up or down.
+ * Nothing here blocks, so whoever pumps it keeps rendering and serving
+ * the socket while WiFi reconnects.
+ *
+ * A link that drops is retried at once. Each attempt that fails after
+ * that waits twice as long as the one before, from WIFI_BACKOFF_BASE_MS
+ * up to WIFI_BACKOFF_MAX_MS, less up to a quarter of random jitter so
+ * matrices that lost the same AP don't retry in step. An attempt that
+ * hears nothing within WIFI_ATTEMPT_TIMEOUT_MS is aborted and counts as
+ * failed. It never gives up: no restart.
+ *
+ * Fast connect: while the driver holds the last good AP (BSSID, channel)
+ * it says so with setCachedAp(true), and attempts are made straight to it
+ * (CONNECT_CACHED: one channel, no scan). If one of those fails, or
+ * hears nothing within WIFI_CACHED_TIMEOUT_MS, the cache is dropped
+ * (CACHE_MISS) and a full-scan attempt follows at once; backoff only
+ * starts when scanning fails too.
+ *
+ * Platform-independent; times are millis(). One thread calls everything.
+ */
+
+#ifndef WIFI_LINK_H
+#define WIFI_LINK_H
+
+#include <stdint.h>
+
+#define WIFI_ATTEMPT_TIMEOUT_MS 15000   // association + DHCP
+#define WIFI_BACKOFF_BASE_MS    1000
+#define WIFI_BACKOFF_MAX_MS     30000
+#define WIFI_CACHED_TIMEOUT_MS  5000    // straight to a known AP: association + DHCP
+#define WIFI_ABORT_SETTLE_MS    200     // lets the aborted attempt's DISCONNECTED land first
+
+enum WifiLinkState : uint8_t {
+    WIFI_LINK_IDLE,         // not begun
+    WIFI_LINK_CONNECTING,   // association in progress
+    WIFI_LINK_ONLINE,       // got an IP
+    WIFI_LINK_WAITING,      // next attempt at retryAt
+};
+
+enum WifiLinkEvent : uint8_t {
+    WIFI_EVENT_GOT_IP,
+    WIFI_EVENT_DISCONNECTED,   // with the 802.11 reason code
+    WIFI_EVENT_LOST_IP,
+};
+
+enum WifiLinkAction : uint8_t {
+    WIFI_ACTION_NONE,
+    WIFI_ACTION_CONNECT,          // start an association (scanning for the SSID)
+    WIFI_ACTION_CONNECT_CACHED,   // start one straight to the cached AP
+    WIFI_ACTION_ABORT,            // the attempt timed out: drop it (then as FAILED,
+                                  // or as CACHE_MISS if attemptCached())
+    WIFI_ACTION_CACHE_MISS,       // the cached AP failed: forget it; scanning next
+    WIFI_ACTION_FAILED,           // the attempt failed; next one in retryInMs()
+    WIFI_ACTION_UP,               // link up
+    WIFI_ACTION_DOWN,             // link lost; reconnecting now
+};
+
+struct WifiLinkStats {
+    uint32_t attempts;        // associations started
+    uint32_t failures;        // scanning attempts that failed or timed out
+    uint32_t timeouts;        // attempts that timed out, cached ones included
+    uint32_t drops;           // times an up link went down
+    uint32_t cacheMisses;     // cached-AP attempts that failed or timed out
+    uint32_t lastConnectMs;   // last successful attempt: start → IP
+    uint8_t lastReason;       // last disconnect reason (0: timeout)
+};
+
+class WifiLink {
+public:
+    /** @param seed Jitter seed; differs per device (esp_random()) */
+    explicit WifiLink(uint32_t seed = 1) : randomState(seed | 1) {}
+
+    /** @brief Start: the first update() connects */
+    void begin(uint32_t nowMs);
+
+    /** @brief Whether the driver holds a last good AP to connect straight to */
+    void setCachedAp(bool available) { cachedAp = available; }
+    bool hasCachedAp() const { return cachedAp; }
+
+    /** @brief The current (or last) attempt went to the cached AP */
+    bool attemptCached() const { return cachedAttempt; }
+
+    /** @brief Call often; returns CONNECT(_CACHED) when an attempt is due, ABORT on timeout */
+    WifiLinkAction update(uint32_t nowMs);
+
+    /** @brief A WiFi event; returns UP, DOWN, FAILED, CACHE_MISS or NONE */
+    WifiLinkAction event(WifiLinkEvent event, uint8_t reason, uint32_t nowMs);
+
+    WifiLinkState state() const { return linkState; }
+    bool online() const { return linkState == WIFI_LINK_ONLINE; }
+
+    /** @brief Time to the next attempt while WAITING, else 0 */
+    uint32_t retryInMs(uint32_t nowMs) const;
+
+    /** @brief Attempts failed in a row (0 once online) */
+    uint32_t consecutiveFailures() const { return failedInRow; }
+
+    const WifiLinkStats& stats() const { return counters; }
+
+private:
+    void fail(uint8_t reason, uint32_t nowMs);
+    void missCache(uint32_t retryAt);
+    uint32_t backoffMs();
+
+    WifiLinkState linkState = WIFI_LINK_IDLE;
+    uint32_t attemptStartMs = 0;
+    uint32_t retryAtMs = 0;
+    uint32_t failedInRow = 0;
+    bool cachedAp = false;
+    bool cachedAttempt = false;
+    uint32_t randomState;
+    WifiLinkStats counters = {};
+};
+
+#endif // WIFI_LINK_H
@@ -0,0 +1,314 @@
+#include "ws_client.h"
+
+#include <stdio.h>
+
+// ─── Framing ─────────────────────────────────────────────────────────────────
+
+size_t wsEncodeFrame(uint8_t* out, uint8_t opcode, const uint8_t* payload, size_t length, const uint8_t* mask) {
+    size_t n = 0;
+    out[n++] = 0x80 | opcode;   // FIN
+    const uint8_t maskBit = mask ? 0x80 : 0x00;
+    if (length < 126) {
+        out[n++] = maskBit | (uint8_t)length;
+    } else if (length <= 0xFFFF) {
+        out[n++] = maskBit | 126;
+        out[n++] = (uint8_t)(length >> 8);
+        out[n++] = (uint8_t)length;
+    } else {
+        out[n++] = maskBit | 127;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            out[n++] = (uint8_t)((uint64_t)length >> shift);
+        }
+    }
+    if (mask) {
+        memcpy(out + n, mask, 4);
+        n += 4;
+    }
+    for (size_t i = 0; i < length; i++) {
+        out[n + i] = mask ? payload[i] ^ mask[i & 3] : payload[i];
+    }
+    return n + length;
+}
+
+static void base64Encode(const uint8_t* in, size_t length, char* out) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t o = 0;
+    for (size_t i = 0; i < length; i += 3) {
+        const uint32_t b = (uint32_t)in[i] << 16 | (i + 1 < length ? in[i + 1] << 8 : 0) | (i + 2 < length ? in[i + 2] : 0);
+        out[o++] = ALPHABET[(b >> 18) & 0x3F];
+        out[o++] = ALPHABET[(b >> 12) & 0x3F];
+        out[o++] = i + 1 < length ? ALPHABET[(b >> 6) & 0x3F] : '=';
+        out[o++] = i + 2 < length ? ALPHABET[b & 0x3F] : '=';
+    }
+    out[o] = 0;
+}
+
+// ─── Client ──────────────────────────────────────────────────────────────────
+
+PersistentWebSocketClient::PersistentWebSocketClient() : randomState(micros() | 1) {
+    stream.setSessionStore(defaultTlsSessionStore());
+}
+
+void PersistentWebSocketClient::begin(const char* host, uint16_t port, const char* path) {
+    start(host, port, path, false);
+}
+
+void PersistentWebSocketClient::beginSSL(const char* host, uint16_t port, const char* path) {
+    start(host, port, path, true);
+}
+
+void PersistentWebSocketClient::start(const char* newHost, uint16_t newPort, const char* newPath, bool newSecure) {
+    closeConnection(false);
+    snprintf(host, sizeof(host), "%s", newHost);
+    snprintf(path, sizeof(path), "%s", newPath);
+    port = newPort;
+    secure = newSecure;
+    state = STATE_WAITING;
+    nextAttemptMs = millis();   // connect on the next loop()
+}
+
+void PersistentWebSocketClient::disconnect() {
+    if (state == STATE_OPEN) {
+        sendFrame(WS_OPCODE_CLOSE, nullptr, 0);
+    }
+    closeConnection(false);
+}
+
+void PersistentWebSocketClient::loop() {
+    if (writeFailed) {
+        writeFailed = false;
+        closeConnection(true);
+        return;
+    }
+    switch (state) {
+        case STATE_WAITING:
+            if ((int32_t)(millis() - nextAttemptMs) >= 0) {
+                connect();
+            }
+            break;
+        case STATE_UPGRADING:
+            readUpgrade();
+            break;
+        case STATE_OPEN:
+            readFrames();
+            break;
+        default:
+            break;
+    }
+}
+
+bool PersistentWebSocketClient::waitForData(uint32_t timeoutMs) {
+    if (writeFailed) {
+        return true;
+    }
+    switch (state) {
+        case STATE_UPGRADING:
+        case STATE_OPEN:
+            return stream.waitReadable(timeoutMs);
+        case STATE_WAITING: {
+            const int32_t untilAttempt = (int32_t)(nextAttemptMs - millis());
+            if (untilAttempt > 0) {
+                delay(untilAttempt < (int32_t)timeoutMs ? (uint32_t)untilAttempt : timeoutMs);
+            }
+            return (int32_t)(nextAttemptMs - millis()) <= 0;
+        }
+        default:
+            delay(timeoutMs);
+            return false;
+    }
+}
+
+bool PersistentWebSocketClient::sendTXT(const char* text) {
+    return state == STATE_OPEN && sendFrame(WS_OPCODE_TEXT, (const uint8_t*)text, strlen(text));
+}
+
+void PersistentWebSocketClient::connect() {
+    attempt = {};
+    attempt.number = ++attempts;
+    const bool connected = stream.connect(host, port, secure, WS_CONNECT_TIMEOUT_MS);
+    const TlsHandshakeStats& handshake = stream.lastHandshake();
+    attempt.tcpUs = handshake.tcpUs;
+    attempt.tlsUs = handshake.tlsUs;
+    attempt.offered = handshake.offered;
+    attempt.resumed = handshake.resumed;
+    if (!connected) {
+        failAttempt("connect");
+        return;
+    }
+
+    uint8_t keyBytes[16];
+    for (size_t i = 0; i < sizeof(keyBytes); i += 4) {
+        const uint32_t r = randomWord();
+        memcpy(keyBytes + i, &r, 4);
+    }
+    char key[25];
+    base64Encode(keyBytes, sizeof(keyBytes), key);
+
+    char hostHeader[72];
+    if (port == (secure ? 443 : 80)) {
+        snprintf(hostHeader, sizeof(hostHeader), "%s", host);
+    } else {
+        snprintf(hostHeader, sizeof(hostHeader), "%s:%u", host, (unsigned)port);
+    }
+    const int length = snprintf((char*)tx, sizeof(tx),
+        "GET %s HTTP/1.1\r\n"
+        "Host: %s\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: %s\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "User-Agent: MissingDrop-Matrix\r\n"
+        "\r\n", path, hostHeader, key);
+
+    rxLength = 0;
+    upgradeStartUs = micros();
+    if (!stream.write(tx, (size_t)length)) {
+        failAttempt("upgrade request");
+        return;
+    }
+    state = STATE_UPGRADING;
+}
+
+void PersistentWebSocketClient::failAttempt(const char* reason) {
+    attempt.ok = false;
+    Serial.printf("[WS] Attempt %u failed (%s)\n", (unsigned)attempt.number, reason);
+    closeConnection(true);
+}
+
+void PersistentWebSocketClient::readUpgrade() {
+    const int n = stream.read(rx + rxLength, sizeof(rx) - 1 - rxLength);
+    if (n < 0) {
+        failAttempt("closed during upgrade");
+        return;
+    }
+    rxLength += (size_t)n;
+    rx[rxLength] = 0;
+
+    char* end = strstr((char*)rx, "\r\n\r\n");
+    if (!end) {
+        if (rxLength == sizeof(rx) - 1 || micros() - upgradeStartUs > WS_UPGRADE_TIMEOUT_MS * 1000UL) {
+            failAttempt("no upgrade response");
+        }
+        return;
+    }
+    attempt.upgradeUs = micros() - upgradeStartUs;
+    if (strncmp((char*)rx, "HTTP/1.1 101", 12) != 0) {
+        failAttempt("upgrade refused");
+        return;
+    }
+
+    // Frames may already follow the response
+    const size_t headerLength = (size_t)(end + 4 - (char*)rx);
+    memmove(rx, rx + headerLength, rxLength - headerLength);
+    rxLength -= headerLength;
+
+    attempt.ok = true;
+    logAttempt();
+    state = STATE_OPEN;
+    emit(WStype_CONNECTED, (uint8_t*)path, strlen(path));
+    readFrames();
+}
+
+void PersistentWebSocketClient::readFrames() {
+    for (;;) {
+        const int n = stream.read(rx + rxLength, sizeof(rx) - 1 - rxLength);
+        if (n < 0) {
+            closeConnection(true);
+            return;
+        }
+        rxLength += (size_t)n;
+
+        bool closing = false;
+        const bool ok = wsParseFrames(rx, rxLength, [this, &closing](uint8_t opcode, uint8_t* payload, size_t length) {
+            switch (opcode) {
+                case WS_OPCODE_TEXT: {
+                    // NUL-terminated, as WebSocketsClient delivers text
+                    const uint8_t next = payload[length];
+                    payload[length] = 0;
+                    emit(WStype_TEXT, payload, length);
+                    payload[length] = next;
+                    break;
+                }
+                case WS_OPCODE_BINARY:
+                    emit(WStype_BIN, payload, length);
+                    break;
+                case WS_OPCODE_PING:
+                    sendFrame(WS_OPCODE_PONG, payload, length);
+                    break;
+                case WS_OPCODE_CLOSE:
+                    closing = true;
+                    break;
+                default:
+                    break;
+            }
+        });
+        if (state != STATE_OPEN) {
+            return;   // a handler disconnected
+        }
+        if (!ok || rxLength == sizeof(rx) - 1) {
+            Serial.println("[WS] Unsupported or oversized frame, reconnecting");
+            closeConnection(true);
+            return;
+        }
+        if (closing) {
+            sendFrame(WS_OPCODE_CLOSE, nullptr, 0);
+            closeConnection(true);
+            return;
+        }
+        if (n == 0) {
+            return;   // nothing more for now
+        }
+    }
+}
+
+void PersistentWebSocketClient::closeConnection(bool retry) {
+    const bool wasOpen = state == STATE_OPEN;
+    stream.close();
+    state = retry ? STATE_WAITING : STATE_IDLE;
+    nextAttemptMs = millis() + (retry ? reconnectIntervalMs : 0);
+    if (wasOpen) {
+        emit(WStype_DISCONNECTED, nullptr, 0);
+    }
+}
+
+bool PersistentWebSocketClient::sendFrame(uint8_t opcode, const uint8_t* payload, size_t length) {
+    if (length > TRANSPORT_MESSAGE_MAX) {
+        return false;
+    }
+    const uint32_t mask = randomWord();
+    const size_t n = wsEncodeFrame(tx, opcode, payload, length, (const uint8_t*)&mask);
+    if (!stream.write(tx, n)) {
+        writeFailed = true;
+        return false;
+    }
+    return true;
+}
+
+void PersistentWebSocketClient::logAttempt() {
+    const char* session = !secure ? "plain"
+        : attempt.resumed ? "resumed"
+        : attempt.offered ? "full, session not resumed"
+        : "full";
+    Serial.printf("[WS] Attempt %u: TCP %u.%u ms, TLS %u.%u ms (%s), upgrade %u.%u ms\n",
+        (unsigned)attempt.number,
+        (unsigned)(attempt.tcpUs / 1000), (unsigned)(attempt.tcpUs / 100 % 10),
+        (unsigned)(attempt.tlsUs / 1000), (unsigned)(attempt.tlsUs / 100 % 10), session,
+        (unsigned)(attempt.upgradeUs / 1000), (unsigned)(attempt.upgradeUs / 100 % 10));
+}
+
+uint32_t PersistentWebSocketClient::randomWord() {
+#if defined(ARDUINO)
+    return esp_random();   // hardware RNG: masks must be unpredictable
+#else
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+#endif
+}
+
+void PersistentWebSocketClient::emit(WStype_t type, uint8_t* payload, size_t length) {
+    if (eventHandler) {
+        eventHandler(type, payload, length);
+    }
+}
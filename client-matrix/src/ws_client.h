@@ -0,0 +1,200 @@
+/**
+ * @file ws_client.h
+ * @brief WebSocket client that keeps its connection object, and its TLS
+ *        session, across reconnects
+ *
+ * links2004's WebSocketsClient deletes its WiFiClientSecure and builds a
+ * new one for every connection attempt, so each reconnect to Render pays
+ * a full TLS handshake (ECDHE + certificate, several hundred ms of CPU on
+ * the ESP32 plus an extra round trip). PersistentWebSocketClient owns one
+ * TlsStream (hal/tls_stream.h) for its whole life: the TLS context is set
+ * up once, and the session of the last handshake is offered again on the
+ * next one (resumption: one round trip, no key exchange). The session is
+ * also saved (NVS on the ESP32), so the first connection after a reboot
+ * resumes too.
+ *
+ * Same API as the subset of WebSocketsClient the transports use (begin /
+ * beginSSL, loop, sendTXT, disconnect, setReconnectInterval, onEvent), so
+ * SocketTaskTransport can pump either. Like WebSocketsClient, loop()
+ * connects synchronously when a (re)connect is due, then reads whatever
+ * has arrived without blocking. Unlike it, waitForData() blocks on the
+ * socket itself (select() / poll() on the stream's fd), so the socket
+ * task sleeps until there is something to read. Each attempt is logged
+ * with its TCP, TLS and upgrade times and whether the session was resumed.
+ *
+ * RFC 6455 client subset: no extensions, no fragmented messages, frames up
+ * to TRANSPORT_MESSAGE_MAX. The framing helpers are shared with the host
+ * stand-ins (native/socket_transport.h).
+ */
+
+#ifndef WS_CLIENT_H
+#define WS_CLIENT_H
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hal/tls_stream.h"
+#include "hal/transport.h"
+#include "transport_inbox.h"
+
+enum : uint8_t {
+    WS_OPCODE_TEXT = 0x1,
+    WS_OPCODE_BINARY = 0x2,
+    WS_OPCODE_CLOSE = 0x8,
+    WS_OPCODE_PING = 0x9,
+    WS_OPCODE_PONG = 0xA,
+};
+
+#define WS_FRAME_OVERHEAD    14      // largest header we write: 2 + 8 (length) + 4 (mask)
+#define WS_UPGRADE_TIMEOUT_MS 10000
+#define WS_CONNECT_TIMEOUT_MS 10000
+
+// ─── Framing ─────────────────────────────────────────────────────────────────
+
+/**
+ * @brief Write one unfragmented frame
+ * @param out  At least WS_FRAME_OVERHEAD + length bytes
+ * @param mask 4 bytes (client → server) or nullptr
+ * @return frame size
+ */
+size_t wsEncodeFrame(uint8_t* out, uint8_t opcode, const uint8_t* payload, size_t length, const uint8_t* mask);
+
+/**
+ * @brief Split complete frames off the front of a receive buffer
+ * @param buffer In place; masked payloads are unmasked
+ * @param length Bytes in the buffer; on return, bytes left (a partial frame)
+ * @param onFrame Called as onFrame(opcode, payload, length)
+ * @return false on a frame this client doesn't handle (fragmented, 64-bit length)
+ */
+template <typename OnFrame>
+bool wsParseFrames(uint8_t* buffer, size_t& length, OnFrame onFrame) {
+    size_t pos = 0;
+    for (;;) {
+        const size_t avail = length - pos;
+        if (avail < 2) {
+            break;
+        }
+        uint8_t* p = buffer + pos;
+        if (!(p[0] & 0x80) || (p[1] & 0x7F) == 127) {
+            return false;
+        }
+        size_t header = 2;
+        size_t payloadLength = p[1] & 0x7F;
+        if (payloadLength == 126) {
+            if (avail < 4) {
+                break;
+            }
+            payloadLength = ((size_t)p[2] << 8) | p[3];
+            header = 4;
+        }
+        const bool masked = p[1] & 0x80;
+        const size_t maskAt = header;
+        header += masked ? 4 : 0;
+        if (avail < header + payloadLength) {
+            break;
+        }
+        uint8_t* payload = p + header;
+        if (masked) {
+            for (size_t i = 0; i < payloadLength; i++) {
+                payload[i] ^= p[maskAt + (i & 3)];
+            }
+        }
+        onFrame((uint8_t)(p[0] & 0x0F), payload, payloadLength);
+        pos += header + payloadLength;
+    }
+    memmove(buffer, buffer + pos, length - pos);
+    length -= pos;
+    return true;
+}
+
+// ─── Client ──────────────────────────────────────────────────────────────────
+
+struct WsConnectAttempt {
+    uint32_t number;       // since construction
+    bool ok;
+    uint32_t tcpUs;        // TCP connect (incl. DNS)
+    uint32_t tlsUs;        // TLS handshake, 0 for ws://
+    uint32_t upgradeUs;    // HTTP upgrade → 101
+    bool offered;          // a TLS session was offered
+    bool resumed;          // and resumed
+};
+
+class PersistentWebSocketClient {
+public:
+    typedef std::function<void(WStype_t type, uint8_t* payload, size_t length)> EventHandler;
+
+    PersistentWebSocketClient();
+
+    void begin(const char* host, uint16_t port, const char* path);
+    void beginSSL(const char* host, uint16_t port, const char* path);
+
+    /** @brief Close (the server is told) and stop reconnecting until begin() */
+    void disconnect();
+
+    /** @brief Connect if due, then dispatch whatever has arrived */
+    void loop();
+
+    /**
+     * @brief Block until loop() has work: data (or a close) on the socket,
+     *        a reconnect due, or timeoutMs passed
+     * @return false on timeout
+     */
+    bool waitForData(uint32_t timeoutMs);
+
+    bool sendTXT(const char* text);
+
+    void setReconnectInterval(unsigned long ms) { reconnectIntervalMs = ms; }
+    void onEvent(EventHandler handler) { eventHandler = handler; }
+
+    /** @brief Where sessions are kept (default: NVS on the ESP32, none on the host) */
+    void setSessionStore(TlsSessionStore* store) { stream.setSessionStore(store); }
+
+    bool isConnected() const { return state == STATE_OPEN; }
+    const WsConnectAttempt& lastAttempt() const { return attempt; }
+
+private:
+    enum State : uint8_t {
+        STATE_IDLE,        // not begun, or disconnect()ed
+        STATE_WAITING,     // reconnect due at nextAttemptMs
+        STATE_UPGRADING,   // 101 not seen yet
+        STATE_OPEN,
+    };
+
+    void start(const char* host, uint16_t port, const char* path, bool secure);
+    void connect();
+    void failAttempt(const char* reason);
+    void readUpgrade();
+    void readFrames();
+    /** @brief Close the stream; retry: reconnect after the interval */
+    void closeConnection(bool retry);
+    bool sendFrame(uint8_t opcode, const uint8_t* payload, size_t length);
+    void logAttempt();
+    uint32_t randomWord();
+    void emit(WStype_t type, uint8_t* payload, size_t length);
+
+    TlsStream stream;
+    EventHandler eventHandler;
+    WsConnectAttempt attempt = {};
+
+    char host[64] = {};
+    char path[64] = {};
+    uint16_t port = 0;
+    bool secure = false;
+
+    State state = STATE_IDLE;
+    bool writeFailed = false;      // closed on the next loop(), on the socket's task
+    unsigned long reconnectIntervalMs = 5000;
+    uint32_t nextAttemptMs = 0;
+    uint32_t upgradeStartUs = 0;
+    uint32_t attempts = 0;
+    uint32_t randomState;
+
+    // Handshake response, then frames; + 1 for the NUL after a text payload
+    uint8_t rx[WS_FRAME_OVERHEAD + TRANSPORT_MESSAGE_MAX + 1];
+    size_t rxLength = 0;
+    uint8_t tx[WS_FRAME_OVERHEAD + TRANSPORT_MESSAGE_MAX];
+};
+
+#endif // WS_CLIENT_H
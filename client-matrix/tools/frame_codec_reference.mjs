@@ -0,0 +1,100 @@
+/**
+ * Frame codec reference stream — runs client-web/js/frame_codec.js on a
+ * scripted sequence of RGB565 frames and prints what the phone would send,
+ * with the image the matrix must show after each payload.
+ *
+ * Usage (from client-matrix/):
+ *   node tools/frame_codec_reference.mjs | .pio/build/native/program codec
+ *
+ * Output, one record per line:
+ *   packet <hex>     binary WebSocket payload (any format in frame_format.h);
+ *                    the whole sequence is repeated behind v1 headers
+ *   expect <hex>     2048-byte RGB565 image after that payload
+ */
+
+import { readFileSync } from 'fs'
+
+// client-web has no package.json, so load the ES module through a data: URL
+const source = readFileSync(new URL('../../client-web/js/frame_codec.js', import.meta.url), 'utf8')
+const { TileDeltaEncoder, encodePalette565, wrapFrame } = await import('data:text/javascript,' + encodeURIComponent(source))
+
+const SIZE = 32
+const FRAMES = 120
+const hex = (bytes) => Buffer.from(bytes.buffer, bytes.byteOffset, bytes.length).toString('hex')
+
+/**
+ * 5×5 square sliding over a background: a full-colour gradient, or (like
+ * the water render) a couple of tints times 8 shade levels.
+ */
+function drawFrame(frame, t, fewColours) {
+    const sx = (t * 3) % SIZE
+    const sy = (t * 2) % SIZE
+    for (let y = 0; y < SIZE; y++) {
+        for (let x = 0; x < SIZE; x++) {
+            let rgb16
+            if (x >= sx && x < sx + 5 && y >= sy && y < sy + 5) {
+                rgb16 = 0xFFE0
+            } else if (fewColours) {
+                const shade = (x + y + t) & 7
+                rgb16 = x < 16 ? (shade << 2) | (shade << 8) : (shade << 13) | (shade << 7)
+            } else {
+                rgb16 = ((x & 0x1F) << 11) | (((x + y) & 0x3F) << 5) | (y & 0x1F)
+            }
+            frame[(y * SIZE + x) * 2] = rgb16 >> 8
+            frame[(y * SIZE + x) * 2 + 1] = rgb16 & 0xFF
+        }
+    }
+}
+
+const frame = new Uint8Array(SIZE * SIZE * 2)
+const paletteOut = new Uint8Array(2 + 256 * 2 + SIZE * SIZE)
+const headerOut = new Uint8Array(7 + 1 + SIZE * SIZE * 2)
+const lines = []
+let sequence = null  // set: wrap payloads in v1 headers
+
+function emit(payload) {
+    if (sequence !== null) {
+        payload = wrapFrame(payload, sequence & 0xFFFF, 5000 + sequence * 33, headerOut)
+        sequence++
+    }
+    lines.push(`packet ${hex(payload)}`)
+    lines.push(`expect ${hex(frame)}`)
+}
+
+function encodeAll() {
+    // Tile deltas, with bare and palette keyframes
+    const streams = [
+        { tileSize: 8, palette: false, fewColours: false },
+        { tileSize: 4, palette: false, fewColours: false },
+        { tileSize: 16, palette: false, fewColours: false },
+        { tileSize: 8, palette: true, fewColours: true },
+        { tileSize: 8, palette: true, fewColours: false }
+    ]
+    for (const { tileSize, palette, fewColours } of streams) {
+        const encoder = new TileDeltaEncoder({ tileSize, palette })
+        for (let t = 0; t < FRAMES; t++) {
+            // Hold still for a while (nothing sent), then scramble everything
+            // once so the encoder has to fall back to a keyframe
+            drawFrame(frame, t >= 40 && t < 50 ? 40 : t, fewColours)
+            if (t === 70) frame.forEach((_, i) => { frame[i] = (i * 37 + 11) & 0xFF })
+
+            const payload = t === 90 ? frame : encoder.encode(frame)
+            if (t === 90) encoder.reset()  // a bare frame ends the delta stream
+            if (payload) emit(payload)
+        }
+    }
+
+    // Palette frames on their own, bare when there are too many colours
+    for (let t = 0; t < FRAMES; t++) {
+        drawFrame(frame, t, t % 10 !== 0)
+        const length = encodePalette565(frame, paletteOut)
+        emit(length ? paletteOut.subarray(0, length) : frame)
+    }
+}
+
+// Plain, then the same payloads behind v1 headers
+encodeAll()
+sequence = 0
+encodeAll()
+
+process.stdout.write(lines.join('\n') + '\n')
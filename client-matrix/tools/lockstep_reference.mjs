@@ -0,0 +1,129 @@
+/**
+ * Lockstep conformance trace — runs client-web/js/lockstep.js over tick-
+ * stamped event logs and prints the fields' checksums along the way, for
+ * the C++ core to reproduce bit for bit.
+ *
+ * Usage (from client-matrix/):
+ *   node tools/lockstep_reference.mjs | .pio/build/native_q16/program lockstep
+ *   node tools/lockstep_reference.mjs > session.txt   # record once, replay later
+ *
+ * Output, one record per line, ticks ascending within a trace:
+ *   trace <name>                          fresh water, default parameters, tick 0
+ *   drop <tick> <x> <y> <strength> <radius> <burst>
+ *   params <tick> <waveDamp> <renderGain>
+ *   reset <tick>
+ *   check <tick> <field checksum> <shading checksum> <idle>   (hex, 0/1; before the tick's events)
+ */
+
+import { readFileSync } from 'fs'
+
+const source = readFileSync(new URL('../../client-web/js/lockstep.js', import.meta.url), 'utf8')
+const { LockstepWater, quantizeStrength, quantizeParam } = await import('data:text/javascript,' + encodeURIComponent(source))
+
+const CHECK_EVERY = 25
+
+function fnv(values) {
+    let hash = 2166136261
+    for (let i = 0; i < values.length; i++) {
+        hash = Math.imul(hash ^ values[i], 16777619)
+    }
+    return hash >>> 0
+}
+
+function hex(x) {
+    return x.toString(16).padStart(8, '0')
+}
+
+/** Play a log (events sorted by tick) for `ticks` ticks, printing as it goes. */
+function play(name, ticks, log) {
+    const water = new LockstepWater()
+    console.log(`trace ${name}`)
+    let next = 0
+    for (let tick = 0; tick < ticks; tick++) {
+        if (tick % CHECK_EVERY === 0) {
+            console.log(`check ${tick} ${hex(water.checksum())} ${hex(fnv(water.getShadingMapQ16()))} ${water.isIdle() ? 1 : 0}`)
+        }
+        for (; next < log.length && log[next].tick === tick; next++) {
+            const e = log[next]
+            if (e.type === 'drop') {
+                console.log(`drop ${tick} ${e.x} ${e.y} ${e.strength} ${e.radius} ${e.burst}`)
+                water.applyDrop(e)
+            } else if (e.type === 'params') {
+                console.log(`params ${tick} ${e.waveDamp} ${e.renderGain}`)
+                water.setWaveDamp(e.waveDamp)
+                water.setRenderGain(e.renderGain)
+            } else if (e.type === 'reset') {
+                console.log(`reset ${tick}`)
+                water.reset()
+            }
+        }
+        water.step()
+    }
+}
+
+function drop(tick, x, y, strength, radius, burst = 1) {
+    return { type: 'drop', tick, x, y, strength: quantizeStrength(strength), radius, burst }
+}
+
+function params(tick, waveDamp, renderGain) {
+    return { type: 'params', tick, waveDamp: quantizeParam(waveDamp), renderGain: quantizeParam(renderGain) }
+}
+
+function reset(tick) {
+    return { type: 'reset', tick }
+}
+
+// A phone session: taps at the hand tracker's pace, a slider drag, a reset
+play('session', 900, [
+    drop(3, 10, 12, 1.0, 2),
+    drop(40, 22, 8, 1.5, 3),
+    drop(41, 22, 9, 1.5, 3),
+    drop(42, 23, 9, 1.5, 3),
+    params(120, 0.97, 3.1),
+    drop(121, 5, 25, 2.0, 1),
+    drop(200, 16, 16, 0.8, 5),
+    drop(200, 30, 1, 1.2, 4),
+    params(310, 0.995, 2.3),
+    drop(400, 0, 31, 3.0, 2),
+    reset(520),
+    drop(521, 16, 16, 1.0, 2),
+    drop(700, 12, 20, 0.2, 1)
+])
+
+// Seeded random taps, bursts and slider moves
+{
+    let rng = 20260314
+    const rand = (n) => {
+        rng = (Math.imul(rng, 1664525) + 1013904223) >>> 0
+        return (rng >>> 8) % n   // the low bits of an LCG cycle too fast
+    }
+    const log = []
+    for (let tick = 0; tick < 3000; tick++) {
+        if (rand(12) === 0) {
+            log.push(drop(tick, rand(32), rand(32), 0.2 + rand(29) / 10, 1 + rand(5), 1 + rand(8)))
+        }
+        if (rand(400) === 0) {
+            log.push(params(tick, 0.95 + rand(50) / 1000, 0.5 + rand(56) / 10))
+        }
+    }
+    play('random', 3000, log)
+}
+
+// Ripples die out, the water idles, a drop and a slider wake it
+play('idle', 6000, [
+    drop(0, 16, 16, 2.0, 3),
+    params(10, 0.95, 2.3),
+    drop(2500, 8, 20, 1.0, 2),
+    drop(2501, 9, 20, 1.0, 2),
+    params(4000, 0.999, 2.3),
+    params(4600, 0.95, 2.3)
+])
+
+// Largest energy the UI allows, undamped as far as it goes, at the edges
+{
+    const log = [params(0, 0.999, 6.0)]
+    for (let tick = 0; tick < 600; tick += 3) {
+        log.push(drop(tick, tick % 2 ? 1 : 30, (tick * 7) % 32, 3.0, 5, 8))
+    }
+    play('stress', 1200, log)
+}
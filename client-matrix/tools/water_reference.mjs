@@ -0,0 +1,77 @@
+/**
+ * Water reference trace — runs client-web/js/water.js on a scripted drop
+ * sequence and prints what the phone would have sent to the matrix.
+ *
+ * Usage (from client-matrix/):
+ *   node tools/water_reference.mjs | .pio/build/native/program water-ref
+ *
+ * Output, one record per line:
+ *   drop <local|remote> <x> <y> <strength> <radius> <r> <g> <b>
+ *   step
+ *   frame <r g b × 1024>   (panel orientation, i.e. after the 90° CCW rotation)
+ */
+
+import { readFileSync } from 'fs'
+
+// dropAt() seeds its jitter from performance.now(); pin it so both sides agree
+Object.defineProperty(globalThis, 'performance', { value: { now: () => 1000 }, configurable: true })
+
+// client-web has no package.json, so load the ES module through a data: URL
+const source = readFileSync(new URL('../../client-web/js/water.js', import.meta.url), 'utf8')
+const { WaterSimulation, composeShading } = await import('data:text/javascript,' + encodeURIComponent(source))
+
+const SIZE = 32
+const TICKS = 240
+const FRAME_EVERY = 30
+
+// tick → drops (same shape as the 'drop' WebSocket message)
+const TRACE = {
+    0: [{ layer: 'local', x: 10, y: 12, strength: 1.0, radius: 2, r: 60, g: 150, b: 255 }],
+    20: [{ layer: 'remote', x: 22, y: 8, strength: 1.5, radius: 3, r: 40, g: 220, b: 120 }],
+    45: [{ layer: 'local', x: 5, y: 25, strength: 2.0, radius: 1, r: 255, g: 200, b: 0 }],
+    60: [
+        { layer: 'remote', x: 16, y: 16, strength: 0.8, radius: 5, r: 200, g: 40, b: 255 },
+        { layer: 'local', x: 30, y: 1, strength: 1.2, radius: 4, r: 255, g: 200, b: 0 }
+    ]
+}
+
+const localWater = new WaterSimulation()
+const remoteWater = new WaterSimulation()
+let localTint = { r: 60, g: 150, b: 255 }
+let remoteTint = { r: 255, g: 100, b: 100 }
+
+const image = new Uint8ClampedArray(SIZE * SIZE * 4)
+const lines = []
+
+for (let tick = 0; tick < TICKS; tick++) {
+    for (const d of TRACE[tick] ?? []) {
+        const water = d.layer === 'local' ? localWater : remoteWater
+        if (d.layer === 'local') localTint = { r: d.r, g: d.g, b: d.b }
+        else remoteTint = { r: d.r, g: d.g, b: d.b }
+        water.dropAt(d.x, d.y, { strength: d.strength, radius: d.radius })
+        lines.push(`drop ${d.layer} ${d.x} ${d.y} ${d.strength} ${d.radius} ${d.r} ${d.g} ${d.b}`)
+    }
+
+    localWater.step()
+    remoteWater.step()
+    lines.push('step')
+
+    if ((tick + 1) % FRAME_EVERY === 0) {
+        composeShading(localWater.getShadingMap(), remoteWater.getShadingMap(), localTint, remoteTint, image)
+
+        // 90° CCW, as app.js rotateImageDataCCW(): (x, y) → (y, 31 - x)
+        const out = new Array(SIZE * SIZE * 3)
+        for (let y = 0; y < SIZE; y++) {
+            for (let x = 0; x < SIZE; x++) {
+                const src = (y * SIZE + x) * 4
+                const dst = ((SIZE - 1 - x) * SIZE + y) * 3
+                out[dst + 0] = image[src + 0]
+                out[dst + 1] = image[src + 1]
+                out[dst + 2] = image[src + 2]
+            }
+        }
+        lines.push('frame ' + out.join(' '))
+    }
+}
+
+process.stdout.write(lines.join('\n') + '\n')
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Build the web client's water core (water_core.cpp + the firmware's
+# lockstep water) to WebAssembly with SIMD128, into client-web/wasm/.
+#
+# Needs wasi-sdk (https://github.com/WebAssembly/wasi-sdk); point
+# WASI_SDK_PATH at it if it isn't in /opt/wasi-sdk. Run from anywhere.
+set -e
+
+cd "$(dirname "$0")/.."
+WASI_SDK_PATH="${WASI_SDK_PATH:-/opt/wasi-sdk}"
+OUT=../client-web/wasm/water_core.wasm
+
+mkdir -p "$(dirname "$OUT")"
+"$WASI_SDK_PATH/bin/clang++" --target=wasm32-wasi -mexec-model=reactor \
+    -std=gnu++17 -O3 -msimd128 -fno-exceptions -fno-rtti \
+    -Wall -Wextra -Isrc -DWATER_FIXED_POINT=1 \
+    -Wl,--strip-all \
+    wasm/water_core.cpp src/water_lockstep.cpp \
+    -o "$OUT"
+
+echo "$OUT: $(wc -c < "$OUT") bytes"
@@ -0,0 +1,144 @@
+/**
+ * @file water_core.cpp
+ * @brief The web client's water core: the firmware's lockstep water and
+ *        compositor, built to WebAssembly (see build.sh)
+ *
+ * Same sources as the matrix — WaveKernel<Q16>, water_lockstep.cpp and
+ * water_composite.h — behind a flat C ABI for client-web/js/water_core.js.
+ * A phone running this core steps, shades and composites exactly as the
+ * matrix does, so there is one implementation to benchmark and optimise.
+ *
+ * Two layers (0 = local, 1 = remote) in static storage: no allocator, and
+ * the linear memory never grows, so JS can keep typed-array views on the
+ * shade and frame buffers. Builds natively as well (no exports there).
+ */
+
+#include <stdint.h>
+
+#include "water_composite.h"
+#include "water_lockstep.h"
+
+#if defined(__wasm__)
+#define WASM_EXPORT(name) extern "C" __attribute__((export_name(#name)))
+#else
+#define WASM_EXPORT(name) extern "C"
+#endif
+
+#define WATER_CORE_LAYERS 2
+
+// ─── State ───────────────────────────────────────────────────────────────────
+
+static WaveKernel<Q16> layers[WATER_CORE_LAYERS];
+static Q16 shadeFixed[WAVE_CELLS];
+static int32_t shade[WATER_CORE_LAYERS][WAVE_CELLS];   // Q16, 0–65536
+static uint8_t preview[WAVE_CELLS * 4];                // RGBA, unrotated
+static uint8_t frame565[WAVE_CELLS * 2];               // rotated, big-endian
+
+static inline WaveKernel<Q16>& layer(int i) {
+    return layers[i == 1 ? 1 : 0];
+}
+
+// ─── Simulation ──────────────────────────────────────────────────────────────
+
+WASM_EXPORT(water_reset) void water_reset(int i) {
+    layer(i).reset();
+}
+
+WASM_EXPORT(water_reset_parameters) void water_reset_parameters(int i) {
+    layer(i).setDefaultParameters();
+}
+
+WASM_EXPORT(water_set_wave_k) void water_set_wave_k(int i, float val) {
+    layer(i).setWaveK(val);
+}
+
+WASM_EXPORT(water_set_wave_damp) void water_set_wave_damp(int i, float val) {
+    layer(i).setWaveDamp(val);
+}
+
+WASM_EXPORT(water_set_render_gain) void water_set_render_gain(int i, float val) {
+    layer(i).setRenderGain(val);
+}
+
+/** Fields as LockstepDrop holds them (already clamped and quantized) */
+WASM_EXPORT(water_drop) void water_drop(int i, uint32_t tick, int x, int y,
+                                        int radius, int burst, int strength) {
+    LockstepDrop drop;
+    drop.tick = tick;
+    drop.x = (uint8_t)x;
+    drop.y = (uint8_t)y;
+    drop.radius = (uint8_t)radius;
+    drop.burst = (uint8_t)burst;
+    drop.strength = (uint16_t)strength;
+    lockstepDrop(layer(i), drop);
+}
+
+WASM_EXPORT(water_step) void water_step(int i) {
+    layer(i).step();
+}
+
+WASM_EXPORT(water_idle) int water_idle(int i) {
+    return layer(i).isIdle() ? 1 : 0;
+}
+
+WASM_EXPORT(water_energy) double water_energy(int i) {
+    return layer(i).getEnergy();
+}
+
+WASM_EXPORT(water_checksum) uint32_t water_checksum(int i) {
+    return lockstepChecksum(layer(i));
+}
+
+// ─── Rendering ───────────────────────────────────────────────────────────────
+
+/** @brief Shade one layer; returns its Q16 shading map */
+WASM_EXPORT(water_shade) const int32_t* water_shade(int i) {
+    int32_t* map = shade[i == 1 ? 1 : 0];
+    layer(i).getShadingMap(shadeFixed);
+    for (int c = 0; c < WAVE_CELLS; c++) {
+        map[c] = shadeFixed[c].raw;
+    }
+    return map;
+}
+
+/**
+ * @brief Shade both layers and composite them into preview() and, if
+ *        pack565, frame565() — the matrix's renderWater() and the phone's
+ *        rotate + RGB565 pack in one pass
+ */
+WASM_EXPORT(water_compose) void water_compose(int lr, int lg, int lb,
+                                              int rr, int rg, int rb, int pack565) {
+    water_shade(0);
+    water_shade(1);
+    const WaterTint local = { (uint8_t)lr, (uint8_t)lg, (uint8_t)lb };
+    const WaterTint remote = { (uint8_t)rr, (uint8_t)rg, (uint8_t)rb };
+
+    if (pack565) {
+        composeWater(shade[0], shade[1], local, remote,
+            [](int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+                uint8_t* px = &preview[(y * WAVE_SIZE + x) * 4];
+                px[0] = r;
+                px[1] = g;
+                px[2] = b;
+                px[3] = 255;
+                packWater565(frame565, waterPanelIndex(x, y), r, g, b);
+            });
+    } else {
+        composeWater(shade[0], shade[1], local, remote,
+            [](int x, int y, uint8_t r, uint8_t g, uint8_t b) {
+                uint8_t* px = &preview[(y * WAVE_SIZE + x) * 4];
+                px[0] = r;
+                px[1] = g;
+                px[2] = b;
+                px[3] = 255;
+            });
+    }
+}
+
+WASM_EXPORT(water_preview) const uint8_t* water_preview() {
+    return preview;
+}
+
+WASM_EXPORT(water_frame565) const uint8_t* water_frame565() {
+    return frame565;
+}
@@ -1,16 +1,21 @@
 /**
- * Main application module — orchestrates hand tracking, water simulation, and WSS.
+ * Main application module — hand tracking and the preview, on the page.
  *
- * Loop: detect → drop → simulate → render → send → next frame
+ * Loop: detect → (tap) post drop → paint the latest preview → next frame
+ *
+ * The water, compositing and the WebSocket live in a worker
+ * (sim_worker.js), so MediaPipe's detectForVideo() here, however slow on a
+ * given phone, cannot cost the simulation ticks or hold up a frame to the
+ * matrix: the two run on different cores. The page posts taps, colour and
+ * slider changes; the worker posts back log lines, connection status and
+ * preview frames (shared_frame.js).
  *
  * Tap gesture triggers a water drop at the index finger position.
- * The simulation runs every frame regardless of hand presence.
- * WebSocket transmission is non-blocking (fire-and-forget binary send).
+ * The simulation runs every tick regardless of hand presence.
  */
 
-import { connect, disconnect, isConnected, sendImageData, setOnStatusChange, setOnError, setOnDrop, sendDrop } from './wss.js'
 import * as Hand from './hand.js'
-import { WaterSimulation } from './water.js'
+import { FrameReader } from './shared_frame.js'
 
 const MATRIX_SIZE = 32
 
@@ -47,15 +52,60 @@ const matrixCtx = matrixCanvas.getContext('2d', { willReadFrequently: true })
 let modelReady = false
 let wasNotTapping = true
 let localTint = { r: 60, g: 150, b: 255 }
-let remoteTint = { r: 255, g: 100, b: 100 } // Default remote color until updated
 let continuousDrop = false
-let lastSendTime = 0
+let connected = false
+let pendingConnect = null // resolves connect()'s reply from the worker
+
+// Preview, painted from the worker's frames; reused every frame
+const previewImage = new ImageData(MATRIX_SIZE, MATRIX_SIZE)
+const sharedPreview = new FrameReader()
+let pendingPreview = null // transferred frame (no SharedArrayBuffer), until painted
+
+// ─── Simulation Worker ───────────────────────────────────────────────────────
+
+const sim = new Worker(new URL('./sim_worker.js', import.meta.url), { type: 'module' })
+
+sim.onmessage = ({ data: msg }) => {
+    if (msg.type === 'log') {
+        log(msg.message)
+    } else if (msg.type === 'frame-shared') {
+        sharedPreview.attach(msg.buffer)
+    } else if (msg.type === 'frame') {
+        // Only the latest is painted; an older one goes straight back
+        if (pendingPreview) sim.postMessage({ type: 'frame', buffer: pendingPreview }, [pendingPreview])
+        pendingPreview = msg.buffer
+    } else if (msg.type === 'connection') {
+        connected = msg.connected
+        statusDot.className = `status-dot ${connected ? 'online' : 'offline'}`
+        btnConnect.textContent = connected ? 'Disconnect' : 'Connect'
+        if (msg.matrix !== null) {
+            matrixDot.className = `status-dot ${connected && msg.matrix ? 'online' : 'offline'}`
+        }
+    } else if (msg.type === 'connect-result') {
+        pendingConnect?.(msg.ok)
+        pendingConnect = null
+    }
+}
+
+sim.onerror = (event) => {
+    log('Simulation worker error: ' + event.message)
+}
+
+/** @returns {Promise<boolean>} true if connected */
+function connect(url, pair) {
+    return new Promise((resolve) => {
+        pendingConnect = resolve
+        sim.postMessage({ type: 'connect', url, pair })
+    })
+}
 
-// Instantiate TWO simulations:
-// 1. localWater: driven by THIS user's hand
-// 2. remoteWater: driven by OTHER user's drops via WSS
-const localWater = new WaterSimulation()
-const remoteWater = new WaterSimulation()
+function sendTint(tint) {
+    sim.postMessage({ type: 'tint', r: tint.r, g: tint.g, b: tint.b })
+}
+
+function sendSetting(name, value) {
+    sim.postMessage({ type: 'setting', name, value })
+}
 
 // ─── Logging ─────────────────────────────────────────────────────────────────
 
@@ -64,33 +114,6 @@ function log(msg) {
     logEl.textContent = `[${time}] ${msg}\n` + logEl.textContent
 }
 
-// ─── WSS Status Callbacks ────────────────────────────────────────────────────
-
-setOnStatusChange((connected, statusMsg) => {
-    statusDot.className = `status-dot ${connected ? 'online' : 'offline'}`
-    btnConnect.textContent = connected ? 'Disconnect' : 'Connect'
-
-    if (statusMsg && statusMsg.type === 'status') {
-        matrixDot.className = `status-dot ${statusMsg.matrix ? 'online' : 'offline'}`
-    }
-})
-
-setOnError((message) => {
-    log('WSS error: ' + message)
-})
-
-setOnDrop((x, y, strength, radius, r, g, b) => {
-    // Received a drop from the other user!
-    // Update remote tint if color data is present
-    if (r !== undefined && g !== undefined && b !== undefined) {
-        remoteTint = { r, g, b }
-    }
-
-    // Trigger drop in the remote simulation layer
-    remoteWater.dropAt(x, y, { strength, radius })
-    // log(`Remote drop at (${x},${y})`)
-})
-
 // ─── Initialization ──────────────────────────────────────────────────────────
 
 async function initModel() {
@@ -111,8 +134,8 @@ initModel()
 // ─── WebSocket Connection ────────────────────────────────────────────────────
 
 btnConnect.addEventListener('click', async () => {
-    if (isConnected()) {
-        disconnect()
+    if (connected) {
+        sim.postMessage({ type: 'disconnect' })
         btnConnect.textContent = 'Connect'
         statusDot.className = 'status-dot offline'
         matrixDot.className = 'status-dot offline'
@@ -214,7 +237,10 @@ function processHandDetection() {
             const rgb = hslToRgb(hue, saturation, lightness)
 
             // Update local state
-            localTint = rgb
+            if (rgb.r !== localTint.r || rgb.g !== localTint.g || rgb.b !== localTint.b) {
+                localTint = rgb
+                sendTint(rgb)
+            }
 
             // Update UI (optional smoothness check could be added)
             colorPicker.value = rgbToHex(rgb.r, rgb.g, rgb.b)
@@ -227,13 +253,8 @@ function processHandDetection() {
         // Only allow tapping if NOT in open hand mode to avoid conflicts
         if (tapping && !openHand) {
             if (wasNotTapping || continuousDrop) {
-                // Trigger LOCAL drop
-                localWater.dropAt(pos.x, pos.y)
-
-                // Broadcast drop to remote (with our color)
-                const s = localWater.getDropStrength()
-                const r = localWater.getDropRadius()
-                sendDrop(pos.x, pos.y, s, r, localTint.r, localTint.g, localTint.b)
+                // The worker drops it locally, or sends it to the lockstep log
+                sim.postMessage({ type: 'drop', x: pos.x, y: pos.y })
 
                 if (wasNotTapping) {
                     log(`💧 Drop at (${pos.x}, ${pos.y})`)
@@ -250,119 +271,31 @@ function processHandDetection() {
 
 // ─── Main Loop ───────────────────────────────────────────────────────────────
 
+/** Paint the worker's latest frame, if there is a new one. */
+function paintPreview() {
+    if (pendingPreview) {
+        previewImage.data.set(new Uint8ClampedArray(pendingPreview))
+        sim.postMessage({ type: 'frame', buffer: pendingPreview }, [pendingPreview])
+        pendingPreview = null
+    } else if (!sharedPreview.read(previewImage.data)) {
+        return
+    }
+    matrixCtx.putImageData(previewImage, 0, 0)
+}
+
 function mainLoop() {
-    // 1. Hand detection → trigger drops
+    // 1. Hand detection → drops and colour, posted to the worker
     if (Hand.isRunning()) {
         processHandDetection()
     }
 
-    // 2. Advance simulations
-    localWater.step()
-    remoteWater.step()
-
-    // 3. Output Rendering:
-    //    Base color is localTint.
-    //    Remote waves push the color towards remoteTint.
-
-    // Get raw shading maps (0.0 - 1.0)
-    const shadeLocal = localWater.getShadingMap()
-    const shadeRemote = remoteWater.getShadingMap()
-
-    const imageData = new ImageData(MATRIX_SIZE, MATRIX_SIZE)
-    const data = imageData.data
-
-    // Brightness boost factor to make colors pop
-    const BRIGHTNESS_BOOST = 2.0
-
-    // Total pixels
-    const N = MATRIX_SIZE * MATRIX_SIZE
-
-    for (let i = 0; i < N; i++) {
-        // Shading values are 0.0 - 1.0 (0.5 is flat water)
-        const s1 = shadeLocal[i]
-        const s2 = shadeRemote[i]
-
-        // Superposition of wave slopes (approximate)
-        // flat + (slope1 + slope2)
-        // s1 = 0.5 + slope1  -> slope1 = s1 - 0.5
-        // total = 0.5 + (s1 - 0.5) + (s2 - 0.5)
-        let totalShade = s1 + s2 - 0.5
-
-        // Clamp shade
-        if (totalShade < 0) totalShade = 0
-        if (totalShade > 1) totalShade = 1
-
-        // Calculate how much "remote activity" is here
-        // We use deviation from 0.5 as a proxy for wave height/slope
-        const remoteActivity = Math.abs(s2 - 0.5)
-
-        // Gain up the activity to make color shift more visible even for small ripples
-        // 4.0 is a magic number: higher = more sensitive color shift
-        let mixFactor = remoteActivity * 4.0
-        if (mixFactor > 1.0) mixFactor = 1.0
-
-        // Lerp color: local -> remote based on mixFactor
-        const r = localTint.r * (1 - mixFactor) + remoteTint.r * mixFactor
-        const g = localTint.g * (1 - mixFactor) + remoteTint.g * mixFactor
-        const b = localTint.b * (1 - mixFactor) + remoteTint.b * mixFactor
-
-        // Apply directional shading to the composed color AND boost brightness
-        const idx = i * 4
+    // 2. Preview on canvas
+    paintPreview()
 
-        // Note: we can go above 255 before clamping if we want "HDR" highlights
-        const rFinal = r * totalShade * BRIGHTNESS_BOOST
-        const gFinal = g * totalShade * BRIGHTNESS_BOOST
-        const bFinal = b * totalShade * BRIGHTNESS_BOOST
-
-        data[idx + 0] = rFinal > 255 ? 255 : rFinal
-        data[idx + 1] = gFinal > 255 ? 255 : gFinal
-        data[idx + 2] = bFinal > 255 ? 255 : bFinal
-        data[idx + 3] = 255
-    }
-
-    // 4. Preview on canvas
-    matrixCtx.putImageData(imageData, 0, 0)
-
-    // 5. Send to matrix via WSS (throttled to ~30 FPS)
-    if (isConnected()) {
-        const now = performance.now()
-        if (now - lastSendTime >= 33) { // 33ms ≈ 30 FPS
-            // ROTATE 90° CCW before sending
-            const rotated = rotateImageDataCCW(imageData)
-            sendImageData(rotated)
-            lastSendTime = now
-        }
-    }
-
-    // 6. Next frame
+    // 3. Next frame
     requestAnimationFrame(mainLoop)
 }
 
-function rotateImageDataCCW(src) {
-    const w = MATRIX_SIZE
-    const h = MATRIX_SIZE
-    const dest = new ImageData(w, h)
-    const srcData = src.data
-    const destData = dest.data
-
-    for (let y = 0; y < h; y++) {
-        for (let x = 0; x < w; x++) {
-            // 90° CCW: (x, y) -> (y, w - 1 - x)
-            const newX = y
-            const newY = w - 1 - x
-
-            const srcIdx = (y * w + x) * 4
-            const destIdx = (newY * w + newX) * 4
-
-            destData[destIdx + 0] = srcData[srcIdx + 0]
-            destData[destIdx + 1] = srcData[srcIdx + 1]
-            destData[destIdx + 2] = srcData[srcIdx + 2]
-            destData[destIdx + 3] = srcData[srcIdx + 3]
-        }
-    }
-    return dest
-}
-
 // Start the loop immediately
 requestAnimationFrame(mainLoop)
 
@@ -376,37 +309,34 @@ colorPicker.addEventListener('input', () => {
         g: parseInt(hex.slice(3, 5), 16),
         b: parseInt(hex.slice(5, 7), 16)
     }
+    sendTint(localTint)
 })
 
 // Drop strength
 strengthSlider.addEventListener('input', () => {
     const val = parseFloat(strengthSlider.value)
-    localWater.setDropStrength(val)
-    remoteWater.setDropStrength(val)
+    sendSetting('dropStrength', val)
     strengthValue.textContent = val.toFixed(1)
 })
 
 // Drop radius
 radiusSlider.addEventListener('input', () => {
     const val = parseInt(radiusSlider.value)
-    localWater.setDropRadius(val)
-    remoteWater.setDropRadius(val)
+    sendSetting('dropRadius', val)
     radiusValue.textContent = val
 })
 
 // Wave damping
 dampSlider.addEventListener('input', () => {
     const val = parseFloat(dampSlider.value)
-    localWater.setWaveDamp(val)
-    remoteWater.setWaveDamp(val)
+    sendSetting('waveDamp', val)
     dampValue.textContent = val.toFixed(3)
 })
 
 // Render gain
 gainSlider.addEventListener('input', () => {
     const val = parseFloat(gainSlider.value)
-    localWater.setRenderGain(val)
-    remoteWater.setRenderGain(val)
+    sendSetting('renderGain', val)
     gainValue.textContent = val.toFixed(1)
 })
 
@@ -422,26 +352,13 @@ if (btnContinuous) {
 
 // Clear / Reset
 btnClear.addEventListener('click', () => {
-    localWater.reset()
-    remoteWater.reset()
+    sim.postMessage({ type: 'reset' })
     log('Water reset.')
 })
 
 // Test — send a solid cyan frame
 if (btnTest) {
     btnTest.addEventListener('click', () => {
-        if (!isConnected()) {
-            log('Connect WebSocket first.')
-            return
-        }
-        const testData = new ImageData(32, 32)
-        for (let i = 0; i < testData.data.length; i += 4) {
-            testData.data[i + 0] = 0    // R
-            testData.data[i + 1] = 200  // G
-            testData.data[i + 2] = 255  // B
-            testData.data[i + 3] = 255  // A
-        }
-        sendImageData(testData)
-        log('Test frame sent (solid cyan).')
+        sim.postMessage({ type: 'test' })
     })
 }
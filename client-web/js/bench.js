@@ -0,0 +1,146 @@
+/**
+ * Render path micro-benchmark — the per-frame work between the simulation
+ * and socket.send(): shade both layers, composite, rotate 90° CCW, pack
+ * RGB565.
+ *
+ *   legacy: what mainLoop() used to do, a fresh Float32Array per shading
+ *           map, a fresh RGBA image, a second one for the rotation, then
+ *           a separate RGB565 packing pass
+ *   fused:  composeFrame() into reused buffers, nothing allocated
+ *
+ * Both paths run on the same water, interleaved, and must produce the same
+ * bytes. Used by bench.html; plain module, so node can run it too:
+ *   node --input-type=module -e "import('./client-web/js/bench.js').then(m => console.log(m.formatReport(m.runRenderBench())))"
+ */
+
+import { WaterSimulation, composeShading, composeFrame } from './water.js'
+
+const SIZE = 32
+const N = SIZE * SIZE
+
+const LOCAL_TINT = { r: 60, g: 150, b: 255 }
+const REMOTE_TINT = { r: 255, g: 100, b: 100 }
+
+// ─── Legacy path ─────────────────────────────────────────────────────────────
+
+function legacyFrame(local, remote, out565) {
+    // getShadingMap() used to return a new array each call
+    const shadeLocal = new Float32Array(local.getShadingMap())
+    const shadeRemote = new Float32Array(remote.getShadingMap())
+
+    const image = new Uint8ClampedArray(N * 4) // new ImageData()
+    composeShading(shadeLocal, shadeRemote, LOCAL_TINT, REMOTE_TINT, image)
+
+    // rotateImageDataCCW(): (x, y) → (y, 31 − x), into another new image
+    const rotated = new Uint8ClampedArray(N * 4)
+    for (let y = 0; y < SIZE; y++) {
+        for (let x = 0; x < SIZE; x++) {
+            const src = (y * SIZE + x) * 4
+            const dst = ((SIZE - 1 - x) * SIZE + y) * 4
+            rotated[dst + 0] = image[src + 0]
+            rotated[dst + 1] = image[src + 1]
+            rotated[dst + 2] = image[src + 2]
+            rotated[dst + 3] = image[src + 3]
+        }
+    }
+
+    // sendImageData(): pack RGB565, big-endian
+    for (let i = 0, o = 0; i < rotated.length; i += 4) {
+        const rgb16 = ((rotated[i] >> 3) << 11) | ((rotated[i + 1] >> 2) << 5) | (rotated[i + 2] >> 3)
+        out565[o++] = rgb16 >> 8
+        out565[o++] = rgb16 & 0xFF
+    }
+    return image
+}
+
+// ─── Fused path ──────────────────────────────────────────────────────────────
+
+const fusedImage = new Uint8ClampedArray(N * 4)
+
+function fusedFrame(local, remote, out565) {
+    composeFrame(local.getShadingMap(), remote.getShadingMap(), LOCAL_TINT, REMOTE_TINT, fusedImage, out565)
+    return fusedImage
+}
+
+// ─── Runner ──────────────────────────────────────────────────────────────────
+
+function percentile(sorted, p) {
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))]
+}
+
+function heapBytes() {
+    // Chromium only; elsewhere allocation shows up in the timings alone
+    return globalThis.performance?.memory?.usedJSHeapSize
+}
+
+/**
+ * @param {{ samples?: number, batch?: number, warmup?: number }} [options]
+ *        samples: timed batches per path; batch: frames per batch (timer
+ *        resolution in browsers can be 100 µs, so frames are timed in bulk);
+ *        warmup: untimed batches first, while the JIT settles
+ * @returns {{ results: Array<{ name: string, p50Us: number, p99Us: number,
+ *             heapDelta?: number }>, mismatches: number, frames: number }}
+ */
+export function runRenderBench({ samples = 200, batch = 50, warmup = 20 } = {}) {
+    const local = new WaterSimulation()
+    const remote = new WaterSimulation()
+    const legacy565 = new Uint8Array(N * 2)
+    const fused565 = new Uint8Array(N * 2)
+    const paths = [
+        { name: 'legacy (allocating, 3 passes)', frame: legacyFrame, out: legacy565, times: [], heap: 0 },
+        { name: 'fused (composeFrame)', frame: fusedFrame, out: fused565, times: [], heap: 0 }
+    ]
+
+    let frames = 0
+    let mismatches = 0
+    for (let s = -warmup; s < samples; s++) {
+        // Keep the water busy so every pixel's colour moves
+        const n = s + warmup
+        if (n % 10 === 0) {
+            local.dropAt(4 + (n * 7) % 24, 4 + (n * 11) % 24, { strength: 1.5, radius: 3, burstCount: 1 })
+            remote.dropAt(4 + (n * 13) % 24, 4 + (n * 5) % 24, { strength: 1.5, radius: 3, burstCount: 1 })
+        }
+        local.step()
+        remote.step()
+
+        for (const path of paths) {
+            const heapBefore = heapBytes()
+            const start = performance.now()
+            for (let f = 0; f < batch; f++) {
+                path.frame(local, remote, path.out)
+            }
+            if (s < 0) continue
+            path.times.push((performance.now() - start) * 1000 / batch)
+            if (heapBefore !== undefined) path.heap += heapBytes() - heapBefore
+        }
+
+        // Same preview and same bytes on the wire
+        const legacyImage = legacyFrame(local, remote, legacy565)
+        const fusedImageNow = fusedFrame(local, remote, fused565)
+        for (let i = 0; i < N * 2; i++) {
+            if (legacy565[i] !== fused565[i]) mismatches++
+        }
+        for (let i = 0; i < N * 4; i++) {
+            if (legacyImage[i] !== fusedImageNow[i]) mismatches++
+        }
+        if (s >= 0) frames += batch
+    }
+
+    const results = paths.map((path) => {
+        const sorted = path.times.slice().sort((a, b) => a - b)
+        const result = { name: path.name, p50Us: percentile(sorted, 0.5), p99Us: percentile(sorted, 0.99) }
+        if (heapBytes() !== undefined) result.heapDelta = path.heap
+        return result
+    })
+    return { results, mismatches, frames }
+}
+
+/** @returns {string} one line per path, then the verdict */
+export function formatReport({ results, mismatches, frames }) {
+    const lines = results.map((r) => {
+        const heap = r.heapDelta !== undefined ? `, heap ${(r.heapDelta / 1024).toFixed(0)} KiB net` : ''
+        return `${r.name.padEnd(32)} p50 ${r.p50Us.toFixed(2)} us/frame, p99 ${r.p99Us.toFixed(2)} us/frame${heap}`
+    })
+    lines.push(`${frames} frames per path, ${mismatches} mismatched bytes: ${mismatches === 0 ? 'PASS' : 'FAIL'}`)
+    return lines.join('\n')
+}
@@ -0,0 +1,197 @@
+/**
+ * Frame codec — binary frame formats sent to the LED matrix.
+ *
+ * Mirrors client-matrix/src/frame_format.h. A payload of exactly 2048
+ * bytes is a bare RGB565 frame; anything else starts with a format byte:
+ *
+ *   FORMAT_TILES565  [0x01][tileSize][count] + count × ([index][tile RGB565])
+ *   FORMAT_KEY565    [0x02] + 2048 bytes RGB565 (starts a delta stream)
+ *   FORMAT_PAL565    [0x03][entries - 1] + entries × RGB565 + 1024 indices
+ *                    (≤ 256 colours; also starts a delta stream)
+ *
+ * Tiles are tileSize² pixels, row-major, big-endian, indexed row-major
+ * over the (32 / tileSize)² grid.
+ *
+ * Any payload may be wrapped in a v1 header (wrapFrame()):
+ *
+ *   [0x81][sequence u16][capture ms u32] + typed payload, big-endian;
+ *   a bare frame gets its format byte (0x00) back inside the header.
+ */
+
+export const FORMAT_TILES565 = 0x01
+export const FORMAT_KEY565 = 0x02
+export const FORMAT_PAL565 = 0x03
+export const FRAME_HEADER_V1 = 0x81
+export const FRAME_HEADER_SIZE = 7
+
+const SIZE = 32
+const FRAME_BYTES = SIZE * SIZE * 2
+const NUM_PIXELS = SIZE * SIZE
+const TILE_HEADER = 3
+const PALETTE_HEADER = 2
+const PALETTE_MAX = 256
+
+// ─── Header ──────────────────────────────────────────────────────────────────
+
+/**
+ * Prefix a payload with a v1 header.
+ * @param {Uint8Array} payload   - bare, keyframe, tile delta or palette frame
+ * @param {number} sequence      - payloads sent so far (wraps at 65536)
+ * @param {number} captureMs     - when the image was made (wraps at 2³²)
+ * @param {Uint8Array} out       - at least FRAME_HEADER_SIZE + 1 + 2048 bytes
+ * @returns {Uint8Array} view of out
+ */
+export function wrapFrame(payload, sequence, captureMs, out) {
+    const bare = payload.length === FRAME_BYTES
+    const capture = Math.floor(captureMs) >>> 0
+    out[0] = FRAME_HEADER_V1
+    out[1] = (sequence >> 8) & 0xFF
+    out[2] = sequence & 0xFF
+    out[3] = capture >>> 24
+    out[4] = (capture >>> 16) & 0xFF
+    out[5] = (capture >>> 8) & 0xFF
+    out[6] = capture & 0xFF
+
+    let length = FRAME_HEADER_SIZE
+    if (bare) out[length++] = 0x00
+    out.set(payload, length)
+    return out.subarray(0, length + payload.length)
+}
+
+// ─── Palette ─────────────────────────────────────────────────────────────────
+
+// RGB565 value → palette slot, valid while colourStamp matches the frame
+const colourSlot = new Uint8Array(65536)
+const colourStamp = new Uint32Array(65536)
+let stamp = 0
+
+/**
+ * Encode an RGB565 frame as a palette frame.
+ * @param {Uint8Array} frame - 2048-byte RGB565 frame
+ * @param {Uint8Array} out   - at least 2 + 512 + 1024 bytes
+ * @returns {number} payload length, or 0 if the frame has over 256 colours
+ */
+export function encodePalette565(frame, out) {
+    const indices = PALETTE_HEADER + PALETTE_MAX * 2
+    let entries = 0
+    stamp++
+
+    for (let i = 0; i < NUM_PIXELS; i++) {
+        const colour = (frame[i * 2] << 8) | frame[i * 2 + 1]
+        if (colourStamp[colour] !== stamp) {
+            if (entries === PALETTE_MAX) return 0
+            colourStamp[colour] = stamp
+            colourSlot[colour] = entries
+            out[PALETTE_HEADER + entries * 2] = frame[i * 2]
+            out[PALETTE_HEADER + entries * 2 + 1] = frame[i * 2 + 1]
+            entries++
+        }
+        // Indices go after the largest palette, then move down once it is known
+        out[indices + i] = colourSlot[colour]
+    }
+
+    out[0] = FORMAT_PAL565
+    out[1] = entries - 1
+    out.copyWithin(PALETTE_HEADER + entries * 2, indices, indices + NUM_PIXELS)
+    return PALETTE_HEADER + entries * 2 + NUM_PIXELS
+}
+
+// ─── Tile Delta Encoder ──────────────────────────────────────────────────────
+
+export class TileDeltaEncoder {
+    /**
+     * @param {object} [opts]
+     * @param {number} [opts.tileSize=8]          - 2, 4, 8, 16 or 32
+     * @param {number} [opts.keyframeInterval=30] - sent frames between keyframes
+     * @param {boolean} [opts.palette=false]      - keyframes as palette frames
+     *                                              when they fit
+     */
+    constructor({ tileSize = 8, keyframeInterval = 30, palette = false } = {}) {
+        if (tileSize < 2 || tileSize > SIZE || (tileSize & (tileSize - 1))) {
+            throw new Error(`Invalid tile size: ${tileSize}`)
+        }
+        this.tileSize = tileSize
+        this.keyframeInterval = keyframeInterval
+        this.palette = palette
+        this.tilesPerRow = SIZE / tileSize
+        this.tileBytes = tileSize * tileSize * 2
+
+        this.previous = new Uint8Array(FRAME_BYTES)
+        // Largest payload is a keyframe; deltas that would not fit become one
+        this.packet = new Uint8Array(Math.max(1 + FRAME_BYTES, PALETTE_HEADER + PALETTE_MAX * 2 + NUM_PIXELS))
+        this.sinceKeyframe = 0
+        this.needKeyframe = true
+    }
+
+    /** Force a keyframe next (e.g. the matrix just (re)connected). */
+    reset() {
+        this.needKeyframe = true
+    }
+
+    /**
+     * Encode one RGB565 frame against the previous one.
+     * @param {Uint8Array} frame - 2048-byte RGB565 frame
+     * @returns {Uint8Array|null} payload view (valid until the next call),
+     *          or null if nothing changed
+     */
+    encode(frame) {
+        if (this.needKeyframe || this.sinceKeyframe >= this.keyframeInterval) {
+            return this.keyframe(frame)
+        }
+
+        const { tileSize, tilesPerRow, tileBytes, previous, packet } = this
+        const rowBytes = tileSize * 2
+        let out = TILE_HEADER
+        let count = 0
+
+        for (let index = 0; index < tilesPerRow * tilesPerRow; index++) {
+            const x0 = (index % tilesPerRow) * tileSize
+            const y0 = Math.floor(index / tilesPerRow) * tileSize
+            if (!tileChanged(frame, previous, x0, y0, tileSize)) continue
+
+            // Would not beat a keyframe (or would collide with the bare size)
+            if (out + 1 + tileBytes >= FRAME_BYTES) return this.keyframe(frame)
+
+            packet[out++] = index
+            for (let row = 0; row < tileSize; row++) {
+                const start = ((y0 + row) * SIZE + x0) * 2
+                for (let i = start; i < start + rowBytes; i++) {
+                    packet[out++] = frame[i]
+                }
+            }
+            count++
+        }
+
+        if (count === 0) return null
+
+        packet[0] = FORMAT_TILES565
+        packet[1] = tileSize
+        packet[2] = count
+        previous.set(frame)
+        this.sinceKeyframe++
+        return packet.subarray(0, out)
+    }
+
+    keyframe(frame) {
+        this.previous.set(frame)
+        this.sinceKeyframe = 0
+        this.needKeyframe = false
+
+        const length = this.palette ? encodePalette565(frame, this.packet) : 0
+        if (length) return this.packet.subarray(0, length)
+
+        this.packet[0] = FORMAT_KEY565
+        this.packet.set(frame, 1)
+        return this.packet.subarray(0, 1 + FRAME_BYTES)
+    }
+}
+
+function tileChanged(a, b, x0, y0, tileSize) {
+    for (let row = 0; row < tileSize; row++) {
+        const start = ((y0 + row) * SIZE + x0) * 2
+        for (let i = start; i < start + tileSize * 2; i++) {
+            if (a[i] !== b[i]) return true
+        }
+    }
+    return false
+}
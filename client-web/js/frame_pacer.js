@@ -0,0 +1,112 @@
+/**
+ * Uplink pacing for streamed frames — keeps the browser's send buffer
+ * from filling up on a congested mobile link.
+ *
+ * socket.send() never blocks: whatever the network can't take yet waits in
+ * bufferedAmount, and every frame queued there adds to the latency of all
+ * the frames behind it. The pacer lets a frame go only once the previous
+ * ones have (nearly) drained; otherwise the caller keeps it pending and
+ * the next render overwrites it, so the matrix always gets the newest
+ * image instead of a backlog.
+ *
+ * The target rate follows the drain rate (bytes leaving the buffer per
+ * second ÷ average frame size, with some headroom) while the link is the
+ * bottleneck. While the buffer keeps draining before the next frame is
+ * due, the link isn't the limit and the target climbs back up to maxFps.
+ */
+
+const FRAME_BYTES = 2048 // bare RGB565 frame
+
+export class FramePacer {
+    /**
+     * @param {object} [opts]
+     * @param {number} [opts.maxFps=60]       - ceiling (the caller's own cadence is usually lower)
+     * @param {number} [opts.minFps=2]        - floor, so a starved link still shows motion
+     * @param {number} [opts.headroom=0.8]    - fraction of the drain rate to use
+     * @param {number} [opts.maxQueued=2048]  - bytes allowed to wait in front of a new frame
+     * @param {number} [opts.windowMs=250]    - drain rate measurement window
+     */
+    constructor({ maxFps = 60, minFps = 2, headroom = 0.8, maxQueued = FRAME_BYTES, windowMs = 250 } = {}) {
+        this.maxFps = maxFps
+        this.minFps = minFps
+        this.headroom = headroom
+        this.maxQueued = maxQueued
+        this.windowMs = windowMs
+        this.frames = 0     // sent, since construction
+        this.coalesced = 0  // replaced by a newer one before they could go
+        this.bytes = 0
+        this.reset(0)
+    }
+
+    /** Start over (new connection): full rate, no history. */
+    reset(now) {
+        this.targetFps = this.maxFps
+        this.drainRate = 0          // bytes/s, 0 until the link has been the limit
+        this.frameBytes = FRAME_BYTES
+        this.lastSend = -Infinity
+        this.windowStart = now
+        this.windowBuffered = 0     // bufferedAmount when the window started
+        this.windowSent = 0         // bytes sent since
+        this.limited = false        // a frame had to wait for the buffer this window
+    }
+
+    /**
+     * May a frame go out now?
+     * @param {number} now - ms
+     * @param {number} buffered - socket.bufferedAmount
+     */
+    ready(now, buffered) {
+        this.measure(now, buffered)
+        if (buffered > this.maxQueued) {
+            this.limited = true
+            return false
+        }
+        return now - this.lastSend >= 1000 / this.targetFps
+    }
+
+    /**
+     * A frame went out.
+     * @param {number} bytes - payload size
+     */
+    sent(now, bytes) {
+        this.frames++
+        this.bytes += bytes
+        this.windowSent += bytes
+        this.frameBytes += (bytes - this.frameBytes) / 8
+        this.lastSend = now
+    }
+
+    /** A pending frame was overwritten by a newer one. */
+    coalesce() {
+        this.coalesced++
+    }
+
+    /** Close the measurement window once it is long enough. */
+    measure(now, buffered) {
+        const elapsed = now - this.windowStart
+        if (elapsed < this.windowMs) return
+
+        const drained = this.windowBuffered + this.windowSent - buffered
+        if (this.limited || buffered > this.maxQueued) {
+            // Backlogged: what drained is what the link carries
+            const rate = Math.max(0, drained) * 1000 / elapsed
+            this.drainRate = this.drainRate ? (this.drainRate + rate) / 2 : rate
+            this.targetFps = this.headroom * this.drainRate / Math.max(1, this.frameBytes)
+        } else {
+            // Never waited: probe upwards
+            this.targetFps *= 1.5
+        }
+        this.targetFps = Math.min(this.maxFps, Math.max(this.minFps, this.targetFps))
+
+        this.windowStart = now
+        this.windowBuffered = buffered
+        this.windowSent = 0
+        this.limited = false
+    }
+
+    /** @returns {{ frames: number, coalesced: number, bytes: number, targetFps: number, drainRate: number }} */
+    stats() {
+        const { frames, coalesced, bytes, targetFps, drainRate } = this
+        return { frames, coalesced, bytes, targetFps, drainRate }
+    }
+}
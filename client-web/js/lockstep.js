@@ -0,0 +1,383 @@
+/**
+ * Lockstep water — deterministic simulation shared with the matrix firmware.
+ *
+ * Bit-exact JS twin of client-matrix/src/water_lockstep.* + WaveKernel<Q16>:
+ * every phone and every matrix that applies the same tick-stamped events
+ * holds identical height/velocity fields at every tick.
+ *
+ *   - Fields are Q16 integers (Int32Array). Every product has one small
+ *     constant factor, so it is exact in a double; rounding mirrors the
+ *     C++ (nearest for products, toward zero for damping).
+ *   - A drop applies at the tick the server stamped it with. Its jitter
+ *     comes from an integer hash of that tick, its falloff from a Q16 table.
+ *   - Strengths travel as multiples of 1/256, waveDamp/renderGain as
+ *     multiples of 1/65536 (quantizeStrength / quantizeParam before sending).
+ *   - Idle as WaveKernel: energy in LSB² (each difference capped at 1.0,
+ *     so the sums are exact) below IDLE_ENERGY_Q32, or v ≡ 0 two steps
+ *     running; step() is then a no-op until a drop or waveK/waveDamp change.
+ *
+ * LockstepSchedule decides how far to step: the ticks a FixedTimestep
+ * (timestep.js) pays out at LOCKSTEP_TICK_MS, one more when far behind,
+ * never past the server's horizon (its `tick` beats: every event up to
+ * there has been sent). Flat water steps to itself, so while both layers
+ * are idle it skips ahead to the next event or the horizon: the server
+ * pauses its beats while everyone's water is flat.
+ */
+
+const SIZE = 32
+const N = SIZE * SIZE
+const ONE = 65536
+const HALF = 32768
+const QUARTER = 16384
+
+export const LOCKSTEP_TICK_MS = 16
+export const LOCKSTEP_MAX_LAG = 8    // ticks behind the horizon before catching up
+
+const STRENGTH_ONE = 256
+const STRENGTH_MAX = 16 * STRENGTH_ONE
+const JITTER_Q16 = 29491             // 0.45 px per unit of radius
+const IDLE_ENERGY_Q32 = 64           // WAVE_IDLE_ENERGY_Q32
+
+// round(65536 × exp(-(dx² + dy²) × 2.2 / radius²)), [radius - 1][|dx|][|dy|]
+const DROP_WEIGHTS = [
+    [[65536, 7262], [7262, 805]],
+    [[65536, 37811, 7262], [37811, 21815, 4190], [7262, 4190, 805]],
+    [[65536, 51324, 24651, 7262], [51324, 40194, 19305, 5687],
+     [24651, 19305, 9272, 2731], [7262, 5687, 2731, 805]],
+    [[65536, 57117, 37811, 19013, 7262], [57117, 49779, 32954, 16570, 6329],
+     [37811, 32954, 21815, 10969, 4190], [19013, 16570, 10969, 5516, 2107],
+     [7262, 6329, 4190, 2107, 805]],
+    [[65536, 60015, 46090, 29684, 16032, 7262], [60015, 54960, 42208, 27183, 14682, 6650],
+     [46090, 42208, 32414, 20876, 11275, 5107], [29684, 27183, 20876, 13445, 7262, 3289],
+     [16032, 14682, 11275, 7262, 3922, 1776], [7262, 6650, 5107, 3289, 1776, 805]]
+]
+
+// ─── Integer helpers ─────────────────────────────────────────────────────────
+
+function clamp(x, lo, hi) {
+    return x < lo ? lo : x > hi ? hi : x
+}
+
+/** lrintf(): round half to even */
+function lrint(x) {
+    const r = Math.round(x)
+    return (r - x === 0.5 && (r & 1)) ? r - 1 : r
+}
+
+/** Fixed<16> operator*: int64 product, rounded to nearest */
+function mulQ16(a, b) {
+    return Math.floor((a * b + HALF) / ONE)
+}
+
+/** mulTowardZero(): decay factors */
+function mulTowardZeroQ16(a, b) {
+    return Math.trunc((a * b) / ONE)
+}
+
+/** squaredDifference(): |a - b| capped at 1.0, squared, in LSB² */
+function squaredDifference(a, b) {
+    const d = Math.min(Math.abs(a - b), ONE)
+    return d * d
+}
+
+/** Float parameter → Q16, as Fixed(float) does */
+function toQ16(val) {
+    return lrint(Math.fround(val) * ONE)
+}
+
+/** 32-bit integer hash (drop jitter), same as lockstepHash() */
+export function lockstepHash(x) {
+    x ^= x >>> 16
+    x = Math.imul(x, 0x7FEB352D)
+    x ^= x >>> 15
+    x = Math.imul(x, 0x846CA68B)
+    x ^= x >>> 16
+    return x >>> 0
+}
+
+/** round((2u - 1) × 0.45 × radius), u in [0, 1) */
+function jitterOffset(seed, radius) {
+    const u = lockstepHash(seed) >>> 16
+    const t = (2 * u - ONE) * radius * JITTER_Q16
+    return Math.floor((t + 2147483648) / 4294967296)
+}
+
+/** Snap a drop strength to the 1/256 grid the matrix uses. */
+export function quantizeStrength(strength) {
+    return clamp(Math.round(strength * STRENGTH_ONE), 0, STRENGTH_MAX) / STRENGTH_ONE
+}
+
+/** Snap waveDamp / renderGain to the Q16 grid. */
+export function quantizeParam(val) {
+    return toQ16(val) / ONE
+}
+
+/**
+ * A drop message's fields as the firmware's LockstepDrop holds them: the
+ * same uint8 truncation as its WaterEvent, strength on the 1/256 grid.
+ * @returns {{ x: number, y: number, radius: number, burst: number, strength: number }}
+ */
+export function lockstepDropFields(drop) {
+    return {
+        x: drop.x & 0xFF,
+        y: drop.y & 0xFF,
+        radius: clamp(drop.radius & 0xFF, 1, 5),
+        burst: clamp((drop.burst ?? 1) & 0xFF || 1, 1, 8),
+        strength: clamp(lrint(Math.fround(drop.strength) * STRENGTH_ONE), 0, STRENGTH_MAX)
+    }
+}
+
+// ─── LockstepWater ───────────────────────────────────────────────────────────
+
+export class LockstepWater {
+    constructor() {
+        this.h = new Int32Array(N) // height field, Q16
+        this.v = new Int32Array(N) // velocity field, Q16
+        this.shade = new Int32Array(N)
+        this.shadeFloat = new Float32Array(N)
+        this.resetParameters()
+        this.reset()
+    }
+
+    /**
+     * Inject a stamped drop (call before stepping drop.tick).
+     * @param {{ tick: number, x: number, y: number, strength: number,
+     *           radius: number, burst?: number }} drop
+     */
+    applyDrop(drop) {
+        const { x: cx, y: cy, radius: rad, burst: bursts, strength } = lockstepDropFields(drop)
+        const weight = DROP_WEIGHTS[rad - 1]
+
+        for (let b = 0; b < bursts; b++) {
+            const seed = (Math.imul(drop.tick, 0x9E3779B1) + (b * 17 + cx * 5 + cy * 3) * 2) >>> 0
+            const px = clamp(cx + jitterOffset(seed, rad), 1, SIZE - 2)
+            const py = clamp(cy + jitterOffset((seed + 1) >>> 0, rad), 1, SIZE - 2)
+
+            for (let dx = -rad; dx <= rad; dx++) {
+                for (let dy = -rad; dy <= rad; dy++) {
+                    const x = px + dx
+                    const y = py + dy
+                    if (x < 1 || x > SIZE - 2 || y < 1 || y > SIZE - 2) continue
+                    const w = weight[Math.abs(dx)][Math.abs(dy)]
+                    this.v[y * SIZE + x] += (strength * w + 128) >> 8
+                }
+            }
+        }
+        this.stillVelocity = false
+        this.idle = false
+    }
+
+    /** Advance one tick (nothing while idle). */
+    step() {
+        if (this.idle) return
+
+        const h = this.h
+        const v = this.v
+        let kinetic = 0
+        let still = true
+        for (let y = 1; y < SIZE - 1; y++) {
+            for (let x = 1; x < SIZE - 1; x++) {
+                const i = y * SIZE + x
+                const lap = (h[i - 1] + h[i + 1] + h[i - SIZE] + h[i + SIZE] - h[i] * 4) | 0
+                v[i] = mulTowardZeroQ16(v[i] + mulQ16(this.waveK, lap), this.waveDamp)
+                kinetic += squaredDifference(v[i], 0)
+                still = still && v[i] === 0
+            }
+        }
+        let potential = 0
+        for (let y = 1; y < SIZE - 1; y++) {
+            for (let x = 1; x < SIZE - 1; x++) {
+                const i = y * SIZE + x
+                h[i] += v[i]
+                potential += squaredDifference(h[i], h[i - 1]) + squaredDifference(h[i], h[i - SIZE])
+                if (x === SIZE - 2) potential += squaredDifference(h[i], 0)
+                if (y === SIZE - 2) potential += squaredDifference(h[i], 0)
+            }
+        }
+        this.energy = kinetic + potential
+        this.idle = this.energy < IDLE_ENERGY_Q32 || (still && this.stillVelocity)
+        this.stillVelocity = still
+    }
+
+    /** @returns {boolean} flat (or frozen): step() is a no-op until woken */
+    isIdle() {
+        return this.idle
+    }
+
+    /** @returns {number} field energy after the last step, as a float */
+    getEnergy() {
+        return this.energy / 4294967296
+    }
+
+    /**
+     * Directional shading in Q16 (0–65536), same as WaveKernel<Q16>.
+     * @returns {Int32Array} reused between calls
+     */
+    getShadingMapQ16() {
+        const h = this.h
+        for (let y = 0; y < SIZE; y++) {
+            for (let x = 0; x < SIZE; x++) {
+                const xm = x > 0 ? x - 1 : x
+                const xp = x < SIZE - 1 ? x + 1 : x
+                const ym = y > 0 ? y - 1 : y
+                const yp = y < SIZE - 1 ? y + 1 : y
+
+                const gx = h[y * SIZE + xp] - h[y * SIZE + xm]
+                const gy = h[yp * SIZE + x] - h[ym * SIZE + x]
+                const shade = HALF + mulQ16(this.renderGain, mulQ16(gx, HALF) + mulQ16(gy, QUARTER))
+                this.shade[y * SIZE + x] = clamp(shade, 0, ONE)
+            }
+        }
+        return this.shade
+    }
+
+    /**
+     * Shading as 0.0–1.0 floats, for composeFrame().
+     * @returns {Float32Array} reused between calls
+     */
+    getShadingMap() {
+        const q = this.getShadingMapQ16()
+        const map = this.shadeFloat
+        for (let i = 0; i < N; i++) {
+            map[i] = q[i] / ONE
+        }
+        return map
+    }
+
+    /** Word-wise FNV-1a over h then v, same as lockstepChecksum(). */
+    checksum() {
+        let hash = 2166136261
+        for (const field of [this.h, this.v]) {
+            for (let i = 0; i < N; i++) {
+                hash = Math.imul(hash ^ field[i], 16777619)
+            }
+        }
+        return hash >>> 0
+    }
+
+    reset() {
+        this.h.fill(0)
+        this.v.fill(0)
+        this.energy = 0      // LSB²
+        this.stillVelocity = true
+        this.idle = true
+    }
+
+    resetParameters() {
+        this.setWaveK(0.20)
+        this.setWaveDamp(0.985)
+        this.setRenderGain(2.3)
+        this.dropStrength = 1.0
+        this.dropRadius = 2
+    }
+
+    // ─── Parameters (WaterSimulation-compatible) ─────────────────────────────
+
+    setWaveK(val) {
+        this.waveK = toQ16(val)
+        this.idle = false
+    }
+    setWaveDamp(val) {
+        this.waveDamp = toQ16(val)
+        this.idle = false
+    }
+    setRenderGain(val) { this.renderGain = toQ16(val) }
+    setDropStrength(val) { this.dropStrength = quantizeStrength(val) }
+    setDropRadius(val) { this.dropRadius = clamp(Math.round(val), 1, 5) }
+
+    getWaveK() { return this.waveK / ONE }
+    getWaveDamp() { return this.waveDamp / ONE }
+    getRenderGain() { return this.renderGain / ONE }
+    getDropStrength() { return this.dropStrength }
+    getDropRadius() { return this.dropRadius }
+}
+
+// ─── LockstepSchedule ────────────────────────────────────────────────────────
+
+/** A stamped reset of both layers: where a client joins (or rejoins) the log */
+export function isSyncPoint(msg) {
+    return msg.type === 'reset' && msg.layer === undefined
+}
+
+export class LockstepSchedule {
+    constructor() {
+        this.reset()
+    }
+
+    /** @returns {boolean} every event received has been applied */
+    isDrained() {
+        return this.events.length === 0
+    }
+
+    /** Leave the log (disconnected); wait for the next sync point. */
+    reset() {
+        this.synced = false
+        this.tick = 0        // next tick to simulate
+        this.horizon = -1    // last tick the server vouched for
+        this.events = []
+        this.lateEvents = 0
+    }
+
+    /**
+     * Take a stamped event or a `tick` beat from the server.
+     * @returns {boolean} true if msg is a sync point: both layers restart
+     *          from flat water and default parameters at msg.tick
+     */
+    receive(msg) {
+        if (msg.type === 'tick') {
+            this.horizon = msg.tick
+            return false
+        }
+        const sync = isSyncPoint(msg)
+        if (sync) {
+            this.horizon = msg.tick - 1
+            if (!this.synced) {
+                this.synced = true
+                this.tick = msg.tick
+            }
+        }
+        if (this.synced) {
+            this.events.push(msg)
+        }
+        return sync
+    }
+
+    /**
+     * Run the ticks that are due, up to the horizon.
+     * @param {number} due     - ticks the frame clock paid out (FixedTimestep.due())
+     * @param {function} apply - called with each event right before its tick
+     * @param {function} step  - called once per tick
+     * @param {function} idle  - true while both layers are idle
+     * @returns {number} ticks stepped
+     */
+    advance(due, apply, step, idle) {
+        if (!this.synced) return 0
+
+        if (due > 0 && this.horizon + 1 - this.tick > LOCKSTEP_MAX_LAG) due++
+
+        let steps = 0
+        for (; steps < due; steps++) {
+            if (idle()) {
+                // Nothing moves until the next event: skip to it (or the horizon)
+                const next = this.events.length ? Math.min(this.events[0].tick, this.horizon + 1) : this.horizon + 1
+                if (next > this.tick) this.tick = next
+            }
+            // A sync point applies at once: the water restarts there anyway
+            while (this.events.length && (isSyncPoint(this.events[0]) || this.events[0].tick <= this.tick)) {
+                const e = this.events.shift()
+                if (isSyncPoint(e)) {
+                    this.tick = e.tick
+                } else if (e.tick !== this.tick) {
+                    this.lateEvents++
+                }
+                apply(e)
+            }
+            if (this.horizon + 1 - this.tick <= 0) {
+                break   // stalled: the unused ticks are not banked
+            }
+            step()
+            this.tick++
+        }
+        return steps
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * Preview frame handoff — simulation worker → page.
+ *
+ * The worker composites each frame (32×32 RGBA) straight into a frame
+ * slot; the page copies the latest one into its canvas on its next
+ * animation frame. No frame-sized buffer is allocated per frame either way:
+ *
+ *   - Cross-origin isolated (the server sends COOP/COEP): one
+ *     SharedArrayBuffer, written in place under a sequence lock (odd
+ *     while the worker writes). A read that overlaps a write is retried
+ *     on the next animation frame.
+ *   - Otherwise: two ArrayBuffers ping-pong by transfer. The worker writes
+ *     into whichever it holds, posts it, and gets it back once painted; a
+ *     frame finished while the page holds both is only sent to the matrix.
+ */
+
+export const PREVIEW_BYTES = 32 * 32 * 4
+
+const HEADER_BYTES = 8 // Int32 sequence, padded
+
+/** @returns {boolean} SharedArrayBuffer can be posted to a worker here */
+export function canShareFrames() {
+    return typeof SharedArrayBuffer !== 'undefined' && globalThis.crossOriginIsolated === true
+}
+
+// ─── Worker side ─────────────────────────────────────────────────────────────
+
+export class FrameWriter {
+    /**
+     * @param {(msg: object, transfer?: Transferable[]) => void} post
+     *        postMessage to the page
+     * @param {boolean} shared - use a SharedArrayBuffer (canShareFrames())
+     */
+    constructor(post, shared) {
+        this.post = post
+        this.scratch = new Uint8ClampedArray(PREVIEW_BYTES) // while the page holds every slot
+        if (shared) {
+            this.buffer = new SharedArrayBuffer(HEADER_BYTES + PREVIEW_BYTES)
+            this.sequence = new Int32Array(this.buffer, 0, 1)
+            this.pixels = new Uint8ClampedArray(this.buffer, HEADER_BYTES, PREVIEW_BYTES)
+            post({ type: 'frame-shared', buffer: this.buffer })
+        } else {
+            this.buffer = null
+            this.spare = [new ArrayBuffer(PREVIEW_BYTES), new ArrayBuffer(PREVIEW_BYTES)]
+            this.pixels = null
+        }
+    }
+
+    /** @returns {Uint8ClampedArray} where to composite the next frame */
+    begin() {
+        if (this.buffer) {
+            Atomics.add(this.sequence, 0, 1)
+            return this.pixels
+        }
+        this.pixels = this.spare.length ? new Uint8ClampedArray(this.spare.pop()) : null
+        return this.pixels ?? this.scratch
+    }
+
+    /** Publish the frame written since begin(). */
+    end() {
+        if (this.buffer) {
+            Atomics.add(this.sequence, 0, 1)
+        } else if (this.pixels) {
+            this.post({ type: 'frame', buffer: this.pixels.buffer }, [this.pixels.buffer])
+            this.pixels = null
+        }
+    }
+
+    /** A transferred slot came back from the page. */
+    recycle(buffer) {
+        this.spare.push(buffer)
+    }
+}
+
+// ─── Page side ───────────────────────────────────────────────────────────────
+
+export class FrameReader {
+    constructor() {
+        this.sequence = null
+        this.pixels = null
+        this.lastSequence = 0
+    }
+
+    /** The worker's 'frame-shared' message. */
+    attach(buffer) {
+        this.sequence = new Int32Array(buffer, 0, 1)
+        this.pixels = new Uint8ClampedArray(buffer, HEADER_BYTES, PREVIEW_BYTES)
+        this.lastSequence = 0
+    }
+
+    /**
+     * Copy the latest complete shared frame into dest.
+     * @param {Uint8ClampedArray} dest - e.g. an ImageData's data
+     * @returns {boolean} false if there was no new frame (or it was mid-write)
+     */
+    read(dest) {
+        if (!this.sequence) return false
+        const before = Atomics.load(this.sequence, 0)
+        if ((before & 1) || before === this.lastSequence) return false
+        dest.set(this.pixels)
+        if (Atomics.load(this.sequence, 0) !== before) return false
+        this.lastSequence = before
+        return true
+    }
+}
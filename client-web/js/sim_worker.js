@@ -0,0 +1,439 @@
+/**
+ * Simulation worker — water, compositing and the WebSocket, off the page's
+ * main thread.
+ *
+ * Loop: (every tick) simulate → render → send
+ *
+ * The page keeps hand detection (MediaPipe) and the preview canvas; a slow
+ * detectForVideo() there no longer costs simulation ticks or delays a send.
+ * The worker wakes every LOCKSTEP_TICK_MS and runs the ticks that came due
+ * (timestep.js), so frames go out every SEND_EVERY_TICKS ticks whatever the
+ * page is doing. Each composited frame is published to the page through
+ * shared_frame.js. On a slow uplink wss.js sends fewer (always the newest)
+ * and the log reports the rate every SIM_STATS_INTERVAL.
+ *
+ * Once the server's lockstep log is joined (lockstep.js), both layers run
+ * on the deterministic Q16 twin of the matrix firmware: taps are only sent,
+ * and every phone and matrix applies them at the tick the server stamped,
+ * so they all show the same water. Offline, the float simulation runs and
+ * taps apply at once.
+ *
+ * Where the WebAssembly core loads (water_core.js), the lockstep layers
+ * and their compositing run on it: the firmware's own C++, SIMD128 build.
+ * lockstep.js stands in until it has loaded, or if it can't.
+ *
+ * Page → worker messages:
+ *   { type: 'connect', url, pair }  → replies { type: 'connect-result', ok }
+ *   { type: 'disconnect' }
+ *   { type: 'drop', x, y }          a tap, in matrix coordinates
+ *   { type: 'tint', r, g, b }       our water colour
+ *   { type: 'setting', name, value } dropStrength | dropRadius | waveDamp | renderGain
+ *   { type: 'reset' }
+ *   { type: 'test' }                send a solid cyan frame
+ *   { type: 'frame', buffer }       a preview slot handed back (no SharedArrayBuffer)
+ *
+ * Worker → page messages:
+ *   { type: 'log', message }
+ *   { type: 'connection', connected, matrix }   matrix: null until a status arrives
+ *   { type: 'frame-shared', buffer } / { type: 'frame', buffer }  (shared_frame.js)
+ */
+
+import { connect, disconnect, isConnected, sendImageData, getFrameBuffer, sendFrame, getSendStats, setOnStatusChange, setOnError, setOnDrop, setOnLockstep, sendDrop, sendTint, sendParams, sendReset, sendHold, sendLockstepHold } from './wss.js'
+import { WaterSimulation, composeFrame } from './water.js'
+import { LockstepWater, LockstepSchedule, LOCKSTEP_TICK_MS, isSyncPoint, quantizeStrength, quantizeParam } from './lockstep.js'
+import { FixedTimestep } from './timestep.js'
+import { FrameWriter, canShareFrames } from './shared_frame.js'
+import { loadWaterCore } from './water_core.js'
+
+const MATRIX_SIZE = 32
+
+// ─── State ───────────────────────────────────────────────────────────────────
+
+let localTint = { r: 60, g: 150, b: 255 }
+let remoteTint = { r: 255, g: 100, b: 100 } // Default remote color until updated
+let ticksSinceSend = 0
+let matrixRendersLocally = false // matrix runs its own simulation, only needs events
+let lastTintSent = null
+let lastTintSendTime = 0
+let holding = false // the water is flat and its last frame still stands
+let lockstepHeld = false // the server knows our lockstep water is flat
+
+const TINT_SEND_INTERVAL = 100 // ms, throttle for open-hand color sweeps
+const SIM_TICK_HZ = 1000 / LOCKSTEP_TICK_MS // 62.5, the matrices' rate too
+const SIM_MAX_CATCH_UP = 4     // ticks per wake-up after a stall; the rest are dropped
+const SIM_STATS_INTERVAL = 10000 // ms between ticks/s reports
+const SEND_EVERY_TICKS = 2     // frames to a streaming matrix: 31.25 FPS at most (frame_pacer.js)
+
+const simClock = new FixedTimestep({ hz: SIM_TICK_HZ, maxCatchUp: SIM_MAX_CATCH_UP })
+let simStats = { ms: null, ticks: 0, dropped: 0 }
+let sendStats = { ms: null, frames: 0, coalesced: 0, bytes: 0 }
+
+// Instantiate TWO simulations:
+// 1. localWater: driven by THIS user's hand
+// 2. remoteWater: driven by OTHER user's drops via WSS
+const localWater = new WaterSimulation()
+const remoteWater = new WaterSimulation()
+
+// The same two layers in lockstep with everyone else (while connected),
+// on the WebAssembly core once it has loaded
+let lockLocal = new LockstepWater()
+let lockRemote = new LockstepWater()
+let core = null
+let pendingCore = null // loaded while in the log: taken at the next sync point
+const schedule = new LockstepSchedule()
+const SIM_LAYERS = [localWater, remoteWater]
+const LOCK_LAYERS = [lockLocal, lockRemote]
+
+// Frame buffers, reused every frame: nothing is allocated in the loop
+const frame565 = getFrameBuffer()
+const preview = new FrameWriter((msg, transfer) => self.postMessage(msg, transfer), canShareFrames())
+
+// ─── Page ────────────────────────────────────────────────────────────────────
+
+function log(message) {
+    self.postMessage({ type: 'log', message })
+}
+
+self.onmessage = async ({ data: msg }) => {
+    if (msg.type === 'frame') {
+        preview.recycle(msg.buffer)
+    } else if (msg.type === 'drop') {
+        drop(msg.x, msg.y)
+    } else if (msg.type === 'tint') {
+        localTint = { r: msg.r, g: msg.g, b: msg.b }
+    } else if (msg.type === 'setting') {
+        applySetting(msg.name, msg.value)
+    } else if (msg.type === 'reset') {
+        localWater.reset()
+        remoteWater.reset()
+        // Lockstep: resets our layer everywhere, when the server echoes it back
+        if (sendingEvents()) sendReset()
+    } else if (msg.type === 'test') {
+        sendTestFrame()
+    } else if (msg.type === 'connect') {
+        const ok = await connect(msg.url, msg.pair)
+        self.postMessage({ type: 'connect-result', ok })
+    } else if (msg.type === 'disconnect') {
+        disconnect()
+        self.postMessage({ type: 'connection', connected: false, matrix: false })
+    }
+}
+
+// ─── WSS Status Callbacks ────────────────────────────────────────────────────
+
+setOnStatusChange((connected, statusMsg) => {
+    holding = false // whoever is (re)connecting needs a frame
+    lockstepHeld = false
+    if (!connected && schedule.synced) {
+        schedule.reset()
+        log('Left the lockstep water — simulating locally.')
+    }
+
+    let matrix = null
+    if (statusMsg && statusMsg.type === 'status') {
+        matrix = !!statusMsg.matrix
+
+        const local = statusMsg.matrix && statusMsg.matrixRender === 'local'
+        if (local !== matrixRendersLocally) {
+            matrixRendersLocally = local
+            log(local ? 'Matrix renders water locally — sending events only.' : 'Matrix expects frames.')
+            if (local) {
+                sendLook()
+            }
+        }
+    }
+    self.postMessage({ type: 'connection', connected, matrix })
+})
+
+setOnError((message) => {
+    log('WSS error: ' + message)
+})
+
+setOnDrop((x, y, strength, radius, r, g, b) => {
+    // Received a drop from the other user!
+    // Update remote tint if color data is present
+    if (r !== undefined && g !== undefined && b !== undefined) {
+        remoteTint = { r, g, b }
+    }
+
+    // Trigger drop in the remote simulation layer
+    remoteWater.dropAt(x, y, { strength, radius })
+})
+
+setOnLockstep((msg) => {
+    const wasSynced = schedule.synced
+    if (schedule.receive(msg)) {
+        if (!wasSynced) log(`Joined the lockstep water at tick ${msg.tick}.`)
+        // Everyone restarts from default parameters: put ours back on our layer
+        sendLook()
+    }
+})
+
+// ─── Lockstep ────────────────────────────────────────────────────────────────
+
+/** Move the lockstep layers onto the WebAssembly core (they restart flat). */
+function useCore(loaded) {
+    core = loaded
+    pendingCore = null
+    lockLocal = LOCK_LAYERS[0] = core.layer(0)
+    lockRemote = LOCK_LAYERS[1] = core.layer(1)
+}
+
+loadWaterCore().then((loaded) => {
+    if (!loaded) {
+        log('WebAssembly core unavailable — lockstep water runs in JS.')
+        return
+    }
+    // Mid-log the JS layers hold state the core doesn't: switch when everyone restarts
+    if (schedule.synced) pendingCore = loaded
+    else useCore(loaded)
+    log('WebAssembly water core loaded (SIMD128).')
+})
+
+/** Apply a stamped event right before its tick (LockstepSchedule.advance). */
+function applyLockstepEvent(e) {
+    lockstepHeld = false
+    if (isSyncPoint(e)) {
+        if (pendingCore) useCore(pendingCore)
+        lockLocal.reset()
+        lockLocal.resetParameters()
+        lockRemote.reset()
+        lockRemote.resetParameters()
+        return
+    }
+
+    const remote = e.layer === 'remote'
+    const water = remote ? lockRemote : lockLocal
+    const hasTint = e.r !== undefined && e.g !== undefined && e.b !== undefined
+
+    if ((e.type === 'drop' || e.type === 'tint') && remote && hasTint) {
+        remoteTint = { r: e.r, g: e.g, b: e.b }
+    }
+    if (e.type === 'drop') {
+        water.applyDrop(e)
+    } else if (e.type === 'params') {
+        water.setWaveDamp(e.waveDamp)
+        water.setRenderGain(e.renderGain)
+    } else if (e.type === 'reset') {
+        water.reset()
+    }
+}
+
+function stepLockstep() {
+    lockLocal.step()
+    lockRemote.step()
+}
+
+function lockstepIdle() {
+    return lockLocal.isIdle() && lockRemote.isIdle()
+}
+
+/** Once the lockstep water is flat with every event applied, say so (once). */
+function reportLockstepHold() {
+    if (!lockstepIdle() || !schedule.isDrained()) {
+        lockstepHeld = false
+    } else if (!lockstepHeld) {
+        lockstepHeld = true
+        sendLockstepHold(schedule.tick)
+    }
+}
+
+// ─── Matrix Events ───────────────────────────────────────────────────────────
+
+/** Whether anyone else simulates the water from our events. */
+function sendingEvents() {
+    return matrixRendersLocally || schedule.synced
+}
+
+/** Send localTint to the matrix (and the lockstep log) if it changed (throttled). */
+function syncTint() {
+    if (!sendingEvents()) return
+
+    const now = performance.now()
+    const t = localTint
+    if (lastTintSent && lastTintSent.r === t.r && lastTintSent.g === t.g && lastTintSent.b === t.b) return
+    if (now - lastTintSendTime < TINT_SEND_INTERVAL) return
+
+    sendTint(t.r, t.g, t.b)
+    lastTintSent = { ...t }
+    lastTintSendTime = now
+}
+
+/** Bring everyone up to date with our current look. */
+function sendLook() {
+    lastTintSent = null
+    lastTintSendTime = 0
+    syncTint()
+    sendParams(quantizeParam(localWater.getWaveDamp()), quantizeParam(localWater.getRenderGain()))
+}
+
+/** A tap from the page's hand tracking. */
+function drop(x, y) {
+    const s = localWater.getDropStrength()
+    const r = localWater.getDropRadius()
+    if (schedule.synced) {
+        // Lockstep: applied when the server echoes it back stamped
+        sendDrop(Math.round(x), Math.round(y), quantizeStrength(s), r,
+            localTint.r, localTint.g, localTint.b)
+    } else {
+        // Trigger LOCAL drop
+        localWater.dropAt(x, y)
+
+        // Broadcast drop to remote (with our color)
+        sendDrop(x, y, s, r, localTint.r, localTint.g, localTint.b)
+    }
+}
+
+function applySetting(name, value) {
+    if (name === 'dropStrength') {
+        localWater.setDropStrength(value)
+        remoteWater.setDropStrength(value)
+    } else if (name === 'dropRadius') {
+        localWater.setDropRadius(value)
+        remoteWater.setDropRadius(value)
+    } else if (name === 'waveDamp') {
+        localWater.setWaveDamp(value)
+        remoteWater.setWaveDamp(value)
+        if (sendingEvents()) sendParams(quantizeParam(value), quantizeParam(localWater.getRenderGain()))
+    } else if (name === 'renderGain') {
+        localWater.setRenderGain(value)
+        remoteWater.setRenderGain(value)
+        if (sendingEvents()) sendParams(quantizeParam(localWater.getWaveDamp()), quantizeParam(value))
+    }
+}
+
+/** Send a solid cyan frame. */
+function sendTestFrame() {
+    if (!isConnected()) {
+        log('Connect WebSocket first.')
+        return
+    }
+    const testData = new ImageData(MATRIX_SIZE, MATRIX_SIZE)
+    for (let i = 0; i < testData.data.length; i += 4) {
+        testData.data[i + 0] = 0    // R
+        testData.data[i + 1] = 200  // G
+        testData.data[i + 2] = 255  // B
+        testData.data[i + 3] = 255  // A
+    }
+    sendImageData(testData)
+    log('Test frame sent (solid cyan).')
+}
+
+// ─── Main Loop ───────────────────────────────────────────────────────────────
+
+/** Report ticks/s and dropped ticks every SIM_STATS_INTERVAL. */
+function reportSimStats(now) {
+    if (simStats.ms === null) {
+        simStats = { ms: now, ...simClock.stats() }
+        return
+    }
+    if (now - simStats.ms < SIM_STATS_INTERVAL) return
+
+    const { ticks, dropped } = simClock.stats()
+    const rate = (ticks - simStats.ticks) * 1000 / (now - simStats.ms)
+    console.info(`[sim] ${rate.toFixed(1)} ticks/s, ${dropped - simStats.dropped} dropped`)
+    if (dropped > simStats.dropped) {
+        log(`Simulation fell behind: ${dropped - simStats.dropped} ticks dropped.`)
+    }
+    simStats = { ms: now, ticks, dropped }
+}
+
+/** Log the uplink's frame rate and backlog every SIM_STATS_INTERVAL while streaming. */
+function reportSendStats(now, streaming) {
+    if (sendStats.ms !== null && now - sendStats.ms < SIM_STATS_INTERVAL) return
+
+    const stats = getSendStats()
+    const frames = stats.frames - sendStats.frames
+    const coalesced = stats.coalesced - sendStats.coalesced
+    if (streaming && sendStats.ms !== null && frames + coalesced > 0) {
+        const seconds = (now - sendStats.ms) / 1000
+        log(`Uplink: ${(frames / seconds).toFixed(1)} fps (target ${stats.targetFps.toFixed(1)}), ` +
+            `${stats.queuedBytes} B queued, ${coalesced} frames coalesced, ` +
+            `${((stats.bytes - sendStats.bytes) / seconds / 1024).toFixed(1)} KiB/s`)
+    }
+    sendStats = { ms: now, frames: stats.frames, coalesced: stats.coalesced, bytes: stats.bytes }
+}
+
+// What a frame of flat water depends on besides the water itself
+const heldLook = new Float64Array(8)
+
+function holdLook(i, value) {
+    const changed = heldLook[i] !== value
+    heldLook[i] = value
+    return changed
+}
+
+/** Record the current look; true if it differs from the held frame's. */
+function lookChanged(layers) {
+    // | rather than ||: every slot gets recorded
+    return holdLook(0, localTint.r) | holdLook(1, localTint.g) | holdLook(2, localTint.b) |
+        holdLook(3, remoteTint.r) | holdLook(4, remoteTint.g) | holdLook(5, remoteTint.b) |
+        holdLook(6, layers[0].getRenderGain()) | holdLook(7, layers[1].getRenderGain())
+}
+
+function simLoop() {
+    const now = performance.now()
+
+    // 1. Advance simulations by the ticks that came due (lockstep: up to the horizon)
+    const due = simClock.due(now)
+    let layers = SIM_LAYERS
+    if (schedule.synced) {
+        schedule.advance(due, applyLockstepEvent, stepLockstep, lockstepIdle)
+        reportLockstepHold()
+        layers = LOCK_LAYERS
+    } else {
+        for (let i = 0; i < due; i++) {
+            localWater.step()
+            remoteWater.step()
+        }
+    }
+    ticksSinceSend += due
+    reportSimStats(now)
+    reportSendStats(now, isConnected() && !matrixRendersLocally)
+    if (isConnected()) {
+        syncTint()
+    }
+
+    // Nothing moved (woke early)
+    if (due === 0) return
+
+    // Both layers flat (idle) and the look unchanged: the last frame still stands
+    const idle = layers[0].isIdle() && layers[1].isIdle()
+    const changed = idle && lookChanged(layers)
+    if (idle && holding && !changed) return
+
+    // 2. Send to matrix via WSS, every SEND_EVERY_TICKS ticks
+    //    A matrix rendering locally only needs events (drops go out as they happen)
+    //    The flat frame goes out at once: it is the last one for a while
+    const streaming = isConnected() && !matrixRendersLocally
+    const sending = streaming && (idle || ticksSinceSend >= SEND_EVERY_TICKS)
+
+    // 3. Output Rendering, in one pass into the reused buffers:
+    //    Base color is localTint; remote waves push the color towards remoteTint.
+    //    The frame to send is rotated 90° CCW and packed as RGB565 on the way.
+    if (layers === LOCK_LAYERS && core) {
+        core.compose(localTint, remoteTint, preview.begin(), sending ? frame565 : null)
+    } else {
+        const shadeLocal = layers[0].getShadingMap()
+        const shadeRemote = layers[1].getShadingMap()
+        composeFrame(shadeLocal, shadeRemote, localTint, remoteTint, preview.begin(), sending ? frame565 : null)
+    }
+
+    // 4. Preview: the page paints it on its next animation frame
+    preview.end()
+
+    if (sending) {
+        sendFrame(now)
+        ticksSinceSend = 0
+    }
+    if (streaming && idle) {
+        sendHold()
+    }
+    if (idle && !holding) {
+        log('Water is flat — holding the last frame.')
+    }
+    holding = idle
+}
+
+setInterval(simLoop, LOCKSTEP_TICK_MS)
+log(`Simulation worker started (${canShareFrames() ? 'shared' : 'transferred'} preview frames).`)
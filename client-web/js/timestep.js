@@ -0,0 +1,58 @@
+/**
+ * Fixed-timestep accumulator — simulation ticks at a set rate, whatever
+ * rate requestAnimationFrame runs at.
+ *
+ * The frame loop calls due() once per frame and runs that many ticks:
+ * elapsed time is banked and paid out in whole ticks, so a 120 Hz phone
+ * simulates as fast (and as much) as a 60 Hz one. After a stall (tab in
+ * the background, slow frame) at most maxCatchUp ticks are paid out; the
+ * rest are dropped and counted.
+ *
+ * Same algorithm as client-matrix/src/fixed_timestep.h.
+ */
+
+export class FixedTimestep {
+    /**
+     * @param {{ hz?: number, maxCatchUp?: number }} [options]
+     *        hz: tick rate (default 62.5, one tick per 16 ms)
+     *        maxCatchUp: most ticks one due() call pays out
+     */
+    constructor({ hz = 62.5, maxCatchUp = 4 } = {}) {
+        this.tickMs = 1000 / hz
+        this.maxCatchUp = Math.max(1, maxCatchUp)
+        this.reset()
+    }
+
+    /** Restart the clock: the next due() pays out one tick. */
+    reset() {
+        this.lastMs = null
+        this.bankedMs = 0
+        this.ticks = 0     // paid out since reset()
+        this.dropped = 0   // not run: more than maxCatchUp were due at once
+    }
+
+    /**
+     * @param {number} nowMs - e.g. the rAF timestamp or performance.now()
+     * @returns {number} ticks to run now, at most maxCatchUp
+     */
+    due(nowMs) {
+        // First call: one tick now and half a tick in hand, so a loop that
+        // runs once per tick gets exactly one each time, not 0/2 on jitter
+        this.bankedMs += this.lastMs === null ? 1.5 * this.tickMs : nowMs - this.lastMs
+        this.lastMs = nowMs
+
+        let steps = Math.floor(this.bankedMs / this.tickMs)
+        this.bankedMs -= steps * this.tickMs
+        if (steps > this.maxCatchUp) {
+            this.dropped += steps - this.maxCatchUp
+            steps = this.maxCatchUp
+        }
+        this.ticks += steps
+        return steps
+    }
+
+    /** @returns {{ ticks: number, dropped: number }} totals since reset() */
+    stats() {
+        return { ticks: this.ticks, dropped: this.dropped }
+    }
+}
@@ -13,10 +13,16 @@
  * Rendering:
  *   - Per-pixel gradient (gx, gy) → directional shading.
  *   - Shade is multiplied by a user-chosen tint color.
+ *
+ * Idle:
+ *   - Each step measures the field energy (Σ v² + Σ |∇h|²). Below
+ *     IDLE_ENERGY the ripples are under half a colour step, the water is
+ *     idle and step() does nothing until the next drop.
  */
 
 const SIZE = 32
 const N = SIZE * SIZE
+const IDLE_ENERGY = 64 / 4294967296 // WAVE_IDLE_ENERGY_Q32 in wave_kernel.h
 
 // ─── Helpers ─────────────────────────────────────────────────────────────────
 
@@ -38,11 +44,105 @@ function idx(x, y) {
     return y * SIZE + x
 }
 
+// ─── Dual-layer compositing ──────────────────────────────────────────────────
+
+/** Brightness boost factor to make colors pop */
+export const BRIGHTNESS_BOOST = 2.0
+
+/**
+ * Compose a local and a remote shading map into an RGBA buffer.
+ *
+ * Base color is localTint; remote waves push the color towards remoteTint.
+ * The matrix firmware (client-matrix/src/water_renderer.cpp) implements
+ * the same formula when it renders the water itself.
+ *
+ * @param {Float32Array} shadeLocal  - Local shading map (0.0 - 1.0)
+ * @param {Float32Array} shadeRemote - Remote shading map (0.0 - 1.0)
+ * @param {{ r: number, g: number, b: number }} localTint
+ * @param {{ r: number, g: number, b: number }} remoteTint
+ * @param {Uint8ClampedArray} data   - 32x32 RGBA output
+ */
+export function composeShading(shadeLocal, shadeRemote, localTint, remoteTint, data) {
+    composeFrame(shadeLocal, shadeRemote, localTint, remoteTint, data, null)
+}
+
+/**
+ * composeShading() fused with what the matrix needs: the same pass also
+ * rotates the pixel 90° CCW ((x, y) → (y, 31 − x)) and packs it as RGB565
+ * into frame565. Both buffers belong to the caller, so a frame costs no
+ * allocation at all.
+ *
+ * @param {Float32Array} shadeLocal  - Local shading map (0.0 - 1.0)
+ * @param {Float32Array} shadeRemote - Remote shading map (0.0 - 1.0)
+ * @param {{ r: number, g: number, b: number }} localTint
+ * @param {{ r: number, g: number, b: number }} remoteTint
+ * @param {Uint8ClampedArray} data   - 32x32 RGBA output (preview orientation)
+ * @param {Uint8Array|null} frame565 - 2048-byte big-endian RGB565 output
+ *                                     (panel orientation), or null
+ */
+export function composeFrame(shadeLocal, shadeRemote, localTint, remoteTint, data, frame565) {
+    for (let i = 0, x = 0, y = 0; i < N; i++) {
+        // Shading values are 0.0 - 1.0 (0.5 is flat water)
+        const s1 = shadeLocal[i]
+        const s2 = shadeRemote[i]
+
+        // Superposition of wave slopes (approximate)
+        // flat + (slope1 + slope2)
+        // s1 = 0.5 + slope1  -> slope1 = s1 - 0.5
+        // total = 0.5 + (s1 - 0.5) + (s2 - 0.5)
+        let totalShade = s1 + s2 - 0.5
+
+        // Clamp shade
+        if (totalShade < 0) totalShade = 0
+        if (totalShade > 1) totalShade = 1
+
+        // Calculate how much "remote activity" is here
+        // We use deviation from 0.5 as a proxy for wave height/slope
+        const remoteActivity = Math.abs(s2 - 0.5)
+
+        // Gain up the activity to make color shift more visible even for small ripples
+        // 4.0 is a magic number: higher = more sensitive color shift
+        let mixFactor = remoteActivity * 4.0
+        if (mixFactor > 1.0) mixFactor = 1.0
+
+        // Lerp color: local -> remote based on mixFactor
+        const r = localTint.r * (1 - mixFactor) + remoteTint.r * mixFactor
+        const g = localTint.g * (1 - mixFactor) + remoteTint.g * mixFactor
+        const b = localTint.b * (1 - mixFactor) + remoteTint.b * mixFactor
+
+        // Apply directional shading to the composed color AND boost brightness
+        const offset = i * 4
+
+        // Note: we can go above 255 before clamping if we want "HDR" highlights
+        const rFinal = r * totalShade * BRIGHTNESS_BOOST
+        const gFinal = g * totalShade * BRIGHTNESS_BOOST
+        const bFinal = b * totalShade * BRIGHTNESS_BOOST
+
+        data[offset + 0] = rFinal > 255 ? 255 : rFinal
+        data[offset + 1] = gFinal > 255 ? 255 : gFinal
+        data[offset + 2] = bFinal > 255 ? 255 : bFinal
+        data[offset + 3] = 255
+
+        if (frame565) {
+            // Read back the clamped-and-rounded bytes, exactly what the preview shows
+            const rgb16 = ((data[offset] >> 3) << 11) | ((data[offset + 1] >> 2) << 5) | (data[offset + 2] >> 3)
+            const out = ((SIZE - 1 - x) * SIZE + y) * 2
+            frame565[out] = rgb16 >> 8
+            frame565[out + 1] = rgb16 & 0xFF
+        }
+        if (++x === SIZE) {
+            x = 0
+            y++
+        }
+    }
+}
+
 export class WaterSimulation {
     constructor() {
         // ─── Simulation fields ───────────────────────────────────────────────────────
         this.h = new Float32Array(N) // height field
         this.v = new Float32Array(N) // velocity field
+        this.shade = new Float32Array(N) // getShadingMap() output, reused
 
         // ─── Tuneable parameters (with sensible defaults) ────────────────────────────
         this.waveK = 0.20     // wave propagation speed
@@ -51,6 +151,11 @@ export class WaterSimulation {
         this.dropStrength = 1.0 // default drop energy
         this.dropRadius = 2    // default drop radius (px)
         this.dropBurst = 1     // number of jittered sub-drops per trigger
+
+        // ─── Idle tracking ──────────────────────────────────────────────────────────
+        this.energy = 0        // Σ v² + Σ |∇h|² after the last step
+        this.stillVelocity = true // v ≡ 0 after the last step
+        this.idle = true       // flat: step() is a no-op until the next drop
     }
 
     // ─── Public API ──────────────────────────────────────────────────────────────
@@ -90,39 +195,70 @@ export class WaterSimulation {
                 }
             }
         }
+        this.stillVelocity = false
+        this.idle = false
     }
 
     /**
-     * Advance the simulation by one time step.
-     * Call once per animation frame.
+     * Advance the simulation by one time step (nothing while idle).
+     * Call once per simulation tick.
      */
     step() {
+        if (this.idle) return
+
+        const h = this.h
+        const v = this.v
+        let kinetic = 0
+        let still = true
+
         // Laplacian → velocity
         for (let x = 1; x < SIZE - 1; x++) {
             for (let y = 1; y < SIZE - 1; y++) {
                 const i = idx(x, y)
-                const lap = this.h[idx(x - 1, y)] + this.h[idx(x + 1, y)] +
-                    this.h[idx(x, y - 1)] + this.h[idx(x, y + 1)] -
-                    4.0 * this.h[i]
-                this.v[i] = (this.v[i] + this.waveK * lap) * this.waveDamp
+                const lap = h[idx(x - 1, y)] + h[idx(x + 1, y)] +
+                    h[idx(x, y - 1)] + h[idx(x, y + 1)] -
+                    4.0 * h[i]
+                v[i] = (v[i] + this.waveK * lap) * this.waveDamp
+                kinetic += v[i] * v[i]
+                still = still && v[i] === 0
             }
         }
 
-        // Velocity → height
+        // Velocity → height; the borders stay 0, so every interior edge counts
+        let potential = 0
         for (let x = 1; x < SIZE - 1; x++) {
             for (let y = 1; y < SIZE - 1; y++) {
                 const i = idx(x, y)
-                this.h[i] += this.v[i]
+                h[i] += v[i]
+                const dx = h[i] - h[idx(x - 1, y)]
+                const dy = h[i] - h[idx(x, y - 1)]
+                potential += dx * dx + dy * dy
+                if (x === SIZE - 2) potential += h[i] * h[i]
+                if (y === SIZE - 2) potential += h[i] * h[i]
             }
         }
+
+        this.energy = kinetic + potential
+        this.idle = this.energy < IDLE_ENERGY || (still && this.stillVelocity)
+        this.stillVelocity = still
+    }
+
+    /** @returns {boolean} flat water: step() is a no-op until the next drop */
+    isIdle() {
+        return this.idle
+    }
+
+    /** @returns {number} field energy after the last step */
+    getEnergy() {
+        return this.energy
     }
 
     /**
      * Get the shading map for the current state (values 0.0 - 1.0).
-     * @returns {Float32Array} 32x32 shading values
+     * @returns {Float32Array} 32x32 shading values, reused between calls
      */
     getShadingMap() {
-        const map = new Float32Array(N)
+        const map = this.shade
         for (let y = 0; y < SIZE; y++) {
             for (let x = 0; x < SIZE; x++) {
                 const xm = x > 0 ? x - 1 : x
@@ -182,12 +318,22 @@ export class WaterSimulation {
     reset() {
         this.h.fill(0)
         this.v.fill(0)
+        this.energy = 0
+        this.stillVelocity = true
+        this.idle = true
     }
 
     // ─── Parameter setters ──────────────────────────────────────────────────────
 
-    setWaveK(val) { this.waveK = val }
-    setWaveDamp(val) { this.waveDamp = val }
+    // waveK / waveDamp change the dynamics: a frozen fixed point may move again
+    setWaveK(val) {
+        this.waveK = val
+        this.idle = false
+    }
+    setWaveDamp(val) {
+        this.waveDamp = val
+        this.idle = false
+    }
     setRenderGain(val) { this.renderGain = val }
     setDropStrength(val) { this.dropStrength = val }
     setDropRadius(val) { this.dropRadius = clamp(Math.round(val), 1, 5) }
@@ -0,0 +1,181 @@
+/**
+ * WebAssembly water core — the matrix firmware's lockstep water and
+ * compositor (client-matrix/wasm/water_core.cpp), built with SIMD128.
+ *
+ * One C++ implementation steps, shades and composites on the matrices and
+ * on the phones: a WaterCore layer is a drop-in for LockstepWater (same
+ * fields, same checksums), and compose() is the matrix's renderWater()
+ * plus the phone's rotate + RGB565 pack, in one pass.
+ *
+ * Build it with client-matrix/wasm/build.sh (wasi-sdk); the .wasm is not
+ * committed, so until it is built and served every browser takes the
+ * fallback. Where it is missing or the browser has no SIMD128,
+ * loadWaterCore() resolves to null and the callers stay on lockstep.js /
+ * water.js, which compute the same water. The C++ behind it is checked
+ * natively against lockstep.js by `program lockstep`.
+ */
+
+import { lockstepDropFields, quantizeStrength, quantizeParam } from './lockstep.js'
+
+const SIZE = 32
+const N = SIZE * SIZE
+const ONE = 65536
+
+const CORE_URL = new URL('../wasm/water_core.wasm', import.meta.url)
+
+// (module (func (result v128) i32.const 0 i8x16.splat i8x16.popcnt))
+const SIMD_PROBE = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0,
+    10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+])
+
+function clamp(x, lo, hi) {
+    return x < lo ? lo : x > hi ? hi : x
+}
+
+/** @returns {boolean} this engine runs SIMD128 modules */
+export function hasWasmSimd() {
+    return typeof WebAssembly === 'object' && WebAssembly.validate(SIMD_PROBE)
+}
+
+/**
+ * Fetch and instantiate the core.
+ * @param {URL|string} [url]
+ * @returns {Promise<WaterCore|null>} null if unsupported or not built
+ */
+export async function loadWaterCore(url = CORE_URL) {
+    if (!hasWasmSimd()) return null
+    try {
+        const response = await fetch(url)
+        if (!response.ok) return null
+        // A WASI reactor that never does I/O: any libc import it still
+        // references only has to exist, and fails with ENOSYS (52)
+        const wasi = new Proxy({}, { get: () => () => 52 })
+        const { instance } = await WebAssembly.instantiate(await response.arrayBuffer(),
+            { wasi_snapshot_preview1: wasi })
+        instance.exports._initialize?.()
+        return new WaterCore(instance.exports)
+    } catch {
+        return null
+    }
+}
+
+// ─── WaterCore ───────────────────────────────────────────────────────────────
+
+export class WaterCore {
+    constructor(exports) {
+        this.exports = exports
+        // Static buffers; the core never grows its memory, so the views last
+        const memory = exports.memory.buffer
+        this.preview = new Uint8ClampedArray(memory, exports.water_preview(), N * 4)
+        this.frame565 = new Uint8Array(memory, exports.water_frame565(), N * 2)
+        this.layers = [new CoreLayer(exports, 0), new CoreLayer(exports, 1)]
+    }
+
+    /** @param {number} i - 0: local, 1: remote */
+    layer(i) {
+        return this.layers[i]
+    }
+
+    /**
+     * Shade both layers and composite them, as composeFrame() does.
+     * @param {{ r: number, g: number, b: number }} localTint
+     * @param {{ r: number, g: number, b: number }} remoteTint
+     * @param {Uint8ClampedArray} data - 32×32 RGBA preview, unrotated
+     * @param {Uint8Array|null} frame565 - rotated big-endian RGB565, or null
+     */
+    compose(localTint, remoteTint, data, frame565) {
+        this.exports.water_compose(localTint.r, localTint.g, localTint.b,
+            remoteTint.r, remoteTint.g, remoteTint.b, frame565 ? 1 : 0)
+        data.set(this.preview)
+        if (frame565) frame565.set(this.frame565)
+    }
+}
+
+/** One layer of the core, with LockstepWater's API. */
+class CoreLayer {
+    constructor(exports, index) {
+        this.exports = exports
+        this.index = index
+        this.shade = new Int32Array(exports.memory.buffer, exports.water_shade(index), N)
+        this.shadeFloat = new Float32Array(N)
+        this.resetParameters()
+        this.reset()
+    }
+
+    /** Inject a stamped drop (call before stepping drop.tick). */
+    applyDrop(drop) {
+        const { x, y, radius, burst, strength } = lockstepDropFields(drop)
+        this.exports.water_drop(this.index, drop.tick >>> 0, x, y, radius, burst, strength)
+    }
+
+    /** Advance one tick (nothing while idle). */
+    step() {
+        this.exports.water_step(this.index)
+    }
+
+    isIdle() {
+        return this.exports.water_idle(this.index) !== 0
+    }
+
+    getEnergy() {
+        return this.exports.water_energy(this.index)
+    }
+
+    /** @returns {Int32Array} Q16 shading, a view on the core's memory */
+    getShadingMapQ16() {
+        this.exports.water_shade(this.index)
+        return this.shade
+    }
+
+    /** @returns {Float32Array} reused between calls */
+    getShadingMap() {
+        const q = this.getShadingMapQ16()
+        const map = this.shadeFloat
+        for (let i = 0; i < N; i++) {
+            map[i] = q[i] / ONE
+        }
+        return map
+    }
+
+    checksum() {
+        return this.exports.water_checksum(this.index) >>> 0
+    }
+
+    reset() {
+        this.exports.water_reset(this.index)
+    }
+
+    resetParameters() {
+        this.exports.water_reset_parameters(this.index)
+        this.waveK = quantizeParam(0.20)
+        this.waveDamp = quantizeParam(0.985)
+        this.renderGain = quantizeParam(2.3)
+        this.dropStrength = 1.0
+        this.dropRadius = 2
+    }
+
+    // ─── Parameters (WaterSimulation-compatible) ─────────────────────────────
+
+    // Math.fround: the core takes floats, and rounds them to Q16 as toQ16() does
+    setWaveK(val) {
+        this.exports.water_set_wave_k(this.index, Math.fround(val))
+        this.waveK = quantizeParam(val)
+    }
+    setWaveDamp(val) {
+        this.exports.water_set_wave_damp(this.index, Math.fround(val))
+        this.waveDamp = quantizeParam(val)
+    }
+    setRenderGain(val) {
+        this.exports.water_set_render_gain(this.index, Math.fround(val))
+        this.renderGain = quantizeParam(val)
+    }
+    setDropStrength(val) { this.dropStrength = quantizeStrength(val) }
+    setDropRadius(val) { this.dropRadius = clamp(Math.round(val), 1, 5) }
+
+    getWaveK() { return this.waveK }
+    getWaveDamp() { return this.waveDamp }
+    getRenderGain() { return this.renderGain }
+    getDropStrength() { return this.dropStrength }
+    getDropRadius() { return this.dropRadius }
+}
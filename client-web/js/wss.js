@@ -9,8 +9,35 @@
  *   disconnect()
  *   isConnected() → boolean
  *   sendImageData(imageData)
+ *
+ * Per-frame path without allocation: render straight into
+ * getFrameBuffer() (water.js composeFrame()), then sendFrame().
+ *
+ * Frames are paced against the socket's bufferedAmount (frame_pacer.js):
+ * while earlier frames are still queued, a new one waits in the frame
+ * buffer and the next render replaces it, so a slow uplink drops frames
+ * instead of piling up latency. getSendStats() reports the rate.
+ *
+ * Events for a matrix that renders the water itself:
+ *   sendDrop(), sendTint(), sendParams(), sendReset()
+ *
+ * Frames go out as tile deltas (see frame_codec.js) when the paired matrix
+ * advertises "tiles565", otherwise as bare RGB565. With "pal565", frames
+ * (or keyframes) of up to 256 colours are sent palette-indexed. A matrix
+ * that asks for "frameHeader": 1 gets a sequence number and capture time
+ * on every frame, so it can drop late ones.
+ *
+ * The phone joins the server's lockstep log: every phone's events come back
+ * stamped with a simulation tick (sendDrop() included, for the sender's own
+ * layer), along with `tick` beats; they go to setOnLockstep() for
+ * lockstep.js to schedule. Unstamped drops still go to setOnDrop().
+ * sendLockstepHold() tells the server the lockstep water has gone flat, so
+ * it can pause the beats.
  */
 
+import { TileDeltaEncoder, encodePalette565, wrapFrame, FRAME_HEADER_SIZE } from './frame_codec.js'
+import { FramePacer } from './frame_pacer.js'
+
 const TOTAL_WIDTH = 32
 const TOTAL_HEIGHT = 32
 const COLOR_DEPTH = 16 // 16-bit RGB565
@@ -19,13 +46,30 @@ const COLOR_DEPTH = 16 // 16-bit RGB565
 const NUM_PIXELS = TOTAL_WIDTH * TOTAL_HEIGHT
 const PIXEL_BUFFER = new Uint8Array(NUM_PIXELS * (COLOR_DEPTH / 8))
 
+const PALETTE_BUFFER = new Uint8Array(2 + 256 * 2 + NUM_PIXELS)
+const HEADER_BUFFER = new Uint8Array(FRAME_HEADER_SIZE + 1 + PIXEL_BUFFER.length)
+
+let deltaEncoder = new TileDeltaEncoder()
+
+const pacer = new FramePacer()
+const FLUSH_INTERVAL = 8 // ms between retries of a waiting frame
+let framePending = false
+let pendingCapture = 0
+let holdPending = false // the hold goes out after the flat frame it follows
+let flushTimer = null
+
 let socket = null
 let connected = false
+let useTileDeltas = false
+let usePalette = false
+let useFrameHeader = false
+let frameSequence = 0
 
 // Callbacks for external status updates
 let onStatusChange = null
 let onError = null
 let onDrop = null
+let onLockstep = null
 
 /**
  * Register a callback for connection status changes.
@@ -51,6 +95,14 @@ export function setOnDrop(cb) {
     onDrop = cb
 }
 
+/**
+ * Register a callback for tick-stamped events and horizon beats.
+ * @param {function} cb - Called with the message ({ type, tick, layer?, … })
+ */
+export function setOnLockstep(cb) {
+    onLockstep = cb
+}
+
 /**
  * Connect to the MissingDrop WSS bridge server.
  * @param {string} url - WebSocket URL (e.g. wss://my-app.onrender.com/ws)
@@ -62,13 +114,17 @@ export function connect(url, pair) {
         try {
             socket = new WebSocket(url)
             socket.binaryType = 'arraybuffer'
+            frameSequence = 0
+            dropPendingFrame()
+            pacer.reset(performance.now())
 
             socket.onopen = () => {
                 // Send join message
                 socket.send(JSON.stringify({
                     type: 'join',
                     role: 'phone',
-                    pair: pair
+                    pair: pair,
+                    lockstep: 1
                 }))
             }
 
@@ -84,6 +140,15 @@ export function connect(url, pair) {
 
                     if (msg.type === 'status') {
                         // Pair status update — matrix connected/disconnected
+                        // A (re)joined matrix has no image to apply deltas to
+                        const formats = msg.matrix ? (msg.matrixFormats ?? []) : []
+                        useTileDeltas = formats.includes('tiles565')
+                        usePalette = formats.includes('pal565')
+                        // The matrix restarts its sequence check on every status
+                        useFrameHeader = msg.matrix && msg.matrixFrameHeader === 1
+                        frameSequence = 0
+                        deltaEncoder = new TileDeltaEncoder({ palette: usePalette })
+                        dropPendingFrame()
                         onStatusChange?.(connected, msg)
                     }
 
@@ -96,7 +161,9 @@ export function connect(url, pair) {
                         onStatusChange?.(false)
                     }
 
-                    if (msg.type === 'drop') {
+                    if (typeof msg.tick === 'number') {
+                        onLockstep?.(msg)
+                    } else if (msg.type === 'drop') {
                         onDrop?.(msg.x, msg.y, msg.strength, msg.radius, msg.r, msg.g, msg.b)
                     }
                 }
@@ -125,6 +192,7 @@ export function connect(url, pair) {
  * Disconnect from the WebSocket server.
  */
 export function disconnect() {
+    dropPendingFrame()
     if (socket) {
         socket.close()
         socket = null
@@ -142,9 +210,11 @@ export function isConnected() {
 
 /**
  * Send an ImageData (32×32 RGBA) to the server as RGB565 binary.
+ * With tile deltas, an unchanged frame is not sent at all.
  * @param {ImageData} imageData - 32×32 RGBA image data
+ * @param {number} [captureMs]  - when the image was rendered
  */
-export function sendImageData(imageData) {
+export function sendImageData(imageData, captureMs = performance.now()) {
     if (!isConnected()) return
 
     const pixels = imageData.data
@@ -158,11 +228,99 @@ export function sendImageData(imageData) {
         PIXEL_BUFFER[idx++] = (rgb16 >> 8) & 0xFF // high byte
         PIXEL_BUFFER[idx++] = rgb16 & 0xFF         // low byte
     }
+    sendFrame(captureMs)
+}
+
+/**
+ * The RGB565 frame sendFrame() sends: 2048 bytes, big-endian, panel
+ * orientation. Fill it in place each frame.
+ * @returns {Uint8Array}
+ */
+export function getFrameBuffer() {
+    return PIXEL_BUFFER
+}
+
+/**
+ * Send the frame in getFrameBuffer() (as a tile delta, palette frame or
+ * bare RGB565, whatever the matrix decodes) — or, while the socket is
+ * still draining earlier frames, leave it waiting there: it goes out once
+ * the socket is ready, unless a newer sendFrame() replaces it first.
+ * @param {number} [captureMs] - when the image was rendered
+ */
+export function sendFrame(captureMs = performance.now()) {
+    if (!isConnected()) return
+
+    if (framePending) pacer.coalesce()
+    framePending = true
+    pendingCapture = captureMs
+    holdPending = false // the water moved again
+    flushFrame()
+}
+
+/**
+ * Uplink counters for the log.
+ * @returns {{ frames: number, coalesced: number, bytes: number,
+ *             targetFps: number, drainRate: number, queuedBytes: number }}
+ *          frames/coalesced/bytes: running totals; drainRate: bytes/s
+ */
+export function getSendStats() {
+    return { ...pacer.stats(), queuedBytes: socket ? socket.bufferedAmount : 0 }
+}
+
+/** Send the waiting frame if the socket has drained; otherwise retry soon. */
+function flushFrame() {
+    if (!framePending) return
+    if (!isConnected()) {
+        dropPendingFrame()
+        return
+    }
+
+    const now = performance.now()
+    if (!pacer.ready(now, socket.bufferedAmount)) {
+        flushTimer ??= setTimeout(() => {
+            flushTimer = null
+            flushFrame()
+        }, FLUSH_INTERVAL)
+        return
+    }
+
+    framePending = false
+    const bytes = transmitFrame(pendingCapture)
+    if (bytes) pacer.sent(now, bytes)
+    if (holdPending) {
+        holdPending = false
+        sendEvent({ type: 'hold' })
+    }
+}
+
+function dropPendingFrame() {
+    framePending = false
+    holdPending = false
+    clearTimeout(flushTimer)
+    flushTimer = null
+}
+
+/** @returns {number} bytes sent (0: nothing changed, or the send failed) */
+function transmitFrame(captureMs) {
+    let payload = PIXEL_BUFFER
+    if (useTileDeltas) {
+        payload = deltaEncoder.encode(PIXEL_BUFFER)
+        if (!payload) return 0
+    } else if (usePalette) {
+        const length = encodePalette565(PIXEL_BUFFER, PALETTE_BUFFER)
+        if (length) payload = PALETTE_BUFFER.subarray(0, length)
+    }
+    if (useFrameHeader) {
+        payload = wrapFrame(payload, frameSequence, captureMs, HEADER_BUFFER)
+        frameSequence = (frameSequence + 1) & 0xFFFF
+    }
 
     try {
-        socket.send(PIXEL_BUFFER.buffer)
+        socket.send(payload)
+        return payload.length
     } catch (err) {
         console.warn('WSS send skipped:', err.message)
+        return 0
     }
 }
 
@@ -183,6 +341,56 @@ export function sendDrop(x, y, strength, radius, r, g, b) {
     }
 }
 
+/**
+ * Send the local tint so a matrix rendering locally can follow color changes.
+ */
+export function sendTint(r, g, b) {
+    sendEvent({ type: 'tint', r, g, b })
+}
+
+/**
+ * Send simulation parameters (damping, render gain) to the paired matrix.
+ */
+export function sendParams(waveDamp, renderGain) {
+    sendEvent({ type: 'params', waveDamp, renderGain })
+}
+
+/**
+ * Ask the paired matrix to reset its water.
+ */
+export function sendReset() {
+    sendEvent({ type: 'reset' })
+}
+
+/**
+ * Tell the paired matrix the water is flat: no frames until the next
+ * drop, keep showing the last one. Sent after the flat frame, if that one
+ * is still waiting for the socket.
+ */
+export function sendHold() {
+    if (framePending) holdPending = true
+    else sendEvent({ type: 'hold' })
+}
+
+/**
+ * Tell the server our lockstep water is flat from `tick` on, with every
+ * event applied: once everyone's is, it stops sending beats.
+ * @param {number} tick - the next tick to simulate
+ */
+export function sendLockstepHold(tick) {
+    sendEvent({ type: 'hold', tick })
+}
+
+function sendEvent(msg) {
+    if (!isConnected()) return
+
+    try {
+        socket.send(JSON.stringify(msg))
+    } catch (err) {
+        console.warn(`WSS ${msg.type} skipped:`, err.message)
+    }
+}
+
 /**
  * Convert 8-bit RGB to 16-bit RGB565.
  * Pack into: RRRRRGGG GGGBBBBB
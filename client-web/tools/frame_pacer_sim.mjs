@@ -0,0 +1,165 @@
+/**
+ * Uplink pacing check — drives client-web/js/frame_pacer.js the way wss.js
+ * does (a render every 32 ms, one pending frame, retries every 8 ms) against
+ * a fake socket whose bufferedAmount drains at a fixed link rate, on a
+ * virtual clock.
+ *
+ * Usage (from client-web/):
+ *   node tools/frame_pacer_sim.mjs            # exits 1 if a paced link fails
+ *
+ * Every link is also played unpaced, for comparison. A paced link fails if,
+ * after the first WARMUP_MS, p95 capture-to-drained latency exceeds
+ * MAX_P95_MS, any frame exceeds MAX_LATENCY_MS, or it carries less than
+ * MIN_UTILISATION of what the link (or the renderer, if slower) allows.
+ */
+
+import { readFileSync } from 'fs'
+
+const source = readFileSync(new URL('../js/frame_pacer.js', import.meta.url), 'utf8')
+const { FramePacer } = await import('data:text/javascript,' + encodeURIComponent(source))
+
+const RENDER_MS = 32         // sim_worker.js: SEND_EVERY_TICKS × 16 ms
+const FLUSH_INTERVAL = 8     // wss.js
+const FRAME_BYTES = 2048     // bare RGB565
+const DURATION_MS = 60000
+const WARMUP_MS = 5000
+
+const MAX_P95_MS = 500
+const MAX_LATENCY_MS = 1000
+const MIN_UTILISATION = 0.8
+
+/** bufferedAmount that drains at `rate(now)` bytes/s, FIFO. */
+class FakeSocket {
+    constructor(rate) {
+        this.rate = rate
+        this.queue = []      // { capture, remaining }
+        this.buffered = 0
+    }
+
+    get bufferedAmount() {
+        return Math.ceil(this.buffered)
+    }
+
+    send(capture, bytes) {
+        this.queue.push({ capture, remaining: bytes })
+        this.buffered += bytes
+    }
+
+    /** Advance 1 ms; returns the capture times of frames that fully left. */
+    drain(now) {
+        let budget = this.rate(now) / 1000
+        const done = []
+        while (budget > 0 && this.queue.length) {
+            const head = this.queue[0]
+            const take = Math.min(budget, head.remaining)
+            head.remaining -= take
+            this.buffered -= take
+            budget -= take
+            if (head.remaining <= 1e-9) {
+                this.queue.shift()
+                done.push(head.capture)
+            }
+        }
+        if (!this.queue.length) this.buffered = 0
+        return done
+    }
+}
+
+function percentile(sorted, p) {
+    return sorted.length ? sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))] : 0
+}
+
+/** Play one link for DURATION_MS; `paced` false sends every render straight away. */
+function play(rate, frameBytes, paced) {
+    const socket = new FakeSocket(rate)
+    const pacer = new FramePacer()
+    pacer.reset(0)
+
+    let pending = false
+    let pendingCapture = 0
+    let retryAt = Infinity
+    let renders = 0
+    const latencies = []
+    let delivered = 0   // bytes drained after warmup
+    let capacity = 0    // bytes the link could have drained after warmup
+    let offered = 0     // bytes rendered after warmup
+
+    const flush = (now) => {
+        if (!pending) return
+        if (paced && !pacer.ready(now, socket.bufferedAmount)) {
+            if (retryAt === Infinity) retryAt = now + FLUSH_INTERVAL
+            return
+        }
+        pending = false
+        const bytes = frameBytes(renders)
+        socket.send(pendingCapture, bytes)
+        pacer.sent(now, bytes)
+    }
+
+    for (let now = 0; now < DURATION_MS; now++) {
+        if (now % RENDER_MS === 0) {
+            if (pending) pacer.coalesce()
+            pending = true
+            pendingCapture = now
+            renders++
+            if (now >= WARMUP_MS) offered += frameBytes(renders)
+            flush(now)
+        }
+        if (now >= retryAt) {
+            retryAt = Infinity
+            flush(now)
+        }
+
+        const before = socket.buffered
+        for (const capture of socket.drain(now)) {
+            if (capture >= WARMUP_MS) latencies.push(now - capture)
+        }
+        if (now >= WARMUP_MS) {
+            delivered += before - socket.buffered
+            capacity += rate(now) / 1000
+        }
+    }
+
+    latencies.sort((a, b) => a - b)
+    return {
+        p50: percentile(latencies, 0.5),
+        p95: percentile(latencies, 0.95),
+        max: latencies.length ? latencies[latencies.length - 1] : 0,
+        fps: latencies.length * 1000 / (DURATION_MS - WARMUP_MS),
+        utilisation: delivered / Math.min(capacity, offered),
+        backlog: socket.bufferedAmount,
+    }
+}
+
+const KiB = 1024
+const fixed = () => FRAME_BYTES
+// Tile deltas and palette frames: anywhere from a few tiles to a full frame
+const mixed = (n) => 256 + ((Math.imul(n, 2654435761) >>> 0) % (FRAME_BYTES - 256))
+
+const links = [
+    { name: '8 KiB/s', rate: () => 8 * KiB, frameBytes: fixed },
+    { name: '16 KiB/s', rate: () => 16 * KiB, frameBytes: fixed },
+    { name: '24 KiB/s', rate: () => 24 * KiB, frameBytes: fixed },
+    { name: '40 KiB/s', rate: () => 40 * KiB, frameBytes: fixed },
+    { name: '128 KiB/s', rate: () => 128 * KiB, frameBytes: fixed },
+    { name: '16 KiB/s mixed', rate: () => 16 * KiB, frameBytes: mixed },
+    // Congestion comes and goes: 40 → 8 → 40 KiB/s every 10 s
+    { name: '40/8 KiB/s step', rate: (now) => (Math.floor(now / 10000) % 2 ? 8 : 40) * KiB, frameBytes: fixed },
+]
+
+let failed = 0
+console.log(`${'link'.padEnd(16)} ${'mode'.padEnd(7)} ${'p50 ms'.padStart(8)} ${'p95 ms'.padStart(8)} ${'max ms'.padStart(8)} ${'fps'.padStart(6)} ${'util'.padStart(6)} ${'backlog'.padStart(8)}`)
+for (const link of links) {
+    for (const paced of [false, true]) {
+        const r = play(link.rate, link.frameBytes, paced)
+        console.log(`${link.name.padEnd(16)} ${(paced ? 'paced' : 'unpaced').padEnd(7)} ${String(r.p50).padStart(8)} ${String(r.p95).padStart(8)} ${String(r.max).padStart(8)} ${r.fps.toFixed(1).padStart(6)} ${r.utilisation.toFixed(2).padStart(6)} ${String(r.backlog).padStart(8)}`)
+        if (!paced) continue
+        if (r.p95 > MAX_P95_MS || r.max > MAX_LATENCY_MS || r.utilisation < MIN_UTILISATION) {
+            console.log(`FAIL ${link.name}: p95 ${r.p95} ms (limit ${MAX_P95_MS}), max ${r.max} ms (limit ${MAX_LATENCY_MS}), utilisation ${r.utilisation.toFixed(2)} (floor ${MIN_UTILISATION})`)
+            failed++
+        }
+    }
+}
+
+console.log(failed ? 'FAIL' : 'PASS')
+process.exit(failed ? 1 : 0)
@@ -9,11 +9,44 @@
  *   2. Client sends JSON: { "type": "join", "role": "phone"|"matrix", "pair": 1|2 }
  *   3. Phone sends binary frames (RGB565) → server forwards to paired matrix
  *   4. Server sends JSON status updates back to clients
+ *   5. A matrix that joins with "render": "local" simulates the water itself:
+ *      it gets drop/tint/params/reset events instead of frames
+ *   6. A matrix lists the binary formats it decodes in "formats" (default
+ *      ["rgb565"]); the phone only sends tile deltas / palette frames if
+ *      "tiles565" / "pal565" is there
+ *   7. A matrix that joins with "frameHeader": 1 gets every binary frame
+ *      behind a sequence / capture-time header (see frame_format.h)
+ *   8. A client that joins with "lockstep": 1 gets every phone's
+ *      drop/tint/params/reset, stamped with the simulation tick to apply it
+ *      at and tagged "layer": "local" (its own pair) or "remote", plus
+ *      { "type": "tick", "tick": n } beats: every event up to tick n has
+ *      been sent. Each lockstep join is announced to all lockstep clients
+ *      as a stamped reset without a layer, where everyone restarts the
+ *      water (client-web/js/lockstep.js). A lockstep client that lost or
+ *      missed an event sends { "type": "resync" } and gets the same sync
+ *      point: at once, or LOCKSTEP_RESYNC_MS after the last requested one,
+ *      shared with everyone else who asked meanwhile (never dropped). A
+ *      lockstep client whose water has gone flat with every event applied
+ *      sends { "type": "hold", "tick": n } (n: its next tick); while all
+ *      of them have, past the last stamped event, the beats pause, and the next
+ *      event goes out with a beat at once (flat water skips to it)
+ *   9. A phone whose water has gone flat sends { "type": "hold" } after its
+ *      last frame; a streaming matrix keeps showing that frame until frames
+ *      resume (no frames meanwhile is not a stall)
+ *  10. If the server runs a UDP relay (UDP_PORT), a streaming matrix that
+ *      joins with "udp": 1 gets "udpPort" and "udpToken" in "joined" and
+ *      registers by sending the token to that port (client-matrix
+ *      udp_frames.h). While it keeps registering, its frames go there as
+ *      sequence-numbered datagrams instead of over the WebSocket, and it
+ *      is never sent tile deltas (a lost datagram must not corrupt later
+ *      frames). Everything else stays on the WebSocket
  */
 
 const path = require('path')
 const express = require('express')
 const http = require('http')
+const dgram = require('dgram')
+const crypto = require('crypto')
 const { WebSocketServer } = require('ws')
 
 // ─── Configuration ───────────────────────────────────────────────────────────
@@ -22,11 +55,33 @@ const PORT = process.env.PORT || 3000
 const HEARTBEAT_INTERVAL = 30_000 // 30s ping interval
 const VALID_PAIRS = [1, 2]
 const VALID_ROLES = ['phone', 'matrix']
+const MATRIX_EVENTS = ['tint', 'params', 'reset'] // phone → own matrix only
+const FRAME_FORMATS = ['rgb565', 'tiles565', 'pal565']
+const DEFAULT_FORMATS = ['rgb565']
+const LOCKSTEP_TICK_MS = 16 // one water step (WATER_STEP_MS)
+const LOCKSTEP_BEAT_MS = 32 // horizon beats, every other tick
+const LOCKSTEP_RESYNC_MS = 500 // requested sync points, at most one per (later asks wait)
+const UDP_PORT = Number(process.env.UDP_PORT) || 0 // 0: no UDP relay (Render has none)
+const UDP_MAGIC = 0xd7
+const UDP_TYPE_REGISTER = 0x00
+const UDP_TYPE_FRAME = 0x01
+const UDP_CHUNK_BYTES = 1400
+const UDP_MAX_CHUNKS = 4
+const UDP_STALE_MS = 10_000 // no registration for this long: back to the WebSocket
 
 // ─── Express App ─────────────────────────────────────────────────────────────
 
 const app = express()
 
+// Cross-origin isolation: lets the web client share its preview frame with
+// its simulation worker (SharedArrayBuffer). "credentialless" rather than
+// "require-corp" so the MediaPipe CDN, model and fonts load as they are
+app.use((_req, res, next) => {
+    res.set('Cross-Origin-Opener-Policy', 'same-origin')
+    res.set('Cross-Origin-Embedder-Policy', 'credentialless')
+    next()
+})
+
 // Serve the smartphone web client
 const clientPath = path.join(__dirname, '..', 'client-web')
 app.use(express.static(clientPath))
@@ -44,11 +99,19 @@ const wss = new WebSocketServer({ server, path: '/ws' })
 // ─── Pair State ──────────────────────────────────────────────────────────────
 
 /**
- * pairs[pairId] = { phone: WebSocket | null, matrix: WebSocket | null }
+ * pairs[pairId] = {
+ *   phone: WebSocket | null,
+ *   matrix: WebSocket | null,
+ *   matrixRender: 'stream' | 'local'  — how the matrix gets its image
+ *   matrixFormats: string[]           — binary formats the matrix decodes
+ *   matrixFrameHeader: number         — frame header version (0 = none)
+ *   matrixUdp: { token, address, port, seq, lastSeen } | null
+ *                                      — UDP relay registration (see protocol 10)
+ * }
  */
 const pairs = {
-    1: { phone: null, matrix: null },
-    2: { phone: null, matrix: null }
+    1: { phone: null, matrix: null, matrixRender: 'stream', matrixFormats: DEFAULT_FORMATS, matrixFrameHeader: 0, matrixUdp: null },
+    2: { phone: null, matrix: null, matrixRender: 'stream', matrixFormats: DEFAULT_FORMATS, matrixFrameHeader: 0, matrixUdp: null }
 }
 
 /** Return a summary of pair connection status. */
@@ -70,6 +133,104 @@ function sendJSON(ws, data) {
     }
 }
 
+// ─── Lockstep ────────────────────────────────────────────────────────────────
+
+const lockstepEpoch = Date.now()
+let lastStampedTick = 0
+let lastResyncAt = 0
+let resyncTimer = null
+let beatsHeld = false
+
+/** Simulation tick the server clock is in. */
+function serverTick() {
+    return Math.floor((Date.now() - lockstepEpoch) / LOCKSTEP_TICK_MS)
+}
+
+/** Tick for a new event: in the future of every beat sent, never before an earlier event. */
+function stampTick() {
+    lastStampedTick = Math.max(lastStampedTick, serverTick() + 1)
+    return lastStampedTick
+}
+
+/** Last tick no event can be stamped with any more. */
+function horizonTick() {
+    return Math.max(serverTick(), lastStampedTick - 1)
+}
+
+/** Registered clients that joined with "lockstep": 1, with their pair. */
+function lockstepClients() {
+    const clients = []
+    for (const id of VALID_PAIRS) {
+        for (const role of VALID_ROLES) {
+            const ws = pairs[id][role]
+            if (ws && ws.lockstep) clients.push({ ws, pair: id })
+        }
+    }
+    return clients
+}
+
+/** Send every lockstep client the horizon: every event up to there has been sent. */
+function sendBeat(clients) {
+    const tick = horizonTick()
+    for (const { ws } of clients) {
+        sendJSON(ws, { type: 'tick', tick })
+    }
+}
+
+/** Whether every lockstep client's water is flat past the last stamped event. */
+function allHolding(clients) {
+    return clients.every(({ ws }) => ws.holdTick > lastStampedTick)
+}
+
+/** After a pause, vouch for the ticks up to a new event at once: flat water skips to it. */
+function resumeBeats(clients) {
+    if (!beatsHeld) return
+    beatsHeld = false
+    sendBeat(clients)
+}
+
+/** Stamp a phone event and send it to every lockstep client, the sender included. */
+function broadcastLockstep(msg, fromPair) {
+    const clients = lockstepClients()
+    if (clients.length === 0) return
+
+    const tick = stampTick()
+    for (const { ws, pair } of clients) {
+        sendJSON(ws, { ...msg, tick, layer: pair === fromPair ? 'local' : 'remote' })
+    }
+    resumeBeats(clients)
+}
+
+/** Everyone restarts the water at a common tick (a client joined the log). */
+function broadcastSyncPoint() {
+    const clients = lockstepClients()
+    const tick = stampTick()
+    for (const { ws } of clients) {
+        sendJSON(ws, { type: 'reset', tick })
+    }
+    resumeBeats(clients)
+}
+
+/**
+ * A client left the log: a sync point for everyone, now or once
+ * LOCKSTEP_RESYNC_MS have passed since the last requested one. Every ask
+ * until then is answered by that same sync point.
+ */
+function scheduleResync() {
+    if (resyncTimer) return
+    const wait = Math.max(0, lastResyncAt + LOCKSTEP_RESYNC_MS - Date.now())
+    resyncTimer = setTimeout(() => {
+        resyncTimer = null
+        lastResyncAt = Date.now()
+        broadcastSyncPoint()
+    }, wait)
+}
+
+/** Send a JSON message only to a client on the legacy (unstamped) protocol. */
+function sendLegacy(ws, data) {
+    if (ws && !ws.lockstep) sendJSON(ws, data)
+}
+
 /** Notify both members of a pair about the current connection status. */
 function notifyPairStatus(pairId) {
     const pair = pairs[pairId]
@@ -77,12 +238,63 @@ function notifyPairStatus(pairId) {
         type: 'status',
         pair: pairId,
         phone: pair.phone !== null,
-        matrix: pair.matrix !== null
+        matrix: pair.matrix !== null,
+        matrixRender: pair.matrixRender,
+        matrixFormats: pair.matrixFormats,
+        matrixFrameHeader: pair.matrixFrameHeader
     }
     sendJSON(pair.phone, status)
     sendJSON(pair.matrix, status)
 }
 
+// ─── UDP Relay ───────────────────────────────────────────────────────────────
+
+const udp = UDP_PORT ? dgram.createSocket('udp4') : null
+
+if (udp) {
+    // Registration: [magic, type, token u32 BE] — remember where the matrix is
+    udp.on('message', (msg, rinfo) => {
+        if (msg.length !== 6 || msg[0] !== UDP_MAGIC || msg[1] !== UDP_TYPE_REGISTER) return
+        const token = msg.readUInt32BE(2)
+        for (const id of VALID_PAIRS) {
+            const reg = pairs[id].matrixUdp
+            if (reg && reg.token === token) {
+                if (reg.address !== rinfo.address || reg.port !== rinfo.port) {
+                    console.log(`[Pair ${id}] matrix UDP at ${rinfo.address}:${rinfo.port}`)
+                }
+                reg.address = rinfo.address
+                reg.port = rinfo.port
+                reg.lastSeen = Date.now()
+            }
+        }
+    })
+    udp.on('error', (err) => {
+        console.error('UDP error:', err.message)
+    })
+}
+
+/**
+ * Relay a phone frame to its matrix over UDP, chunked so no datagram is
+ * IP-fragmented.
+ * @returns {boolean} false if the matrix isn't (or no longer) registered
+ */
+function sendUdpFrame(pair, data) {
+    const reg = pair.matrixUdp
+    if (!udp || !reg || !reg.port || Date.now() - reg.lastSeen > UDP_STALE_MS) return false
+
+    const count = Math.max(1, Math.ceil(data.length / UDP_CHUNK_BYTES))
+    if (count > UDP_MAX_CHUNKS) return false
+
+    const seq = reg.seq
+    reg.seq = (reg.seq + 1) & 0xffff
+    for (let index = 0; index < count; index++) {
+        const chunk = data.subarray(index * UDP_CHUNK_BYTES, (index + 1) * UDP_CHUNK_BYTES)
+        const header = Buffer.from([UDP_MAGIC, UDP_TYPE_FRAME, seq >> 8, seq & 0xff, index, count])
+        udp.send([header, chunk], reg.port, reg.address)
+    }
+    return true
+}
+
 // ─── WebSocket Connection Handler ────────────────────────────────────────────
 
 wss.on('connection', (ws) => {
@@ -97,6 +309,7 @@ wss.on('connection', (ws) => {
         if (isBinary) {
             if (clientRole === 'phone' && clientPair) {
                 const target = pairs[clientPair].matrix
+                if (sendUdpFrame(pairs[clientPair], data)) return
                 if (target && target.readyState === 1) {
                     target.send(data, { binary: true })
                 }
@@ -126,9 +339,51 @@ wss.on('connection', (ws) => {
             const targetPairId = clientPair === 1 ? 2 : 1
             const targetPhone = pairs[targetPairId].phone
             
-            if (targetPhone && targetPhone.readyState === 1) {
-                // Forward the drop message
-                sendJSON(targetPhone, msg)
+            // Forward the drop message
+            sendLegacy(targetPhone, msg)
+
+            // Matrices rendering locally: the sender's matrix gets it on its
+            // local layer, the other pair's matrix on its remote layer
+            if (clientPair) {
+                const own = pairs[clientPair]
+                if (own.matrixRender === 'local') {
+                    sendLegacy(own.matrix, { ...msg, layer: 'local' })
+                }
+                if (pairs[targetPairId].matrixRender === 'local') {
+                    sendLegacy(pairs[targetPairId].matrix, { ...msg, layer: 'remote' })
+                }
+                broadcastLockstep(msg, clientPair)
+            }
+            return
+        }
+
+        if (msg.type === 'hold') {
+            // Lockstep: this client's water is flat from msg.tick on
+            if (Number.isInteger(msg.tick)) {
+                if (ws.lockstep) ws.holdTick = msg.tick
+                return
+            }
+            if (clientRole === 'phone' && clientPair && pairs[clientPair].matrixRender === 'stream') {
+                sendLegacy(pairs[clientPair].matrix, msg)
+            }
+            return
+        }
+
+        if (msg.type === 'resync') {
+            // A lockstep client left the log: restart everyone at a common tick
+            if (ws.lockstep) {
+                console.log(`[Pair ${clientPair}] ${clientRole} asked for a sync point`)
+                scheduleResync()
+            }
+            return
+        }
+
+        if (MATRIX_EVENTS.includes(msg.type)) {
+            if (clientRole === 'phone' && clientPair) {
+                if (pairs[clientPair].matrixRender === 'local') {
+                    sendLegacy(pairs[clientPair].matrix, msg)
+                }
+                broadcastLockstep(msg, clientPair)
             }
             return
         }
@@ -165,11 +420,33 @@ wss.on('connection', (ws) => {
             clientRole = role
             clientPair = pair
             pairs[pair][role] = ws
+            ws.lockstep = msg.lockstep === 1
+            ws.holdTick = -1
+            if (role === 'matrix') {
+                pairs[pair].matrixRender = msg.render === 'local' ? 'local' : 'stream'
+                pairs[pair].matrixFormats = Array.isArray(msg.formats)
+                    ? FRAME_FORMATS.filter((f) => msg.formats.includes(f))
+                    : DEFAULT_FORMATS
+                pairs[pair].matrixFrameHeader = msg.frameHeader === 1 ? 1 : 0
+                pairs[pair].matrixUdp = null
+                if (udp && msg.udp === 1 && pairs[pair].matrixRender === 'stream') {
+                    pairs[pair].matrixUdp = { token: crypto.randomBytes(4).readUInt32BE(0), address: null, port: 0, seq: 0, lastSeen: 0 }
+                    pairs[pair].matrixFormats = pairs[pair].matrixFormats.filter((f) => f !== 'tiles565')
+                }
+            }
 
             console.log(`[Pair ${pair}] ${role} joined`)
 
-            sendJSON(ws, { type: 'joined', role, pair })
+            const joined = { type: 'joined', role, pair }
+            if (role === 'matrix' && pairs[pair].matrixUdp) {
+                joined.udpPort = UDP_PORT
+                joined.udpToken = pairs[pair].matrixUdp.token
+            }
+            sendJSON(ws, joined)
             notifyPairStatus(pair)
+            if (ws.lockstep) {
+                broadcastSyncPoint()
+            }
         }
     })
 
@@ -177,6 +454,7 @@ wss.on('connection', (ws) => {
         if (clientPair && clientRole) {
             if (pairs[clientPair][clientRole] === ws) {
                 pairs[clientPair][clientRole] = null
+                if (clientRole === 'matrix') pairs[clientPair].matrixUdp = null
                 console.log(`[Pair ${clientPair}] ${clientRole} disconnected`)
                 notifyPairStatus(clientPair)
             }
@@ -201,8 +479,22 @@ const heartbeat = setInterval(() => {
     })
 }, HEARTBEAT_INTERVAL)
 
+// Lockstep horizon beats, paused while everyone's water is flat
+const beat = setInterval(() => {
+    const clients = lockstepClients()
+    if (clients.length === 0) return
+
+    if (allHolding(clients)) {
+        beatsHeld = true
+        return
+    }
+    sendBeat(clients)
+}, LOCKSTEP_BEAT_MS)
+
 wss.on('close', () => {
     clearInterval(heartbeat)
+    clearInterval(beat)
+    clearTimeout(resyncTimer)
 })
 
 // ─── Start ───────────────────────────────────────────────────────────────────
@@ -212,3 +504,9 @@ server.listen(PORT, () => {
     console.log(`  → Web client: http://localhost:${PORT}`)
     console.log(`  → WebSocket:  ws://localhost:${PORT}/ws`)
 })
+
+if (udp) {
+    udp.bind(UDP_PORT, () => {
+        console.log(`  → UDP relay:  port ${UDP_PORT}`)
+    })
+}